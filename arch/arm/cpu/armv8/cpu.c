@@ -13,6 +13,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <smp_work.h>
 #include <asm/system.h>
 #include <linux/compiler.h>
 
@@ -24,6 +25,7 @@ int cleanup_before_linux(void)
 	 *
 	 * disable interrupt and turn off caches etc ...
 	 */
+	smp_work_stop();
 	disable_interrupts();
 
 	/*
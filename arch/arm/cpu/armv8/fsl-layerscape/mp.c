@@ -5,8 +5,11 @@
  */
 
 #include <common.h>
+#include <malloc.h>
+#include <smp_work.h>
 #include <asm/io.h>
 #include <asm/system.h>
+#include <asm/armv8/mmu.h>
 #include <asm/arch/mp.h>
 #include <asm/arch/soc.h>
 #include "cpu.h"
@@ -255,6 +258,9 @@ int cpu_release(int nr, int argc, char * const argv[])
 	if (pos <= 0)
 		return -1;
 
+	/* Bring the core back to the spin loop if it is running jobs */
+	smp_work_stop();
+
 	table += pos * WORDS_PER_SPIN_TABLE_ENTRY;
 	boot_addr = simple_strtoull(argv[0], NULL, 16);
 	table[SPIN_TABLE_ELEM_ENTRY_ADDR_IDX] = boot_addr;
@@ -271,3 +277,106 @@ int cpu_release(int nr, int argc, char * const argv[])
 
 	return 0;
 }
+
+#if defined(CONFIG_SMP_WORK) && !defined(CONFIG_SPL_BUILD)
+#define SMP_WORK_STACK_SIZE	(16 << 10)
+
+static void *smp_work_stacks;
+
+/*
+ * Called on a secondary core from the spin loop in lowlevel.S, with the
+ * stack and gd taken from its spin table element. The core turns on its MMU
+ * and caches, using the boot core's page tables, to run jobs. It turns them
+ * off again before returning to the spin loop.
+ */
+void fsl_layerscape_smp_work(u64 *table)
+{
+	u64 *base = get_spin_tbl_addr();
+	unsigned int sctlr = get_sctlr();
+	int el = current_el();
+
+	__asm_invalidate_tlb_all();
+	set_ttbr_tcr_mair(el, table[SPIN_TABLE_ELEM_WORK_TTBR_IDX],
+			  table[SPIN_TABLE_ELEM_WORK_TCR_IDX],
+			  MEMORY_ATTRIBUTES);
+	set_sctlr(sctlr | CR_M | CR_C | CR_I);
+
+	smp_work_run((table - base) / WORDS_PER_SPIN_TABLE_ENTRY);
+
+	set_sctlr(sctlr);
+	__asm_flush_dcache_all();
+	__asm_invalidate_tlb_all();
+}
+
+int smp_work_arch_start(void)
+{
+	u64 *table = get_spin_tbl_addr();
+	ulong table_end = (ulong)table + CONFIG_MAX_CPUS * SPIN_TABLE_ELEM_SIZE;
+	ulong size = CONFIG_MAX_CPUS * SMP_WORK_STACK_SIZE;
+	int el = current_el();
+	int i, count = 0;
+	u64 *elem;
+
+	if (!smp_work_stacks) {
+		smp_work_stacks = memalign(ARCH_DMA_MINALIGN, size);
+		if (!smp_work_stacks)
+			return -ENOMEM;
+	}
+	/* The cores use their stacks before turning on their caches */
+	flush_dcache_range((ulong)smp_work_stacks,
+			   (ulong)smp_work_stacks + size);
+	flush_dcache_range((ulong)table, table_end);
+
+	for (i = 1; i < CONFIG_MAX_CPUS; i++) {
+		elem = table + i * WORDS_PER_SPIN_TABLE_ENTRY;
+		/* Skip cores which are not up, or released by 'cpu release' */
+		if (elem[SPIN_TABLE_ELEM_STATUS_IDX] != 1 ||
+		    elem[SPIN_TABLE_ELEM_ENTRY_ADDR_IDX])
+			continue;
+		elem[SPIN_TABLE_ELEM_WORK_GD_IDX] = (ulong)gd;
+		elem[SPIN_TABLE_ELEM_WORK_TTBR_IDX] = gd->arch.tlb_addr;
+		elem[SPIN_TABLE_ELEM_WORK_TCR_IDX] = get_tcr(el, NULL, NULL);
+		elem[SPIN_TABLE_ELEM_WORK_SP_IDX] = (ulong)smp_work_stacks +
+				(i + 1) * SMP_WORK_STACK_SIZE;
+		count++;
+	}
+	if (!count)
+		return 0;
+
+	flush_dcache_range((ulong)table, table_end);
+	asm volatile("dsb st");
+	smp_kick_all_cpus();
+	asm volatile("sev");
+
+	return count;
+}
+
+void smp_work_arch_stop(void)
+{
+	u64 *table = get_spin_tbl_addr();
+	bool busy;
+	int i;
+
+	/* Each core clears its stack pointer once it is back in the loop */
+	do {
+		flush_dcache_range((ulong)table, (ulong)table +
+				   CONFIG_MAX_CPUS * SPIN_TABLE_ELEM_SIZE);
+		busy = false;
+		for (i = 1; i < CONFIG_MAX_CPUS; i++) {
+			if (table[i * WORDS_PER_SPIN_TABLE_ENTRY +
+				  SPIN_TABLE_ELEM_WORK_SP_IDX])
+				busy = true;
+		}
+	} while (busy);
+}
+
+void smp_work_arch_kick(void)
+{
+	asm volatile("dsb ish\n\tsev" : : : "memory");
+}
+
+void smp_work_arch_idle(int cpu)
+{
+	asm volatile("wfe" : : : "memory");
+}
+#endif
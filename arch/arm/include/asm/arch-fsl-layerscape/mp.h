@@ -14,14 +14,25 @@
 *      uint64_t status;
 *      uint64_t lpid;
 *      uint64_t os_arch;
+*      uint64_t work_sp;
+*      uint64_t work_gd;
+*      uint64_t work_ttbr;
+*      uint64_t work_tcr;
 * };
 * we pad this struct to 64 bytes so each entry is in its own cacheline
 * the actual spin table is an array of these structures
+*
+* work_sp is set while U-Boot is running jobs on the core (CONFIG_SMP_WORK),
+* and cleared by the core when it is back in the spin loop
 */
 #define SPIN_TABLE_ELEM_ENTRY_ADDR_IDX	0
 #define SPIN_TABLE_ELEM_STATUS_IDX	1
 #define SPIN_TABLE_ELEM_LPID_IDX	2
 #define SPIN_TABLE_ELEM_OS_ARCH_IDX	3
+#define SPIN_TABLE_ELEM_WORK_SP_IDX	4
+#define SPIN_TABLE_ELEM_WORK_GD_IDX	5
+#define SPIN_TABLE_ELEM_WORK_TTBR_IDX	6
+#define SPIN_TABLE_ELEM_WORK_TCR_IDX	7
 #define WORDS_PER_SPIN_TABLE_ENTRY	8	/* pad to 64 bytes */
 #define SPIN_TABLE_ELEM_SIZE		64
 
@@ -39,6 +50,7 @@ static inline int fsl_layerscape_wake_seconday_cores(void) { return 1; }
 void *get_spin_tbl_addr(void);
 phys_addr_t determine_mp_bootpg(void);
 void secondary_boot_func(void);
+void fsl_layerscape_smp_work(u64 *table);
 int is_core_online(u64 cpu_id);
 #endif
 
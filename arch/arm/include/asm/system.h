@@ -175,6 +175,19 @@ static inline unsigned long read_mpidr(void)
 	return val;
 }
 
+#define ID_AA64ISAR0_SHA2_MASK		(0xf << 12)
+#define ID_AA64ISAR0_CRC32_MASK		(0xf << 16)
+
+/* Instruction set extensions implemented by the CPU */
+static inline unsigned long read_id_aa64isar0(void)
+{
+	unsigned long val;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (val));
+
+	return val;
+}
+
 #define BSP_COREID	0
 
 void __asm_flush_dcache_all(void);
@@ -22,6 +22,7 @@
  */
 
 #include <common.h>
+#include <smp_work.h>
 
 __weak void reset_misc(void)
 {
@@ -31,6 +32,9 @@ int do_reset(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	puts ("resetting ...\n");
 
+	/* Some resets only reach the boot CPU, so park the others first */
+	smp_work_stop();
+
 	udelay (50000);				/* wait 50 ms */
 
 	disable_interrupts();
@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <libfdt.h>
 #include <os.h>
+#include <smp_work.h>
 #include <asm/io.h>
 #include <asm/state.h>
 #include <dm/root.h>
@@ -99,6 +100,37 @@ void flush_dcache_range(unsigned long start, unsigned long stop)
 {
 }
 
+void invalidate_dcache_range(unsigned long start, unsigned long stop)
+{
+}
+
+#ifdef CONFIG_SMP_WORK
+/* Secondary CPUs are host threads, which wait for events much like 'wfe' */
+#define SANDBOX_SMP_CPUS	4
+
+static unsigned long smp_events_seen[SANDBOX_SMP_CPUS];
+
+int smp_work_arch_start(void)
+{
+	return os_cpu_start(SANDBOX_SMP_CPUS - 1, smp_work_run);
+}
+
+void smp_work_arch_stop(void)
+{
+	os_cpu_stop();
+}
+
+void smp_work_arch_kick(void)
+{
+	os_cpu_send_event();
+}
+
+void smp_work_arch_idle(int cpu)
+{
+	os_cpu_wait_event(&smp_events_seen[cpu]);
+}
+#endif
+
 int sandbox_read_fdt_from_file(void)
 {
 	struct sandbox_state *state = state_get_current();
@@ -221,14 +221,23 @@ int sandbox_eth_raw_os_recv(void *packet, int *length,
 {
 	int retval;
 	int saddr_size;
+	int size;
 
 	if (!priv->sd || !priv->device)
 		return -EINVAL;
+	size = *length;
+	*length = 0;
+
+	/* Leave a packet which does not fit, so it can be read elsewhere */
+	if (size < 1536) {
+		retval = recv(priv->sd, NULL, 0, MSG_PEEK | MSG_TRUNC);
+		if (retval > size)
+			return -EMSGSIZE;
+	}
 	saddr_size = sizeof(struct sockaddr);
-	retval = recvfrom(priv->sd, packet, 1536, 0,
+	retval = recvfrom(priv->sd, packet, size, 0,
 			  (struct sockaddr *)priv->device,
 			  (socklen_t *)&saddr_size);
-	*length = 0;
 	if (retval >= 0) {
 		*length = retval;
 		return 0;
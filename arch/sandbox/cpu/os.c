@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -84,6 +85,8 @@ int os_open(const char *pathname, int os_flags)
 
 	if (os_flags & OS_O_CREAT)
 		flags |= O_CREAT;
+	if (os_flags & OS_O_TRUNC)
+		flags |= O_TRUNC;
 
 	return open(pathname, flags, 0777);
 }
@@ -98,6 +101,17 @@ int os_unlink(const char *pathname)
 	return unlink(pathname);
 }
 
+int os_mktemp(char *fname)
+{
+	int fd;
+
+	fd = mkstemp(fname);
+	if (fd < 0)
+		return -errno;
+
+	return fd;
+}
+
 void os_exit(int exit_code)
 {
 	exit(exit_code);
@@ -206,6 +220,69 @@ uint64_t __attribute__((no_instrument_function)) os_get_nsec(void)
 #endif
 }
 
+/* Host threads standing in for secondary CPUs */
+#define OS_CPU_MAX	16
+
+static pthread_t os_cpu_thread[OS_CPU_MAX];
+static int os_cpu_count;
+static void (*os_cpu_func)(int cpu);
+static pthread_mutex_t os_cpu_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t os_cpu_cond = PTHREAD_COND_INITIALIZER;
+static unsigned long os_cpu_events;
+
+static void *os_cpu_main(void *arg)
+{
+	os_cpu_func((int)(uintptr_t)arg);
+
+	return NULL;
+}
+
+int os_cpu_start(int count, void (*func)(int cpu))
+{
+	int i;
+
+	if (os_cpu_count)
+		return -EBUSY;
+	if (count > OS_CPU_MAX)
+		count = OS_CPU_MAX;
+
+	os_cpu_func = func;
+	for (i = 0; i < count; i++) {
+		if (pthread_create(&os_cpu_thread[i], NULL, os_cpu_main,
+				   (void *)(uintptr_t)(i + 1)))
+			break;
+	}
+	os_cpu_count = i;
+
+	return i;
+}
+
+void os_cpu_stop(void)
+{
+	int i;
+
+	for (i = 0; i < os_cpu_count; i++)
+		pthread_join(os_cpu_thread[i], NULL);
+	os_cpu_count = 0;
+}
+
+void os_cpu_send_event(void)
+{
+	pthread_mutex_lock(&os_cpu_lock);
+	os_cpu_events++;
+	pthread_cond_broadcast(&os_cpu_cond);
+	pthread_mutex_unlock(&os_cpu_lock);
+}
+
+void os_cpu_wait_event(unsigned long *seen)
+{
+	pthread_mutex_lock(&os_cpu_lock);
+	while (*seen == os_cpu_events)
+		pthread_cond_wait(&os_cpu_cond, &os_cpu_lock);
+	*seen = os_cpu_events;
+	pthread_mutex_unlock(&os_cpu_lock);
+}
+
 static char *short_opts;
 static struct option *long_opts;
 
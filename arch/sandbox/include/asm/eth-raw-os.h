@@ -33,6 +33,11 @@ int sandbox_eth_raw_os_start(const char *ifname, unsigned char *ethmac,
 			    struct eth_sandbox_raw_priv *priv);
 int sandbox_eth_raw_os_send(void *packet, int length,
 			    struct eth_sandbox_raw_priv *priv);
+/*
+ * Receive a packet into @packet, whose size is given by *@length on entry.
+ * Returns 0 with *@length set to 0 if none is waiting, or -EMSGSIZE if the
+ * next one is too big for the buffer.
+ */
 int sandbox_eth_raw_os_recv(void *packet, int *length,
 			    const struct eth_sandbox_raw_priv *priv);
 void sandbox_eth_raw_os_stop(struct eth_sandbox_raw_priv *priv);
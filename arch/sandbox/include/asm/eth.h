@@ -14,4 +14,101 @@ void sandbox_eth_disable_response(int index, bool disable);
 
 void sandbox_eth_skip_timeout(void);
 
+/* UDP port the fake TFTP server answers from */
+#define SANDBOX_TFTP_SERVER_PORT	30000
+#define SANDBOX_TFTP_MAX_BLKSIZE	1468
+
+/**
+ * struct sandbox_eth_tftp - fake TFTP server on the mocked machine
+ *
+ * The server sends a generated file of @file_size bytes in reply to any read
+ * request, honouring the blksize and windowsize options. Set @file_size to 0
+ * to disable it.
+ *
+ * @file_size:		Size of the file to serve
+ * @max_windowsize:	Largest window to agree to, 0 to ignore the option
+ * @drop_every:		Lose every Nth data packet, 0 for no loss
+ * @swap_every:		Send every Nth pair of data packets in reverse order,
+ *			0 to keep them in order
+ * @data_sent:		Number of data packets sent, including lost ones
+ * @data_dropped:	Number of data packets lost on purpose
+ * @acks:		Number of ACKs received
+ */
+struct sandbox_eth_tftp {
+	ulong file_size;
+	uint max_windowsize;
+	uint drop_every;
+	uint swap_every;
+	ulong data_sent;
+	ulong data_dropped;
+	ulong acks;
+
+	/* private */
+	bool active;
+	uint blksize;
+	uint windowsize;
+	ulong acked;
+	ulong pairs_sent;
+};
+
+/* Get the fake TFTP server's settings and statistics */
+struct sandbox_eth_tftp *sandbox_eth_get_tftp(void);
+
+/* Contents of the file served by the fake TFTP server at @offset */
+static inline u8 sandbox_eth_tftp_byte(ulong offset)
+{
+	return (offset ^ (offset >> 9) ^ (offset >> 17)) & 0xff;
+}
+
+/* UDP port the fake NFS server answers mount and NFS calls on */
+#define SANDBOX_NFS_SERVER_PORT		2049
+#define SANDBOX_NFS_MAX_PENDING		16
+
+/**
+ * struct sandbox_eth_nfs - fake NFS server on the mocked machine
+ *
+ * The server answers the portmapper, mount and NFS calls needed to read a
+ * generated file of @file_size bytes, whatever its name, using the same
+ * contents as the fake TFTP server. READ replies are held back until the
+ * client waits for a packet, then sent together, as over a link with a long
+ * round-trip time. Replies too large for a frame are sent as IP fragments.
+ * Set @file_size to 0 to disable it.
+ *
+ * @file_size:		Size of the file to serve
+ * @min_version:	Lowest NFS version to accept (2 or 3), 0 for 2
+ * @max_read:		Most bytes to return for each READ, 0 for no limit
+ * @drop_every:		Lose every Nth READ reply, 0 for no loss
+ * @reverse:		Send each batch of READ replies in reverse order
+ * @reads:		Number of READ calls received
+ * @round_trips:	Number of batches of READ replies sent
+ * @max_in_flight:	Most READ calls in one batch
+ */
+struct sandbox_eth_nfs {
+	ulong file_size;
+	uint min_version;
+	uint max_read;
+	uint drop_every;
+	bool reverse;
+	ulong reads;
+	ulong round_trips;
+	uint max_in_flight;
+
+	/* private */
+	bool active;
+	ulong replies;
+	uchar client_hwaddr[ARP_HLEN];
+	struct in_addr client_ip;
+	int client_port;
+	int pending;
+	struct {
+		u32 xid;
+		uint version;
+		ulong offset;
+		uint count;
+	} read[SANDBOX_NFS_MAX_PENDING];
+};
+
+/* Get the fake NFS server's settings and statistics */
+struct sandbox_eth_nfs *sandbox_eth_get_nfs(void);
+
 #endif /* __ETH_H */
@@ -79,4 +79,60 @@ long sandbox_i2c_rtc_get_set_base_time(struct udevice *dev, long base_time);
 
 int sandbox_usb_keyb_add_string(struct udevice *dev, const char *str);
 
+/**
+ * sandbox_flash_set_max_xfer() - Limit the size of USB flash-stick reads
+ *
+ * READ(10) commands for more blocks than this fail with an aborted command
+ * and the data stage stalled, as happens with some real devices.
+ *
+ * @dev:	USB flash-stick emulator
+ * @blocks:	Most blocks in a READ(10) command, or 0 for no limit
+ */
+void sandbox_flash_set_max_xfer(struct udevice *dev, uint blocks);
+
+/**
+ * sandbox_flash_set_bad_block() - Make a USB flash-stick block unreadable
+ *
+ * READ(10) commands which include this block fail with a medium error.
+ *
+ * @dev:	USB flash-stick emulator
+ * @lba:	Block to fail, or -1 for none
+ */
+void sandbox_flash_set_bad_block(struct udevice *dev, long lba);
+
+/**
+ * sandbox_flash_read_count() - Get the number of READ(10) commands received
+ *
+ * @dev:	USB flash-stick emulator
+ * @return number of READ(10) commands received since the emulator was probed
+ */
+int sandbox_flash_read_count(struct udevice *dev);
+
+struct mmc_adma_desc;
+
+/**
+ * sandbox_mmc_adma_run() - Follow an ADMA2 descriptor table
+ *
+ * This does what a host controller would with the table, checking that it
+ * keeps to the rules of the SD Host Controller specification.
+ *
+ * @desc:	First descriptor
+ * @card:	Card data to transfer to or from
+ * @len:	Number of bytes which the command transfers
+ * @read:	true to copy from the card into memory, false for the reverse
+ * @return 0 if OK, -EIO if the table is not valid
+ */
+int sandbox_mmc_adma_run(const struct mmc_adma_desc *desc, u8 *card,
+			 ulong len, bool read);
+
+/**
+ * sandbox_mmc_cmd_count() - Find out how often an MMC command has been sent
+ *
+ * @dev:	sandbox MMC device
+ * @cmdidx:	Command index (MMC_CMD_...)
+ * @return number of times the command has been sent since binding, or -EINVAL
+ * if it is not counted
+ */
+int sandbox_mmc_cmd_count(struct udevice *dev, uint cmdidx);
+
 #endif
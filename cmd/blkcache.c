@@ -17,12 +17,14 @@ static int blkc_show(cmd_tbl_t *cmdtp, int flag,
 	blkcache_stats(&stats);
 
 	printf("hits: %u\n"
+	       "partial hits: %u\n"
 	       "misses: %u\n"
+	       "read-ahead blocks: %u\n"
 	       "entries: %u\n"
 	       "max blocks/entry: %u\n"
 	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       stats.hits, stats.partial_hits, stats.misses, stats.readahead,
+	       stats.entries, stats.max_blocks_per_entry, stats.max_entries);
 	return 0;
 }
 
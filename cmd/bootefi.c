@@ -14,6 +14,7 @@
 #include <libfdt.h>
 #include <libfdt_env.h>
 #include <memalign.h>
+#include <smp_work.h>
 #include <asm/global_data.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -206,6 +207,9 @@ static unsigned long do_bootefi_exec(void *efi, void *fdt)
 		loaded_image_info.device_handle = nethandle;
 #endif
 
+	/* The payload may start the secondary CPUs itself */
+	smp_work_stop();
+
 	/* Call our payload! */
 	debug("%s:%d Jumping to 0x%lx\n", __func__, __LINE__, (long)entry);
 
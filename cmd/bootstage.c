@@ -5,6 +5,9 @@
  */
 
 #include <common.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <os.h>
 
 static int do_bootstage_report(cmd_tbl_t *cmdtp, int flag, int argc,
 			       char * const argv[])
@@ -58,10 +61,111 @@ static int do_bootstage_stash(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#ifdef CONFIG_BOOTSTAGE_SPANS
+/**
+ * Write the trace into a buffer from malloc()
+ *
+ * The trace grows while it is written, since spans which are still open
+ * run up to the present, so this tries again if it did not fit.
+ *
+ * @param lenp	Returns the length of the trace
+ * @return trace, which the caller must free, or NULL if out of memory
+ */
+static char *get_trace(int *lenp)
+{
+	int size = bootstage_trace(NULL, 0) + 64;
+	char *buf;
+
+	for (;;) {
+		buf = malloc(size);
+		if (!buf)
+			return NULL;
+		*lenp = bootstage_trace(buf, size);
+		if (*lenp < size)
+			return buf;
+		free(buf);
+		size = *lenp + 64;
+	}
+}
+
+static int do_bootstage_trace(cmd_tbl_t *cmdtp, int flag, int argc,
+			      char * const argv[])
+{
+	ulong addr, size;
+	char *buf, *endp;
+	int len;
+
+	if (argc < 2) {
+		buf = get_trace(&len);
+		if (!buf)
+			return CMD_RET_FAILURE;
+		puts(buf);
+		free(buf);
+
+		return 0;
+	}
+
+	addr = simple_strtoul(argv[1], &endp, 16);
+	if (*argv[1] == 0 || *endp != 0)
+		return CMD_RET_USAGE;
+	size = bootstage_trace(NULL, 0) + 64;
+	if (argc > 2) {
+		size = simple_strtoul(argv[2], &endp, 16);
+		if (*argv[2] == 0 || *endp != 0)
+			return CMD_RET_USAGE;
+	}
+	buf = map_sysmem(addr, size);
+	len = bootstage_trace(buf, size);
+	unmap_sysmem(buf);
+	if (len >= size) {
+		printf("Trace needs %#x bytes\n", len + 1);
+		return CMD_RET_FAILURE;
+	}
+	setenv_hex("filesize", len);
+
+	return 0;
+}
+
+#ifdef CONFIG_SANDBOX
+static int do_bootstage_save(cmd_tbl_t *cmdtp, int flag, int argc,
+			     char * const argv[])
+{
+	char *buf;
+	int len, fd;
+	int ret = CMD_RET_FAILURE;
+
+	if (argc != 2)
+		return CMD_RET_USAGE;
+	buf = get_trace(&len);
+	if (!buf)
+		return CMD_RET_FAILURE;
+	fd = os_open(argv[1], OS_O_WRONLY | OS_O_CREAT | OS_O_TRUNC);
+	if (fd < 0) {
+		printf("Cannot open '%s'\n", argv[1]);
+	} else {
+		if (os_write(fd, buf, len) == len)
+			ret = 0;
+		else
+			printf("Cannot write '%s'\n", argv[1]);
+		os_close(fd);
+	}
+	free(buf);
+
+	return ret;
+}
+#endif
+#endif
+
 static cmd_tbl_t cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
+#ifdef CONFIG_BOOTSTAGE_SPANS
+	U_BOOT_CMD_MKENT(trace, 3, 0, do_bootstage_trace, "", ""),
+#ifdef CONFIG_SANDBOX
+	U_BOOT_CMD_MKENT(save, 2, 0, do_bootstage_save, "", ""),
+#endif
+#endif
 };
 
 /*
@@ -92,4 +196,10 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	"report                      - Print a report\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
 	"unstash [<start> [<size>]]  - Unstash data from memory"
+#ifdef CONFIG_BOOTSTAGE_SPANS
+	"\ntrace [<addr> [<size>]]     - Print trace JSON, or write to memory"
+#ifdef CONFIG_SANDBOX
+	"\nsave <file>                 - Write trace JSON to a host file"
+#endif
+#endif
 );
@@ -13,13 +13,53 @@
 #include <common.h>
 #include <command.h>
 #include <hash.h>
+#include <malloc.h>
+#include <mapmem.h>
 #include <linux/ctype.h>
 
+#ifdef CONFIG_CMD_HASH_BENCH
+/* Size of the buffer hashed when no memory area is given */
+#define HASH_BENCH_SIZE		0x10000
+
+static int do_hash_bench(int argc, char * const argv[])
+{
+	ulong addr, len;
+	uint8_t *buf;
+	int ret, i;
+
+	if (argc == 3) {
+		addr = simple_strtoul(argv[1], NULL, 16);
+		len = simple_strtoul(argv[2], NULL, 16);
+		buf = map_sysmem(addr, len);
+		ret = hash_bench(buf, len);
+		unmap_sysmem(buf);
+	} else if (argc == 1) {
+		buf = malloc(HASH_BENCH_SIZE);
+		if (!buf) {
+			puts("Out of memory\n");
+			return CMD_RET_FAILURE;
+		}
+		for (i = 0; i < HASH_BENCH_SIZE; i++)
+			buf[i] = i * 7 + (i >> 8);
+		ret = hash_bench(buf, HASH_BENCH_SIZE);
+		free(buf);
+	} else {
+		return CMD_RET_USAGE;
+	}
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+#endif
+
 static int do_hash(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	char *s;
 	int flags = HASH_FLAG_ENV;
 
+#ifdef CONFIG_CMD_HASH_BENCH
+	if (argc > 1 && !strcmp(argv[1], "bench"))
+		return do_hash_bench(argc - 1, argv + 1);
+#endif
 #ifdef CONFIG_HASH_VERIFY
 	if (argc < 4)
 		return CMD_RET_USAGE;
@@ -53,4 +93,8 @@ U_BOOT_CMD(
 		"    - verify message digest of memory area to immediate value, \n"
 		"      env var or *address"
 #endif
+#ifdef CONFIG_CMD_HASH_BENCH
+	"\nhash bench [address count]\n"
+		"    - measure the speed of each algorithm"
+#endif
 );
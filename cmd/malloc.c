@@ -0,0 +1,83 @@
+/*
+ * Show how malloc() memory is being used
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <malloc_slab.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+/* Show each size class, with how well it is working and how full it is */
+static void malloc_show_slab(const char *name, struct slab_heap *heap)
+{
+	ulong used, held;
+	int i;
+
+	used = slab_used(heap);
+	held = heap->end - heap->base;
+	printf("%s: %lu bytes in %lu pages of %u, %lu bytes used",
+	       name, held, held / heap->page_size, heap->page_size, used);
+	if (held)
+		printf(" (%lu%% unused)", (held - used) * 100 / held);
+	printf("\n  size  pages  in use    peak   allocs    frees  misses");
+	printf("  hit%%  free%%\n");
+
+	for (i = 0; i < SLAB_CLASSES; i++) {
+		struct slab_class *sc = &heap->cls[i];
+		uint size = slab_class_size(i);
+		uint slots, tries, hit;
+
+		slots = sc->pages * ((heap->page_size - SLAB_PAGE_HDR) / size);
+		tries = sc->allocs + sc->misses;
+		hit = tries ? (u64)sc->allocs * 100 / tries : 0;
+		printf("%6u %6u %7u %7u %8u %8u %7u  %4u  %5u\n", size,
+		       sc->pages, sc->in_use, sc->peak, sc->allocs, sc->frees,
+		       sc->misses, hit,
+		       slots ? (slots - sc->in_use) * 100 / slots : 0);
+	}
+}
+#endif
+
+static int do_malloc_stats(void)
+{
+	__maybe_unused struct slab_heap *heap;
+
+#ifdef CONFIG_SYS_MALLOC_F_LEN
+	printf("Before relocation: %lu bytes used of %#x\n", gd->malloc_ptr,
+	       CONFIG_SYS_MALLOC_F_LEN);
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	heap = malloc_slab_get(true);
+	if (heap)
+		malloc_show_slab("Small objects before relocation", heap);
+#endif
+#endif
+	printf("After relocation: %lu bytes used at most of %lu\n",
+	       malloc_get_peak(), mem_malloc_end - mem_malloc_start);
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	heap = malloc_slab_get(false);
+	if (heap)
+		malloc_show_slab("Small objects", heap);
+#endif
+
+	return 0;
+}
+
+static int do_malloc(cmd_tbl_t *cmdtp, int flag, int argc,
+		     char * const argv[])
+{
+	if (argc == 2 && !strcmp(argv[1], "stats"))
+		return do_malloc_stats();
+
+	return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(
+	malloc,	2,	1,	do_malloc,
+	"malloc() information",
+	"stats - show memory use and the small-object size classes"
+);
@@ -8,6 +8,9 @@
 #include <common.h>
 #include <command.h>
 #include <console.h>
+#include <div64.h>
+#include <malloc.h>
+#include <memalign.h>
 #include <mmc.h>
 
 static int curr_device = -1;
@@ -267,6 +270,35 @@ static int do_mmcrpmb(cmd_tbl_t *cmdtp, int flag,
 }
 #endif
 
+/* Most reads which 'mmc read' can queue, three arguments each */
+#define MMC_READ_QUEUE_MAX	((CONFIG_SYS_MAXARGS - 2) / 3)
+
+static int do_mmc_read_queue(struct mmc *mmc, int argc, char * const argv[])
+{
+	struct mmc_read_req req[MMC_READ_QUEUE_MAX];
+	int count = argc / 3;
+	int i, n;
+
+	if (count > MMC_READ_QUEUE_MAX)
+		return CMD_RET_USAGE;
+
+	for (i = 0; i < count; i++) {
+		req[i].dst = (void *)simple_strtoul(argv[i * 3], NULL, 16);
+		req[i].start = simple_strtoul(argv[i * 3 + 1], NULL, 16);
+		req[i].blkcnt = simple_strtoul(argv[i * 3 + 2], NULL, 16);
+	}
+
+	printf("\nMMC read: dev # %d, %d ranges ... ", curr_device, count);
+
+	n = mmc_bread_queue(mmc, req, count);
+	for (i = 0; i < n; i++)
+		flush_cache((ulong)req[i].dst,
+			    req[i].blkcnt * mmc->read_bl_len);
+	printf("%d ranges read: %s\n", n, (n == count) ? "OK" : "ERROR");
+
+	return (n == count) ? CMD_RET_SUCCESS : CMD_RET_FAILURE;
+}
+
 static int do_mmc_read(cmd_tbl_t *cmdtp, int flag,
 		       int argc, char * const argv[])
 {
@@ -274,17 +306,20 @@ static int do_mmc_read(cmd_tbl_t *cmdtp, int flag,
 	u32 blk, cnt, n;
 	void *addr;
 
-	if (argc != 4)
+	if (argc < 4 || (argc - 1) % 3)
 		return CMD_RET_USAGE;
 
-	addr = (void *)simple_strtoul(argv[1], NULL, 16);
-	blk = simple_strtoul(argv[2], NULL, 16);
-	cnt = simple_strtoul(argv[3], NULL, 16);
-
 	mmc = init_mmc_device(curr_device, false);
 	if (!mmc)
 		return CMD_RET_FAILURE;
 
+	if (argc > 4)
+		return do_mmc_read_queue(mmc, argc - 1, argv + 1);
+
+	addr = (void *)simple_strtoul(argv[1], NULL, 16);
+	blk = simple_strtoul(argv[2], NULL, 16);
+	cnt = simple_strtoul(argv[3], NULL, 16);
+
 	printf("\nMMC read: dev # %d, block # %d, count %d ... ",
 	       curr_device, blk, cnt);
 
@@ -353,6 +388,125 @@ static int do_mmc_erase(cmd_tbl_t *cmdtp, int flag,
 
 	return (n == cnt) ? CMD_RET_SUCCESS : CMD_RET_FAILURE;
 }
+#ifdef CONFIG_CMD_MMC_BENCH
+/* Transfer sizes in blocks which 'mmc bench' uses unless told otherwise */
+static const ulong mmc_bench_sizes[] = { 0x1, 0x8, 0x40, 0x200 };
+
+/* Time transfers of @size blocks over the area and print the speed */
+static int mmc_bench_run(struct mmc *mmc, bool read, ulong blk, ulong cnt,
+			 ulong size, void *buf)
+{
+	struct blk_desc *desc = mmc_get_blk_desc(mmc);
+	struct mmc_read_req req;
+	ulong start, us, ops, rate;
+	ulong done;
+
+	ops = 0;
+	start = timer_get_us();
+	for (done = 0; done + size <= cnt; done += size, ops++) {
+		if (read) {
+			/* Go to the card rather than the block cache */
+			req.dst = buf;
+			req.start = blk + done;
+			req.blkcnt = size;
+			if (mmc_bread_queue(mmc, &req, 1) != 1)
+				return -EIO;
+		} else if (blk_dwrite(desc, blk + done, size, buf) != size) {
+			return -EIO;
+		}
+	}
+	us = max(timer_get_us() - start, 1UL);
+	if (ctrlc())
+		return -EINTR;
+
+	/* Bytes per microsecond is MB/s, shown to one decimal place */
+	rate = lldiv((u64)ops * size * desc->blksz * 10, us);
+	printf("%8lx %8lu %6lu.%lu %8lu\n", size, ops, rate / 10, rate % 10,
+	       (ulong)lldiv((u64)ops * 1000000, us));
+
+	return 0;
+}
+
+static int do_mmc_bench(cmd_tbl_t *cmdtp, int flag,
+			int argc, char * const argv[])
+{
+	ulong sizes[CONFIG_SYS_MAXARGS];
+	ulong blk, cnt, max_size;
+	bool no_cmd23 = false;
+	struct mmc *mmc;
+	uint card_caps;
+	int count, i, ret;
+	bool read;
+	void *buf;
+
+	if (argc > 1 && !strcmp(argv[1], "-n")) {
+		no_cmd23 = true;
+		argc--;
+		argv++;
+	}
+	if (argc < 4)
+		return CMD_RET_USAGE;
+	if (!strcmp(argv[1], "read"))
+		read = true;
+	else if (!strcmp(argv[1], "write"))
+		read = false;
+	else
+		return CMD_RET_USAGE;
+	blk = simple_strtoul(argv[2], NULL, 16);
+	cnt = simple_strtoul(argv[3], NULL, 16);
+
+	count = argc - 4;
+	for (i = 0; i < count; i++)
+		sizes[i] = simple_strtoul(argv[i + 4], NULL, 16);
+	if (!count) {
+		while (count < ARRAY_SIZE(mmc_bench_sizes) &&
+		       mmc_bench_sizes[count] <= cnt) {
+			sizes[count] = mmc_bench_sizes[count];
+			count++;
+		}
+	}
+	if (!count)
+		return CMD_RET_USAGE;
+	max_size = 0;
+	for (i = 0; i < count; i++) {
+		if (!sizes[i] || sizes[i] > cnt)
+			return CMD_RET_USAGE;
+		max_size = max(max_size, sizes[i]);
+	}
+
+	mmc = init_mmc_device(curr_device, false);
+	if (!mmc)
+		return CMD_RET_FAILURE;
+	if (!read && mmc_getwp(mmc) == 1) {
+		printf("Error: card is write protected!\n");
+		return CMD_RET_FAILURE;
+	}
+
+	buf = memalign(ARCH_DMA_MINALIGN, max_size * mmc->read_bl_len);
+	if (!buf) {
+		puts("Out of memory\n");
+		return CMD_RET_FAILURE;
+	}
+	memset(buf, 0xa5, max_size * mmc->read_bl_len);
+
+	card_caps = mmc->card_caps;
+	if (no_cmd23)
+		mmc->card_caps &= ~MMC_MODE_CMD23;
+	printf("\nMMC bench %s: dev # %d, block # %#lx, count %#lx, CMD23 %s\n",
+	       read ? "read" : "write", curr_device, blk, cnt,
+	       mmc->card_caps & MMC_MODE_CMD23 ? "on" : "off");
+	printf("  Blocks      Ops     MB/s     IOPS\n");
+	for (i = 0, ret = 0; !ret && i < count; i++)
+		ret = mmc_bench_run(mmc, read, blk, cnt, sizes[i], buf);
+	mmc->card_caps = card_caps;
+	free(buf);
+	if (ret == -EIO)
+		printf("MMC %s failed\n", read ? "read" : "write");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+#endif
+
 static int do_mmc_rescan(cmd_tbl_t *cmdtp, int flag,
 			 int argc, char * const argv[])
 {
@@ -731,7 +885,7 @@ static int do_mmc_setdsr(cmd_tbl_t *cmdtp, int flag,
 
 static cmd_tbl_t cmd_mmc[] = {
 	U_BOOT_CMD_MKENT(info, 1, 0, do_mmcinfo, "", ""),
-	U_BOOT_CMD_MKENT(read, 4, 1, do_mmc_read, "", ""),
+	U_BOOT_CMD_MKENT(read, CONFIG_SYS_MAXARGS, 1, do_mmc_read, "", ""),
 	U_BOOT_CMD_MKENT(write, 4, 0, do_mmc_write, "", ""),
 	U_BOOT_CMD_MKENT(erase, 3, 0, do_mmc_erase, "", ""),
 	U_BOOT_CMD_MKENT(rescan, 1, 1, do_mmc_rescan, "", ""),
@@ -749,6 +903,9 @@ static cmd_tbl_t cmd_mmc[] = {
 	U_BOOT_CMD_MKENT(rpmb, CONFIG_SYS_MAXARGS, 1, do_mmcrpmb, "", ""),
 #endif
 	U_BOOT_CMD_MKENT(setdsr, 2, 0, do_mmc_setdsr, "", ""),
+#ifdef CONFIG_CMD_MMC_BENCH
+	U_BOOT_CMD_MKENT(bench, CONFIG_SYS_MAXARGS, 0, do_mmc_bench, "", ""),
+#endif
 };
 
 static int do_mmcops(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
@@ -781,7 +938,8 @@ U_BOOT_CMD(
 	mmc, 29, 1, do_mmcops,
 	"MMC sub system",
 	"info - display info of the current MMC device\n"
-	"mmc read addr blk# cnt\n"
+	"mmc read addr blk# cnt [addr blk# cnt ...]\n"
+	" - read one or more ranges of blocks, in order\n"
 	"mmc write addr blk# cnt\n"
 	"mmc erase blk# cnt\n"
 	"mmc rescan\n"
@@ -813,6 +971,12 @@ U_BOOT_CMD(
 	"mmc rpmb counter - read the value of the write counter\n"
 #endif
 	"mmc setdsr <value> - set DSR register value\n"
+#ifdef CONFIG_CMD_MMC_BENCH
+	"mmc bench [-n] read|write blk# cnt [blocks ...]\n"
+	" - measure transfers of the given numbers of blocks over an area,\n"
+	"   with -n to stop each one with CMD12 instead of using CMD23.\n"
+	"   WARNING: 'write' destroys the data in the area.\n"
+#endif
 	);
 
 /* Old command kept for compatibility. Same as 'mmc info' */
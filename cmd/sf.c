@@ -153,6 +153,60 @@ static int do_spi_flash_probe(int argc, char * const argv[])
 	return 0;
 }
 
+#ifdef CONFIG_SPI_FLASH_SMART_UPDATE
+/* Amount of flash updated between progress reports */
+#define SF_UPDATE_SLICE		(1 << 20)
+
+/**
+ * Update an area of SPI flash by erasing and programming only what needs to
+ * change. This is done in slices so that progress can be shown.
+ *
+ * @param flash		flash context pointer
+ * @param offset	flash offset to write
+ * @param len		number of bytes to write
+ * @param buf		buffer to write from
+ * @return 0 if ok, 1 on error
+ */
+static int spi_flash_update(struct spi_flash *flash, u32 offset,
+		size_t len, const char *buf)
+{
+	struct spi_flash_update_stats stats;
+	const ulong start_time = get_timer(0);
+	ulong last_update = start_time;
+	size_t scale = 1;
+	size_t done, todo;
+	ulong delta;
+	int ret = 0;
+
+	memset(&stats, '\0', sizeof(stats));
+	if (len >= 200)
+		scale = len / 100;
+	for (done = 0; done < len && !ret; done += todo) {
+		todo = min_t(size_t, len - done, SF_UPDATE_SLICE -
+			     (offset + done) % SF_UPDATE_SLICE);
+		if (get_timer(last_update) > 100) {
+			printf("   \rUpdating, %zu%% %lu B/s", done / scale,
+			       bytes_per_second(done, start_time));
+			last_update = get_timer(0);
+		}
+		ret = spi_flash_smart_update(flash, offset + done, todo,
+					     buf + done, &stats);
+	}
+	putc('\r');
+	if (ret) {
+		printf("SPI flash update failed (err=%d)\n", ret);
+		return 1;
+	}
+
+	delta = get_timer(start_time);
+	printf("%zu bytes written, %zu bytes skipped, %zu bytes erased",
+	       stats.written, stats.skipped, stats.erased);
+	printf(" in %ld.%lds, speed %ld B/s\n",
+	       delta / 1000, delta % 1000, bytes_per_second(len, start_time));
+
+	return 0;
+}
+#else
 /**
  * Write a block of data to SPI flash, first checking if it is different from
  * what is already there.
@@ -258,6 +312,7 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 
 	return 0;
 }
+#endif
 
 static int do_spi_flash_read_write(int argc, char * const argv[])
 {
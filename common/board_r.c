@@ -23,6 +23,7 @@
 #include <dm.h>
 #include <environment.h>
 #include <fdtdec.h>
+#include <fdt_support.h>
 #if defined(CONFIG_CMD_IDE)
 #include <ide.h>
 #endif
@@ -319,13 +320,21 @@ static int initr_dm(void)
 {
 	int ret;
 
+	/* This still uses the pre-reloc timer, if it is a driver-model one */
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DM_R, "dm_r");
+
 	/* Save the pre-reloc driver model and start a new one */
 	gd->dm_root_f = gd->dm_root;
 	gd->dm_root = NULL;
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
+#endif
+#if defined(CONFIG_OF_LIBFDT_INDEX) && CONFIG_IS_ENABLED(OF_CONTROL)
+	/* The control FDT does not move from here on, so index it */
+	fdt_index_setup(gd->fdt_blob);
 #endif
 	ret = dm_init_and_scan(false);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_R);
 	if (ret)
 		return ret;
 #ifdef CONFIG_TIMER_EARLY
@@ -29,6 +29,7 @@
 #include <command.h>
 #include <bootm.h>
 #include <image.h>
+#include <smp_work.h>
 
 #ifndef CONFIG_SYS_BOOTM_LEN
 /* use 8MByte as default max gunzip size */
@@ -37,6 +38,16 @@
 
 #define IH_INITRD_ARCH IH_ARCH_DEFAULT
 
+/*
+ * smp_memcpy() copies in a few large pieces without kicking the watchdog,
+ * so boards with one keep the chunked copy
+ */
+#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
+#define BOOTM_SMP_COPY	0
+#else
+#define BOOTM_SMP_COPY	1
+#endif
+
 #ifndef USE_HOSTCC
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -355,10 +366,12 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 	case IH_COMP_NONE:
 		if (load == image_start)
 			break;
-		if (image_len <= unc_len)
-			memmove_wd(load_buf, image_buf, image_len, CHUNKSZ);
-		else
+		if (image_len > unc_len)
 			ret = 1;
+		else if (BOOTM_SMP_COPY && smp_work_cpus() > 1)
+			smp_memcpy(load_buf, image_buf, image_len);
+		else
+			memmove_wd(load_buf, image_buf, image_len, CHUNKSZ);
 		break;
 #ifdef CONFIG_GZIP
 	case IH_COMP_GZIP: {
@@ -690,6 +703,10 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		ret = boot_fn(BOOTM_STATE_OS_PREP, argc, argv, images);
 	}
 
+	/* Park the secondary CPUs where the OS expects them */
+	if (!ret && (states & (BOOTM_STATE_OS_FAKE_GO | BOOTM_STATE_OS_GO)))
+		smp_work_stop();
+
 #ifdef CONFIG_TRACE
 	/* Pretend to run the OS, then run a user command */
 	if (!ret && (states & BOOTM_STATE_OS_FAKE_GO)) {
@@ -0,0 +1,346 @@
+/*
+ * Decompress an OS image while it is being loaded
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <bootm.h>
+#include <image.h>
+#include <mapmem.h>
+#include <asm/unaligned.h>
+#include <u-boot/crc.h>
+#if defined(CONFIG_LZMA)
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+#include <lzma/LzmaTools.h>
+#endif /* CONFIG_LZMA */
+
+#ifndef CONFIG_SYS_BOOTM_LEN
+/* use 8MByte as default max gunzip size */
+#define CONFIG_SYS_BOOTM_LEN	0x800000
+#endif
+
+/*
+ * Loaders normally read a compressed image into memory in one piece and
+ * bootm then decompresses it to the load address. With "loaddecomp" set, a
+ * loader passes each chunk to bootm_stream_write() as it arrives instead:
+ *
+ * - a legacy uImage with gzip, lzma or lz4 data is decompressed behind its
+ *   header, which is then rewritten to describe the uncompressed data, so
+ *   that bootm can use it as it is
+ * - a bare gzip or lz4 file is decompressed to the load address
+ * - anything else is copied to the load address as usual
+ *
+ * The compressed image then never needs to be held in memory, and the
+ * decompression is done a chunk at a time between reads.
+ */
+enum stream_mode {
+	STREAM_IDLE,		/* no stream in progress */
+	STREAM_DETECT,		/* waiting for enough data to decide */
+	STREAM_COPY,
+	STREAM_DECOMP,
+	STREAM_DONE,		/* the decoder has seen the end of its data */
+};
+
+static struct bootm_stream {
+	ulong addr;
+	enum stream_mode mode;
+	int comp;		/* IH_COMP_... */
+	bool legacy;		/* uImage header kept at addr */
+	bool verify;
+	void *dec;		/* decoder state */
+	void *out;		/* where the decoder writes */
+	ulong in_len;		/* input bytes written so far */
+	ulong data_len;		/* uImage data size, 0 if not known */
+	ulong copied;		/* bytes stored in STREAM_COPY mode */
+	u32 dcrc;		/* CRC32 of the uImage data seen so far */
+	uint8_t head[sizeof(image_header_t)];
+} stream;
+
+static void *stream_decomp_start(int comp, void *dst, ulong len)
+{
+	switch (comp) {
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		return gunzip_stream_start(dst, len);
+#endif
+#ifdef CONFIG_LZMA
+	case IH_COMP_LZMA:
+		return lzma_stream_start(dst, len);
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+		return ulz4_stream_start(dst, len);
+#endif
+	}
+
+	return NULL;
+}
+
+static int stream_decomp_write(int comp, void *dec, const void *buf,
+			       ulong len)
+{
+	switch (comp) {
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		return gunzip_stream_write(dec, buf, len);
+#endif
+#ifdef CONFIG_LZMA
+	case IH_COMP_LZMA:
+		return lzma_stream_write(dec, buf, len);
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+		return ulz4_stream_write(dec, buf, len);
+#endif
+	}
+
+	return -ENOSYS;
+}
+
+static int stream_decomp_end(int comp, void *dec, ulong *lenp)
+{
+	switch (comp) {
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		return gunzip_stream_end(dec, lenp);
+#endif
+#ifdef CONFIG_LZMA
+	case IH_COMP_LZMA: {
+		SizeT size;
+		int ret;
+
+		ret = lzma_stream_end(dec, &size);
+		*lenp = size;
+		return ret;
+	}
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4: {
+		size_t size;
+		int ret;
+
+		ret = ulz4_stream_end(dec, &size);
+		*lenp = size;
+		return ret;
+	}
+#endif
+	}
+
+	return -ENOSYS;
+}
+
+static void stream_abort(void)
+{
+	ulong len;
+
+	if (stream.dec)
+		stream_decomp_end(stream.comp, stream.dec, &len);
+	if (stream.out)
+		unmap_sysmem(stream.out);
+	memset(&stream, '\0', sizeof(stream));
+}
+
+static int stream_copy(const void *buf, ulong len)
+{
+	void *ptr = map_sysmem(stream.addr + stream.copied, len);
+
+	memcpy(ptr, buf, len);
+	unmap_sysmem(ptr);
+	stream.copied += len;
+
+	return 0;
+}
+
+static int stream_decomp(const void *buf, ulong len)
+{
+	int ret;
+
+	if (stream.legacy) {
+		/* Ignore any padding after the data */
+		if (stream.in_len >= stream.data_len)
+			return 0;
+		len = min(len, stream.data_len - stream.in_len);
+		if (stream.verify)
+			stream.dcrc = crc32(stream.dcrc, buf, len);
+	}
+	stream.in_len += len;
+	if (stream.mode == STREAM_DONE)
+		return 0;
+
+	ret = stream_decomp_write(stream.comp, stream.dec, buf, len);
+	if (ret == 1)
+		stream.mode = STREAM_DONE;
+	else if (ret == -ENOSPC)
+		printf("Image too large: increase CONFIG_SYS_BOOTM_LEN\n");
+	else if (ret)
+		printf("Error: %s decompression failed (%d)\n",
+		       genimg_get_comp_name(stream.comp), ret);
+
+	return ret < 0 ? ret : 0;
+}
+
+/*
+ * Work out what the image is from its first @len bytes, held in stream.head,
+ * set up to load it and then deal with those bytes.
+ */
+static int stream_detect(ulong len)
+{
+	image_header_t *hdr = (image_header_t *)stream.head;
+	ulong hdr_len = 0;
+
+	stream.comp = IH_COMP_NONE;
+	if (len == sizeof(image_header_t) && image_check_magic(hdr) &&
+	    image_check_hcrc(hdr) && !image_check_type(hdr, IH_TYPE_MULTI)) {
+		switch (image_get_comp(hdr)) {
+		case IH_COMP_GZIP:
+		case IH_COMP_LZMA:
+		case IH_COMP_LZ4:
+			stream.comp = image_get_comp(hdr);
+			stream.legacy = true;
+			stream.data_len = image_get_data_size(hdr);
+			hdr_len = image_get_header_size();
+			break;
+		}
+	} else if (len >= 2 && stream.head[0] == 0x1f &&
+		   stream.head[1] == 0x8b) {
+		stream.comp = IH_COMP_GZIP;
+	} else if (len >= 4 && get_unaligned_le32(stream.head) == 0x184d2204) {
+		stream.comp = IH_COMP_LZ4;
+	}
+
+	stream.mode = STREAM_COPY;
+	stream.in_len = 0;
+	if (stream.comp != IH_COMP_NONE) {
+		stream.out = map_sysmem(stream.addr + hdr_len,
+					CONFIG_SYS_BOOTM_LEN);
+		stream.dec = stream_decomp_start(stream.comp, stream.out,
+						 CONFIG_SYS_BOOTM_LEN);
+		if (stream.dec)
+			stream.mode = STREAM_DECOMP;
+		else
+			stream.comp = IH_COMP_NONE;
+	}
+	if (stream.mode == STREAM_COPY) {
+		stream.legacy = false;
+		return stream_copy(stream.head, len);
+	}
+	if (!stream.legacy)
+		return stream_decomp(stream.head, len);
+
+	memcpy(stream.out - hdr_len, stream.head, hdr_len);
+
+	return 0;
+}
+
+int bootm_stream_start(ulong addr)
+{
+	stream_abort();
+	if (getenv_yesno("loaddecomp") != 1)
+		return 0;
+
+	stream.addr = addr;
+	stream.verify = getenv_yesno("verify");
+	stream.mode = STREAM_DETECT;
+
+	return 1;
+}
+
+int bootm_stream_write(const void *buf, ulong len)
+{
+	ulong size;
+
+	if (stream.mode == STREAM_IDLE)
+		return -EINVAL;
+
+	if (stream.mode == STREAM_DETECT) {
+		size = min(len, sizeof(stream.head) - stream.in_len);
+		memcpy(stream.head + stream.in_len, buf, size);
+		stream.in_len += size;
+		if (stream.in_len < sizeof(stream.head))
+			return 0;
+		if (stream_detect(sizeof(stream.head)))
+			goto err;
+		buf += size;
+		len -= size;
+	}
+
+	if (stream.mode == STREAM_COPY)
+		return stream_copy(buf, len);
+	if (stream_decomp(buf, len))
+		goto err;
+
+	return 0;
+
+err:
+	stream_abort();
+	return -EINVAL;
+}
+
+int bootm_stream_end(ulong *lenp)
+{
+	image_header_t *hdr;
+	ulong len;
+	int ret;
+
+	if (stream.mode == STREAM_IDLE)
+		return -EINVAL;
+
+	/* The image is shorter than a uImage header */
+	if (stream.mode == STREAM_DETECT && stream_detect(stream.in_len))
+		goto err;
+	if (stream.mode == STREAM_COPY) {
+		*lenp = stream.copied;
+		stream_abort();
+		return 0;
+	}
+
+	ret = stream_decomp_end(stream.comp, stream.dec, &len);
+	stream.dec = NULL;
+	if (ret) {
+		printf("Error: %s data is truncated\n",
+		       genimg_get_comp_name(stream.comp));
+		goto err;
+	}
+
+	if (stream.legacy) {
+		hdr = (image_header_t *)stream.head;
+		if (stream.in_len < stream.data_len) {
+			puts("Error: image data is truncated\n");
+			goto err;
+		}
+		if (stream.verify && stream.dcrc != image_get_dcrc(hdr)) {
+			puts("Bad Data CRC\n");
+			goto err;
+		}
+
+		/* Describe what is now behind the header */
+		hdr = map_sysmem(stream.addr, image_get_header_size());
+		image_set_comp(hdr, IH_COMP_NONE);
+		image_set_size(hdr, len);
+		image_set_dcrc(hdr, crc32_wd(0, stream.out, len,
+					     CHUNKSZ_CRC32));
+		image_set_hcrc(hdr, 0);
+		image_set_hcrc(hdr, crc32(0, (uint8_t *)hdr,
+					  image_get_header_size()));
+		unmap_sysmem(hdr);
+		len += image_get_header_size();
+	}
+
+	printf("Uncompressed %s image to %lu bytes\n",
+	       genimg_get_comp_name(stream.comp), len);
+	*lenp = len;
+	stream_abort();
+
+	return 0;
+
+err:
+	stream_abort();
+	return -EINVAL;
+}
+
+void bootm_stream_abort(void)
+{
+	stream_abort();
+}
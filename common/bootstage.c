@@ -13,6 +13,7 @@
  */
 
 #include <common.h>
+#include <errno.h>
 #include <libfdt.h>
 #include <malloc.h>
 #include <linux/compiler.h>
@@ -259,6 +260,302 @@ int bootstage_fdt_add_report(void)
 }
 #endif
 
+#ifdef CONFIG_BOOTSTAGE_SPANS
+enum {
+	BOOTSTAGE_SPAN_NAME	= 24,
+	BOOTSTAGE_SPAN_OPEN	= -1U,	/* dur_us of a span not ended yet */
+	BOOTSTAGE_SPAN_MAX_DEPTH = 0xff,
+	BOOTSTAGE_SPAN_SLOWEST	= 10,	/* Number of spans listed in report */
+
+	BOOTSTAGE_SPANF_ADDR	= 1 << 0,	/* Named by addr, not name */
+};
+
+/**
+ * struct bootstage_span - A timed activity
+ *
+ * Spans are kept in the order they started, so the parent of a span is the
+ * last one before it with a smaller depth.
+ *
+ * @start_us:	Time the span started
+ * @dur_us:	Length of the span, or BOOTSTAGE_SPAN_OPEN
+ * @type:	Kind of span (enum bootstage_span_type)
+ * @depth:	Number of spans this one is inside
+ * @flags:	Flags (BOOTSTAGE_SPANF_...)
+ * @name:	Name of the span
+ * @addr:	Address of code, with BOOTSTAGE_SPANF_ADDR
+ */
+struct bootstage_span {
+	ulong start_us;
+	uint32_t dur_us;
+	u8 type;
+	u8 depth;
+	u8 flags;
+	union {
+		char name[BOOTSTAGE_SPAN_NAME];
+		ulong addr;
+	};
+};
+
+/* Spans start before relocation, so keep all this out of .bss */
+static struct bootstage_span span_tab[CONFIG_BOOTSTAGE_SPAN_COUNT]
+	__section(.data);
+static int span_count __section(.data);
+static int span_depth __section(.data);
+static int span_dropped __section(.data);
+
+static const char *const span_type_name[BOOTSTAGE_SPAN_TYPE_COUNT] = {
+	"user", "initcall", "probe", "uclass", "cmd",
+};
+
+static struct bootstage_span *span_add(enum bootstage_span_type type)
+{
+	struct bootstage_span *span;
+
+	if (span_count == ARRAY_SIZE(span_tab) ||
+	    span_depth == BOOTSTAGE_SPAN_MAX_DEPTH) {
+		span_dropped++;
+		return NULL;
+	}
+	span = &span_tab[span_count++];
+	span->dur_us = BOOTSTAGE_SPAN_OPEN;
+	span->type = type;
+	span->depth = span_depth++;
+
+	return span;
+}
+
+int bootstage_span_begin(enum bootstage_span_type type, const char *name)
+{
+	struct bootstage_span *span = span_add(type);
+
+	if (!span)
+		return -ENOSPC;
+	span->flags = 0;
+	strlcpy(span->name, name, sizeof(span->name));
+	span->start_us = timer_get_boot_us();
+
+	return span - span_tab;
+}
+
+int bootstage_span_begin_addr(enum bootstage_span_type type, ulong addr)
+{
+	struct bootstage_span *span = span_add(type);
+
+	if (!span)
+		return -ENOSPC;
+	span->flags = BOOTSTAGE_SPANF_ADDR;
+	span->addr = addr;
+	span->start_us = timer_get_boot_us();
+
+	return span - span_tab;
+}
+
+void bootstage_span_end(int id)
+{
+	struct bootstage_span *span, *inner;
+	ulong now;
+
+	if (id < 0 || id >= span_count)
+		return;
+	now = timer_get_boot_us();
+	span = &span_tab[id];
+	span->dur_us = now - span->start_us;
+
+	/* This also ends any spans inside it which were left open */
+	for (inner = span + 1; inner < span_tab + span_count; inner++) {
+		if (inner->depth > span->depth &&
+		    inner->dur_us == BOOTSTAGE_SPAN_OPEN)
+			inner->dur_us = now - inner->start_us;
+	}
+	span_depth = span->depth;
+}
+
+static const char *get_span_name(char *buf, int len,
+				 struct bootstage_span *span)
+{
+	if (!(span->flags & BOOTSTAGE_SPANF_ADDR))
+		return span->name;
+	snprintf(buf, len, "%08lx", span->addr);
+
+	return buf;
+}
+
+static ulong get_span_dur(struct bootstage_span *span, ulong now)
+{
+	if (span->dur_us == BOOTSTAGE_SPAN_OPEN)
+		return now - span->start_us;
+
+	return span->dur_us;
+}
+
+/**
+ * Work out the time in each span which is not spent in the spans inside it
+ *
+ * @param self	Returns the self time of each span
+ * @param now	Current time, for spans still open
+ */
+static void get_span_self(ulong *self, ulong now)
+{
+	int parent[BOOTSTAGE_SPAN_MAX_DEPTH];
+	struct bootstage_span *span;
+	ulong dur, *up;
+	int i;
+
+	for (i = 0, span = span_tab; i < span_count; i++, span++) {
+		dur = get_span_dur(span, now);
+		self[i] = dur;
+		parent[span->depth] = i;
+		if (span->depth) {
+			up = &self[parent[span->depth - 1]];
+			*up -= min(dur, *up);
+		}
+	}
+}
+
+static void print_span(ulong self, ulong now, struct bootstage_span *span)
+{
+	char buf[20];
+
+	print_grouped_ull(self, BOOTSTAGE_DIGITS);
+	print_grouped_ull(get_span_dur(span, now), BOOTSTAGE_DIGITS);
+	printf("  %-8s %s\n", span_type_name[span->type],
+	       get_span_name(buf, sizeof(buf), span));
+}
+
+static void bootstage_span_report(void)
+{
+	int slow[BOOTSTAGE_SPAN_SLOWEST];
+	ulong count[BOOTSTAGE_SPAN_TYPE_COUNT] = { 0 };
+	ulong total[BOOTSTAGE_SPAN_TYPE_COUNT] = { 0 };
+	ulong now = timer_get_boot_us();
+	int nslow = 0;
+	ulong *self;
+	int i, j;
+
+	if (!span_count)
+		return;
+	self = calloc(span_count, sizeof(*self));
+	if (!self) {
+		puts("\nNo memory for span report\n");
+		return;
+	}
+	get_span_self(self, now);
+
+	/* Keep the slowest few, slowest first */
+	for (i = 0; i < span_count; i++) {
+		count[span_tab[i].type]++;
+		total[span_tab[i].type] += self[i];
+		for (j = nslow; j > 0 && self[slow[j - 1]] < self[i]; j--) {
+			if (j < BOOTSTAGE_SPAN_SLOWEST)
+				slow[j] = slow[j - 1];
+		}
+		if (j < BOOTSTAGE_SPAN_SLOWEST) {
+			slow[j] = i;
+			if (nslow < BOOTSTAGE_SPAN_SLOWEST)
+				nslow++;
+		}
+	}
+
+	puts("\nTime in spans, not counting spans inside them:\n");
+	printf("%11s%11s  %s\n", "Count", "Self", "Kind");
+	for (i = 0; i < BOOTSTAGE_SPAN_TYPE_COUNT; i++) {
+		if (!count[i])
+			continue;
+		print_grouped_ull(count[i], BOOTSTAGE_DIGITS);
+		print_grouped_ull(total[i], BOOTSTAGE_DIGITS);
+		printf("  %s\n", span_type_name[i]);
+	}
+
+	puts("\nSlowest spans:\n");
+	printf("%11s%11s  %s\n", "Self", "Total", "Span");
+	for (i = 0; i < nslow; i++)
+		print_span(self[slow[i]], now, &span_tab[slow[i]]);
+	if (span_dropped)
+		printf("(%d spans not recorded - please increase CONFIG_BOOTSTAGE_SPAN_COUNT)\n",
+		       span_dropped);
+	free(self);
+}
+
+/**
+ * struct trace_buf - Place to write a trace
+ *
+ * @buf:	Buffer to write into
+ * @size:	Size of buffer
+ * @len:	Number of characters needed so far, which may exceed @size
+ */
+struct trace_buf {
+	char *buf;
+	int size;
+	int len;
+};
+
+static void trace_printf(struct trace_buf *tb, const char *fmt, ...)
+{
+	int pos = min(tb->len, tb->size);
+	va_list args;
+
+	va_start(args, fmt);
+	tb->len += vsnprintf(tb->buf + pos, tb->size - pos, fmt, args);
+	va_end(args);
+}
+
+/* Write a JSON string, escaping anything which needs it */
+static void trace_str(struct trace_buf *tb, const char *str)
+{
+	trace_printf(tb, "\"");
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			trace_printf(tb, "\\%c", *str);
+		else if ((u8)*str < ' ')
+			trace_printf(tb, "\\u%04x", *str);
+		else
+			trace_printf(tb, "%c", *str);
+	}
+	trace_printf(tb, "\"");
+}
+
+int bootstage_trace(char *buf, int size)
+{
+	struct trace_buf tb = { .buf = buf, .size = size };
+	struct bootstage_record *rec;
+	struct bootstage_span *span;
+	ulong now = timer_get_boot_us();
+	const char *sep = "";
+	char name[20];
+	int i;
+
+	if (size > 0)
+		*buf = '\0';
+	trace_printf(&tb, "{\"traceEvents\":[");
+	for (i = 0, span = span_tab; i < span_count; i++, span++) {
+		trace_printf(&tb, "%s\n{\"name\":", sep);
+		trace_str(&tb, get_span_name(name, sizeof(name), span));
+		trace_printf(&tb, ",\"cat\":\"%s\",\"ph\":\"X\",",
+			     span_type_name[span->type]);
+		trace_printf(&tb, "\"ts\":%lu,\"dur\":%lu,\"pid\":0,\"tid\":0}",
+			     span->start_us, get_span_dur(span, now));
+		sep = ",";
+	}
+	for (i = 0, rec = record; i < BOOTSTAGE_ID_COUNT; i++, rec++) {
+		if (!rec->time_us || rec->start_us)
+			continue;
+		trace_printf(&tb, "%s\n{\"name\":", sep);
+		trace_str(&tb, get_record_name(name, sizeof(name), rec));
+		trace_printf(&tb, ",\"cat\":\"mark\",\"ph\":\"i\",");
+		trace_printf(&tb, "\"s\":\"g\",\"ts\":%lu,\"pid\":0,\"tid\":0}",
+			     rec->time_us);
+		sep = ",";
+	}
+	trace_printf(&tb, "\n]}\n");
+
+	return tb.len;
+}
+#else
+static inline void bootstage_span_report(void)
+{
+}
+#endif /* CONFIG_BOOTSTAGE_SPANS */
+
 void bootstage_report(void)
 {
 	struct bootstage_record *rec = record;
@@ -290,6 +587,7 @@ void bootstage_report(void)
 		if (rec->start_us)
 			prev = print_time_record(id, rec, -1);
 	}
+	bootstage_span_report();
 }
 
 ulong __timer_get_boot_us(void)
@@ -495,9 +495,11 @@ void fixup_cmdtable(cmd_tbl_t *cmdtp, int size)
  */
 static int cmd_call(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
-	int result;
+	int result, span;
 
+	span = bootstage_span_begin(BOOTSTAGE_SPAN_CMD, cmdtp->name);
 	result = (cmdtp->cmd)(cmdtp, flag, argc, argv);
+	bootstage_span_end(span);
 	if (result)
 		debug("Command failed, result=%d\n", result);
 	return result;
@@ -5,6 +5,8 @@
 #endif
 
 #include <malloc.h>
+#include <malloc_slab.h>
+#include <mapmem.h>
 #include <asm/io.h>
 
 #ifdef DEBUG
@@ -19,6 +21,38 @@ void malloc_stats();
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+/*
+ * Small requests are tried with the slab allocator first, so dlmalloc's own
+ * routines are renamed and called only when it cannot help. They call each
+ * other by these names, so that memalign() and the like only ever see
+ * dlmalloc chunks.
+ */
+#undef mALLOc
+#undef fREe
+#undef rEALLOc
+#undef cALLOc
+#define mALLOc		dl_malloc
+#define fREe		dl_free
+#define rEALLOc		dl_realloc
+#define cALLOc		dl_calloc
+
+static Void_t *dl_malloc(size_t bytes);
+static void dl_free(Void_t *mem);
+static Void_t *dl_realloc(Void_t *oldmem, size_t bytes);
+static Void_t *dl_calloc(size_t n, size_t elem_size);
+
+/* Page size for the slab allocator, before and after relocation */
+#define SLAB_F_PAGE_SIZE	512
+#define SLAB_PAGE_SIZE		1024
+
+static struct slab_heap slab_heap;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB_F)
+/* Copy of the heap used before relocation, kept for 'malloc stats' */
+static struct slab_heap slab_heap_f;
+#endif
+#endif
+
 /*
   Emulation of sbrk for WIN32
   All code within the ifdef WIN32 is untested by me.
@@ -600,6 +634,18 @@ void *sbrk(ptrdiff_t increment)
 
 void mem_malloc_init(ulong start, ulong size)
 {
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	/* The slab allocator has the top of the area */
+	ulong slab_len = min((ulong)CONFIG_SYS_MALLOC_SLAB_LEN, size / 2);
+
+	slab_init(&slab_heap, start + size, start + size - slab_len,
+		  SLAB_PAGE_SIZE);
+	size -= slab_len;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB_F)
+	if (gd->malloc_slab)
+		slab_heap_f = *gd->malloc_slab;
+#endif
+#endif
 	mem_malloc_start = start;
 	mem_malloc_end = start + size;
 	mem_malloc_brk = start;
@@ -2120,7 +2166,7 @@ void cfree(Void_t *mem)
 void cfree(mem) Void_t *mem;
 #endif
 {
-  fREe(mem);
+  free(mem);
 }
 #endif
 
@@ -2225,6 +2271,12 @@ size_t malloc_usable_size(mem) Void_t* mem;
 #endif
 {
   mchunkptr p;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  size_t size = slab_size(&slab_heap, mem);
+
+  if (size)
+    return size;
+#endif
   if (mem == NULL)
     return 0;
   else
@@ -2327,6 +2379,10 @@ void malloc_stats()
 struct mallinfo mALLINFo()
 {
   malloc_update_mallinfo();
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  /* Count the objects, not the pages, so that leaks still show up */
+  current_mallinfo.uordblks += slab_used(&slab_heap);
+#endif
   return current_mallinfo;
 }
 #endif	/* DEBUG */
@@ -2373,12 +2429,146 @@ int mALLOPt(param_number, value) int param_number; int value;
   }
 }
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+/* Get the slab heap to use now, or NULL if there is none */
+static struct slab_heap *malloc_slab_heap(void)
+{
+#ifdef CONFIG_SYS_MALLOC_F_LEN
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT)) {
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB_F)
+		return gd->malloc_slab;
+#else
+		return NULL;
+#endif
+	}
+#endif
+
+	return slab_heap.page_size ? &slab_heap : NULL;
+}
+
+static void *malloc_slab_alloc(struct slab_heap *heap, size_t bytes)
+{
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB_F)
+	ulong base;
+	void *ptr;
+
+	if (heap == gd->malloc_slab) {
+		/*
+		 * Pages come from the top of the pool and malloc_simple()
+		 * works up from the bottom. Pages may use at most half, so
+		 * that partly-used pages cannot starve malloc_simple().
+		 */
+		base = (ulong)map_sysmem(gd->malloc_base, 0);
+		heap->limit = base + max(gd->malloc_ptr,
+					 (ulong)CONFIG_SYS_MALLOC_F_LEN / 2);
+		ptr = slab_alloc(heap, bytes);
+		gd->malloc_limit = heap->base - base;
+
+		return ptr;
+	}
+#endif
+
+	return slab_alloc(heap, bytes);
+}
+
+Void_t *malloc(size_t bytes)
+{
+	struct slab_heap *heap = malloc_slab_heap();
+	void *ptr;
+
+	if (heap && bytes <= SLAB_MAX_SIZE) {
+		ptr = malloc_slab_alloc(heap, bytes);
+		if (ptr)
+			return ptr;
+	}
+
+	return dl_malloc(bytes);
+}
+
+void free(Void_t *mem)
+{
+	struct slab_heap *heap = malloc_slab_heap();
+
+	if (heap && slab_size(heap, mem))
+		slab_free(heap, mem);
+	else
+		dl_free(mem);
+}
+
+Void_t *realloc(Void_t *oldmem, size_t bytes)
+{
+	struct slab_heap *heap = malloc_slab_heap();
+	size_t size = heap ? slab_size(heap, oldmem) : 0;
+	void *mem;
+
+	if (!size)
+		return dl_realloc(oldmem, bytes);
+	if (bytes <= size)
+		return oldmem;
+
+	mem = malloc(bytes);
+	if (mem) {
+		memcpy(mem, oldmem, size);
+		free(oldmem);
+	}
+
+	return mem;
+}
+
+Void_t *calloc(size_t n, size_t elem_size)
+{
+	struct slab_heap *heap = malloc_slab_heap();
+	size_t bytes = n * elem_size;
+	void *mem;
+
+	if (heap && bytes <= SLAB_MAX_SIZE && (long)n >= 0) {
+		mem = malloc_slab_alloc(heap, bytes);
+		if (mem) {
+			memset(mem, '\0', bytes);
+			return mem;
+		}
+	}
+
+	return dl_calloc(n, elem_size);
+}
+
+struct slab_heap *malloc_slab_get(bool early)
+{
+	if (early) {
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB_F)
+		if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+			return gd->malloc_slab;
+		return slab_heap_f.page_size ? &slab_heap_f : NULL;
+#else
+		return NULL;
+#endif
+	}
+
+	return slab_heap.page_size ? &slab_heap : NULL;
+}
+#endif
+
+ulong malloc_get_peak(void)
+{
+	return max_sbrked_mem;
+}
+
 int initf_malloc(void)
 {
 #ifdef CONFIG_SYS_MALLOC_F_LEN
 	assert(gd->malloc_base);	/* Set up by crt0.S */
 	gd->malloc_limit = CONFIG_SYS_MALLOC_F_LEN;
 	gd->malloc_ptr = 0;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB_F)
+	gd->malloc_slab = malloc_simple(sizeof(*gd->malloc_slab));
+	if (gd->malloc_slab) {
+		ulong base = (ulong)map_sysmem(gd->malloc_base, 0);
+
+		slab_init(gd->malloc_slab, base + gd->malloc_limit,
+			  base + gd->malloc_ptr, SLAB_F_PAGE_SIZE);
+		gd->malloc_limit = gd->malloc_slab->end - base;
+	}
+#endif
 #endif
 
 	return 0;
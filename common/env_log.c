@@ -0,0 +1,256 @@
+/*
+ * Log-structured environment storage
+ *
+ * Saving the environment normally means erasing its flash sector and writing
+ * the whole of it again, even if just one variable has changed. Here only
+ * the changes are appended, and the area is erased when it fills up.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <environment.h>
+#include <env_log.h>
+#include <errno.h>
+#include <malloc.h>
+#include <search.h>
+
+#ifdef CONFIG_ENV_AES
+#error "CONFIG_ENV_LOG does not support an encrypted environment"
+#endif
+
+/* Records follow the env_t, each aligned to this */
+#define ENV_LOG_ALIGN	4
+#define ENV_LOG_START	ALIGN(CONFIG_ENV_SIZE, ENV_LOG_ALIGN)
+
+/* A header with this length has not been written */
+#define ENV_LOG_ERASED	0xffff
+
+/**
+ * struct env_log_rec - Header of a record in the log
+ *
+ * @len:	Length of the data following the header
+ * @len_inv:	~@len, so that a length which was not fully programmed can be
+ *		spotted
+ * @crc:	CRC32 of the data
+ */
+struct env_log_rec {
+	uint16_t len;
+	uint16_t len_inv;
+	uint32_t crc;
+};
+
+/* Compare the names in two "name=value" strings */
+static int env_log_namecmp(const char *a, const char *b)
+{
+	for (; *a && *a == *b && *a != '='; a++, b++)
+		;
+
+	return (*a == '=' ? 0 : *a) - (*b == '=' ? 0 : *b);
+}
+
+/*
+ * Write to @out the strings which turn the environment @old into @new, each
+ * being a sorted export. A variable which has gone is written as just its
+ * name, which himport_r() takes to mean deletion.
+ *
+ * Returns the number of bytes written, or -ENOSPC if more than @size are
+ * needed.
+ */
+static int env_log_diff(const char *old, const char *new, char *out,
+			int size)
+{
+	int len = 0;
+	int cmp, n;
+
+	while (*old || *new) {
+		if (!*old)
+			cmp = 1;
+		else if (!*new)
+			cmp = -1;
+		else
+			cmp = env_log_namecmp(old, new);
+
+		if (cmp < 0) {
+			n = strchr(old, '=') - old;
+			if (len + n + 1 > size)
+				return -ENOSPC;
+			memcpy(out + len, old, n);
+			out[len + n] = '\0';
+			len += n + 1;
+			old += strlen(old) + 1;
+			continue;
+		}
+
+		n = strlen(new) + 1;
+		if (cmp > 0 || strcmp(old, new)) {
+			if (len + n > size)
+				return -ENOSPC;
+			memcpy(out + len, new, n);
+			len += n;
+		}
+		if (!cmp)
+			old += strlen(old) + 1;
+		new += n;
+	}
+
+	return len;
+}
+
+/* Append the changes from @log->saved to @new as a record */
+static int env_log_append(struct env_log *log, const char *new)
+{
+	struct env_log_rec *rec;
+	int space, len, ret;
+
+	if (!log->saved || log->pos + sizeof(*rec) >= log->size)
+		return -ENOSPC;
+	space = min(log->size - log->pos - sizeof(*rec),
+		    (size_t)ENV_LOG_ERASED - 1);
+	rec = malloc(sizeof(*rec) + space);
+	if (!rec)
+		return -ENOMEM;
+
+	len = env_log_diff(log->saved, new, (char *)(rec + 1), space);
+	if (len <= 0) {
+		free(rec);
+		return len;
+	}
+	rec->len = len;
+	rec->len_inv = ~len;
+	rec->crc = crc32(0, (uchar *)(rec + 1), len);
+	debug("%s: %d bytes at %#x\n", __func__, len, log->pos);
+
+	ret = log->write(log, log->pos, sizeof(*rec) + len, rec);
+	free(rec);
+	if (ret)
+		return ret;
+	log->pos = ALIGN(log->pos + sizeof(*rec) + len, ENV_LOG_ALIGN);
+
+	return 0;
+}
+
+/* Erase the area and write @new as its env_t, leaving the log empty */
+static int env_log_compact(struct env_log *log, const char *new)
+{
+	env_t *env;
+	int ret;
+
+	debug("%s: compacting\n", __func__);
+	env = calloc(1, sizeof(*env));
+	if (!env)
+		return -ENOMEM;
+	memcpy(env->data, new, ENV_SIZE);
+	env->crc = crc32(0, env->data, ENV_SIZE);
+
+	ret = log->erase(log);
+	if (!ret)
+		ret = log->write(log, 0, sizeof(*env), env);
+	free(env);
+	if (ret)
+		return ret;
+	log->pos = ENV_LOG_START;
+
+	return 0;
+}
+
+int env_log_save(struct env_log *log)
+{
+	char *new = NULL;
+	int ret;
+
+	if (log->saved && log->changes == log->htab->changes)
+		return 0;
+
+	if (hexport_r(log->htab, '\0', 0, &new, ENV_SIZE, 0, NULL) < 0)
+		return -ENOSPC;
+
+	ret = env_log_append(log, new);
+	if (ret == -ENOSPC)
+		ret = env_log_compact(log, new);
+	if (ret) {
+		/* The area is in an unknown state, so compact next time */
+		free(new);
+		free(log->saved);
+		log->saved = NULL;
+		log->pos = log->size;
+		return ret;
+	}
+
+	free(log->saved);
+	log->saved = new;
+	log->changes = log->htab->changes;
+
+	return 0;
+}
+
+int env_log_load(struct env_log *log)
+{
+	struct env_log_rec rec;
+	uint pos, next;
+	env_t *env;
+	char *data;
+	int count = 0;
+	int ret;
+
+	free(log->saved);
+	log->saved = NULL;
+	log->pos = log->size;
+
+	env = malloc(sizeof(*env));
+	if (!env)
+		return -ENOMEM;
+	ret = log->read(log, 0, sizeof(*env), env);
+	if (!ret && crc32(0, env->data, ENV_SIZE) != env->crc)
+		ret = -EBADMSG;
+	if (!ret && !himport_r(log->htab, (char *)env->data, ENV_SIZE, '\0',
+			       0, 0, 0, NULL))
+		ret = -EINVAL;
+	free(env);
+	if (ret)
+		return ret;
+
+	for (pos = ENV_LOG_START; pos + sizeof(rec) <= log->size; pos = next) {
+		ret = log->read(log, pos, sizeof(rec), &rec);
+		if (ret)
+			return ret;
+		if (rec.len == ENV_LOG_ERASED && rec.len_inv == ENV_LOG_ERASED)
+			break;
+
+		/* Without a length the rest of the log cannot be followed */
+		next = pos + sizeof(rec) + rec.len;
+		if ((uint16_t)~rec.len != rec.len_inv || next > log->size) {
+			debug("%s: bad record at %#x\n", __func__, pos);
+			pos = log->size;
+			break;
+		}
+		next = ALIGN(next, ENV_LOG_ALIGN);
+
+		data = malloc(rec.len);
+		if (!data)
+			return -ENOMEM;
+		ret = log->read(log, pos + sizeof(rec), rec.len, data);
+		if (ret) {
+			free(data);
+			return ret;
+		}
+
+		/* A save cut short by power failure leaves a bad CRC */
+		if (crc32(0, (uchar *)data, rec.len) != rec.crc) {
+			debug("%s: ignoring torn record at %#x\n", __func__,
+			      pos);
+		} else if (himport_r(log->htab, data, rec.len, '\0',
+				     H_NOCLEAR | H_FORCE, 0, 0, NULL)) {
+			count++;
+		}
+		free(data);
+	}
+	log->pos = min(pos, log->size);
+
+	/* Without this the next save will compact the log */
+	if (hexport_r(log->htab, '\0', 0, &log->saved, ENV_SIZE, 0, NULL) < 0)
+		log->saved = NULL;
+	log->changes = log->htab->changes;
+
+	return count;
+}
@@ -16,6 +16,7 @@
 #include <spi_flash.h>
 #include <search.h>
 #include <errno.h>
+#include <env_log.h>
 #include <dm/device-internal.h>
 
 #ifndef CONFIG_ENV_SPI_BUS
@@ -31,6 +32,10 @@
 # define CONFIG_ENV_SPI_MODE	SPI_MODE_3
 #endif
 
+#if defined(CONFIG_ENV_LOG) && defined(CONFIG_ENV_OFFSET_REDUND)
+#error "CONFIG_ENV_LOG does not support a redundant environment"
+#endif
+
 #ifdef CONFIG_ENV_OFFSET_REDUND
 static ulong env_offset		= CONFIG_ENV_OFFSET;
 static ulong env_new_offset	= CONFIG_ENV_OFFSET_REDUND;
@@ -235,6 +240,96 @@ out:
 	free(tmp_env1);
 	free(tmp_env2);
 }
+#elif defined(CONFIG_ENV_LOG)
+static int env_sf_log_read(struct env_log *log, uint offset, size_t len,
+			   void *buf)
+{
+	return spi_flash_read(env_flash, CONFIG_ENV_OFFSET + offset, len, buf);
+}
+
+static int env_sf_log_write(struct env_log *log, uint offset, size_t len,
+			    const void *buf)
+{
+	return spi_flash_write(env_flash, CONFIG_ENV_OFFSET + offset, len, buf);
+}
+
+static int env_sf_log_erase(struct env_log *log)
+{
+	return spi_flash_erase(env_flash, CONFIG_ENV_OFFSET, log->size);
+}
+
+static struct env_log env_sf_log = {
+	.read	= env_sf_log_read,
+	.write	= env_sf_log_write,
+	.erase	= env_sf_log_erase,
+	.size	= DIV_ROUND_UP(CONFIG_ENV_SIZE + CONFIG_ENV_LOG_SIZE,
+			       CONFIG_ENV_SECT_SIZE) * CONFIG_ENV_SECT_SIZE,
+	.htab	= &env_htab,
+};
+
+int saveenv(void)
+{
+	int ret;
+#ifdef CONFIG_DM_SPI_FLASH
+	struct udevice *new;
+
+	/* speed and mode will be read from DT */
+	ret = spi_flash_probe_bus_cs(CONFIG_ENV_SPI_BUS, CONFIG_ENV_SPI_CS,
+				     0, 0, &new);
+	if (ret) {
+		set_default_env("!spi_flash_probe_bus_cs() failed");
+		return 1;
+	}
+
+	env_flash = dev_get_uclass_priv(new);
+#else
+
+	if (!env_flash) {
+		env_flash = spi_flash_probe(CONFIG_ENV_SPI_BUS,
+			CONFIG_ENV_SPI_CS,
+			CONFIG_ENV_SPI_MAX_HZ, CONFIG_ENV_SPI_MODE);
+		if (!env_flash) {
+			set_default_env("!spi_flash_probe() failed");
+			return 1;
+		}
+	}
+#endif
+
+	puts("Writing to SPI flash...");
+	ret = env_log_save(&env_sf_log);
+	if (ret) {
+		printf("failed (err=%d)\n", ret);
+		return 1;
+	}
+	puts("done\n");
+
+	return 0;
+}
+
+void env_relocate_spec(void)
+{
+	int ret;
+
+	env_flash = spi_flash_probe(CONFIG_ENV_SPI_BUS, CONFIG_ENV_SPI_CS,
+			CONFIG_ENV_SPI_MAX_HZ, CONFIG_ENV_SPI_MODE);
+	if (!env_flash) {
+		set_default_env("!spi_flash_probe() failed");
+		return;
+	}
+
+	ret = env_log_load(&env_sf_log);
+	if (ret >= 0) {
+		gd->flags |= GD_FLG_ENV_READY;
+		gd->env_valid = 1;
+	} else if (ret == -EBADMSG) {
+		set_default_env("!bad CRC");
+	} else {
+		set_default_env("!env_log_load() failed");
+	}
+
+	spi_flash_free(env_flash);
+	env_flash = NULL;
+}
 #else
 int saveenv(void)
 {
@@ -7,6 +7,7 @@
 #include <config.h>
 #include <common.h>
 #include <blk.h>
+#include <errno.h>
 #include <fastboot.h>
 #include <fb_mmc.h>
 #include <image-sparse.h>
@@ -59,6 +60,44 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+#ifdef CONFIG_FASTBOOT_FLASH_MMC_DISCARD
+static int fb_mmc_sparse_discard(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+	struct blk_desc *dev_desc = sparse->dev_desc;
+
+	return blk_derase(dev_desc, blk, blkcnt) == blkcnt ? 0 : -EIO;
+}
+#endif
+
+static void fb_mmc_sparse_init(struct sparse_storage *sparse,
+		struct fb_mmc_sparse *sparse_priv, struct blk_desc *dev_desc,
+		disk_partition_t *info)
+{
+#ifdef CONFIG_FASTBOOT_FLASH_MMC_DISCARD
+	struct mmc *mmc = find_mmc_device(CONFIG_FASTBOOT_FLASH_MMC_DEV);
+#endif
+
+	memset(sparse, '\0', sizeof(*sparse));
+	sparse_priv->dev_desc = dev_desc;
+
+	sparse->blksz = info->blksz;
+	sparse->start = info->start;
+	sparse->size = info->size;
+	sparse->write = fb_mmc_sparse_write;
+	sparse->reserve = fb_mmc_sparse_reserve;
+	sparse->okay = fastboot_okay;
+	sparse->fail = fastboot_fail;
+#ifdef CONFIG_FASTBOOT_FLASH_MMC_DISCARD
+	if (mmc) {
+		sparse->discard = fb_mmc_sparse_discard;
+		sparse->discard_grp = mmc->erase_grp_size;
+	}
+#endif
+	sparse->priv = sparse_priv;
+}
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		unsigned int download_bytes)
@@ -131,18 +170,11 @@ void fb_mmc_flash_write(const char *cmd, void *download_buffer,
 		struct fb_mmc_sparse sparse_priv;
 		struct sparse_storage sparse;
 
-		sparse_priv.dev_desc = dev_desc;
-
-		sparse.blksz = info.blksz;
-		sparse.start = info.start;
-		sparse.size = info.size;
-		sparse.write = fb_mmc_sparse_write;
-		sparse.reserve = fb_mmc_sparse_reserve;
+		fb_mmc_sparse_init(&sparse, &sparse_priv, dev_desc, &info);
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
 
-		sparse.priv = &sparse_priv;
 		write_sparse_image(&sparse, cmd, download_buffer,
 				   download_bytes);
 	} else {
@@ -151,6 +183,58 @@ void fb_mmc_flash_write(const char *cmd, void *download_buffer,
 	}
 }
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+static struct fb_mmc_sparse stream_priv;
+static struct sparse_storage stream_storage;
+static struct sparse_stream *stream;
+
+int fb_mmc_flash_stream_start(const char *cmd)
+{
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+
+	dev_desc = blk_get_dev("mmc", CONFIG_FASTBOOT_FLASH_MMC_DEV);
+	if (!dev_desc || dev_desc->type == DEV_TYPE_UNKNOWN) {
+		error("invalid mmc device\n");
+		fastboot_fail("invalid mmc device");
+		return -ENODEV;
+	}
+
+	/* The GPT must be checked before anything is written */
+	if (strcmp(cmd, CONFIG_FASTBOOT_GPT_NAME) == 0) {
+		fastboot_fail("cannot stream the GPT");
+		return -EINVAL;
+	} else if (part_get_info_efi_by_name_or_alias(dev_desc, cmd, &info)) {
+		error("cannot find partition: '%s'\n", cmd);
+		fastboot_fail("cannot find partition");
+		return -ENOENT;
+	}
+
+	fb_mmc_sparse_init(&stream_storage, &stream_priv, dev_desc, &info);
+	printf("Flashing image at offset " LBAFU " as it arrives\n",
+	       stream_storage.start);
+
+	stream = sparse_stream_start(&stream_storage, cmd);
+
+	return stream ? 0 : -ENOMEM;
+}
+
+int fb_mmc_flash_stream_write(const void *data, unsigned int len)
+{
+	return sparse_stream_write(stream, data, len);
+}
+
+int fb_mmc_flash_stream_end(void)
+{
+	int ret;
+
+	ret = sparse_stream_end(stream);
+	stream = NULL;
+
+	return ret;
+}
+#endif
+
 void fb_mmc_erase(const char *cmd)
 {
 	int ret;
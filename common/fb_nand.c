@@ -114,7 +114,7 @@ static lbaint_t fb_nand_sparse_write(struct sparse_storage *info,
 			     blkcnt * info->blksz, &written);
 	if (ret < 0) {
 		printf("Failed to write sparse chunk\n");
-		return ret;
+		return 0;
 	}
 
 /* TODO - verify that the value "written" includes the "bad-blocks" ... */
@@ -129,20 +129,44 @@ static lbaint_t fb_nand_sparse_write(struct sparse_storage *info,
 static lbaint_t fb_nand_sparse_reserve(struct sparse_storage *info,
 		lbaint_t blk, lbaint_t blkcnt)
 {
-	int bad_blocks = 0;
+	struct fb_nand_sparse *sparse = info->priv;
+	size_t used = 0;
 
-/*
- * TODO - implement a function to determine the total number
- * of blocks which must be used in order to reserve the specified
- * number ("blkcnt") of "good-blocks", starting at "blk"...
- * ( possibly something like the "check_skip_len()" function )
- */
+	/*
+	 * Skip the same bad blocks that nand_write_skip_bad() would, so
+	 * that whatever follows is written where a plain write puts it.
+	 * The return value is 'blkcnt' ("good-blocks") plus the number of
+	 * "bad-blocks" encountered within this space.
+	 */
+	check_skip_len(sparse->mtd, (loff_t)blk * info->blksz,
+		       blkcnt * info->blksz, &used);
+
+	return used / info->blksz;
+}
+
+static void fb_nand_sparse_init(struct sparse_storage *sparse,
+				struct fb_nand_sparse *sparse_priv,
+				struct mtd_info *mtd, struct part_info *part)
+{
+	memset(sparse, '\0', sizeof(*sparse));
+	sparse_priv->mtd = mtd;
+	sparse_priv->part = part;
+
+	sparse->blksz = mtd->writesize;
+	sparse->start = part->offset / sparse->blksz;
+	sparse->size = part->size / sparse->blksz;
+	sparse->write = fb_nand_sparse_write;
+	sparse->reserve = fb_nand_sparse_reserve;
+	sparse->okay = fastboot_okay;
+	sparse->fail = fastboot_fail;
 
 	/*
-	 * the return value must be 'blkcnt' ("good-blocks") plus the
-	 * number of "bad-blocks" encountered within this space...
+	 * Pages which are not written stay erased. This relies on reserve()
+	 * skipping bad blocks just like write() does.
 	 */
-	return blkcnt + bad_blocks;
+	sparse->skip_erased = true;
+	sparse->erased_val = 0xffffffff;
+	sparse->priv = sparse_priv;
 }
 
 void fb_nand_flash_write(const char *cmd, void *download_buffer,
@@ -167,31 +191,23 @@ void fb_nand_flash_write(const char *cmd, void *download_buffer,
 		struct fb_nand_sparse sparse_priv;
 		struct sparse_storage sparse;
 
-		sparse_priv.mtd = mtd;
-		sparse_priv.part = part;
-
-		sparse.blksz = mtd->writesize;
-		sparse.start = part->offset / sparse.blksz;
-		sparse.size = part->size / sparse.blksz;
-		sparse.write = fb_nand_sparse_write;
-		sparse.reserve = fb_nand_sparse_reserve;
+		fb_nand_sparse_init(&sparse, &sparse_priv, mtd, part);
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
 
-		sparse.priv = &sparse_priv;
+		/* This sends the response itself */
 		write_sparse_image(&sparse, cmd, download_buffer,
 				   download_bytes);
-	} else {
-		printf("Flashing raw image at offset 0x%llx\n",
-		       part->offset);
+		return;
+	}
 
-		ret = _fb_nand_write(mtd, part, download_buffer, part->offset,
-				     download_bytes, NULL);
+	printf("Flashing raw image at offset 0x%llx\n", part->offset);
 
-		printf("........ wrote %u bytes to '%s'\n",
-		       download_bytes, part->name);
-	}
+	ret = _fb_nand_write(mtd, part, download_buffer, part->offset,
+			     download_bytes, NULL);
+
+	printf("........ wrote %u bytes to '%s'\n", download_bytes, part->name);
 
 	if (ret) {
 		fastboot_fail("error writing the image");
@@ -201,6 +217,53 @@ void fb_nand_flash_write(const char *cmd, void *download_buffer,
 	fastboot_okay("");
 }
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+static struct fb_nand_sparse stream_priv;
+static struct sparse_storage stream_storage;
+static struct sparse_stream *stream;
+
+int fb_nand_flash_stream_start(const char *cmd)
+{
+	struct part_info *part;
+	struct mtd_info *mtd = NULL;
+	int ret;
+
+	ret = fb_nand_lookup(cmd, &mtd, &part);
+	if (ret) {
+		error("invalid NAND device");
+		fastboot_fail("invalid NAND device");
+		return ret;
+	}
+
+	ret = board_fastboot_write_partition_setup(part->name);
+	if (ret)
+		return ret;
+
+	fb_nand_sparse_init(&stream_storage, &stream_priv, mtd, part);
+	printf("Flashing image at offset 0x%llx as it arrives\n",
+	       part->offset);
+
+	stream = sparse_stream_start(&stream_storage, part->name);
+
+	return stream ? 0 : -ENOMEM;
+}
+
+int fb_nand_flash_stream_write(const void *data, unsigned int len)
+{
+	return sparse_stream_write(stream, data, len);
+}
+
+int fb_nand_flash_stream_end(void)
+{
+	int ret;
+
+	ret = sparse_stream_end(stream);
+	stream = NULL;
+
+	return ret;
+}
+#endif
+
 void fb_nand_erase(const char *cmd)
 {
 	struct part_info *part;
@@ -8,7 +8,9 @@
  */
 
 #include <common.h>
+#include <errno.h>
 #include <inttypes.h>
+#include <malloc.h>
 #include <stdio_dev.h>
 #include <linux/ctype.h>
 #include <linux/types.h>
@@ -1734,3 +1736,35 @@ int fdt_fixup_display(void *blob, const char *path, const char *display)
 	}
 	return toff;
 }
+
+#if CONFIG_IS_ENABLED(OF_LIBFDT_INDEX)
+int fdt_index_setup(const void *blob)
+{
+	void *buf;
+	int size, ret;
+
+	size = fdt_index_size(blob);
+	if (size < 0)
+		return -EINVAL;
+
+	/* Leave room for the nodes added by fixups */
+	size += size / 2;
+	buf = malloc(size);
+	if (!buf)
+		return -ENOMEM;
+	ret = fdt_index_add(blob, buf, size);
+	if (ret) {
+		debug("%s: Cannot index FDT: %s\n", __func__,
+		      fdt_strerror(ret));
+		free(buf);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+void fdt_index_release(const void *blob)
+{
+	free(fdt_index_remove(blob));
+}
+#endif
@@ -13,6 +13,8 @@
 #ifndef USE_HOSTCC
 #include <common.h>
 #include <command.h>
+#include <console.h>
+#include <div64.h>
 #include <malloc.h>
 #include <mapmem.h>
 #include <hw_sha.h>
@@ -132,6 +134,10 @@ static struct hash_algo hash_algo[] = {
 		hw_sha_init,
 		hw_sha_update,
 		hw_sha_finish,
+#endif
+#ifdef CONFIG_SHA_ASYNC_HW_ACCEL
+		hw_sha_submit,
+		hw_sha_wait,
 #endif
 	}, {
 		"sha256",
@@ -142,6 +148,10 @@ static struct hash_algo hash_algo[] = {
 		hw_sha_init,
 		hw_sha_update,
 		hw_sha_finish,
+#endif
+#ifdef CONFIG_SHA_ASYNC_HW_ACCEL
+		hw_sha_submit,
+		hw_sha_wait,
 #endif
 	},
 #endif
@@ -226,6 +236,82 @@ int hash_progressive_lookup_algo(const char *algo_name,
 	return -EPROTONOSUPPORT;
 }
 
+/* Wait for the oldest job still in flight, if any, and return its index */
+static int hash_wait_oldest(struct hash_job *jobs, int first, int next)
+{
+	struct hash_job *job;
+
+	for (; first < next; first++) {
+		job = &jobs[first];
+		if (job->ret == -EINPROGRESS) {
+			job->ret = job->algo->hash_wait(job->algo, job);
+			break;
+		}
+	}
+
+	return first;
+}
+
+static int hash_job_run(void *arg)
+{
+	struct hash_job *job = arg;
+	struct hash_algo *algo = job->algo;
+
+	algo->hash_func_ws(job->data, job->len, job->output, algo->chunk_size);
+
+	return 0;
+}
+
+int hash_block_multi(struct hash_job *jobs, int count)
+{
+	struct hash_algo *algo;
+	struct hash_job *job;
+	int first = 0;		/* oldest job which may be in flight */
+	int i, ret;
+
+	for (i = 0; i < count; i++) {
+		job = &jobs[i];
+		algo = job->algo;
+		if (!algo->hash_submit) {
+			/*
+			 * Hash this one on another CPU, or here while the
+			 * hardware is busy
+			 */
+			job->ret = 0;
+			job->work.func = hash_job_run;
+			job->work.arg = job;
+			smp_work_queue(&job->work);
+			continue;
+		}
+
+		ret = algo->hash_submit(algo, job);
+		while (ret == -EBUSY && first < i) {
+			first = hash_wait_oldest(jobs, first, i);
+			ret = algo->hash_submit(algo, job);
+		}
+		if (ret == -EBUSY) {
+			/* The queue is full of someone else's jobs */
+			algo->hash_func_ws(job->data, job->len, job->output,
+					   algo->chunk_size);
+			ret = 0;
+		} else if (!ret) {
+			ret = -EINPROGRESS;
+		}
+		job->ret = ret;
+	}
+
+	while (first < count)
+		first = hash_wait_oldest(jobs, first, count);
+	smp_work_wait();
+
+	for (i = 0; i < count; i++) {
+		if (jobs[i].ret)
+			return jobs[i].ret;
+	}
+
+	return 0;
+}
+
 #ifndef USE_HOSTCC
 int hash_parse_string(const char *algo_name, const char *str, uint8_t *result)
 {
@@ -473,5 +559,45 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 
 	return 0;
 }
+
+#ifdef CONFIG_CMD_HASH_BENCH
+/* Run each algorithm for at least this long */
+#define HASH_BENCH_US	500000
+
+int hash_bench(const void *buf, ulong len)
+{
+	uint8_t output[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+	ulong start, us, rate;
+	uint64_t bytes;
+	bool hw = false;
+	int i;
+
+	printf("Algorithm      MB/s\n");
+	for (i = 0; i < ARRAY_SIZE(hash_algo); i++) {
+		algo = &hash_algo[i];
+#ifdef CONFIG_SHA_HW_ACCEL
+		hw = algo->hash_func_ws == hw_sha1 ||
+		     algo->hash_func_ws == hw_sha256;
+#endif
+		bytes = 0;
+		start = timer_get_us();
+		do {
+			algo->hash_func_ws(buf, len, output, algo->chunk_size);
+			bytes += len;
+			us = timer_get_us() - start;
+		} while (us < HASH_BENCH_US);
+		if (ctrlc())
+			return -EINTR;
+
+		/* Bytes per microsecond is MB/s, shown to one decimal place */
+		rate = lldiv(bytes * 10, us);
+		printf("%-6s %-4s %5lu.%lu\n", algo->name, hw ? "(hw)" : "",
+		       rate / 10, rate % 10);
+	}
+
+	return 0;
+}
+#endif /* CONFIG_CMD_HASH_BENCH */
 #endif
 #endif
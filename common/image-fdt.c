@@ -466,6 +466,8 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 	int ret = -EPERM;
 	int fdt_ret;
 
+	/* Fixups look up many nodes, so index them until they are done */
+	fdt_index_setup(blob);
 	if (fdt_root(blob) < 0) {
 		printf("ERROR: root node setup failed\n");
 		goto err;
@@ -497,6 +499,7 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 		}
 	}
 	fdt_fixup_ethernet(blob);
+	fdt_index_release(blob);
 
 	/* Delete the old LMB reservation */
 	if (lmb)
@@ -527,6 +530,7 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 
 	return 0;
 err:
+	fdt_index_release(blob);
 	printf(" - must RESET the board to recover.\n\n");
 
 	return ret;
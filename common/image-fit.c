@@ -942,15 +942,94 @@ int calculate_hash(const void *data, int data_len, const char *algo,
 	return 0;
 }
 
+/* hash_block_multi() is in hash.c, which SPL only has if asked for */
+#if defined(USE_HOSTCC) || !defined(CONFIG_SPL_BUILD) || \
+	defined(CONFIG_SPL_HASH_SUPPORT)
+#define FIT_HASH_BATCH		8
+#else
+#define FIT_HASH_BATCH		0
+#endif
+
+/*
+ * Hashes of image data which are calculated together before they are
+ * checked, so that hashing hardware can work on several at once. Hash nodes
+ * which are not in the batch are calculated when they are checked.
+ */
+struct fit_hash_batch {
+	int count;
+	int noffset[FIT_HASH_BATCH];		/* hash node of each job */
+	struct hash_job job[FIT_HASH_BATCH];
+	uint8_t value[FIT_HASH_BATCH][FIT_MAX_HASH_LEN];
+};
+
+static bool fit_hash_batch_supported(const char *algo)
+{
+	return (IMAGE_ENABLE_CRC32 && !strcmp(algo, "crc32")) ||
+	       (IMAGE_ENABLE_SHA1 && !strcmp(algo, "sha1")) ||
+	       (IMAGE_ENABLE_SHA256 && !strcmp(algo, "sha256"));
+}
+
+/* Add the hashes of a component image to the batch, as far as they fit */
+static void fit_hash_batch_add(struct fit_hash_batch *batch, const void *fit,
+			       int image_noffset)
+{
+	struct hash_algo *hash_algo;
+	struct hash_job *job;
+	const void *data;
+	size_t size;
+	int noffset;
+	char *algo;
+	int ignore;
+
+	if (!FIT_HASH_BATCH ||
+	    fit_image_get_data(fit, image_noffset, &data, &size))
+		return;
+
+	fdt_for_each_subnode(fit, noffset, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (batch->count == FIT_HASH_BATCH)
+			return;
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)) ||
+		    fit_image_hash_get_algo(fit, noffset, &algo) ||
+		    !fit_hash_batch_supported(algo) ||
+		    hash_lookup_algo(algo, &hash_algo))
+			continue;
+		if (IMAGE_ENABLE_IGNORE) {
+			fit_image_hash_get_ignore(fit, noffset, &ignore);
+			if (ignore)
+				continue;
+		}
+
+		job = &batch->job[batch->count];
+		job->algo = hash_algo;
+		job->data = data;
+		job->len = size;
+		job->output = batch->value[batch->count];
+		batch->noffset[batch->count++] = noffset;
+	}
+}
+
+static void fit_hash_batch_run(struct fit_hash_batch *batch)
+{
+	/* Errors are reported for each job when its hash is checked */
+	if (FIT_HASH_BATCH && batch->count)
+		hash_block_multi(batch->job, batch->count);
+}
+
 static int fit_image_check_hash(const void *fit, int noffset, const void *data,
-				size_t size, char **err_msgp)
+				size_t size, struct fit_hash_batch *batch,
+				char **err_msgp)
 {
-	uint8_t value[FIT_MAX_HASH_LEN];
+	uint8_t buf[FIT_MAX_HASH_LEN];
+	uint8_t *value = buf;
 	int value_len;
 	char *algo;
 	uint8_t *fit_value;
 	int fit_value_len;
 	int ignore;
+	int i;
 
 	*err_msgp = NULL;
 
@@ -974,7 +1053,18 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	for (i = 0; i < batch->count; i++) {
+		if (batch->noffset[i] == noffset)
+			break;
+	}
+	if (i < batch->count) {
+		if (batch->job[i].ret) {
+			*err_msgp = "Unable to calculate hash";
+			return -1;
+		}
+		value = batch->value[i];
+		value_len = batch->job[i].algo->digest_size;
+	} else if (calculate_hash(data, size, algo, value, &value_len)) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
 	}
@@ -990,20 +1080,8 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	return 0;
 }
 
-/**
- * fit_image_verify - verify data integrity
- * @fit: pointer to the FIT format image header
- * @image_noffset: component image node offset
- *
- * fit_image_verify() goes over component image hash nodes,
- * re-calculates each data hash and compares with the value stored in hash
- * node.
- *
- * returns:
- *     1, if all hashes are valid
- *     0, otherwise (or on error)
- */
-int fit_image_verify(const void *fit, int image_noffset)
+static int fit_image_verify_batch(const void *fit, int image_noffset,
+				  struct fit_hash_batch *batch)
 {
 	const void	*data;
 	size_t		size;
@@ -1038,7 +1116,7 @@ int fit_image_verify(const void *fit, int image_noffset)
 		if (!strncmp(name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
 			if (fit_image_check_hash(fit, noffset, data, size,
-						 &err_msg))
+						 batch, &err_msg))
 				goto error;
 			puts("+ ");
 		} else if (IMAGE_ENABLE_VERIFY && verify_all &&
@@ -1074,6 +1152,30 @@ error:
 	return 0;
 }
 
+/**
+ * fit_image_verify - verify data integrity
+ * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ *
+ * fit_image_verify() goes over component image hash nodes,
+ * re-calculates each data hash and compares with the value stored in hash
+ * node.
+ *
+ * returns:
+ *     1, if all hashes are valid
+ *     0, otherwise (or on error)
+ */
+int fit_image_verify(const void *fit, int image_noffset)
+{
+	struct fit_hash_batch batch;
+
+	batch.count = 0;
+	fit_hash_batch_add(&batch, fit, image_noffset);
+	fit_hash_batch_run(&batch);
+
+	return fit_image_verify_batch(fit, image_noffset, &batch);
+}
+
 /**
  * fit_all_image_verify - verify data integrity for all images
  * @fit: pointer to the FIT format image header
@@ -1087,6 +1189,7 @@ error:
  */
 int fit_all_image_verify(const void *fit)
 {
+	struct fit_hash_batch batch;
 	int images_noffset;
 	int noffset;
 	int ndepth;
@@ -1100,6 +1203,12 @@ int fit_all_image_verify(const void *fit)
 		return 0;
 	}
 
+	/* Calculate the hashes of all images together */
+	batch.count = 0;
+	fdt_for_each_subnode(fit, noffset, images_noffset)
+		fit_hash_batch_add(&batch, fit, noffset);
+	fit_hash_batch_run(&batch);
+
 	/* Process all image subnodes, check hashes for each */
 	printf("## Checking hash(es) for FIT Image at %08lx ...\n",
 	       (ulong)fit);
@@ -1116,7 +1225,7 @@ int fit_all_image_verify(const void *fit)
 			       fit_get_name(fit, noffset, NULL));
 			count++;
 
-			if (!fit_image_verify(fit, noffset))
+			if (!fit_image_verify_batch(fit, noffset, &batch))
 				return 0;
 			printf("\n");
 		}
@@ -1811,7 +1920,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		       prop_name, data, load);
 
 		dst = map_sysmem(load, len);
-		memmove(dst, buf, len);
+		smp_memcpy(dst, buf, len);
 		data = load;
 	}
 	bootstage_mark(bootstage_id + BOOTSTAGE_SUB_LOAD);
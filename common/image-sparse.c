@@ -36,12 +36,12 @@
 
 #include <config.h>
 #include <common.h>
+#include <errno.h>
 #include <image-sparse.h>
 #include <div64.h>
 #include <malloc.h>
 #include <part.h>
 #include <sparse_format.h>
-#include <fastboot.h>
 
 #include <linux/math64.h>
 
@@ -49,216 +49,619 @@
 #define CONFIG_FASTBOOT_FLASH_FILLBUF_SIZE (1024 * 512)
 #endif
 
-void write_sparse_image(
-		struct sparse_storage *info, const char *part_name,
-		void *data, unsigned sz)
-{
+/* RAW data is gathered into writes of up to this size */
+#ifndef CONFIG_FASTBOOT_FLASH_WRITEBUF_SIZE
+#define CONFIG_FASTBOOT_FLASH_WRITEBUF_SIZE (1024 * 1024)
+#endif
+
+enum sparse_state {
+	SPARSE_FILE_HEADER,
+	SPARSE_CHUNK_HEADER,
+	SPARSE_RAW,		/* data of a RAW chunk */
+	SPARSE_FILL,		/* value of a FILL chunk */
+	SPARSE_CRC32,		/* value of a CRC32 chunk */
+	SPARSE_IMAGE,		/* not a sparse image, so written as it is */
+	SPARSE_DONE,
+};
+
+/**
+ * struct sparse_stream - An image being written as it arrives
+ *
+ * Output is held back so that it can be written in large pieces: RAW data
+ * collects in @buf, and a run of blocks which need not be written (from
+ * DONT_CARE chunks, for example) is counted in @hole. At most one of these
+ * is in use at a time, and either way the output continues at @blk.
+ *
+ * @info:	Where the image goes
+ * @name:	Partition name, for messages
+ * @state:	What the next bytes of the image are
+ * @hdr:	Header or value being collected
+ * @need:	Number of bytes wanted in @hdr
+ * @have:	Number of bytes collected in @hdr
+ * @drop:	Bytes to ignore, from headers longer than we know about
+ * @blk_sz:	Block size of the sparse image
+ * @blk_ratio:	Number of device blocks in each sparse image block
+ * @chunk_hdr_sz:	Size of each chunk header
+ * @total_blks:	Number of blocks in the output image
+ * @total_chunks:	Number of chunks in the sparse image
+ * @image_checksum:	CRC32 of the output image, or 0 if not given
+ * @chunks:	Number of chunks started
+ * @chunk_sz:	Number of sparse image blocks in the current chunk
+ * @remain:	Bytes still to come in the current RAW chunk
+ * @total_blocks:	Number of sparse image blocks in the chunks so far
+ * @crc:	CRC32 of the output image so far, with zeros for DONT_CARE
+ * @blk:	Device block where the output continues
+ * @bytes_written:	Number of bytes written to the device
+ * @buf:	RAW data waiting to be written
+ * @buf_size:	Size of @buf, a whole number of device blocks
+ * @buf_len:	Number of bytes in @buf
+ * @fill_buf:	Buffer of FILL values, allocated when first needed
+ * @fill_blks:	Number of device blocks in @fill_buf
+ * @fill_val:	Value held in @fill_buf
+ * @hole:	Number of device blocks to skip before writing more
+ * @err:	First error, after which the rest of the image is ignored
+ */
+struct sparse_stream {
+	struct sparse_storage *info;
+	char name[64];
+	enum sparse_state state;
+	u8 hdr[sizeof(sparse_header_t)] __aligned(4);
+	uint need;
+	uint have;
+	uint drop;
+	uint32_t blk_sz;
+	uint blk_ratio;
+	uint chunk_hdr_sz;
+	uint32_t total_blks;
+	uint32_t total_chunks;
+	uint32_t image_checksum;
+	uint32_t chunks;
+	uint32_t chunk_sz;
+	u64 remain;
+	uint32_t total_blocks;
+	uint32_t crc;
 	lbaint_t blk;
-	lbaint_t blkcnt;
-	lbaint_t blks;
-	uint32_t bytes_written = 0;
-	unsigned int chunk;
-	unsigned int offset;
-	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
+	u64 bytes_written;
+	u8 *buf;
+	size_t buf_size;
+	size_t buf_len;
+	uint32_t *fill_buf;
+	uint fill_blks;
 	uint32_t fill_val;
-	sparse_header_t *sparse_header;
-	chunk_header_t *chunk_header;
-	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
-
-	fill_buf_num_blks = CONFIG_FASTBOOT_FLASH_FILLBUF_SIZE / info->blksz;
-
-	/* Read and skip over sparse image header */
-	sparse_header = (sparse_header_t *)data;
-
-	data += sparse_header->file_hdr_sz;
-	if (sparse_header->file_hdr_sz > sizeof(sparse_header_t)) {
-		/*
-		 * Skip the remaining bytes in a header that is longer than
-		 * we expected.
-		 */
-		data += (sparse_header->file_hdr_sz - sizeof(sparse_header_t));
+	lbaint_t hole;
+	int err;
+};
+
+/* Report the first error; anything after that is ignored */
+static int sparse_fail(struct sparse_stream *ss, int err, const char *reason)
+{
+	ss->info->fail(reason);
+	ss->err = err;
+
+	return err;
+}
+
+static int sparse_check_room(struct sparse_stream *ss, lbaint_t blkcnt)
+{
+	struct sparse_storage *info = ss->info;
+
+	if (ss->blk + blkcnt > info->start + info->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		return sparse_fail(ss, -ENOSPC,
+				   "Request would exceed partition size!");
+	}
+
+	return 0;
+}
+
+static int sparse_write_blocks(struct sparse_stream *ss, const void *data,
+			       lbaint_t blkcnt)
+{
+	struct sparse_storage *info = ss->info;
+	lbaint_t blks;
+	int ret;
+
+	ret = sparse_check_room(ss, blkcnt);
+	if (ret)
+		return ret;
+
+	blks = info->write(info, ss->blk, blkcnt, data);
+	/* blks might be > blkcnt (eg. NAND bad-blocks) */
+	if (blks < blkcnt) {
+		printf("%s: %s" LBAFU " [" LBAFU "]\n", __func__,
+		       "Write failed, block #", ss->blk, blks);
+		return sparse_fail(ss, -EIO, "flash write failure");
+	}
+	ss->blk += blks;
+	ss->bytes_written += (u64)blkcnt * info->blksz;
+
+	return 0;
+}
+
+static int sparse_flush_buf(struct sparse_stream *ss)
+{
+	uint blksz = ss->info->blksz;
+	int ret;
+
+	if (!ss->buf_len)
+		return 0;
+	ret = sparse_write_blocks(ss, ss->buf, ss->buf_len / blksz);
+	ss->buf_len = 0;
+
+	return ret;
+}
+
+/*
+ * Move past the blocks which need not be written, letting the device
+ * discard any whole groups among them
+ */
+static int sparse_flush_hole(struct sparse_stream *ss)
+{
+	struct sparse_storage *info = ss->info;
+	lbaint_t first, end;
+	u32 rem;
+	int ret;
+
+	if (!ss->hole)
+		return 0;
+	ret = sparse_check_room(ss, ss->hole);
+	if (ret)
+		return ret;
+
+	if (info->discard && info->discard_grp) {
+		div_u64_rem(ss->blk, info->discard_grp, &rem);
+		first = ss->blk + (rem ? info->discard_grp - rem : 0);
+		end = ss->blk + ss->hole;
+		div_u64_rem(end, info->discard_grp, &rem);
+		end -= rem;
+		if (first < end && info->discard(info, first, end - first)) {
+			printf("%s: Discard failed, block #" LBAFU "\n",
+			       __func__, first);
+			return sparse_fail(ss, -EIO, "flash discard failure");
+		}
+	}
+
+	ss->blk += info->reserve(info, ss->blk, ss->hole);
+	ss->hole = 0;
+
+	return 0;
+}
+
+static int sparse_skip(struct sparse_stream *ss, lbaint_t blkcnt)
+{
+	int ret;
+
+	ret = sparse_flush_buf(ss);
+	if (ret)
+		return ret;
+	ss->hole += blkcnt;
+
+	return 0;
+}
+
+/* Write RAW data, gathering small pieces into large writes */
+static int sparse_raw(struct sparse_stream *ss, const u8 *data, size_t len)
+{
+	uint blksz = ss->info->blksz;
+	size_t part;
+	int ret;
+
+	ret = sparse_flush_hole(ss);
+	if (ret)
+		return ret;
+
+	for (; len; data += part, len -= part) {
+		if (!ss->buf_len && len >= ss->buf_size) {
+			/* There is plenty here, so write it in place */
+			part = len - len % blksz;
+			ret = sparse_write_blocks(ss, data, part / blksz);
+		} else {
+			part = min(len, ss->buf_size - ss->buf_len);
+			memcpy(ss->buf + ss->buf_len, data, part);
+			ss->buf_len += part;
+			if (ss->buf_len == ss->buf_size)
+				ret = sparse_flush_buf(ss);
+		}
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int sparse_fill(struct sparse_stream *ss, uint32_t fill_val,
+		       lbaint_t blkcnt)
+{
+	struct sparse_storage *info = ss->info;
+	uint blksz = info->blksz;
+	lbaint_t i, j;
+	uint k;
+	int ret;
+
+	ret = sparse_flush_hole(ss);
+	if (!ret)
+		ret = sparse_flush_buf(ss);
+	if (ret)
+		return ret;
+
+	if (!ss->fill_buf) {
+		ss->fill_blks = max(CONFIG_FASTBOOT_FLASH_FILLBUF_SIZE / blksz,
+				    1U);
+		ss->fill_buf = memalign(ARCH_DMA_MINALIGN,
+					ROUNDUP(blksz * ss->fill_blks,
+						ARCH_DMA_MINALIGN));
+		if (!ss->fill_buf)
+			return sparse_fail(ss, -ENOMEM,
+					   "Malloc failed for: CHUNK_TYPE_FILL");
+		ss->fill_val = ~fill_val;
+	}
+	if (ss->fill_val != fill_val) {
+		for (k = 0; k < blksz * ss->fill_blks / sizeof(fill_val); k++)
+			ss->fill_buf[k] = fill_val;
+		ss->fill_val = fill_val;
+	}
+
+	for (i = 0; i < blkcnt; i += j) {
+		j = min(blkcnt - i, (lbaint_t)ss->fill_blks);
+		ret = sparse_write_blocks(ss, ss->fill_buf, j);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Add @count copies of @len bytes with CRC32 @unit to the running CRC */
+static uint32_t sparse_crc_repeat(uint32_t crc, uint32_t unit, u64 len,
+				  u64 count)
+{
+	while (count) {
+		if (count & 1)
+			crc = crc32_combine(crc, unit, len);
+		count >>= 1;
+		if (count) {
+			unit = crc32_combine(unit, unit, len);
+			len <<= 1;
+		}
+	}
+
+	return crc;
+}
+
+/* Get ready to collect @need bytes of a header or value */
+static void sparse_expect(struct sparse_stream *ss, enum sparse_state state,
+			  uint need)
+{
+	ss->state = state;
+	ss->need = need;
+	ss->have = 0;
+}
+
+static void sparse_next_chunk(struct sparse_stream *ss)
+{
+	if (ss->chunks == ss->total_chunks)
+		ss->state = SPARSE_DONE;
+	else
+		sparse_expect(ss, SPARSE_CHUNK_HEADER, sizeof(chunk_header_t));
+}
+
+static int sparse_file_header(struct sparse_stream *ss)
+{
+	sparse_header_t *sparse_header = (sparse_header_t *)ss->hdr;
+	uint blksz = ss->info->blksz;
+	uint file_hdr_sz;
+
+	if (!is_sparse_image(sparse_header)) {
+		puts("Flashing Raw Image\n");
+		ss->state = SPARSE_IMAGE;
+		return sparse_raw(ss, ss->hdr, ss->have);
 	}
 
 	debug("=== Sparse Image Header ===\n");
-	debug("magic: 0x%x\n", sparse_header->magic);
-	debug("major_version: 0x%x\n", sparse_header->major_version);
-	debug("minor_version: 0x%x\n", sparse_header->minor_version);
-	debug("file_hdr_sz: %d\n", sparse_header->file_hdr_sz);
-	debug("chunk_hdr_sz: %d\n", sparse_header->chunk_hdr_sz);
-	debug("blk_sz: %d\n", sparse_header->blk_sz);
-	debug("total_blks: %d\n", sparse_header->total_blks);
-	debug("total_chunks: %d\n", sparse_header->total_chunks);
+	debug("magic: 0x%x\n", le32_to_cpu(sparse_header->magic));
+	debug("major_version: 0x%x\n",
+	      le16_to_cpu(sparse_header->major_version));
+	debug("minor_version: 0x%x\n",
+	      le16_to_cpu(sparse_header->minor_version));
+	debug("file_hdr_sz: %d\n", le16_to_cpu(sparse_header->file_hdr_sz));
+	debug("chunk_hdr_sz: %d\n", le16_to_cpu(sparse_header->chunk_hdr_sz));
+	debug("blk_sz: %d\n", le32_to_cpu(sparse_header->blk_sz));
+	debug("total_blks: %d\n", le32_to_cpu(sparse_header->total_blks));
+	debug("total_chunks: %d\n", le32_to_cpu(sparse_header->total_chunks));
+
+	file_hdr_sz = le16_to_cpu(sparse_header->file_hdr_sz);
+	ss->chunk_hdr_sz = le16_to_cpu(sparse_header->chunk_hdr_sz);
+	ss->blk_sz = le32_to_cpu(sparse_header->blk_sz);
+	ss->total_blks = le32_to_cpu(sparse_header->total_blks);
+	ss->total_chunks = le32_to_cpu(sparse_header->total_chunks);
+	ss->image_checksum = le32_to_cpu(sparse_header->image_checksum);
+
+	if (file_hdr_sz < sizeof(sparse_header_t) ||
+	    ss->chunk_hdr_sz < sizeof(chunk_header_t))
+		return sparse_fail(ss, -EINVAL, "Bogus sparse image header");
 
 	/*
 	 * Verify that the sparse block size is a multiple of our
 	 * storage backend block size
 	 */
-	div_u64_rem(sparse_header->blk_sz, info->blksz, &offset);
-	if (offset) {
+	if (!ss->blk_sz || ss->blk_sz % blksz) {
 		printf("%s: Sparse image block size issue [%u]\n",
-		       __func__, sparse_header->blk_sz);
-		fastboot_fail("sparse image block size issue");
-		return;
+		       __func__, ss->blk_sz);
+		return sparse_fail(ss, -EINVAL,
+				   "sparse image block size issue");
 	}
+	ss->blk_ratio = ss->blk_sz / blksz;
 
 	puts("Flashing Sparse Image\n");
 
-	/* Start processing chunks */
-	blk = info->start;
-	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
-		/* Read and skip over chunk header */
-		chunk_header = (chunk_header_t *)data;
-		data += sizeof(chunk_header_t);
-
-		if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
-			debug("=== Chunk Header ===\n");
-			debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
-			debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
-			debug("total_size: 0x%x\n", chunk_header->total_sz);
-		}
+	/* Skip the remaining bytes in a header that is longer than expected */
+	ss->drop = file_hdr_sz - sizeof(sparse_header_t);
+	sparse_next_chunk(ss);
+
+	return 0;
+}
+
+static int sparse_chunk_header(struct sparse_stream *ss)
+{
+	chunk_header_t *chunk_header = (chunk_header_t *)ss->hdr;
+	uint type = le16_to_cpu(chunk_header->chunk_type);
+	uint32_t total_sz = le32_to_cpu(chunk_header->total_sz);
+	u64 chunk_data_sz;
+	int ret;
+
+	ss->chunk_sz = le32_to_cpu(chunk_header->chunk_sz);
+	chunk_data_sz = (u64)ss->blk_sz * ss->chunk_sz;
+	ss->chunks++;
+
+	if (type != CHUNK_TYPE_RAW) {
+		debug("=== Chunk Header ===\n");
+		debug("chunk_type: 0x%x\n", type);
+		debug("chunk_data_sz: 0x%x\n", ss->chunk_sz);
+		debug("total_size: 0x%x\n", total_sz);
+	}
+
+	/* Skip the remaining bytes in a header that is longer than expected */
+	ss->drop = ss->chunk_hdr_sz - sizeof(chunk_header_t);
+
+	switch (type) {
+	case CHUNK_TYPE_RAW:
+		if (total_sz != ss->chunk_hdr_sz + chunk_data_sz)
+			return sparse_fail(ss, -EINVAL,
+					   "Bogus chunk size for chunk type Raw");
+		ss->total_blocks += ss->chunk_sz;
+		ss->remain = chunk_data_sz;
+		if (ss->remain)
+			ss->state = SPARSE_RAW;
+		else
+			sparse_next_chunk(ss);
+		break;
+
+	case CHUNK_TYPE_FILL:
+		if (total_sz != ss->chunk_hdr_sz + sizeof(uint32_t))
+			return sparse_fail(ss, -EINVAL,
+					   "Bogus chunk size for chunk type FILL");
+		sparse_expect(ss, SPARSE_FILL, sizeof(uint32_t));
+		break;
+
+	case CHUNK_TYPE_DONT_CARE:
+		if (total_sz != ss->chunk_hdr_sz)
+			return sparse_fail(ss, -EINVAL,
+				"Bogus chunk size for chunk type Dont Care");
+		ret = sparse_skip(ss, (lbaint_t)ss->chunk_sz * ss->blk_ratio);
+		if (ret)
+			return ret;
+		ss->crc = crc32_zeros(ss->crc, chunk_data_sz);
+		ss->total_blocks += ss->chunk_sz;
+		sparse_next_chunk(ss);
+		break;
+
+	case CHUNK_TYPE_CRC32:
+		if (total_sz != ss->chunk_hdr_sz + sizeof(uint32_t))
+			return sparse_fail(ss, -EINVAL,
+				"Bogus chunk size for chunk type CRC32");
+		sparse_expect(ss, SPARSE_CRC32, sizeof(uint32_t));
+		break;
+
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__, type);
+		return sparse_fail(ss, -EINVAL, "Unknown chunk type");
+	}
+
+	return 0;
+}
+
+/* The FILL value is kept as it is in the image, in its byte order */
+static int sparse_fill_chunk(struct sparse_stream *ss)
+{
+	struct sparse_storage *info = ss->info;
+	lbaint_t blkcnt = (lbaint_t)ss->chunk_sz * ss->blk_ratio;
+	u64 chunk_data_sz = (u64)ss->blk_sz * ss->chunk_sz;
+	uint32_t fill_val;
+	int ret;
+
+	memcpy(&fill_val, ss->hdr, sizeof(fill_val));
+	if (info->skip_erased && fill_val == info->erased_val)
+		ret = sparse_skip(ss, blkcnt);
+	else
+		ret = sparse_fill(ss, fill_val, blkcnt);
+	if (ret)
+		return ret;
+
+	if (fill_val)
+		ss->crc = sparse_crc_repeat(ss->crc,
+					    crc32(0, (uchar *)&fill_val,
+						  sizeof(fill_val)),
+					    sizeof(fill_val),
+					    chunk_data_sz / sizeof(fill_val));
+	else
+		ss->crc = crc32_zeros(ss->crc, chunk_data_sz);
+	ss->total_blocks += ss->chunk_sz;
+	sparse_next_chunk(ss);
+
+	return 0;
+}
+
+static int sparse_crc32_chunk(struct sparse_stream *ss)
+{
+	uint32_t crc = le32_to_cpu(*(__le32 *)ss->hdr);
+
+	if (crc != ss->crc) {
+		printf("%s: CRC32 %08x, expected %08x\n", __func__, ss->crc,
+		       crc);
+		return sparse_fail(ss, -EBADMSG, "sparse image CRC32 mismatch");
+	}
+	ss->total_blocks += ss->chunk_sz;
+	sparse_next_chunk(ss);
 
-		if (sparse_header->chunk_hdr_sz > sizeof(chunk_header_t)) {
-			/*
-			 * Skip the remaining bytes in a header that is longer
-			 * than we expected.
-			 */
-			data += (sparse_header->chunk_hdr_sz -
-				 sizeof(chunk_header_t));
+	return 0;
+}
+
+struct sparse_stream *sparse_stream_start(struct sparse_storage *info,
+					  const char *part_name)
+{
+	struct sparse_stream *ss;
+	uint blksz = info->blksz;
+
+	ss = calloc(1, sizeof(*ss));
+	if (ss) {
+		ss->buf_size = max(CONFIG_FASTBOOT_FLASH_WRITEBUF_SIZE / blksz,
+				   1U) * blksz;
+		ss->buf = memalign(ARCH_DMA_MINALIGN, ss->buf_size);
+	}
+	if (!ss || !ss->buf) {
+		free(ss);
+		info->fail("Malloc failed for sparse image");
+		return NULL;
+	}
+
+	ss->info = info;
+	strlcpy(ss->name, part_name, sizeof(ss->name));
+	ss->blk = info->start;
+	sparse_expect(ss, SPARSE_FILE_HEADER, sizeof(sparse_header_t));
+
+	return ss;
+}
+
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			size_t len)
+{
+	const u8 *ptr = data;
+	size_t part;
+	int ret = 0;
+
+	for (; len && !ss->err; ptr += part, len -= part) {
+		if (ss->drop) {
+			part = min(len, (size_t)ss->drop);
+			ss->drop -= part;
+			continue;
 		}
 
-		chunk_data_sz = sparse_header->blk_sz * chunk_header->chunk_sz;
-		blkcnt = chunk_data_sz / info->blksz;
-		switch (chunk_header->chunk_type) {
-		case CHUNK_TYPE_RAW:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
-				fastboot_fail(
-					"Bogus chunk size for chunk type Raw");
-				return;
-			}
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				fastboot_fail(
-				    "Request would exceed partition size!");
-				return;
-			}
-
-			blks = info->write(info, blk, blkcnt, data);
-			/* blks might be > blkcnt (eg. NAND bad-blocks) */
-			if (blks < blkcnt) {
-				printf("%s: %s" LBAFU " [" LBAFU "]\n",
-				       __func__, "Write failed, block #",
-				       blk, blks);
-				fastboot_fail(
-					      "flash write failure");
-				return;
-			}
-			blk += blks;
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
+		switch (ss->state) {
+		case SPARSE_RAW:
+			part = min_t(u64, len, ss->remain);
+			ss->crc = crc32(ss->crc, ptr, part);
+			ret = sparse_raw(ss, ptr, part);
+			ss->remain -= part;
+			if (!ss->remain)
+				sparse_next_chunk(ss);
 			break;
-
-		case CHUNK_TYPE_FILL:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
-				fastboot_fail(
-					"Bogus chunk size for chunk type FILL");
-				return;
-			}
-
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				fastboot_fail(
-					"Malloc failed for: CHUNK_TYPE_FILL");
-				return;
-			}
-
-			fill_val = *(uint32_t *)data;
-			data = (char *)data + sizeof(uint32_t);
-
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				fastboot_fail(
-				    "Request would exceed partition size!");
-				return;
-			}
-
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					fastboot_fail(
-						      "flash write failure");
-					free(fill_buf);
-					return;
-				}
-				blk += blks;
-				i += j;
-			}
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
+		case SPARSE_IMAGE:
+			part = len;
+			ret = sparse_raw(ss, ptr, part);
 			break;
-
-		case CHUNK_TYPE_DONT_CARE:
-			blk += info->reserve(info, blk, blkcnt);
-			total_blocks += chunk_header->chunk_sz;
+		case SPARSE_DONE:
+			/* Anything after the last chunk is ignored */
+			part = len;
 			break;
-
-		case CHUNK_TYPE_CRC32:
-			if (chunk_header->total_sz !=
-			    sparse_header->chunk_hdr_sz) {
-				fastboot_fail(
-					"Bogus chunk size for chunk type Dont Care");
-				return;
-			}
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
+		default:
+			part = min(len, (size_t)(ss->need - ss->have));
+			memcpy(ss->hdr + ss->have, ptr, part);
+			ss->have += part;
+			if (ss->have < ss->need)
+				break;
+			if (ss->state == SPARSE_FILE_HEADER)
+				ret = sparse_file_header(ss);
+			else if (ss->state == SPARSE_CHUNK_HEADER)
+				ret = sparse_chunk_header(ss);
+			else if (ss->state == SPARSE_FILL)
+				ret = sparse_fill_chunk(ss);
+			else
+				ret = sparse_crc32_chunk(ss);
 			break;
+		}
+		if (ret)
+			return ret;
+	}
 
-		default:
-			printf("%s: Unknown chunk type: %x\n", __func__,
-			       chunk_header->chunk_type);
-			fastboot_fail("Unknown chunk type");
-			return;
+	return ss->err;
+}
+
+int sparse_stream_end(struct sparse_stream *ss)
+{
+	struct sparse_storage *info = ss->info;
+	uint blksz = info->blksz;
+	size_t pad;
+	int ret = ss->err;
+
+	/* Anything too short for a sparse header is written as it is */
+	if (!ret && ss->state == SPARSE_FILE_HEADER) {
+		puts("Flashing Raw Image\n");
+		ss->state = SPARSE_IMAGE;
+		ret = sparse_raw(ss, ss->hdr, ss->have);
+	}
+
+	/* Fill out the last block of a raw image */
+	pad = ss->buf_len % blksz;
+	if (!ret && pad) {
+		pad = blksz - pad;
+		memset(ss->buf + ss->buf_len,
+		       info->skip_erased ? (u8)info->erased_val : 0, pad);
+		ss->buf_len += pad;
+	}
+
+	if (!ret)
+		ret = sparse_flush_buf(ss);
+	if (!ret)
+		ret = sparse_flush_hole(ss);
+
+	if (!ret && ss->state != SPARSE_IMAGE) {
+		debug("Wrote %d blocks, expected to write %d blocks\n",
+		      ss->total_blocks, ss->total_blks);
+		if (ss->state != SPARSE_DONE ||
+		    ss->total_blocks != ss->total_blks) {
+			ret = sparse_fail(ss, -EINVAL,
+					  "sparse image write failure");
+		} else if (ss->image_checksum &&
+			   ss->image_checksum != ss->crc) {
+			printf("%s: image checksum %08x, expected %08x\n",
+			       __func__, ss->crc, ss->image_checksum);
+			ret = sparse_fail(ss, -EBADMSG,
+					  "sparse image checksum mismatch");
 		}
 	}
 
-	debug("Wrote %d blocks, expected to write %d blocks\n",
-	      total_blocks, sparse_header->total_blks);
-	printf("........ wrote %u bytes to '%s'\n", bytes_written, part_name);
+	if (!ret) {
+		printf("........ wrote %llu bytes to '%s'\n", ss->bytes_written,
+		       ss->name);
+		info->okay("");
+	}
 
-	if (total_blocks != sparse_header->total_blks)
-		fastboot_fail("sparse image write failure");
-	else
-		fastboot_okay("");
+	free(ss->fill_buf);
+	free(ss->buf);
+	free(ss);
+
+	return ret;
+}
 
-	return;
+void write_sparse_image(
+		struct sparse_storage *info, const char *part_name,
+		void *data, unsigned sz)
+{
+	struct sparse_stream *ss;
+
+	ss = sparse_stream_start(info, part_name);
+	if (!ss)
+		return;
+	sparse_stream_write(ss, data, sz);
+	sparse_stream_end(ss);
 }
@@ -0,0 +1,118 @@
+/*
+ * Size-class allocator for small malloc() requests
+ *
+ * Driver model, the environment and the filesystems make many small
+ * allocations which are soon freed again. Each size class keeps its free
+ * objects on a list, so these are served without searching dlmalloc's bins
+ * and without a header on each object.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <malloc_slab.h>
+
+static const ushort slab_sizes[SLAB_CLASSES] = {
+	16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, SLAB_MAX_SIZE,
+};
+
+/* Class for each request size, in steps of 16 bytes */
+static const u8 slab_size_class[SLAB_MAX_SIZE / 16 + 1] = {
+	0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+};
+
+void slab_init(struct slab_heap *heap, ulong end, ulong limit,
+	       uint page_size)
+{
+	memset(heap, '\0', sizeof(*heap));
+	heap->end = end & ~(ulong)(page_size - 1);
+	heap->base = heap->end;
+	heap->limit = limit;
+	heap->page_size = page_size;
+}
+
+uint slab_class_size(int cls)
+{
+	return slab_sizes[cls];
+}
+
+/* Give a new page to class @cls and put its objects on the free list */
+static int slab_add_page(struct slab_heap *heap, int cls)
+{
+	struct slab_class *sc = &heap->cls[cls];
+	uint size = slab_sizes[cls];
+	ulong page, obj;
+
+	if (heap->base < heap->limit ||
+	    heap->base - heap->limit < heap->page_size)
+		return -ENOSPC;
+	page = heap->base - heap->page_size;
+	heap->base = page;
+	*(u8 *)page = cls;
+	sc->pages++;
+
+	for (obj = page + heap->page_size - size;
+	     obj >= page + SLAB_PAGE_HDR; obj -= size) {
+		*(void **)obj = sc->free;
+		sc->free = (void *)obj;
+	}
+
+	return 0;
+}
+
+void *slab_alloc(struct slab_heap *heap, size_t size)
+{
+	struct slab_class *sc;
+	void *ptr;
+	int cls;
+
+	if (size > SLAB_MAX_SIZE)
+		return NULL;
+	cls = slab_size_class[(size + 15) / 16];
+	sc = &heap->cls[cls];
+	if (!sc->free && slab_add_page(heap, cls)) {
+		sc->misses++;
+		return NULL;
+	}
+
+	ptr = sc->free;
+	sc->free = *(void **)ptr;
+	sc->allocs++;
+	if (++sc->in_use > sc->peak)
+		sc->peak = sc->in_use;
+
+	return ptr;
+}
+
+size_t slab_size(const struct slab_heap *heap, const void *ptr)
+{
+	ulong addr = (ulong)ptr;
+
+	if (addr < heap->base || addr >= heap->end)
+		return 0;
+
+	return slab_sizes[*(u8 *)(addr & ~(ulong)(heap->page_size - 1))];
+}
+
+void slab_free(struct slab_heap *heap, void *ptr)
+{
+	ulong page = (ulong)ptr & ~(ulong)(heap->page_size - 1);
+	struct slab_class *sc = &heap->cls[*(u8 *)page];
+
+	*(void **)ptr = sc->free;
+	sc->free = ptr;
+	sc->frees++;
+	sc->in_use--;
+}
+
+ulong slab_used(const struct slab_heap *heap)
+{
+	ulong used = 0;
+	int i;
+
+	for (i = 0; i < SLAB_CLASSES; i++)
+		used += (ulong)heap->cls[i].in_use * slab_sizes[i];
+
+	return used;
+}
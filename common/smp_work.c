@@ -0,0 +1,223 @@
+/*
+ * Run independent jobs on the secondary CPUs
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <smp_work.h>
+#include <watchdog.h>
+
+/*
+ * The secondary CPUs normally sit idle while the boot CPU verifies,
+ * decompresses and copies images. Jobs queued here are taken by whichever
+ * CPU gets to them first, the boot CPU included once it waits for them.
+ *
+ * Only the boot CPU adds jobs. The queue is a ring of job pointers with
+ * three free-running counters: @head is only written by the boot CPU,
+ * @next is advanced by the CPU taking a job and @done counts finished jobs.
+ * A slot is reused only once its job has been taken.
+ */
+#define SMP_WORK_SLOTS		64
+
+/* Below this, splitting up a copy costs more than it saves */
+#define SMP_COPY_MIN		(256 << 10)
+#define SMP_COPY_JOBS		8
+#define SMP_COPY_ALIGN		64
+
+static struct smp_work_queue {
+	struct smp_work *slot[SMP_WORK_SLOTS];
+	unsigned int head;	/* jobs queued */
+	unsigned int next;	/* jobs taken by a CPU */
+	unsigned int done;	/* jobs finished */
+	int stop;		/* tells the secondary CPUs to park */
+	int helpers;		/* number of secondary CPUs running jobs */
+	bool started;
+} queue;
+
+struct smp_copy {
+	struct smp_work work;
+	void *dst;
+	const void *src;	/* NULL to fill with @c */
+	size_t len;
+	int c;
+};
+
+static struct smp_work *smp_work_take(void)
+{
+	struct smp_work *work;
+	unsigned int next;
+
+	next = __atomic_load_n(&queue.next, __ATOMIC_ACQUIRE);
+	do {
+		if (next == __atomic_load_n(&queue.head, __ATOMIC_ACQUIRE))
+			return NULL;
+		work = __atomic_load_n(&queue.slot[next % SMP_WORK_SLOTS],
+				       __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n(&queue.next, &next, next + 1,
+					      false, __ATOMIC_ACQ_REL,
+					      __ATOMIC_ACQUIRE));
+
+	return work;
+}
+
+static void smp_work_do(struct smp_work *work)
+{
+	work->ret = work->func(work->arg);
+	__atomic_add_fetch(&queue.done, 1, __ATOMIC_RELEASE);
+}
+
+void smp_work_run(int cpu)
+{
+	struct smp_work *work;
+
+	while (!__atomic_load_n(&queue.stop, __ATOMIC_ACQUIRE)) {
+		work = smp_work_take();
+		if (work)
+			smp_work_do(work);
+		else
+			smp_work_arch_idle(cpu);
+	}
+}
+
+static void smp_work_start(void)
+{
+	int ret;
+
+	queue.stop = 0;
+	queue.started = true;
+	ret = smp_work_arch_start();
+	queue.helpers = max(ret, 0);
+	debug("%s: %d secondary CPUs\n", __func__, queue.helpers);
+}
+
+int smp_work_cpus(void)
+{
+	if (!queue.started)
+		smp_work_start();
+
+	return queue.helpers + 1;
+}
+
+void smp_work_queue(struct smp_work *work)
+{
+	struct smp_work *other;
+
+	if (smp_work_cpus() == 1) {
+		work->ret = work->func(work->arg);
+		return;
+	}
+
+	/* Make room by running the oldest jobs here */
+	while (queue.head - __atomic_load_n(&queue.next, __ATOMIC_ACQUIRE) >=
+	       SMP_WORK_SLOTS) {
+		other = smp_work_take();
+		if (other)
+			smp_work_do(other);
+		WATCHDOG_RESET();
+	}
+
+	__atomic_store_n(&queue.slot[queue.head % SMP_WORK_SLOTS], work,
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&queue.head, queue.head + 1, __ATOMIC_RELEASE);
+	smp_work_arch_kick();
+}
+
+void smp_work_wait(void)
+{
+	struct smp_work *work;
+
+	while ((work = smp_work_take())) {
+		smp_work_do(work);
+		WATCHDOG_RESET();
+	}
+
+	/* Anything left is running on another CPU */
+	while (__atomic_load_n(&queue.done, __ATOMIC_ACQUIRE) != queue.head)
+		WATCHDOG_RESET();
+}
+
+void smp_work_stop(void)
+{
+	if (!queue.started)
+		return;
+
+	smp_work_wait();
+	if (queue.helpers) {
+		__atomic_store_n(&queue.stop, 1, __ATOMIC_RELEASE);
+		smp_work_arch_kick();
+		smp_work_arch_stop();
+	}
+	queue.helpers = 0;
+	queue.started = false;
+}
+
+static int smp_copy_run(void *arg)
+{
+	struct smp_copy *copy = arg;
+
+	if (copy->src)
+		memcpy(copy->dst, copy->src, copy->len);
+	else
+		memset(copy->dst, copy->c, copy->len);
+
+	return 0;
+}
+
+static void smp_copy(void *dst, const void *src, int c, size_t len)
+{
+	struct smp_copy copy[SMP_COPY_JOBS];
+	size_t chunk, offset;
+	int count, i;
+
+	count = min(smp_work_cpus(), SMP_COPY_JOBS);
+	if (count < 2 || len < 2 * SMP_COPY_MIN) {
+		if (src)
+			memcpy(dst, src, len);
+		else
+			memset(dst, c, len);
+		return;
+	}
+
+	chunk = ALIGN(DIV_ROUND_UP(len, count), SMP_COPY_ALIGN);
+	for (i = 0, offset = 0; offset < len; i++, offset += chunk) {
+		copy[i].work.func = smp_copy_run;
+		copy[i].work.arg = &copy[i];
+		copy[i].dst = dst + offset;
+		copy[i].src = src ? src + offset : NULL;
+		copy[i].len = min(chunk, len - offset);
+		copy[i].c = c;
+		smp_work_queue(&copy[i].work);
+	}
+	smp_work_wait();
+}
+
+void smp_memcpy(void *dst, const void *src, size_t len)
+{
+	if (dst < src + len && src < dst + len)
+		memmove(dst, src, len);
+	else
+		smp_copy(dst, src, 0, len);
+}
+
+void smp_memset(void *s, int c, size_t len)
+{
+	smp_copy(s, NULL, c, len);
+}
+
+__weak int smp_work_arch_start(void)
+{
+	return 0;
+}
+
+__weak void smp_work_arch_stop(void)
+{
+}
+
+__weak void smp_work_arch_kick(void)
+{
+}
+
+__weak void smp_work_arch_idle(int cpu)
+{
+}
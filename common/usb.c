@@ -285,6 +285,41 @@ int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 		return -EIO;
 }
 
+/*
+ * submits a chain of bulk transfers to the same endpoint and waits for
+ * completion. The actual length of each segment is returned in the segment.
+ * Controllers which cannot chain transfers get each segment in turn.
+ */
+int usb_bulk_msg_chain(struct usb_device *dev, unsigned int pipe,
+		       struct usb_bulk_seg *seg, int count, int timeout)
+{
+	int ret, i;
+
+	if (count < 1 || count > USB_MAX_BULK_SEGS)
+		return -EINVAL;
+	for (i = 0; i < count; i++) {
+		if (seg[i].length < 0)
+			return -EINVAL;
+		seg[i].act_len = 0;
+	}
+	dev->status = USB_ST_NOT_PROC; /*not yet processed */
+	ret = submit_bulk_chain(dev, pipe, seg, count);
+	if (ret == -ENOSYS) {
+		for (i = 0; i < count; i++) {
+			ret = usb_bulk_msg(dev, pipe, seg[i].buffer,
+					   seg[i].length, &seg[i].act_len,
+					   timeout);
+			if (ret)
+				return ret;
+		}
+		return 0;
+	}
+	if (ret < 0 || dev->status)
+		return -EIO;
+
+	return 0;
+}
+
 
 /*-------------------------------------------------------------------
  * Max Packet stuff
@@ -915,6 +950,18 @@ __weak int usb_alloc_device(struct usb_device *udev)
 {
 	return 0;
 }
+
+/* Controllers which can chain bulk transfers override this */
+__weak int submit_bulk_chain(struct usb_device *dev, unsigned long pipe,
+			     struct usb_bulk_seg *seg, int count)
+{
+	return -ENOSYS;
+}
+
+__weak int usb_get_max_xfer_size(struct usb_device *dev, size_t *size)
+{
+	return -ENOSYS;
+}
 #endif /* !CONFIG_DM_USB */
 
 static int usb_hub_port_reset(struct usb_device *dev, struct usb_device *hub)
@@ -98,19 +98,28 @@ struct us_data {
 	ccb		*srb;			/* current srb */
 	trans_reset	transport_reset;	/* reset routine */
 	trans_cmnd	transport;		/* transport routine */
+	unsigned short	max_xfer_blk;		/* blocks per READ/WRITE(10) */
 };
 
+/* The SCSI READ(10) and WRITE(10) commands are limited to 65535 blocks */
+#define USB_MAX_RW10_BLK	65535
+
 #ifdef CONFIG_USB_EHCI
 /*
  * The U-Boot EHCI driver can handle any transfer length as long as there is
- * enough free heap space left, but the SCSI READ(10) and WRITE(10) commands are
- * limited to 65535 blocks.
+ * enough free heap space left.
  */
-#define USB_MAX_XFER_BLK	65535
+#define USB_MAX_XFER_BLK	USB_MAX_RW10_BLK
 #else
 #define USB_MAX_XFER_BLK	20
 #endif
 
+/*
+ * Some devices fail large transfers. Each failed full-sized transfer halves
+ * the transfer size for the device, down to this, until it is scanned again.
+ */
+#define USB_MIN_XFER_BLK	8
+
 #ifndef CONFIG_BLK
 static struct us_data usb_stor[USB_MAX_STOR_DEV];
 #endif
@@ -755,8 +764,28 @@ static int usb_stor_BBB_transport(ccb *srb, struct us_data *us)
 	else
 		pipe = pipeout;
 
-	result = usb_bulk_msg(us->pusb_dev, pipe, srb->pdata, srb->datalen,
-			      &data_actlen, USB_CNTL_TIMEOUT * 5);
+	if (dir_in) {
+		/*
+		 * Queue the status behind the data, so the controller can
+		 * collect it without waiting for us.
+		 */
+		struct usb_bulk_seg seg[] = {
+			{ .buffer = srb->pdata, .length = srb->datalen },
+			{ .buffer = csw, .length = UMASS_BBB_CSW_SIZE },
+		};
+
+		result = usb_bulk_msg_chain(us->pusb_dev, pipein, seg,
+					    ARRAY_SIZE(seg),
+					    USB_CNTL_TIMEOUT * 5);
+		data_actlen = seg[0].act_len;
+		actlen = seg[1].act_len;
+		if (result >= 0 && actlen == UMASS_BBB_CSW_SIZE)
+			goto check_csw;
+	} else {
+		result = usb_bulk_msg(us->pusb_dev, pipe, srb->pdata,
+				      srb->datalen, &data_actlen,
+				      USB_CNTL_TIMEOUT * 5);
+	}
 	/* special handling of STALL in DATA phase */
 	if ((result < 0) && (us->pusb_dev->status & USB_ST_STALLED)) {
 		debug("DATA:stall\n");
@@ -808,6 +837,7 @@ again:
 		printf("ptr[%d] %#x ", index, ptr[index]);
 	printf("\n");
 #endif
+check_csw:
 	/* misuse pipe to get the residue */
 	pipe = le32_to_cpu(csw->dCSWDataResidue);
 	if (pipe == 0 && srb->datalen != 0 && srb->datalen - data_actlen != 0)
@@ -989,6 +1019,7 @@ static int usb_request_sense(ccb *srb, struct us_data *ss)
 	srb->datalen = 18;
 	srb->pdata = &srb->sense_buf[0];
 	srb->cmdlen = 12;
+	memset(srb->sense_buf, '\0', srb->datalen);
 	ss->transport(srb, ss);
 	debug("Request Sense returned %02X %02X %02X\n",
 	      srb->sense_buf[2], srb->sense_buf[12],
@@ -1104,6 +1135,42 @@ static void usb_bin_fixup(struct usb_device_descriptor descriptor,
 }
 #endif /* CONFIG_USB_BIN_FIXUP */
 
+/*
+ * After a failed full-sized transfer, try again with half as many blocks, in
+ * case the device cannot manage that many at once. The first transfer of a
+ * request counts as full-sized, but a shorter one after it does not, since
+ * larger ones have just worked. A medium error or an illegal request is not
+ * down to the size, so is left to the normal retries. Returns true to retry.
+ */
+static bool usb_stor_reduce_xfer(ccb *srb, struct us_data *ss, bool first,
+				 unsigned short *blks)
+{
+	int key = srb->sense_buf[2] & 0x0f;
+
+	if (!first && *blks != ss->max_xfer_blk)
+		return false;
+	if (*blks <= USB_MIN_XFER_BLK)
+		return false;
+	if (key == SENSE_MEDIUM_ERROR || key == SENSE_ILLEGAL_REQUEST)
+		return false;
+	*blks = max_t(unsigned short, *blks / 2, USB_MIN_XFER_BLK);
+	ss->max_xfer_blk = *blks;
+	debug("%s: now %u blocks\n", __func__, ss->max_xfer_blk);
+
+	return true;
+}
+
+/* Work out how many blocks to transfer at once with a device */
+static void usb_stor_set_max_xfer(struct us_data *ss, unsigned long blksz)
+{
+	size_t size;
+
+	ss->max_xfer_blk = USB_MAX_XFER_BLK;
+	if (!blksz || usb_get_max_xfer_size(ss->pusb_dev, &size))
+		return;
+	ss->max_xfer_blk = clamp_t(size_t, size / blksz, 1, USB_MAX_RW10_BLK);
+}
+
 #ifdef CONFIG_BLK
 static unsigned long usb_stor_read(struct udevice *dev, lbaint_t blknr,
 				   lbaint_t blkcnt, void *buffer)
@@ -1153,18 +1220,21 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 		/* XXX need some comment here */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > USB_MAX_XFER_BLK)
-			smallblks = USB_MAX_XFER_BLK;
+		if (blks > ss->max_xfer_blk)
+			smallblks = ss->max_xfer_blk;
 		else
 			smallblks = (unsigned short) blks;
 retry_it:
-		if (smallblks == USB_MAX_XFER_BLK)
+		if (smallblks == ss->max_xfer_blk)
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
 		if (usb_read_10(srb, ss, start, smallblks)) {
 			debug("Read ERROR\n");
 			usb_request_sense(srb, ss);
+			if (usb_stor_reduce_xfer(srb, ss, start == blknr,
+						 &smallblks))
+				goto retry_it;
 			if (retry--)
 				goto retry_it;
 			blkcnt -= blks;
@@ -1181,7 +1251,7 @@ retry_it:
 	      start, smallblks, buf_addr);
 
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= USB_MAX_XFER_BLK)
+	if (blkcnt >= ss->max_xfer_blk)
 		debug("\n");
 	return blkcnt;
 }
@@ -1239,18 +1309,21 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 		 */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > USB_MAX_XFER_BLK)
-			smallblks = USB_MAX_XFER_BLK;
+		if (blks > ss->max_xfer_blk)
+			smallblks = ss->max_xfer_blk;
 		else
 			smallblks = (unsigned short) blks;
 retry_it:
-		if (smallblks == USB_MAX_XFER_BLK)
+		if (smallblks == ss->max_xfer_blk)
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
 		if (usb_write_10(srb, ss, start, smallblks)) {
 			debug("Write ERROR\n");
 			usb_request_sense(srb, ss);
+			if (usb_stor_reduce_xfer(srb, ss, start == blknr,
+						 &smallblks))
+				goto retry_it;
 			if (retry--)
 				goto retry_it;
 			blkcnt -= blks;
@@ -1266,7 +1339,7 @@ retry_it:
 	      PRIxPTR "\n", start, smallblks, buf_addr);
 
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= USB_MAX_XFER_BLK)
+	if (blkcnt >= ss->max_xfer_blk)
 		debug("\n");
 	return blkcnt;
 
@@ -1294,6 +1367,7 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 	}
 
 	memset(ss, 0, sizeof(struct us_data));
+	ss->max_xfer_blk = USB_MAX_XFER_BLK;
 
 	/* At this point, we know we've got a live one */
 	debug("\n\nUSB Mass Storage device detected\n");
@@ -1402,6 +1476,9 @@ int usb_stor_get_info(struct usb_device *dev, struct us_data *ss,
 
 	pccb->pdata = usb_stor_buf;
 
+	/* Forget any smaller transfer size from an earlier session */
+	usb_stor_set_max_xfer(ss, 0);
+
 	dev_desc->target = dev->devnum;
 	pccb->lun = dev_desc->lun;
 	debug(" address %d\n", dev_desc->target);
@@ -1474,6 +1551,7 @@ int usb_stor_get_info(struct usb_device *dev, struct us_data *ss,
 	dev_desc->blksz = blksz;
 	dev_desc->log2blksz = LOG2(dev_desc->blksz);
 	dev_desc->type = perq;
+	usb_stor_set_max_xfer(ss, blksz);
 	debug(" address %d\n", dev_desc->target);
 
 	return 1;
@@ -8,166 +8,395 @@
 #include <config.h>
 #include <common.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <linux/ctype.h>
-#include <linux/list.h>
+#include <linux/bitops.h>
 
-struct block_cache_node {
-	struct list_head lh;
+/*
+ * The cache is made of lines of max_blocks_per_entry blocks (a power of two),
+ * each aligned to its own size on the device. Lines are hashed into sets of
+ * BLKCACHE_WAYS lines each, so a lookup only has to check a handful of lines,
+ * and the least-recently used line of a set is replaced on a miss.
+ *
+ * Reads are split into runs of cached and missing lines. Cached lines are
+ * copied out and each run of missing lines is read from the device with a
+ * single request. When a device is read sequentially, the last run is
+ * extended by up to BLKCACHE_READAHEAD lines so the next reads are hits.
+ */
+#define BLKCACHE_WAYS		4
+#define BLKCACHE_READAHEAD	4
+#define BLKCACHE_STREAMS	4
+
+struct block_cache_line {
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
+	lbaint_t tag;		/* first block >> line_shift */
 	unsigned long blksz;
+	unsigned long stamp;	/* time of last use, 0 if line is free */
 	char *cache;
 };
 
-static LIST_HEAD(block_cache);
+/* Read pattern of a device, used to spot sequential reads */
+struct block_cache_stream {
+	int iftype;
+	int devnum;
+	lbaint_t next;		/* block following the last read */
+	unsigned long stamp;
+};
+
+static struct block_cache_line *lines;
+static unsigned int num_sets;
+static unsigned int line_shift;	/* log2 of blocks per line */
+static unsigned long tick;
+static struct block_cache_stream streams[BLKCACHE_STREAMS];
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 2,
+	.max_blocks_per_entry = 8,
 	.max_entries = 32
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+static void cache_free(void)
 {
-	struct block_cache_node *node;
-
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
-			return node;
-		}
-	return 0;
+	unsigned int i;
+
+	if (lines) {
+		for (i = 0; i < num_sets * BLKCACHE_WAYS; i++)
+			free(lines[i].cache);
+		free(lines);
+	}
+	lines = NULL;
+	num_sets = 0;
+	_stats.entries = 0;
 }
 
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
+static int cache_init(void)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
-	}
+	unsigned int sets;
+
+	if (lines)
+		return 0;
+	if (!_stats.max_entries || !_stats.max_blocks_per_entry)
+		return -ENOSPC;
+
+	sets = DIV_ROUND_UP(_stats.max_entries, BLKCACHE_WAYS);
+	sets = 1U << fls(sets - 1);
+	lines = calloc(sets * BLKCACHE_WAYS, sizeof(*lines));
+	if (!lines)
+		return -ENOMEM;
+	num_sets = sets;
+	line_shift = ffs(_stats.max_blocks_per_entry) - 1;
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
 	return 0;
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+static struct block_cache_line *cache_set(int iftype, int devnum,
+					  lbaint_t tag)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	unsigned long hash;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
-		return;
+	hash = (unsigned long)tag * 0x9e3779b1 ^ (iftype << 8) ^ devnum;
+	hash ^= hash >> 16;
 
-	if (_stats.max_entries == 0)
-		return;
+	return &lines[(hash & (num_sets - 1)) * BLKCACHE_WAYS];
+}
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
+static struct block_cache_line *cache_find(int iftype, int devnum,
+					   lbaint_t tag, unsigned long blksz)
+{
+	struct block_cache_line *line = cache_set(iftype, devnum, tag);
+	int i;
+
+	for (i = 0; i < BLKCACHE_WAYS; i++, line++) {
+		if (line->stamp && line->tag == tag &&
+		    line->iftype == iftype && line->devnum == devnum &&
+		    line->blksz == blksz) {
+			line->stamp = ++tick;
+			return line;
+		}
+	}
+
+	return NULL;
+}
+
+/* Pick the line to hold @tag, evicting the least-recently used if needed */
+static struct block_cache_line *cache_alloc(int iftype, int devnum,
+					    lbaint_t tag, unsigned long blksz)
+{
+	struct block_cache_line *set = cache_set(iftype, devnum, tag);
+	struct block_cache_line *line = set;
+	unsigned long bytes = blksz * _stats.max_blocks_per_entry;
+	int i;
+
+	for (i = 1; i < BLKCACHE_WAYS; i++) {
+		if (set[i].stamp < line->stamp)
+			line = &set[i];
+	}
+
+	if (line->stamp) {
+		debug("drop: start " LBAF "\n", line->tag << line_shift);
+		line->stamp = 0;
 		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
+	}
+	if (line->cache && line->blksz != blksz) {
+		free(line->cache);
+		line->cache = NULL;
+	}
+	if (!line->cache) {
+		line->cache = malloc(bytes);
+		if (!line->cache)
+			return NULL;
+	}
+
+	line->iftype = iftype;
+	line->devnum = devnum;
+	line->tag = tag;
+	line->blksz = blksz;
+	line->stamp = ++tick;
+	_stats.entries++;
+
+	return line;
+}
+
+/* Check whether this read follows on from the last one on the device */
+static bool cache_sequential(int iftype, int devnum, lbaint_t start,
+			     lbaint_t blkcnt)
+{
+	struct block_cache_stream *stream = streams;
+	bool seq = false;
+	int i;
+
+	for (i = 0; i < BLKCACHE_STREAMS; i++) {
+		if (streams[i].stamp && streams[i].iftype == iftype &&
+		    streams[i].devnum == devnum) {
+			stream = &streams[i];
+			seq = stream->next == start;
+			break;
 		}
+		if (streams[i].stamp < stream->stamp)
+			stream = &streams[i];
+	}
+
+	stream->iftype = iftype;
+	stream->devnum = devnum;
+	stream->next = start + blkcnt;
+	stream->stamp = ++tick;
+
+	return seq;
+}
+
+/*
+ * Read the missing lines from @first to @last inclusive with one device
+ * request, add them to the cache and copy out the part inside the caller's
+ * range of @start to @end (exclusive).
+ *
+ * @return 0 if OK, -EIO if the device read failed
+ */
+static int cache_read_lines(struct blk_desc *block_dev, blkcache_read_t read,
+			    lbaint_t first, lbaint_t last, lbaint_t start,
+			    lbaint_t end, char *buffer)
+{
+	unsigned long per_line = _stats.max_blocks_per_entry;
+	unsigned long blksz = block_dev->blksz;
+	lbaint_t from = first << line_shift;
+	lbaint_t blkcnt = (last - first + 1) << line_shift;
+	struct block_cache_line *line;
+	lbaint_t tag;
+	char *data;
+
+	/* Read straight into the caller's buffer when the lines fit it */
+	if (from == start && from + blkcnt == end) {
+		data = buffer;
 	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
+		data = malloc_cache_aligned(blkcnt * blksz);
+		if (!data)
+			return -ENOMEM;
 	}
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
+	if (read(block_dev, from, blkcnt, data) != blkcnt) {
+		if (data != buffer)
+			free(data);
+		return -EIO;
+	}
+
+	for (tag = first; tag <= last; tag++) {
+		line = cache_alloc(block_dev->if_type, block_dev->devnum, tag,
+				   blksz);
+		if (line)
+			memcpy(line->cache, data + ((tag - first) <<
+			       line_shift) * blksz, per_line * blksz);
+	}
+
+	if (data != buffer) {
+		lbaint_t lo = max(start, from);
+		lbaint_t hi = min(end, from + blkcnt);
+
+		if (lo < hi)
+			memcpy(buffer + (lo - start) * blksz,
+			       data + (lo - from) * blksz, (hi - lo) * blksz);
+		free(data);
+	}
+
+	return 0;
+}
+
+unsigned long blkcache_read(struct blk_desc *block_dev, lbaint_t start,
+			    lbaint_t blkcnt, void *buffer,
+			    blkcache_read_t read)
+{
+	int iftype = block_dev->if_type;
+	int devnum = block_dev->devnum;
+	unsigned long blksz = block_dev->blksz;
+	unsigned long per_line = _stats.max_blocks_per_entry;
+	lbaint_t end = start + blkcnt;
+	lbaint_t tag, first, last, lo, hi, miss_start = 0;
+	struct block_cache_line *line;
+	unsigned int found = 0, missing = 0;
+	bool seq;
+
+	seq = cache_sequential(iftype, devnum, start, blkcnt);
+
+	/*
+	 * Don't cache big stuff, or lines which would run off the end of
+	 * the device
+	 */
+	if (!blkcnt || blkcnt > per_line * BLKCACHE_READAHEAD ||
+	    cache_init() || !block_dev->lba ||
+	    (((end - 1) >> line_shift) + 1) << line_shift > block_dev->lba)
+		return read(block_dev, start, blkcnt, buffer);
+
+	first = start >> line_shift;
+	last = (end - 1) >> line_shift;
+	for (tag = first; tag <= last + 1; tag++) {
+		if (tag <= last) {
+			line = cache_find(iftype, devnum, tag, blksz);
+			if (!line) {
+				if (!missing++)
+					miss_start = tag;
+				continue;
+			}
+
+			/*
+			 * Copy the hit out now, since filling the missing
+			 * lines before it may evict it
+			 */
+			lo = max(start, tag << line_shift);
+			hi = min(end, (tag + 1) << line_shift);
+			memcpy(buffer + (lo - start) * blksz, line->cache +
+			       (lo - (tag << line_shift)) * blksz,
+			       (hi - lo) * blksz);
+			found++;
+		}
+
+		/* Read the run of missing lines before this one */
+		if (missing) {
+			lbaint_t miss_end = tag - 1;
+
+			/* Read ahead when this read finishes the run */
+			if (seq && tag > last) {
+				while (miss_end - last < BLKCACHE_READAHEAD &&
+				       (miss_end + 2) << line_shift <=
+				       block_dev->lba &&
+				       !cache_find(iftype, devnum,
+						   miss_end + 1, blksz))
+					miss_end++;
+				_stats.readahead += (miss_end - last) <<
+						    line_shift;
+			}
+			debug("fill: start " LBAF ", count " LBAFU "\n",
+			      miss_start << line_shift,
+			      (miss_end - miss_start + 1) << line_shift);
+			if (cache_read_lines(block_dev, read, miss_start,
+					     miss_end, start, end, buffer))
+				return read(block_dev, start, blkcnt, buffer);
+			missing = 0;
 		}
 	}
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
+	if (found == last - first + 1) {
+		debug("hit: start " LBAF ", count " LBAFU "\n", start, blkcnt);
+		++_stats.hits;
+	} else if (found) {
+		debug("partial: start " LBAF ", count " LBAFU "\n", start,
+		      blkcnt);
+		++_stats.partial_hits;
+	} else {
+		debug("miss: start " LBAF ", count " LBAFU "\n", start,
+		      blkcnt);
+		++_stats.misses;
+	}
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	return blkcnt;
 }
 
-void blkcache_invalidate(int iftype, int devnum)
+void blkcache_invalidate_range(int iftype, int devnum, lbaint_t start,
+			       lbaint_t blkcnt)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
-
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
+	struct block_cache_line *line;
+	lbaint_t tag, first, last;
+	unsigned int i;
+
+	if (!lines || !blkcnt)
+		return;
+
+	first = start >> line_shift;
+	last = (start + blkcnt - 1) >> line_shift;
+	if (last - first >= num_sets * BLKCACHE_WAYS) {
+		/* Cheaper to check every line than every tag */
+		for (i = 0, line = lines; i < num_sets * BLKCACHE_WAYS;
+		     i++, line++) {
+			if (line->stamp && line->iftype == iftype &&
+			    line->devnum == devnum && line->tag >= first &&
+			    line->tag <= last) {
+				line->stamp = 0;
+				_stats.entries--;
+			}
+		}
+		return;
+	}
+
+	for (tag = first; tag <= last; tag++) {
+		line = cache_set(iftype, devnum, tag);
+		for (i = 0; i < BLKCACHE_WAYS; i++, line++) {
+			if (line->stamp && line->tag == tag &&
+			    line->iftype == iftype && line->devnum == devnum) {
+				line->stamp = 0;
+				_stats.entries--;
+			}
 		}
 	}
 }
 
+void blkcache_invalidate(int iftype, int devnum)
+{
+	blkcache_invalidate_range(iftype, devnum, 0, ~(lbaint_t)0);
+}
+
 void blkcache_configure(unsigned blocks, unsigned entries)
 {
-	struct block_cache_node *node;
+	/* Round up to a power of two */
+	if (blocks)
+		blocks = 1U << fls(blocks - 1);
 	if ((blocks != _stats.max_blocks_per_entry) ||
 	    (entries != _stats.max_entries)) {
 		/* invalidate cache */
-		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
-		}
-		_stats.entries = 0;
+		cache_free();
 	}
 
 	_stats.max_blocks_per_entry = blocks;
 	_stats.max_entries = entries;
 
 	_stats.hits = 0;
+	_stats.partial_hits = 0;
 	_stats.misses = 0;
+	_stats.readahead = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
 {
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
+	_stats.partial_hits = 0;
 	_stats.misses = 0;
+	_stats.readahead = 0;
 }
@@ -49,6 +49,7 @@ static unsigned long host_block_read(struct blk_desc *block_dev,
 		return -1;
 #endif
 
+	host_dev->reads++;
 	if (os_lseek(host_dev->fd, start * block_dev->blksz, OS_SEEK_SET) ==
 			-1) {
 		printf("ERROR: Invalid block %lx\n", start);
@@ -88,6 +89,54 @@ static unsigned long host_block_write(struct blk_desc *block_dev,
 }
 
 #ifdef CONFIG_BLK
+/*
+ * The backing file is only touched through host system calls, so a write
+ * can run as a job on another CPU while U-Boot gets on with something else
+ */
+static int host_block_write_job(void *arg)
+{
+	struct host_block_dev *host_dev = arg;
+	ssize_t len;
+
+	host_dev->written = -EIO;
+	if (os_lseek(host_dev->fd, host_dev->wr_start * host_dev->wr_blksz,
+		     OS_SEEK_SET) == -1)
+		return -EIO;
+	len = os_write(host_dev->fd, host_dev->wr_buf,
+		       host_dev->wr_blkcnt * host_dev->wr_blksz);
+	if (len < 0)
+		return -EIO;
+	host_dev->written = len / host_dev->wr_blksz;
+
+	return 0;
+}
+
+static int host_block_write_submit(struct udevice *dev, lbaint_t start,
+				   lbaint_t blkcnt, const void *buffer)
+{
+	struct host_block_dev *host_dev = dev_get_priv(dev);
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+
+	host_dev->wr_start = start;
+	host_dev->wr_blkcnt = blkcnt;
+	host_dev->wr_blksz = block_dev->blksz;
+	host_dev->wr_buf = buffer;
+	host_dev->work.func = host_block_write_job;
+	host_dev->work.arg = host_dev;
+	smp_work_queue(&host_dev->work);
+
+	return 0;
+}
+
+static unsigned long host_block_write_wait(struct udevice *dev)
+{
+	struct host_block_dev *host_dev = dev_get_priv(dev);
+
+	smp_work_wait();
+
+	return host_dev->written;
+}
+
 int host_dev_bind(int devnum, char *filename)
 {
 	struct host_block_dev *host_dev;
@@ -221,6 +270,8 @@ int host_get_dev_err(int devnum, struct blk_desc **blk_devp)
 static const struct blk_ops sandbox_host_blk_ops = {
 	.read	= host_block_read,
 	.write	= host_block_write,
+	.write_submit	= host_block_write_submit,
+	.write_wait	= host_block_write_wait,
 };
 
 U_BOOT_DRIVER(sandbox_host_blk) = {
@@ -161,6 +161,8 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 			goto fail_uclass_post_bind;
 	}
 
+	/* The bind methods may have renamed the device or looked it up */
+	uclass_index_drop(uc);
 	if (parent)
 		dm_dbg("Bound device %s to %s\n", dev->name, parent->name);
 	if (devp)
@@ -264,19 +266,13 @@ static void *alloc_priv(int size, uint flags)
 	return priv;
 }
 
-int device_probe(struct udevice *dev)
+static int device_do_probe(struct udevice *dev)
 {
 	const struct driver *drv;
 	int size = 0;
 	int ret;
 	int seq;
 
-	if (!dev)
-		return -EINVAL;
-
-	if (dev->flags & DM_FLAG_ACTIVATED)
-		return 0;
-
 	drv = dev->driver;
 	assert(drv);
 
@@ -332,7 +328,7 @@ int device_probe(struct udevice *dev)
 		ret = seq;
 		goto fail;
 	}
-	dev->seq = seq;
+	uclass_set_seq(dev, seq);
 
 	dev->flags |= DM_FLAG_ACTIVATED;
 
@@ -385,12 +381,29 @@ fail_uclass:
 fail:
 	dev->flags &= ~DM_FLAG_ACTIVATED;
 
-	dev->seq = -1;
+	uclass_set_seq(dev, -1);
 	device_free(dev);
 
 	return ret;
 }
 
+int device_probe(struct udevice *dev)
+{
+	int span, ret;
+
+	if (!dev)
+		return -EINVAL;
+
+	if (dev->flags & DM_FLAG_ACTIVATED)
+		return 0;
+
+	span = bootstage_span_begin(BOOTSTAGE_SPAN_PROBE, dev->name);
+	ret = device_do_probe(dev);
+	bootstage_span_end(span);
+
+	return ret;
+}
+
 void *dev_get_platdata(struct udevice *dev)
 {
 	if (!dev) {
@@ -769,6 +782,7 @@ int device_set_name(struct udevice *dev, const char *name)
 		return -ENOMEM;
 	dev->name = name;
 	device_set_name_alloced(dev);
+	uclass_index_drop(dev->uclass);
 
 	return 0;
 }
@@ -16,8 +16,11 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <linux/compiler.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 struct driver *lists_driver_lookup_name(const char *name)
 {
 	struct driver *drv =
@@ -138,6 +141,184 @@ static int driver_check_compatible(const void *blob, int offset,
 	return -ENOENT;
 }
 
+#if CONFIG_IS_ENABLED(DM_INDEX)
+/*
+ * Rather than checking every driver against each node, look up the node's
+ * compatible strings in a hash table of all drivers' of_match entries. The
+ * table is built on first use after relocation and then kept, since the
+ * driver list never changes.
+ *
+ * A node normally matches one or two drivers. Nodes which match more than
+ * LISTS_MAX_MATCHES fall back to checking every driver.
+ */
+#define LISTS_MAX_MATCHES	16
+
+struct lists_compat {
+	const char *compatible;
+	struct driver *drv;
+	const struct udevice_id *id;
+};
+
+static struct lists_compat *compat_table;
+static int compat_mask;
+
+static uint lists_compat_hash(const char *str)
+{
+	uint hash = 2166136261u;
+
+	while (*str)
+		hash = (hash ^ (u8)*str++) * 16777619;
+
+	return hash;
+}
+
+static int lists_compat_build(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct lists_compat *table;
+	struct driver *entry;
+	int count = 0, size;
+	uint slot;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++)
+			count++;
+	}
+
+	/* Keep the table no more than half full */
+	for (size = 16; size < count * 2; size *= 2)
+		;
+	table = calloc(size, sizeof(*table));
+	if (!table)
+		return -ENOMEM;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			slot = lists_compat_hash(id->compatible);
+			while (table[slot & (size - 1)].compatible)
+				slot++;
+			table[slot & (size - 1)].compatible = id->compatible;
+			table[slot & (size - 1)].drv = entry;
+			table[slot & (size - 1)].id = id;
+		}
+	}
+	compat_table = table;
+	compat_mask = size - 1;
+	dm_dbg("%s: %d compatible strings\n", __func__, count);
+
+	return 0;
+}
+
+/**
+ * lists_compat_find() - Find the drivers which match a node
+ *
+ * Matches are ordered as driver_check_compatible() would find them: by
+ * driver, and for each driver only the first of_match entry which matches
+ * any compatible string of the node.
+ *
+ * @param blob:		Device tree pointer
+ * @param offset:	Offset of node in device tree
+ * @param match:	Returns the matches found
+ * @return number of matches, -ENODEV if the node does not have a compatible
+ * string, -E2BIG if there are too many matches, other error <0 if there is
+ * a device tree error
+ */
+static int lists_compat_find(const void *blob, int offset,
+			     struct lists_compat *match)
+{
+	const struct lists_compat *entry;
+	const char *compat, *end;
+	int count = 0;
+	int len, i;
+	uint slot;
+
+	compat = fdt_getprop(blob, offset, "compatible", &len);
+	if (!compat)
+		return len == -FDT_ERR_NOTFOUND ? -ENODEV : -EINVAL;
+
+	for (end = compat + len; compat < end;
+	     compat += strnlen(compat, end - compat) + 1) {
+		slot = lists_compat_hash(compat);
+		for (; (entry = &compat_table[slot & compat_mask])->compatible;
+		     slot++) {
+			if (strcmp(entry->compatible, compat))
+				continue;
+			for (i = 0; i < count; i++) {
+				if (match[i].drv == entry->drv)
+					break;
+			}
+			if (i == count) {
+				if (count == LISTS_MAX_MATCHES)
+					return -E2BIG;
+				match[count++] = *entry;
+			} else if (entry->id < match[i].id) {
+				match[i].id = entry->id;
+			}
+		}
+	}
+
+	/* Put the matches in driver order; there are very few */
+	for (i = 1; i < count; i++) {
+		struct lists_compat tmp = match[i];
+		int j;
+
+		for (j = i; j > 0 && match[j - 1].drv > tmp.drv; j--)
+			match[j] = match[j - 1];
+		match[j] = tmp;
+	}
+
+	return count;
+}
+
+static int lists_bind_fdt_indexed(struct udevice *parent, const void *blob,
+				  int offset, struct udevice **devp)
+{
+	struct lists_compat match[LISTS_MAX_MATCHES];
+	struct udevice *dev;
+	const char *name;
+	int count, i;
+	int ret;
+
+	name = fdt_get_name(blob, offset, NULL);
+	count = lists_compat_find(blob, offset, match);
+	if (count == -ENODEV) {
+		dm_dbg("Device '%s' has no compatible string\n", name);
+		return 0;
+	} else if (count == -E2BIG) {
+		return count;
+	} else if (count < 0) {
+		dm_warn("Device tree error at offset %d\n", offset);
+		return count;
+	}
+
+	for (i = 0; i < count; i++) {
+		dm_dbg("   - found match at '%s'\n", match[i].drv->name);
+		ret = device_bind_with_driver_data(parent, match[i].drv, name,
+						   match[i].id->data, offset,
+						   &dev);
+		if (ret == -ENODEV) {
+			dm_dbg("Driver '%s' refuses to bind\n",
+			       match[i].drv->name);
+			continue;
+		}
+		if (ret) {
+			dm_warn("Error binding driver '%s': %d\n",
+				match[i].drv->name, ret);
+			return ret;
+		}
+		if (devp)
+			*devp = dev;
+		return 0;
+	}
+	if (!count)
+		dm_dbg("No match for node '%s'\n", name);
+
+	return 0;
+}
+#endif
+
 int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
 		   struct udevice **devp)
 {
@@ -154,6 +335,15 @@ int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
 	dm_dbg("bind node %s\n", fdt_get_name(blob, offset, NULL));
 	if (devp)
 		*devp = NULL;
+#if CONFIG_IS_ENABLED(DM_INDEX)
+	/* Keep the small pre-relocation malloc() pool for devices */
+	if ((gd->flags & GD_FLG_RELOC) &&
+	    (compat_table || !lists_compat_build())) {
+		ret = lists_bind_fdt_indexed(parent, blob, offset, devp);
+		if (ret != -E2BIG)
+			return ret;
+	}
+#endif
 	for (entry = driver; entry != driver + n_ents; entry++) {
 		ret = driver_check_compatible(blob, offset, entry->of_match,
 					      &id);
@@ -38,6 +38,254 @@ struct uclass *uclass_find(enum uclass_id key)
 	return NULL;
 }
 
+#if CONFIG_IS_ENABLED(DM_INDEX)
+/*
+ * Finding a device by name, sequence number or device-tree offset walks the
+ * uclass's device list. Once a uclass with a fair number of devices has been
+ * searched a few times, an index is built instead: the devices sorted by
+ * name and by offset, and a table of devices by sequence number. Binding or
+ * unbinding a device drops the index; probing and removing devices keeps the
+ * sequence table up to date.
+ *
+ * Each entry records the position of its device in the list, so that the
+ * first matching device wins, just as with the list walk.
+ */
+#define UCLASS_INDEX_MIN_DEVS	8
+#define UCLASS_INDEX_SCANS	4
+#define UCLASS_INDEX_MAX_SEQ	1024
+
+struct uclass_index_entry {
+	struct udevice *dev;
+	int pos;
+};
+
+struct uclass_index {
+	int count;
+	struct uclass_index_entry *by_name;
+	struct uclass_index_entry *by_offset;
+	int num_seqs;
+	struct udevice **by_seq;
+};
+
+static int uclass_index_cmp_name(const void *a, const void *b)
+{
+	const struct uclass_index_entry *ea = a, *eb = b;
+	int ret;
+
+	ret = strcmp(ea->dev->name, eb->dev->name);
+	if (ret)
+		return ret;
+
+	return ea->pos - eb->pos;
+}
+
+static int uclass_index_cmp_offset(const void *a, const void *b)
+{
+	const struct uclass_index_entry *ea = a, *eb = b;
+
+	if (ea->dev->of_offset != eb->dev->of_offset)
+		return ea->dev->of_offset < eb->dev->of_offset ? -1 : 1;
+
+	return ea->pos - eb->pos;
+}
+
+void uclass_index_drop(struct uclass *uc)
+{
+	free(uc->index);
+	uc->index = NULL;
+	uc->index_scans = 0;
+}
+
+static void uclass_index_build(struct uclass *uc)
+{
+	struct uclass_index *index;
+	struct udevice *dev;
+	int count = 0, num_seqs = 0;
+	int i;
+
+	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
+		count++;
+		num_seqs = max(num_seqs, dev->seq + 1);
+	}
+	if (count < UCLASS_INDEX_MIN_DEVS)
+		return;
+
+	/* Leave room for devices which are not probed yet */
+	num_seqs = max(num_seqs, count) * 2;
+	if (num_seqs > UCLASS_INDEX_MAX_SEQ)
+		return;
+
+	index = malloc(sizeof(*index) +
+		       2 * count * sizeof(struct uclass_index_entry) +
+		       num_seqs * sizeof(struct udevice *));
+	if (!index)
+		return;
+	index->count = count;
+	index->by_name = (struct uclass_index_entry *)(index + 1);
+	index->by_offset = index->by_name + count;
+	index->num_seqs = num_seqs;
+	index->by_seq = (struct udevice **)(index->by_offset + count);
+	memset(index->by_seq, '\0', num_seqs * sizeof(struct udevice *));
+
+	i = 0;
+	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
+		index->by_name[i].dev = dev;
+		index->by_name[i].pos = i;
+		if (dev->seq != -1 && !index->by_seq[dev->seq])
+			index->by_seq[dev->seq] = dev;
+		i++;
+	}
+	memcpy(index->by_offset, index->by_name,
+	       count * sizeof(struct uclass_index_entry));
+	qsort(index->by_name, count, sizeof(struct uclass_index_entry),
+	      uclass_index_cmp_name);
+	qsort(index->by_offset, count, sizeof(struct uclass_index_entry),
+	      uclass_index_cmp_offset);
+	uc->index = index;
+	debug("%s: %s: %d devices\n", __func__, uc->uc_drv->name, count);
+}
+
+/**
+ * uclass_index_get() - Get the lookup index for a uclass
+ *
+ * @uc: uclass to check
+ * @return index, or NULL if the caller should walk the device list
+ */
+static struct uclass_index *uclass_index_get(struct uclass *uc)
+{
+	/* Keep the small pre-relocation malloc() pool for devices */
+	if (!(gd->flags & GD_FLG_RELOC))
+		return NULL;
+	if (!uc->index && ++uc->index_scans >= UCLASS_INDEX_SCANS) {
+		uc->index_scans = 0;
+		uclass_index_build(uc);
+	}
+
+	return uc->index;
+}
+
+/**
+ * uclass_index_find_name() - Look up a device by name prefix in the index
+ *
+ * @uc: uclass to search
+ * @name: Name prefix to find, as with uclass_find_device_by_name()
+ * @devp: Returns the device found, or NULL if none
+ * @return true if the index was used, false if the caller should walk the
+ * device list
+ */
+static bool uclass_index_find_name(struct uclass *uc, const char *name,
+				   struct udevice **devp)
+{
+	struct uclass_index_entry *entry, *found = NULL;
+	struct uclass_index *index;
+	int len = strlen(name);
+	int lo = 0, hi, mid;
+
+	index = uclass_index_get(uc);
+	if (!index || !len)
+		return false;
+
+	/* Devices whose names start with @name sort together, from here */
+	hi = index->count;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (strcmp(index->by_name[mid].dev->name, name) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (entry = &index->by_name[lo];
+	     entry != index->by_name + index->count; entry++) {
+		if (strncmp(entry->dev->name, name, len))
+			break;
+		if (!found || entry->pos < found->pos)
+			found = entry;
+	}
+	*devp = found ? found->dev : NULL;
+
+	return true;
+}
+
+static bool uclass_index_find_seq(struct uclass *uc, int seq,
+				  struct udevice **devp)
+{
+	struct uclass_index *index;
+
+	index = uclass_index_get(uc);
+	if (!index || seq < 0)
+		return false;
+	*devp = seq < index->num_seqs ? index->by_seq[seq] : NULL;
+
+	return true;
+}
+
+static bool uclass_index_find_offset(struct uclass *uc, int node,
+				     struct udevice **devp)
+{
+	struct uclass_index *index;
+	struct udevice *dev;
+	int lo = 0, hi, mid;
+
+	index = uclass_index_get(uc);
+	if (!index)
+		return false;
+
+	hi = index->count;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (index->by_offset[mid].dev->of_offset < node)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	dev = lo < index->count ? index->by_offset[lo].dev : NULL;
+	*devp = dev && dev->of_offset == node ? dev : NULL;
+
+	return true;
+}
+#else
+void uclass_index_drop(struct uclass *uc)
+{
+}
+
+static inline bool uclass_index_find_name(struct uclass *uc,
+					  const char *name,
+					  struct udevice **devp)
+{
+	return false;
+}
+
+static inline bool uclass_index_find_seq(struct uclass *uc, int seq,
+					 struct udevice **devp)
+{
+	return false;
+}
+
+static inline bool uclass_index_find_offset(struct uclass *uc, int node,
+					    struct udevice **devp)
+{
+	return false;
+}
+#endif
+
+void uclass_set_seq(struct udevice *dev, int seq)
+{
+#if CONFIG_IS_ENABLED(DM_INDEX)
+	struct uclass_index *index = dev->uclass->index;
+
+	if (index) {
+		if (dev->seq != -1 && index->by_seq[dev->seq] == dev)
+			index->by_seq[dev->seq] = NULL;
+		if (seq >= index->num_seqs ||
+		    (seq != -1 && index->by_seq[seq]))
+			uclass_index_drop(dev->uclass);
+		else if (seq != -1)
+			index->by_seq[seq] = dev;
+	}
+#endif
+	dev->seq = seq;
+}
+
 /**
  * uclass_add() - Create new uclass in list
  * @id: Id number to create
@@ -81,7 +329,12 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	list_add(&uc->sibling_node, &DM_UCLASS_ROOT_NON_CONST);
 
 	if (uc_drv->init) {
+		int span;
+
+		span = bootstage_span_begin(BOOTSTAGE_SPAN_UCLASS,
+					    uc_drv->name);
 		ret = uc_drv->init(uc);
+		bootstage_span_end(span);
 		if (ret)
 			goto fail;
 	}
@@ -130,6 +383,7 @@ int uclass_destroy(struct uclass *uc)
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto_alloc_size)
 		free(uc->priv);
+	uclass_index_drop(uc);
 	free(uc);
 
 	return 0;
@@ -215,6 +469,9 @@ int uclass_find_device_by_name(enum uclass_id id, const char *name,
 	if (ret)
 		return ret;
 
+	if (uclass_index_find_name(uc, name, devp))
+		return *devp ? 0 : -ENODEV;
+
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		if (!strncmp(dev->name, name, strlen(name))) {
 			*devp = dev;
@@ -240,6 +497,12 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 	if (ret)
 		return ret;
 
+	/* Requested sequence numbers are not indexed */
+	if (!find_req_seq && uclass_index_find_seq(uc, seq_or_req_seq, devp)) {
+		debug("   - %s\n", *devp ? "found" : "not found");
+		return *devp ? 0 : -ENODEV;
+	}
+
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		debug("   - %d %d\n", dev->req_seq, dev->seq);
 		if ((find_req_seq ? dev->req_seq : dev->seq) ==
@@ -268,6 +531,9 @@ int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 	if (ret)
 		return ret;
 
+	if (uclass_index_find_offset(uc, node, devp))
+		return *devp ? 0 : -ENODEV;
+
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		if (dev->of_offset == node) {
 			*devp = dev;
@@ -453,6 +719,7 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+	uclass_index_drop(uc);
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -468,6 +735,7 @@ int uclass_bind_device(struct udevice *dev)
 err:
 	/* There is no need to undo the parent's post_bind call */
 	list_del(&dev->uclass_node);
+	uclass_index_drop(uc);
 
 	return ret;
 }
@@ -486,6 +754,8 @@ int uclass_unbind_device(struct udevice *dev)
 	}
 
 	list_del(&dev->uclass_node);
+	uclass_index_drop(uc);
+
 	return 0;
 }
 #endif
@@ -211,3 +211,54 @@ int hw_sha_finish(struct hash_algo *algo, void *ctx, void *dest_buf,
 {
 	return caam_hash_finish(ctx, dest_buf, size, get_hash_type(algo));
 }
+
+#ifdef CONFIG_SHA_ASYNC_HW_ACCEL
+/* A hash running on the job ring, hung off hash_job->priv */
+struct caam_hash_job {
+	uint32_t desc[MAX_CAAM_DESCSIZE];
+	struct result op;
+};
+
+int hw_sha_submit(struct hash_algo *algo, struct hash_job *job)
+{
+	enum caam_hash_algos caam_algo = get_hash_type(algo);
+	struct caam_hash_job *cjob;
+	int ret;
+
+	cjob = malloc(sizeof(*cjob));
+	if (!cjob) {
+		debug("Not enough memory for descriptor allocation\n");
+		return -ENOMEM;
+	}
+
+	inline_cnstr_jobdesc_hash(cjob->desc, job->data, job->len, job->output,
+				  driver_hash[caam_algo].alg_type,
+				  driver_hash[caam_algo].digestsize,
+				  0);
+
+	ret = run_descriptor_jr_async(cjob->desc, &cjob->op);
+	if (ret) {
+		free(cjob);
+		return ret;
+	}
+	job->priv = cjob;
+
+	return 0;
+}
+
+int hw_sha_wait(struct hash_algo *algo, struct hash_job *job)
+{
+	struct caam_hash_job *cjob = job->priv;
+	int ret;
+
+	ret = wait_descriptor_jr(&cjob->op);
+	free(cjob);
+	job->priv = NULL;
+	if (ret) {
+		printf("CAAM was not setup properly or it is faulty\n");
+		return -EIO;
+	}
+
+	return 0;
+}
+#endif
@@ -7,6 +7,7 @@
  */
 
 #include <common.h>
+#include <errno.h>
 #include <malloc.h>
 #include "fsl_sec.h"
 #include "jr.h"
@@ -193,6 +194,10 @@ static int jr_enqueue(uint32_t *desc_addr,
 	uint32_t *addr_hi, *addr_lo;
 #endif
 
+	/* Leave a slot free so that a full ring is not mistaken for empty */
+	if (!CIRC_SPACE(head, jr->tail, jr->size))
+		return -EBUSY;
+
 	/* The descriptor must be submitted to SEC block as per endianness
 	 * of the SEC Block.
 	 * So, if the endianness of Core and SEC block is different, each word
@@ -276,6 +281,12 @@ static int jr_dequeue(int sec_idx)
 
 		found = 0;
 
+		/* Jobs finish in any order, so take them in output order */
+		invalidate_dcache_range((unsigned long)jr->output_ring &
+					~(ARCH_DMA_MINALIGN - 1),
+					ALIGN((unsigned long)jr->output_ring +
+					      jr->op_size, ARCH_DMA_MINALIGN));
+
 		phys_addr_t op_desc;
 	#ifdef CONFIG_PHYS_64BIT
 		/* Read the 64 bit Descriptor address from Output Ring.
@@ -283,11 +294,11 @@ static int jr_dequeue(int sec_idx)
 		 * depend on endianness of SEC block.
 		 */
 	#ifdef CONFIG_SYS_FSL_SEC_LE
-		addr_lo = (uint32_t *)(&jr->output_ring[jr->tail].desc);
-		addr_hi = (uint32_t *)(&jr->output_ring[jr->tail].desc) + 1;
+		addr_lo = (uint32_t *)(&jr->output_ring[jr->read_idx].desc);
+		addr_hi = (uint32_t *)(&jr->output_ring[jr->read_idx].desc) + 1;
 	#elif defined(CONFIG_SYS_FSL_SEC_BE)
-		addr_hi = (uint32_t *)(&jr->output_ring[jr->tail].desc);
-		addr_lo = (uint32_t *)(&jr->output_ring[jr->tail].desc) + 1;
+		addr_hi = (uint32_t *)(&jr->output_ring[jr->read_idx].desc);
+		addr_lo = (uint32_t *)(&jr->output_ring[jr->read_idx].desc) + 1;
 	#endif /* ifdef CONFIG_SYS_FSL_SEC_LE */
 
 		op_desc = ((u64)sec_in32(addr_hi) << 32) |
@@ -295,11 +306,12 @@ static int jr_dequeue(int sec_idx)
 
 	#else
 		/* Read the 32 bit Descriptor address from Output Ring. */
-		addr = (uint32_t *)&jr->output_ring[jr->tail].desc;
+		addr = (uint32_t *)&jr->output_ring[jr->read_idx].desc;
 		op_desc = sec_in32(addr);
 	#endif /* ifdef CONFIG_PHYS_64BIT */
 
-		uint32_t status = sec_in32(&jr->output_ring[jr->tail].status);
+		uint32_t status =
+			sec_in32(&jr->output_ring[jr->read_idx].status);
 
 		for (i = 0; CIRC_CNT(head, tail + i, jr->size) >= 1; i++) {
 			idx = (tail + i) & (jr->size - 1);
@@ -323,6 +335,7 @@ static int jr_dequeue(int sec_idx)
 		 */
 		if (idx == tail)
 			do {
+				jr->info[tail].op_done = 0;
 				tail = (tail + 1) & (jr->size - 1);
 			} while (jr->info[tail].op_done);
 
@@ -330,7 +343,6 @@ static int jr_dequeue(int sec_idx)
 		jr->read_idx = (jr->read_idx + 1) & (jr->size - 1);
 
 		sec_out32(&regs->orjr, 1);
-		jr->info[idx].op_done = 0;
 
 		callback(status, arg);
 	}
@@ -348,45 +360,47 @@ static void desc_done(uint32_t status, void *arg)
 	x->done = 1;
 }
 
-static inline int run_descriptor_jr_idx(uint32_t *desc, uint8_t sec_idx)
+static int wait_descriptor_jr_idx(struct result *op, uint8_t sec_idx)
 {
 	unsigned long long timeval = get_ticks();
 	unsigned long long timeout = usec2ticks(CONFIG_SEC_DEQ_TIMEOUT);
-	struct result op;
-	int ret = 0;
-
-	memset(&op, 0, sizeof(op));
-
-	ret = jr_enqueue(desc, desc_done, &op, sec_idx);
-	if (ret) {
-		debug("Error in SEC enq\n");
-		ret = JQ_ENQ_ERR;
-		goto out;
-	}
+	int ret;
 
-	timeval = get_ticks();
-	timeout = usec2ticks(CONFIG_SEC_DEQ_TIMEOUT);
-	while (op.done != 1) {
+	while (op->done != 1) {
 		ret = jr_dequeue(sec_idx);
 		if (ret) {
 			debug("Error in SEC deq\n");
-			ret = JQ_DEQ_ERR;
-			goto out;
+			return JQ_DEQ_ERR;
 		}
 
 		if ((get_ticks() - timeval) > timeout) {
 			debug("SEC Dequeue timed out\n");
-			ret = JQ_DEQ_TO_ERR;
-			goto out;
+			return JQ_DEQ_TO_ERR;
 		}
 	}
 
-	if (op.status) {
-		debug("Error %x\n", op.status);
-		ret = op.status;
+	if (op->status) {
+		debug("Error %x\n", op->status);
+		return op->status;
 	}
-out:
-	return ret;
+
+	return 0;
+}
+
+static inline int run_descriptor_jr_idx(uint32_t *desc, uint8_t sec_idx)
+{
+	struct result op;
+	int ret = 0;
+
+	memset(&op, 0, sizeof(op));
+
+	ret = jr_enqueue(desc, desc_done, &op, sec_idx);
+	if (ret) {
+		debug("Error in SEC enq\n");
+		return JQ_ENQ_ERR;
+	}
+
+	return wait_descriptor_jr_idx(&op, sec_idx);
 }
 
 int run_descriptor_jr(uint32_t *desc)
@@ -394,6 +408,18 @@ int run_descriptor_jr(uint32_t *desc)
 	return run_descriptor_jr_idx(desc, 0);
 }
 
+int run_descriptor_jr_async(uint32_t *desc, struct result *op)
+{
+	memset(op, 0, sizeof(*op));
+
+	return jr_enqueue(desc, desc_done, op, 0);
+}
+
+int wait_descriptor_jr(struct result *op)
+{
+	return wait_descriptor_jr_idx(op, 0);
+}
+
 static inline int jr_reset_sec(uint8_t sec_idx)
 {
 	if (jr_hw_reset(sec_idx) < 0)
@@ -103,4 +103,26 @@ struct result {
 void caam_jr_strstatus(u32 status);
 int run_descriptor_jr(uint32_t *desc);
 
+/**
+ * run_descriptor_jr_async() - Start a descriptor without waiting for it
+ *
+ * Up to JR_SIZE - 1 descriptors can be in flight at once. The descriptor
+ * and @op must stay valid until wait_descriptor_jr() has returned.
+ *
+ * @desc:	Descriptor to run
+ * @op:		Updated when the descriptor completes
+ * @return 0 if OK, -EBUSY if the job ring is full
+ */
+int run_descriptor_jr_async(uint32_t *desc, struct result *op);
+
+/**
+ * wait_descriptor_jr() - Wait for a descriptor started asynchronously
+ *
+ * Other descriptors which complete meanwhile are dealt with too.
+ *
+ * @op:		As passed to run_descriptor_jr_async()
+ * @return 0 if OK, else the SEC status or a JQ_..._ERR value
+ */
+int wait_descriptor_jr(struct result *op);
+
 #endif
@@ -0,0 +1,125 @@
+/*
+ * Sandbox emulation of a SHA engine with a job ring
+ *
+ * The hashes are worked out by the CPU, but the ring behaves like real
+ * hardware as far as the caller can tell: it only has room for a few jobs,
+ * and they finish in a different order from the one they were submitted in.
+ * This lets the hardware paths of hash_block_multi() and its users be
+ * tested on sandbox.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <hw_sha.h>
+#include <malloc.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+/* Like the CAAM job ring, one slot is always left free */
+#define SANDBOX_SHA_RING	4
+
+struct sandbox_sha_ctx {
+	bool is_sha256;
+	union {
+		sha1_context sha1;
+		sha256_context sha256;
+	};
+};
+
+static struct hash_job *ring[SANDBOX_SHA_RING - 1];
+static int ring_count;
+
+static bool algo_is_sha256(struct hash_algo *algo)
+{
+	return !strcmp(algo->name, "sha256");
+}
+
+void hw_sha256(const uchar *in_addr, uint buflen, uchar *out_addr,
+	       uint chunk_size)
+{
+	sha256_csum_wd(in_addr, buflen, out_addr, chunk_size);
+}
+
+void hw_sha1(const uchar *in_addr, uint buflen, uchar *out_addr,
+	     uint chunk_size)
+{
+	sha1_csum_wd(in_addr, buflen, out_addr, chunk_size);
+}
+
+int hw_sha_init(struct hash_algo *algo, void **ctxp)
+{
+	struct sandbox_sha_ctx *ctx;
+
+	ctx = malloc(sizeof(*ctx));
+	if (!ctx)
+		return -ENOMEM;
+	ctx->is_sha256 = algo_is_sha256(algo);
+	if (ctx->is_sha256)
+		sha256_starts(&ctx->sha256);
+	else
+		sha1_starts(&ctx->sha1);
+	*ctxp = ctx;
+
+	return 0;
+}
+
+int hw_sha_update(struct hash_algo *algo, void *ctx, const void *buf,
+		  unsigned int size, int is_last)
+{
+	struct sandbox_sha_ctx *sctx = ctx;
+
+	if (sctx->is_sha256)
+		sha256_update(&sctx->sha256, buf, size);
+	else
+		sha1_update(&sctx->sha1, buf, size);
+
+	return 0;
+}
+
+int hw_sha_finish(struct hash_algo *algo, void *ctx, void *dest_buf,
+		  int size)
+{
+	struct sandbox_sha_ctx *sctx = ctx;
+	int ret = 0;
+
+	if (size < algo->digest_size)
+		ret = -ENOSPC;
+	else if (sctx->is_sha256)
+		sha256_finish(&sctx->sha256, dest_buf);
+	else
+		sha1_finish(&sctx->sha1, dest_buf);
+	free(ctx);
+
+	return ret;
+}
+
+int hw_sha_submit(struct hash_algo *algo, struct hash_job *job)
+{
+	if (ring_count == ARRAY_SIZE(ring))
+		return -EBUSY;
+	job->priv = NULL;
+	ring[ring_count++] = job;
+
+	return 0;
+}
+
+int hw_sha_wait(struct hash_algo *algo, struct hash_job *job)
+{
+	struct hash_job *done;
+
+	/* Finish everything in the ring, newest first */
+	while (!job->priv && ring_count) {
+		done = ring[--ring_count];
+		if (algo_is_sha256(done->algo))
+			hw_sha256(done->data, done->len, done->output,
+				  CHUNKSZ_SHA256);
+		else
+			hw_sha1(done->data, done->len, done->output,
+				CHUNKSZ_SHA1);
+		done->priv = done;	/* mark it finished */
+	}
+
+	return job->priv ? 0 : -ENOENT;
+}
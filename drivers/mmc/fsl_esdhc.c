@@ -19,12 +19,17 @@
 #include <malloc.h>
 #include <fsl_esdhc.h>
 #include <fdt_support.h>
+#include <mmc_adma.h>
 #include <asm/io.h>
 #include <dm.h>
 #include <asm-generic/gpio.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if defined(CONFIG_MMC_ADMA2) && defined(CONFIG_SYS_FSL_ESDHC_USE_PIO)
+#error "CONFIG_MMC_ADMA2 cannot be used with CONFIG_SYS_FSL_ESDHC_USE_PIO"
+#endif
+
 #define SDHCI_IRQ_EN_BITS		(IRQSTATEN_CC | IRQSTATEN_TC | \
 				IRQSTATEN_CINT | \
 				IRQSTATEN_CTOE | IRQSTATEN_CCE | IRQSTATEN_CEBE | \
@@ -94,6 +99,7 @@ struct fsl_esdhc {
  * @wp_enable: 1: enable checking wp; 0: no check
  * @cd_gpio: gpio for card detection
  * @wp_gpio: gpio for write protection
+ * @adma: ADMA2 descriptor table used for data transfers
  */
 struct fsl_esdhc_priv {
 	struct fsl_esdhc *esdhc_regs;
@@ -108,6 +114,9 @@ struct fsl_esdhc_priv {
 	struct gpio_desc cd_gpio;
 	struct gpio_desc wp_gpio;
 #endif
+#ifdef CONFIG_MMC_ADMA2
+	struct mmc_adma_table adma;
+#endif
 };
 
 /* Return the XFERTYP flags for a given command and data packet */
@@ -215,13 +224,49 @@ esdhc_pio_read_write(struct mmc *mmc, struct mmc_data *data)
 }
 #endif
 
+#ifdef CONFIG_MMC_ADMA2
+/* Describe the whole transfer in the descriptor table, in place of SDMA */
+static int esdhc_setup_adma(struct fsl_esdhc_priv *priv, struct mmc_data *data)
+{
+	struct fsl_esdhc *regs = priv->esdhc_regs;
+	struct mmc_adma_table *adma = &priv->adma;
+	bool read = data->flags & MMC_DATA_READ;
+	phys_addr_t addr;
+	int ret;
+
+	mmc_adma_start(adma, read);
+	ret = mmc_adma_add(adma, read ? data->dest : (char *)data->src,
+			   data->blocks * data->blocksize);
+	if (!ret)
+		ret = mmc_adma_finish(adma);
+	if (ret) {
+		printf("Cannot set up ADMA2 table (err=%d)\n", ret);
+		return ret;
+	}
+
+	addr = virt_to_phys(adma->desc);
+	if (upper_32_bits(addr)) {
+		printf("Error found for upper 32 bits\n");
+		return -EINVAL;
+	}
+	esdhc_write32(&regs->adsaddr, lower_32_bits(addr));
+	esdhc_clrsetbits32(&regs->proctl, PROCTL_DMAS_MASK, PROCTL_DMAS_ADMA2);
+
+	return 0;
+}
+#endif
+
 static int esdhc_setup_data(struct mmc *mmc, struct mmc_data *data)
 {
 	int timeout;
 	struct fsl_esdhc_priv *priv = mmc->priv;
 	struct fsl_esdhc *regs = priv->esdhc_regs;
-#if defined(CONFIG_FSL_LAYERSCAPE) || defined(CONFIG_S32V234)
+#if (defined(CONFIG_FSL_LAYERSCAPE) || defined(CONFIG_S32V234)) && \
+	!defined(CONFIG_MMC_ADMA2)
 	dma_addr_t addr;
+#endif
+#ifdef CONFIG_MMC_ADMA2
+	int err;
 #endif
 	uint wml_value;
 
@@ -232,7 +277,7 @@ static int esdhc_setup_data(struct mmc *mmc, struct mmc_data *data)
 			wml_value = WML_RD_WML_MAX_VAL;
 
 		esdhc_clrsetbits32(&regs->wml, WML_RD_WML_MASK, wml_value);
-#ifndef CONFIG_SYS_FSL_ESDHC_USE_PIO
+#if !defined(CONFIG_SYS_FSL_ESDHC_USE_PIO) && !defined(CONFIG_MMC_ADMA2)
 #if defined(CONFIG_FSL_LAYERSCAPE) || defined(CONFIG_S32V234)
 		addr = virt_to_phys((void *)(data->dest));
 		if (upper_32_bits(addr))
@@ -261,7 +306,7 @@ static int esdhc_setup_data(struct mmc *mmc, struct mmc_data *data)
 
 		esdhc_clrsetbits32(&regs->wml, WML_WR_WML_MASK,
 					wml_value << 16);
-#ifndef CONFIG_SYS_FSL_ESDHC_USE_PIO
+#if !defined(CONFIG_SYS_FSL_ESDHC_USE_PIO) && !defined(CONFIG_MMC_ADMA2)
 #if defined(CONFIG_FSL_LAYERSCAPE) || defined(CONFIG_S32V234)
 		addr = virt_to_phys((void *)(data->src));
 		if (upper_32_bits(addr))
@@ -274,6 +319,12 @@ static int esdhc_setup_data(struct mmc *mmc, struct mmc_data *data)
 #endif
 	}
 
+#ifdef CONFIG_MMC_ADMA2
+	err = esdhc_setup_adma(priv, data);
+	if (err)
+		return err;
+#endif
+
 	esdhc_write32(&regs->blkattr, data->blocks << 16 | data->blocksize);
 
 	/* Calculate the timeout period for data transactions */
@@ -478,6 +529,11 @@ esdhc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 			}
 
 			if (irqstat & DATA_ERR) {
+#ifdef CONFIG_MMC_ADMA2
+				if (irqstat & IRQSTAT_DMAE)
+					debug("ADMA error status %x\n",
+					      esdhc_read32(&regs->admaes));
+#endif
 				err = -ECOMM;
 				goto out;
 			}
@@ -490,6 +546,9 @@ esdhc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 		 */
 		if (data->flags & MMC_DATA_READ)
 			check_and_invalidate_dcache_range(cmd, data);
+#ifdef CONFIG_MMC_ADMA2
+		mmc_adma_complete(&priv->adma);
+#endif
 #endif
 	}
 
@@ -802,6 +861,10 @@ static int fsl_esdhc_init(struct fsl_esdhc_priv *priv)
 #ifdef CONFIG_SYS_FSL_ESDHC_HAS_DDR_MODE
 	priv->cfg.host_caps |= MMC_MODE_DDR_52MHz;
 #endif
+#ifndef CONFIG_SYS_FSL_ERRATUM_ESDHC111
+	/* The erratum workaround sends its own stop command */
+	priv->cfg.host_caps |= MMC_MODE_CMD23;
+#endif
 
 	if (priv->bus_width > 0) {
 		if (priv->bus_width < 8)
@@ -823,6 +886,12 @@ static int fsl_esdhc_init(struct fsl_esdhc_priv *priv)
 
 	priv->cfg.b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
 
+#ifdef CONFIG_MMC_ADMA2
+	/* One table covers the largest transfer the block count allows */
+	if (mmc_adma_init(&priv->adma, priv->cfg.b_max * MMC_MAX_BLOCK_LEN, 1))
+		return -ENOMEM;
+#endif
+
 	mmc = mmc_create(&priv->cfg, priv);
 	if (mmc == NULL)
 		return -1;
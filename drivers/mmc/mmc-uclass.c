@@ -262,6 +262,8 @@ static const struct blk_ops mmc_blk_ops = {
 	.read	= mmc_bread,
 #ifndef CONFIG_SPL_BUILD
 	.write	= mmc_bwrite,
+	.write_submit	= mmc_bwrite_submit,
+	.write_wait	= mmc_bwrite_wait,
 #endif
 	.select_hwpart	= mmc_select_hwpart,
 };
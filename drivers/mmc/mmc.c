@@ -188,11 +188,23 @@ int mmc_set_blocklen(struct mmc *mmc, int len)
 	return mmc_send_cmd(mmc, &cmd, NULL);
 }
 
+int mmc_set_block_count(struct mmc *mmc, lbaint_t blkcnt)
+{
+	struct mmc_cmd cmd;
+
+	cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+	cmd.cmdarg = blkcnt;
+	cmd.resp_type = MMC_RSP_R1;
+
+	return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
 static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 			   lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
+	bool set_count = mmc_can_set_block_count(mmc, blkcnt);
 
 	if (blkcnt > 1)
 		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
@@ -211,10 +223,14 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	data.blocksize = mmc->read_bl_len;
 	data.flags = MMC_DATA_READ;
 
+	/* With the count set in advance the card stops by itself */
+	if (set_count && mmc_set_block_count(mmc, blkcnt))
+		return 0;
+
 	if (mmc_send_cmd(mmc, &cmd, &data))
 		return 0;
 
-	if (blkcnt > 1) {
+	if (blkcnt > 1 && !set_count) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
@@ -229,6 +245,27 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	return blkcnt;
 }
 
+/* Read blocks in chunks no larger than the host can transfer at once */
+static lbaint_t mmc_read_chunks(struct mmc *mmc, void *dst, lbaint_t start,
+				lbaint_t blkcnt)
+{
+	lbaint_t cur, blocks_todo = blkcnt;
+
+	do {
+		cur = (blocks_todo > mmc->cfg->b_max) ?
+			mmc->cfg->b_max : blocks_todo;
+		if (mmc_read_blocks(mmc, dst, start, cur) != cur) {
+			debug("%s: Failed to read blocks\n", __func__);
+			return 0;
+		}
+		blocks_todo -= cur;
+		start += cur;
+		dst += cur * mmc->read_bl_len;
+	} while (blocks_todo > 0);
+
+	return blkcnt;
+}
+
 #ifdef CONFIG_BLK
 ulong mmc_bread(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *dst)
 #else
@@ -241,7 +278,6 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 #endif
 	int dev_num = block_dev->devnum;
 	int err;
-	lbaint_t cur, blocks_todo = blkcnt;
 
 	if (blkcnt == 0)
 		return 0;
@@ -267,19 +303,46 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 		return 0;
 	}
 
-	do {
-		cur = (blocks_todo > mmc->cfg->b_max) ?
-			mmc->cfg->b_max : blocks_todo;
-		if (mmc_read_blocks(mmc, dst, start, cur) != cur) {
-			debug("%s: Failed to read blocks\n", __func__);
-			return 0;
+	return mmc_read_chunks(mmc, dst, start, blkcnt);
+}
+
+int mmc_bread_queue(struct mmc *mmc, struct mmc_read_req *req, int count)
+{
+	struct blk_desc *block_dev = mmc_get_blk_desc(mmc);
+	lbaint_t blkcnt;
+	int done, i;
+
+	if (blk_dselect_hwpart(block_dev, block_dev->hwpart) < 0)
+		return 0;
+	if (mmc_set_blocklen(mmc, mmc->read_bl_len)) {
+		debug("%s: Failed to set blocklen\n", __func__);
+		return 0;
+	}
+
+	for (done = 0; done < count; done = i) {
+		blkcnt = req[done].blkcnt;
+		if (!blkcnt || req[done].start + blkcnt > block_dev->lba)
+			break;
+
+		/* Take in the following reads which carry straight on */
+		for (i = done + 1; i < count; i++) {
+			struct mmc_read_req *prev = &req[i - 1];
+
+			if (!req[i].blkcnt ||
+			    req[i].start != prev->start + prev->blkcnt ||
+			    req[i].dst != prev->dst +
+					  prev->blkcnt * mmc->read_bl_len ||
+			    req[i].start + req[i].blkcnt > block_dev->lba)
+				break;
+			blkcnt += req[i].blkcnt;
 		}
-		blocks_todo -= cur;
-		start += cur;
-		dst += cur * mmc->read_bl_len;
-	} while (blocks_todo > 0);
 
-	return blkcnt;
+		if (mmc_read_chunks(mmc, req[done].dst, req[done].start,
+				    blkcnt) != blkcnt)
+			break;
+	}
+
+	return done;
 }
 
 static int mmc_go_idle(struct mmc *mmc)
@@ -514,6 +577,10 @@ static int mmc_change_freq(struct mmc *mmc)
 	if (mmc_host_is_spi(mmc))
 		return 0;
 
+	/* SET_BLOCK_COUNT arrived with version 3.1 */
+	if (mmc->version >= MMC_VERSION_3)
+		mmc->card_caps |= MMC_MODE_CMD23;
+
 	/* Only version 4 supports high-speed */
 	if (mmc->version < MMC_VERSION_4)
 		return 0;
@@ -902,6 +969,8 @@ retry_scr:
 
 	if (mmc->scr[0] & SD_DATA_4BIT)
 		mmc->card_caps |= MMC_MODE_4BIT;
+	if (mmc->scr[0] & SD_CMD23_SUPPORT)
+		mmc->card_caps |= MMC_MODE_CMD23;
 
 	/* Version 1.0 doesn't support switching */
 	if (mmc->version == SD_VERSION_1_0)
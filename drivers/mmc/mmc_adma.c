@@ -0,0 +1,170 @@
+/*
+ * ADMA2 descriptor tables for SD/MMC host controllers
+ *
+ * With ADMA2 the controller follows a table of descriptors, each giving the
+ * address and length of a piece of the data, so one command can move a large
+ * transfer to or from scattered buffers.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <malloc.h>
+#include <mmc_adma.h>
+#include <asm/io.h>
+
+static u64 mmc_adma_addr(void *buf)
+{
+#ifdef CONFIG_SANDBOX
+	return (ulong)buf;
+#else
+	return virt_to_phys(buf);
+#endif
+}
+
+static int mmc_adma_set(struct mmc_adma_table *table, u16 attr, void *buf,
+			uint len)
+{
+	struct mmc_adma_desc *desc;
+	u64 addr = mmc_adma_addr(buf);
+
+	if (table->used == table->count)
+		return -ENOSPC;
+#ifndef CONFIG_MMC_ADMA2_64BIT
+	if (upper_32_bits(addr))
+		return -EINVAL;
+#endif
+	desc = &table->desc[table->used++];
+	desc->attr = cpu_to_le16(attr);
+	desc->len = cpu_to_le16(len);
+	desc->addr = cpu_to_le32(lower_32_bits(addr));
+#ifdef CONFIG_MMC_ADMA2_64BIT
+	desc->addr_hi = cpu_to_le32(upper_32_bits(addr));
+	desc->reserved = 0;
+#endif
+
+	return 0;
+}
+
+int mmc_adma_init(struct mmc_adma_table *table, ulong max_len, uint max_bufs)
+{
+	size_t size;
+
+	memset(table, '\0', sizeof(*table));
+
+	/* Each buffer may need a descriptor for its unaligned start */
+	table->count = DIV_ROUND_UP(max_len, ADMA_MAX_LEN) + max_bufs * 2;
+	size = roundup(table->count * sizeof(struct mmc_adma_desc),
+		       ARCH_DMA_MINALIGN);
+	table->desc = memalign(ARCH_DMA_MINALIGN, size);
+	size = roundup(max_bufs * ADMA_ALIGN, ARCH_DMA_MINALIGN);
+	table->bounce = memalign(ARCH_DMA_MINALIGN, size);
+	table->head = calloc(max_bufs, sizeof(*table->head));
+	if (!table->desc || !table->bounce || !table->head) {
+		mmc_adma_free(table);
+		return -ENOMEM;
+	}
+	table->max_bufs = max_bufs;
+
+	return 0;
+}
+
+void mmc_adma_free(struct mmc_adma_table *table)
+{
+	free(table->desc);
+	free(table->bounce);
+	free(table->head);
+	table->desc = NULL;
+	table->bounce = NULL;
+	table->head = NULL;
+}
+
+void mmc_adma_start(struct mmc_adma_table *table, bool read)
+{
+	table->used = 0;
+	table->bufs = 0;
+	table->read = read;
+}
+
+int mmc_adma_add(struct mmc_adma_table *table, void *buf, ulong len)
+{
+	u8 *ptr = buf;
+	uint offset, part;
+	int ret;
+
+	if (table->bufs == table->max_bufs)
+		return -ENOSPC;
+
+	/* Move the start through the bounce buffer to align the rest */
+	table->head[table->bufs].ptr = NULL;
+	offset = (ulong)ptr & (ADMA_ALIGN - 1);
+	if (offset && len) {
+		u8 *bounce = table->bounce + table->bufs * ADMA_ALIGN;
+
+		part = min((ulong)(ADMA_ALIGN - offset), len);
+		if (!table->read)
+			memcpy(bounce, ptr, part);
+		ret = mmc_adma_set(table, ADMA_DESC_VALID | ADMA_DESC_ACT_TRAN,
+				   bounce, part);
+		if (ret)
+			return ret;
+		table->head[table->bufs].ptr = ptr;
+		table->head[table->bufs].len = part;
+		ptr += part;
+		len -= part;
+	}
+	table->bufs++;
+
+	for (; len; ptr += part, len -= part) {
+		part = min(len, (ulong)ADMA_MAX_LEN);
+		ret = mmc_adma_set(table, ADMA_DESC_VALID | ADMA_DESC_ACT_TRAN,
+				   ptr, part);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int mmc_adma_finish(struct mmc_adma_table *table)
+{
+	struct mmc_adma_desc *last;
+	ulong start;
+
+	if (!table->used)
+		return -EINVAL;
+	last = &table->desc[table->used - 1];
+	last->attr |= cpu_to_le16(ADMA_DESC_END);
+
+	start = (ulong)table->desc;
+	flush_dcache_range(start, start + roundup(table->used * sizeof(*last),
+						  ARCH_DMA_MINALIGN));
+	if (!table->read) {
+		start = (ulong)table->bounce;
+		flush_dcache_range(start, start + roundup(table->bufs *
+							  ADMA_ALIGN,
+							  ARCH_DMA_MINALIGN));
+	}
+
+	return 0;
+}
+
+void mmc_adma_complete(struct mmc_adma_table *table)
+{
+	ulong start = (ulong)table->bounce;
+	uint i;
+
+	if (!table->read)
+		return;
+	invalidate_dcache_range(start, start + roundup(table->bufs * ADMA_ALIGN,
+						       ARCH_DMA_MINALIGN));
+	for (i = 0; i < table->bufs; i++) {
+		struct mmc_adma_head *head = &table->head[i];
+
+		if (head->ptr) {
+			memcpy(head->ptr, table->bounce + i * ADMA_ALIGN,
+			       head->len);
+		}
+	}
+}
@@ -16,6 +16,34 @@ extern int mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 			struct mmc_data *data);
 extern int mmc_send_status(struct mmc *mmc, int timeout);
 extern int mmc_set_blocklen(struct mmc *mmc, int len);
+
+/**
+ * mmc_set_block_count() - Set the number of blocks for the next transfer
+ *
+ * A multi-block read or write which follows this stops by itself after
+ * @blkcnt blocks, with no need for a STOP_TRANSMISSION command.
+ *
+ * @mmc:	MMC device
+ * @blkcnt:	Number of blocks
+ * @return 0 if OK, -ve on error
+ */
+int mmc_set_block_count(struct mmc *mmc, lbaint_t blkcnt);
+
+/**
+ * mmc_can_set_block_count() - Check if a transfer can use SET_BLOCK_COUNT
+ *
+ * The card and host must both support it, and the count must fit in the
+ * 16 bits which an MMC card takes.
+ *
+ * @mmc:	MMC device
+ * @blkcnt:	Number of blocks in the transfer
+ * @return true if mmc_set_block_count() can be used
+ */
+static inline bool mmc_can_set_block_count(struct mmc *mmc, lbaint_t blkcnt)
+{
+	return (mmc->card_caps & MMC_MODE_CMD23) && !mmc_host_is_spi(mmc) &&
+		blkcnt > 1 && blkcnt <= 0xffff;
+}
 #ifdef CONFIG_FSL_ESDHC_ADAPTER_IDENT
 void mmc_adapter_card_type_ident(void);
 #endif
@@ -36,6 +64,14 @@ unsigned long mmc_berase(struct blk_desc *block_dev, lbaint_t start,
 #ifdef CONFIG_BLK
 ulong mmc_bwrite(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		 const void *src);
+
+/*
+ * Write like mmc_bwrite(), but return without waiting for the card to
+ * finish programming the data, which mmc_bwrite_wait() does
+ */
+int mmc_bwrite_submit(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+		      const void *src);
+ulong mmc_bwrite_wait(struct udevice *dev);
 #else
 ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 		 const void *src);
@@ -10,11 +10,15 @@
 #include <config.h>
 #include <common.h>
 #include <dm.h>
+#include <errno.h>
 #include <part.h>
 #include <div64.h>
 #include <linux/math64.h>
 #include "mmc_private.h"
 
+/* How long the card may stay busy programming written data, in ms */
+#define MMC_BUSY_TIMEOUT	1000
+
 static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
@@ -116,12 +120,16 @@ unsigned long mmc_berase(struct blk_desc *block_dev, lbaint_t start,
 	return blk;
 }
 
+/*
+ * With @wait false this returns once the data is sent, leaving the card
+ * busy programming it
+ */
 static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
-		lbaint_t blkcnt, const void *src)
+		lbaint_t blkcnt, const void *src, bool wait)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
-	int timeout = 1000;
+	bool set_count = mmc_can_set_block_count(mmc, blkcnt);
 
 	if ((start + blkcnt) > mmc_get_blk_desc(mmc)->lba) {
 		printf("MMC: block number 0x" LBAF " exceeds max(0x" LBAF ")\n",
@@ -148,6 +156,11 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 	data.blocksize = mmc->write_bl_len;
 	data.flags = MMC_DATA_WRITE;
 
+	if (set_count && mmc_set_block_count(mmc, blkcnt)) {
+		printf("mmc fail to set block count\n");
+		return 0;
+	}
+
 	if (mmc_send_cmd(mmc, &cmd, &data)) {
 		printf("mmc write failed\n");
 		return 0;
@@ -156,7 +169,7 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 	/* SPI multiblock writes terminate using a special
 	 * token, not a STOP_TRANSMISSION request.
 	 */
-	if (!mmc_host_is_spi(mmc) && blkcnt > 1) {
+	if (!mmc_host_is_spi(mmc) && blkcnt > 1 && !set_count) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
@@ -167,23 +180,15 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 	}
 
 	/* Waiting for the ready status */
-	if (mmc_send_status(mmc, timeout))
+	if (wait && mmc_send_status(mmc, MMC_BUSY_TIMEOUT))
 		return 0;
 
 	return blkcnt;
 }
 
-#ifdef CONFIG_BLK
-ulong mmc_bwrite(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
-		 const void *src)
-#else
-ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
-		 const void *src)
-#endif
+static ulong mmc_bwrite_run(struct blk_desc *block_dev, lbaint_t start,
+			    lbaint_t blkcnt, const void *src, bool wait)
 {
-#ifdef CONFIG_BLK
-	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
-#endif
 	int dev_num = block_dev->devnum;
 	lbaint_t cur, blocks_todo = blkcnt;
 	int err;
@@ -202,7 +207,9 @@ ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	do {
 		cur = (blocks_todo > mmc->cfg->b_max) ?
 			mmc->cfg->b_max : blocks_todo;
-		if (mmc_write_blocks(mmc, start, cur, src) != cur)
+		/* Only the last write can be left in progress */
+		if (mmc_write_blocks(mmc, start, cur, src,
+				     wait || cur < blocks_todo) != cur)
 			return 0;
 		blocks_todo -= cur;
 		start += cur;
@@ -211,3 +218,51 @@ ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 
 	return blkcnt;
 }
+
+#ifdef CONFIG_BLK
+ulong mmc_bwrite(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+		 const void *src)
+{
+	return mmc_bwrite_run(dev_get_uclass_platdata(dev), start, blkcnt,
+			      src, true);
+}
+
+int mmc_bwrite_submit(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+		      const void *src)
+{
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	struct mmc *mmc = find_mmc_device(block_dev->devnum);
+
+	if (!mmc)
+		return -ENODEV;
+	if (mmc_bwrite_run(block_dev, start, blkcnt, src, false) != blkcnt)
+		return -EIO;
+	mmc->write_pending = blkcnt;
+
+	return 0;
+}
+
+ulong mmc_bwrite_wait(struct udevice *dev)
+{
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	struct mmc *mmc = find_mmc_device(block_dev->devnum);
+	lbaint_t blkcnt;
+
+	if (!mmc)
+		return -ENODEV;
+	blkcnt = mmc->write_pending;
+	mmc->write_pending = 0;
+
+	/* Wait for the card to finish programming the data */
+	if (blkcnt && mmc_send_status(mmc, MMC_BUSY_TIMEOUT))
+		return 0;
+
+	return blkcnt;
+}
+#else
+ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
+		 const void *src)
+{
+	return mmc_bwrite_run(block_dev, start, blkcnt, src, true);
+}
+#endif
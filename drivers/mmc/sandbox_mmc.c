@@ -9,25 +9,177 @@
 #include <dm.h>
 #include <errno.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <mmc.h>
+#include <mmc_adma.h>
 #include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Size of the emulated card, which must be a multiple of 1MiB */
+#define SANDBOX_MMC_SIZE	(4 << 20)
+
+/* Most descriptors followed in one transfer, to catch a table with no end */
+#define SANDBOX_ADMA_MAX_DESCS	0x10000
+
+/* Commands with a higher index are not counted */
+#define SANDBOX_MMC_CMD_COUNT	64
+
+/**
+ * struct sandbox_mmc_plat - Emulated card and controller
+ *
+ * @buf:	Card contents
+ * @set_count:	Block count given by SET_BLOCK_COUNT for the next transfer,
+ *		or 0 if none
+ * @stop_needed: true if a multi-block transfer is waiting for
+ *		STOP_TRANSMISSION
+ * @cmd_count:	Number of times each command has been sent
+ */
 struct sandbox_mmc_plat {
 	struct mmc_config cfg;
 	struct mmc mmc;
+	u8 *buf;
+	uint set_count;
+	bool stop_needed;
+	uint cmd_count[SANDBOX_MMC_CMD_COUNT];
+#ifdef CONFIG_MMC_ADMA2
+	struct mmc_adma_table adma;
+#endif
 };
 
+#ifdef CONFIG_MMC_ADMA2
+int sandbox_mmc_adma_run(const struct mmc_adma_desc *desc, u8 *card,
+			 ulong len, bool read)
+{
+	ulong table_align = sizeof(*desc) > 8 ? 8 : 4;
+	ulong done = 0;
+	int i;
+
+	for (i = 0; i < SANDBOX_ADMA_MAX_DESCS; i++) {
+		uint attr = le16_to_cpu(desc->attr);
+		ulong size = le16_to_cpu(desc->len) ?: 0x10000;
+		u64 addr = le32_to_cpu(desc->addr);
+
+#ifdef CONFIG_MMC_ADMA2_64BIT
+		addr |= (u64)le32_to_cpu(desc->addr_hi) << 32;
+#endif
+		if ((ulong)desc & (table_align - 1)) {
+			debug("%s: descriptor %p not aligned\n", __func__,
+			      desc);
+			return -EIO;
+		}
+		if (!(attr & ADMA_DESC_VALID)) {
+			debug("%s: descriptor %d not valid\n", __func__, i);
+			return -EIO;
+		}
+
+		switch (attr & ADMA_DESC_ACT_MASK) {
+		case ADMA_DESC_ACT_NOP:
+			desc++;
+			break;
+		case ADMA_DESC_ACT_TRAN:
+			if (addr & (ADMA_ALIGN - 1)) {
+				debug("%s: descriptor %d data %llx not aligned\n",
+				      __func__, i, addr);
+				return -EIO;
+			}
+			if (done + size > len) {
+				debug("%s: descriptor %d overruns the transfer\n",
+				      __func__, i);
+				return -EIO;
+			}
+			if (read)
+				memcpy((void *)(ulong)addr, card + done, size);
+			else
+				memcpy(card + done, (void *)(ulong)addr, size);
+			done += size;
+			desc++;
+			break;
+		case ADMA_DESC_ACT_LINK:
+			desc = (const struct mmc_adma_desc *)(ulong)addr;
+			break;
+		default:
+			debug("%s: descriptor %d has reserved action\n",
+			      __func__, i);
+			return -EIO;
+		}
+
+		if (attr & ADMA_DESC_END) {
+			if (done != len) {
+				debug("%s: table ends after %lx of %lx bytes\n",
+				      __func__, done, len);
+				return -EIO;
+			}
+			return 0;
+		}
+	}
+	debug("%s: table has no end\n", __func__);
+
+	return -EIO;
+}
+#endif
+
+int sandbox_mmc_cmd_count(struct udevice *dev, uint cmdidx)
+{
+	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+
+	if (cmdidx >= SANDBOX_MMC_CMD_COUNT)
+		return -EINVAL;
+
+	return plat->cmd_count[cmdidx];
+}
+
+/* Move block data to or from the card, as a controller would using DMA */
+static int sandbox_mmc_xfer(struct udevice *dev, struct mmc_cmd *cmd,
+			    struct mmc_data *data)
+{
+	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+	bool read = data->flags & MMC_DATA_READ;
+	ulong offset = (ulong)cmd->cmdarg * data->blocksize;
+	ulong len = data->blocks * data->blocksize;
+#ifdef CONFIG_MMC_ADMA2
+	int ret;
+#endif
+
+	if (offset + len > SANDBOX_MMC_SIZE)
+		return -EIO;
+
+#ifdef CONFIG_MMC_ADMA2
+	mmc_adma_start(&plat->adma, read);
+	ret = mmc_adma_add(&plat->adma, read ? data->dest : (char *)data->src,
+			   len);
+	if (!ret)
+		ret = mmc_adma_finish(&plat->adma);
+	if (!ret)
+		ret = sandbox_mmc_adma_run(plat->adma.desc, plat->buf + offset,
+					   len, read);
+	if (ret)
+		return ret;
+	mmc_adma_complete(&plat->adma);
+#else
+	if (read)
+		memcpy(data->dest, plat->buf + offset, len);
+	else
+		memcpy(plat->buf + offset, data->src, len);
+#endif
+
+	return 0;
+}
+
 /**
  * sandbox_mmc_send_cmd() - Emulate SD commands
  *
- * This emulate an SD card version 2. Single-block reads result in zero data.
- * Multiple-block reads return a test string.
+ * This emulate an SD card version 2, holding SANDBOX_MMC_SIZE bytes in
+ * memory. The first block starts with a test string.
  */
 static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 				struct mmc_data *data)
 {
+	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+
+	if (cmd->cmdidx < SANDBOX_MMC_CMD_COUNT)
+		plat->cmd_count[cmd->cmdidx]++;
+
 	switch (cmd->cmdidx) {
 	case MMC_CMD_ALL_SEND_CID:
 		break;
@@ -46,6 +198,9 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	case MMC_CMD_SEND_CSD:
 		cmd->response[0] = 0;
 		cmd->response[1] = 10 << 16;	/* 1 << block_len */
+		/* Size in MiB, less one, with the block_len above */
+		cmd->response[2] = ((SANDBOX_MMC_SIZE >> 20) - 1) << 16;
+		cmd->response[3] = 0;
 		break;
 	case SD_CMD_SWITCH_FUNC: {
 		u32 *resp = (u32 *)data->dest;
@@ -53,13 +208,29 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		resp[7] = cpu_to_be32(SD_HIGHSPEED_BUSY);
 		break;
 	}
-	case MMC_CMD_READ_SINGLE_BLOCK:
-		memset(data->dest, '\0', data->blocksize);
+	case MMC_CMD_SET_BLOCK_COUNT:
+		plat->set_count = cmd->cmdarg;
 		break;
 	case MMC_CMD_READ_MULTIPLE_BLOCK:
-		strcpy(data->dest, "this is a test");
-		break;
+	case MMC_CMD_WRITE_MULTIPLE_BLOCK:
+		if (plat->set_count && plat->set_count != data->blocks) {
+			debug("%s: block count %d but transfer has %d\n",
+			      __func__, plat->set_count, data->blocks);
+			plat->set_count = 0;
+			return -EIO;
+		}
+		plat->stop_needed = !plat->set_count;
+		plat->set_count = 0;
+		return sandbox_mmc_xfer(dev, cmd, data);
+	case MMC_CMD_READ_SINGLE_BLOCK:
+	case MMC_CMD_WRITE_SINGLE_BLOCK:
+		plat->set_count = 0;
+		return sandbox_mmc_xfer(dev, cmd, data);
 	case MMC_CMD_STOP_TRANSMISSION:
+		/* A card which is not transferring data does not respond */
+		if (!plat->stop_needed)
+			return -ETIMEDOUT;
+		plat->stop_needed = false;
 		break;
 	case SD_CMD_APP_SEND_OP_COND:
 		cmd->response[0] = OCR_BUSY | OCR_HCS;
@@ -74,7 +245,8 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	case SD_CMD_APP_SEND_SCR: {
 		u32 *scr = (u32 *)data->dest;
 
-		scr[0] = cpu_to_be32(2 << 24 | 1 << 15);  /* SD version 3 */
+		/* SD version 3, with SET_BLOCK_COUNT */
+		scr[0] = cpu_to_be32(2 << 24 | 1 << 15 | SD_CMD23_SUPPORT);
 		break;
 	}
 	default:
@@ -105,9 +277,35 @@ int sandbox_mmc_probe(struct udevice *dev)
 {
 	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
 
+	plat->buf = calloc(1, SANDBOX_MMC_SIZE);
+	if (!plat->buf)
+		return -ENOMEM;
+	strcpy((char *)plat->buf, "this is a test");
+	plat->set_count = 0;
+	plat->stop_needed = false;
+#ifdef CONFIG_MMC_ADMA2
+	if (mmc_adma_init(&plat->adma, SANDBOX_MMC_SIZE, 1)) {
+		free(plat->buf);
+		return -ENOMEM;
+	}
+#endif
+
 	return mmc_init(&plat->mmc);
 }
 
+static int sandbox_mmc_remove(struct udevice *dev)
+{
+	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+
+#ifdef CONFIG_MMC_ADMA2
+	mmc_adma_free(&plat->adma);
+#endif
+	free(plat->buf);
+	plat->buf = NULL;
+
+	return 0;
+}
+
 int sandbox_mmc_bind(struct udevice *dev)
 {
 	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
@@ -115,7 +313,8 @@ int sandbox_mmc_bind(struct udevice *dev)
 	int ret;
 
 	cfg->name = dev->name;
-	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT;
+	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT |
+			 MMC_MODE_CMD23;
 	cfg->voltages = MMC_VDD_165_195 | MMC_VDD_32_33 | MMC_VDD_33_34;
 	cfg->f_min = 1000000;
 	cfg->f_max = 52000000;
@@ -148,5 +347,6 @@ U_BOOT_DRIVER(mmc_sandbox) = {
 	.bind		= sandbox_mmc_bind,
 	.unbind		= sandbox_mmc_unbind,
 	.probe		= sandbox_mmc_probe,
+	.remove		= sandbox_mmc_remove,
 	.platdata_auto_alloc_size = sizeof(struct sandbox_mmc_plat),
 };
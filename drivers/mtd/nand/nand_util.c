@@ -401,13 +401,14 @@ int nand_unlock(struct mtd_info *mtd, loff_t start, size_t length,
  * @param mtd nand mtd instance
  * @param offset offset in flash
  * @param length image length
- * @param used length of flash needed for the requested length
+ * @param used length of flash needed for the requested length, which is
+ *	       added to
  * @return 0 if the image fits and there are no bad blocks
  *         1 if the image fits, but there are bad blocks
  *        -1 if the image does not fit
  */
-static int check_skip_len(struct mtd_info *mtd, loff_t offset, size_t length,
-			  size_t *used)
+int check_skip_len(struct mtd_info *mtd, loff_t offset, size_t length,
+		   size_t *used)
 {
 	size_t len_excl_bad = 0;
 	int ret = 0;
@@ -0,0 +1,224 @@
+/*
+ * Update SPI flash, erasing and programming only what has changed
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <malloc.h>
+#include <spi_flash.h>
+
+/* Amount of flash read and compared in one go */
+#define SF_UPDATE_CHUNK		(256 << 10)
+
+/* State of each erase sector in the chunk being updated */
+enum {
+	SF_SECT_SAME,		/* already holds the new data */
+	SF_SECT_ERASED,		/* blank, so can be programmed directly */
+	SF_SECT_DIRTY,		/* must be erased before programming */
+};
+
+/**
+ * struct sf_update - Information about an update in progress
+ *
+ * @flash:	Flash being updated
+ * @offset:	Flash offset of the new data
+ * @end:	Flash offset just past the new data
+ * @buf:	New data
+ * @data:	Contents of the current chunk, read from flash and then merged
+ *		with the new data
+ * @state:	State of each sector in the chunk (SF_SECT_...)
+ * @stats:	Statistics to update
+ */
+struct sf_update {
+	struct spi_flash *flash;
+	u32 offset;
+	u32 end;
+	const u8 *buf;
+	u8 *data;
+	u8 *state;
+	struct spi_flash_update_stats *stats;
+};
+
+static bool sf_update_blank(const void *data, size_t len)
+{
+	const ulong *ptr = data;
+
+	for (; len; len -= sizeof(*ptr)) {
+		if (*ptr++ != ~0UL)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Compare each sector of the chunk at @pos with the new data, then merge the
+ * new data into the sectors which need programming
+ */
+static void sf_update_compare(struct sf_update *upd, u32 pos, u32 size)
+{
+	u32 sect_size = upd->flash->erase_size;
+	u32 addr, lo, hi;
+	int sect;
+
+	for (sect = 0, addr = pos; addr < pos + size;
+	     sect++, addr += sect_size) {
+		u8 *old = upd->data + (addr - pos);
+
+		lo = max(addr, upd->offset);
+		hi = min(addr + sect_size, upd->end);
+		if (!memcmp(old + (lo - addr), upd->buf + (lo - upd->offset),
+			    hi - lo)) {
+			upd->state[sect] = SF_SECT_SAME;
+			upd->stats->skipped += hi - lo;
+			continue;
+		}
+		if (sf_update_blank(old, sect_size))
+			upd->state[sect] = SF_SECT_ERASED;
+		else
+			upd->state[sect] = SF_SECT_DIRTY;
+		memcpy(old + (lo - addr), upd->buf + (lo - upd->offset),
+		       hi - lo);
+	}
+}
+
+/*
+ * Where a whole block needs erasing apart from some blank sectors, erase
+ * them too, so that one block erase can be used instead of several sector
+ * erases
+ */
+static void sf_update_use_blocks(struct sf_update *upd, u32 pos, u32 size)
+{
+	u32 sect_size = upd->flash->erase_size;
+	u32 block_size = upd->flash->block_size;
+	int per_block = block_size / sect_size;
+	u32 addr;
+	int sect, i;
+
+	if (block_size <= sect_size)
+		return;
+	addr = roundup(pos, block_size);
+	for (sect = (addr - pos) / sect_size; addr + block_size <= pos + size;
+	     sect += per_block, addr += block_size) {
+		bool dirty = false;
+
+		for (i = 0; i < per_block; i++) {
+			if (upd->state[sect + i] == SF_SECT_SAME)
+				break;
+			if (upd->state[sect + i] == SF_SECT_DIRTY)
+				dirty = true;
+		}
+		if (i != per_block || !dirty)
+			continue;
+		for (i = 0; i < per_block; i++)
+			upd->state[sect + i] = SF_SECT_DIRTY;
+	}
+}
+
+/* Erase each run of dirty sectors in one call */
+static int sf_update_erase(struct sf_update *upd, u32 pos, u32 size)
+{
+	u32 sect_size = upd->flash->erase_size;
+	int num_sects = size / sect_size;
+	int sect, first;
+	int ret;
+
+	for (sect = 0; sect < num_sects; sect++) {
+		if (upd->state[sect] != SF_SECT_DIRTY)
+			continue;
+		for (first = sect; sect < num_sects; sect++) {
+			if (upd->state[sect] != SF_SECT_DIRTY)
+				break;
+		}
+		ret = spi_flash_erase(upd->flash, pos + first * sect_size,
+				      (sect - first) * sect_size);
+		if (ret)
+			return ret;
+		upd->stats->erased += (sect - first) * sect_size;
+	}
+
+	return 0;
+}
+
+/* Program each run of pages which are not blank, skipping unchanged sectors */
+static int sf_update_write(struct sf_update *upd, u32 pos, u32 size)
+{
+	u32 sect_size = upd->flash->erase_size;
+	u32 page_size = upd->flash->page_size;
+	u32 start = 0, addr;
+	int ret;
+
+	for (addr = 0; addr <= size; addr += page_size) {
+		bool skip = addr == size ||
+			upd->state[addr / sect_size] == SF_SECT_SAME ||
+			sf_update_blank(upd->data + addr, page_size);
+
+		if (!skip)
+			continue;
+		if (addr > start) {
+			ret = spi_flash_write(upd->flash, pos + start,
+					      addr - start, upd->data + start);
+			if (ret)
+				return ret;
+			upd->stats->written += addr - start;
+		}
+		start = addr + page_size;
+	}
+
+	return 0;
+}
+
+int spi_flash_smart_update(struct spi_flash *flash, u32 offset, size_t len,
+			   const void *buf,
+			   struct spi_flash_update_stats *stats)
+{
+	struct sf_update upd;
+	u32 chunk, pos, next, start, end;
+	int ret = 0;
+
+	if (!len)
+		return 0;
+	if (offset + len > flash->size)
+		return -EINVAL;
+
+	/* Chunks hold whole blocks, so a block erase can be chosen */
+	chunk = roundup(SF_UPDATE_CHUNK, max(flash->erase_size,
+					     flash->block_size));
+	upd.data = memalign(ARCH_DMA_MINALIGN, chunk);
+	upd.state = malloc(chunk / flash->erase_size);
+	if (!upd.data || !upd.state) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	upd.flash = flash;
+	upd.offset = offset;
+	upd.end = offset + len;
+	upd.buf = buf;
+	upd.stats = stats;
+
+	start = rounddown(offset, flash->erase_size);
+	end = roundup(offset + len, flash->erase_size);
+	for (pos = start; pos < end; pos = next) {
+		next = min(end, pos - pos % chunk + chunk);
+		debug("%s: chunk %#x size %#x\n", __func__, pos, next - pos);
+		ret = spi_flash_read(flash, pos, next - pos, upd.data);
+		if (ret)
+			break;
+		sf_update_compare(&upd, pos, next - pos);
+		sf_update_use_blocks(&upd, pos, next - pos);
+		ret = sf_update_erase(&upd, pos, next - pos);
+		if (ret)
+			break;
+		ret = sf_update_write(&upd, pos, next - pos);
+		if (ret)
+			break;
+	}
+
+out:
+	free(upd.state);
+	free(upd.data);
+
+	return ret;
+}
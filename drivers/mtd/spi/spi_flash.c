@@ -347,9 +347,18 @@ int spi_flash_cmd_erase_ops(struct spi_flash *flash, u32 offset, size_t len)
 		}
 	}
 
-	cmd[0] = flash->erase_cmd;
 	while (len) {
 		erase_addr = offset;
+		cmd[0] = flash->erase_cmd;
+		erase_size = flash->erase_size;
+#ifdef CONFIG_SPI_FLASH_SMART_UPDATE
+		/* Use one block erase in place of many small sector erases */
+		if (flash->block_size > erase_size &&
+		    !(offset % flash->block_size) && len >= flash->block_size) {
+			cmd[0] = CMD_ERASE_64K;
+			erase_size = flash->block_size;
+		}
+#endif
 
 #ifdef CONFIG_SF_DUAL_FLASH
 		if (flash->dual_flash > SF_SINGLE_FLASH)
@@ -1239,6 +1248,9 @@ int spi_flash_scan(struct spi_flash *flash)
 		flash->erase_size = flash->sector_size;
 	}
 
+	/* The sector size from the table is what CMD_ERASE_64K erases */
+	flash->block_size = flash->sector_size;
+
 	/* Now erase size becomes valid sector size */
 	flash->sector_size = flash->erase_size;
 
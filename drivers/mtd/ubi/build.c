@@ -1002,8 +1002,14 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 	ubi->fm_buf = vzalloc(ubi->fm_size);
 	if (!ubi->fm_buf)
 		goto out_free;
+#endif
+#ifdef __UBOOT__
+	bootstage_start(BOOTSTAGE_ID_ACCUM_UBI_ATTACH, "ubi_attach");
 #endif
 	err = ubi_attach(ubi, 0);
+#ifdef __UBOOT__
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_ATTACH);
+#endif
 	if (err) {
 		ubi_err(ubi, "failed to attach mtd%d, error %d",
 			mtd->index, err);
@@ -1016,6 +1022,21 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 			goto out_detach;
 	}
 
+#if defined(__UBOOT__) && defined(CONFIG_MTD_UBI_FASTMAP)
+	/*
+	 * U-Boot special: The device was attached by scanning, and nothing
+	 * writes a fastmap until the pool runs dry or the device is detached,
+	 * which rarely happens before the OS boots. Write one now, so that
+	 * the next attach, by U-Boot, the SPL loader or the OS, is quick.
+	 */
+	if (!ubi->fm && !ubi->fm_disabled && !ubi->ro_mode) {
+		err = ubi_update_fastmap(ubi);
+		if (err)
+			ubi_warn(ubi, "unable to write a fastmap, error %d",
+				 err);
+	}
+#endif
+
 	err = uif_init(ubi, &ref);
 	if (err)
 		goto out_detach;
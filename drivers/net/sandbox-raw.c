@@ -69,12 +69,12 @@ static int sb_eth_raw_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eth_pdata *pdata = dev_get_platdata(dev);
 	struct eth_sandbox_raw_priv *priv = dev_get_priv(dev);
+	uchar *buf = net_rx_packets[0];
 	int retval = 0;
 	int length;
 
 	if (reply_arp) {
-		struct arp_hdr *arp = (void *)net_rx_packets[0] +
-			ETHER_HDR_SIZE;
+		struct arp_hdr *arp = (void *)buf + ETHER_HDR_SIZE;
 
 		/*
 		 * Fake an ARP response. The u-boot network stack is sending an
@@ -98,16 +98,32 @@ static int sb_eth_raw_recv(struct udevice *dev, int flags, uchar **packetp)
 		net_write_ip(&arp->ar_tpa, net_ip);
 		length = ARP_HDR_SIZE;
 	} else {
-		/* If local, the Ethernet header won't be included; skip it */
-		uchar *pktptr = priv->local ?
-			net_rx_packets[0] + ETHER_HDR_SIZE : net_rx_packets[0];
-
-		retval = sandbox_eth_raw_os_recv(pktptr, &length, priv);
+		/* Receive in place if the stack asks, unless it is too big */
+		uchar *direct = eth_rx_direct_buf(&length);
+
+		if (direct) {
+			buf = direct;
+			if (priv->local)
+				length -= ETHER_HDR_SIZE;
+			retval = sandbox_eth_raw_os_recv(priv->local ?
+					buf + ETHER_HDR_SIZE : buf, &length,
+					priv);
+		}
+		if (!direct || retval == -EMSGSIZE) {
+			buf = net_rx_packets[0];
+			length = PKTSIZE_ALIGN;
+			if (priv->local)
+				length -= ETHER_HDR_SIZE;
+			/* If local, the Ethernet header won't be included */
+			retval = sandbox_eth_raw_os_recv(priv->local ?
+					buf + ETHER_HDR_SIZE : buf, &length,
+					priv);
+		}
 	}
 
 	if (!retval && length) {
 		if (priv->local) {
-			struct ethernet_hdr *eth = (void *)net_rx_packets[0];
+			struct ethernet_hdr *eth = (void *)buf;
 
 			/* Fill in enough of the missing Ethernet header */
 			memcpy(eth->et_dest, pdata->enetaddr, ARP_HLEN);
@@ -119,7 +135,7 @@ static int sb_eth_raw_recv(struct udevice *dev, int flags, uchar **packetp)
 
 		debug("eth_sandbox_raw: received packet %d\n",
 		      length);
-		*packetp = net_rx_packets[0];
+		*packetp = buf;
 		return length;
 	}
 	return retval;
@@ -11,27 +11,41 @@
 #include <dm.h>
 #include <malloc.h>
 #include <net.h>
+#include <asm/eth.h>
 #include <asm/test.h>
+#include <asm/unaligned.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Number of packets the mocked machine can have queued for us */
+#define SB_ETH_RECV_QUEUE	32
+
+/* Most IP payload in one frame, a multiple of 8 as needed for fragments */
+#define SB_ETH_IP_MTU		1480
+
 /**
  * struct eth_sandbox_priv - memory for sandbox mock driver
  *
  * fake_host_hwaddr: MAC address of mocked machine
  * fake_host_ipaddr: IP address of mocked machine
- * recv_packet_buffer: buffer of the packet returned as received
- * recv_packet_length: length of the packet returned as received
+ * recv_packet_buffer: queue of packets to be returned as received
+ * recv_packet_length: length of each queued packet
+ * recv_head: index of the next packet to return
+ * recv_count: number of packets queued
  */
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
 	struct in_addr fake_host_ipaddr;
-	uchar *recv_packet_buffer;
-	int recv_packet_length;
+	uchar recv_packet_buffer[SB_ETH_RECV_QUEUE][PKTSIZE_ALIGN];
+	int recv_packet_length[SB_ETH_RECV_QUEUE];
+	int recv_head;
+	int recv_count;
 };
 
 static bool disabled[8] = {false};
 static bool skip_timeout;
+static struct sandbox_eth_tftp tftp_server;
+static struct sandbox_eth_nfs nfs_server;
 
 /*
  * sandbox_eth_disable_response()
@@ -54,6 +68,418 @@ void sandbox_eth_skip_timeout(void)
 	skip_timeout = true;
 }
 
+struct sandbox_eth_tftp *sandbox_eth_get_tftp(void)
+{
+	return &tftp_server;
+}
+
+struct sandbox_eth_nfs *sandbox_eth_get_nfs(void)
+{
+	return &nfs_server;
+}
+
+/*
+ * sb_eth_queue_packet()
+ *
+ * Reserve room for a packet from the mocked machine. Like a real receive
+ * ring, packets are dropped when the queue is full.
+ *
+ * priv - Driver private data
+ * length - Length of the packet to be filled in
+ * returns buffer to write the packet to, or NULL if the queue is full
+ */
+static uchar *sb_eth_queue_packet(struct eth_sandbox_priv *priv, int length)
+{
+	int tail;
+
+	if (priv->recv_count == SB_ETH_RECV_QUEUE)
+		return NULL;
+	tail = (priv->recv_head + priv->recv_count) % SB_ETH_RECV_QUEUE;
+	priv->recv_packet_length[tail] = length;
+	priv->recv_count++;
+
+	return priv->recv_packet_buffer[tail];
+}
+
+/*
+ * sb_eth_udp_reply()
+ *
+ * Queue a UDP datagram from the mocked machine to U-Boot, split into IP
+ * fragments if it does not fit in one frame
+ *
+ * dest_hwaddr - MAC address to send to
+ * dest_ip - IP address to send to
+ * sport - UDP source port
+ * dport - UDP destination port
+ * data - UDP payload
+ * len - Length of the UDP payload
+ */
+static void sb_eth_udp_reply(struct eth_sandbox_priv *priv,
+			     const uchar *dest_hwaddr, struct in_addr dest_ip,
+			     int sport, int dport, const void *data, int len)
+{
+	int total = UDP_HDR_SIZE + len;
+	struct ethernet_hdr *eth_recv;
+	struct ip_udp_hdr *ipr;
+	int offset, part;
+	uchar *dgram, *buf;
+	ushort id = 0;
+
+	dgram = malloc(total);
+	if (!dgram)
+		return;
+	put_unaligned_be16(sport, dgram);
+	put_unaligned_be16(dport, dgram + 2);
+	put_unaligned_be16(total, dgram + 4);
+	put_unaligned_be16(0, dgram + 6);
+	memcpy(dgram + UDP_HDR_SIZE, data, len);
+
+	for (offset = 0; offset < total; offset += part) {
+		part = min(total - offset, SB_ETH_IP_MTU);
+		buf = sb_eth_queue_packet(priv, ETHER_HDR_SIZE + IP_HDR_SIZE +
+					  part);
+		if (!buf)
+			break;
+
+		eth_recv = (void *)buf;
+		memcpy(eth_recv->et_dest, dest_hwaddr, ARP_HLEN);
+		memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+		eth_recv->et_protlen = htons(PROT_IP);
+
+		ipr = (void *)buf + ETHER_HDR_SIZE;
+		net_set_ip_header((uchar *)ipr, dest_ip,
+				  priv->fake_host_ipaddr);
+		if (offset)
+			ipr->ip_id = id;
+		id = ipr->ip_id;
+		ipr->ip_len = htons(IP_HDR_SIZE + part);
+		if (total > SB_ETH_IP_MTU) {
+			ipr->ip_off = htons(offset / 8 |
+					    (offset + part < total ?
+					     IP_FLAGS_MFRAG : 0));
+		}
+		ipr->ip_p = IPPROTO_UDP;
+		ipr->ip_sum = compute_ip_checksum(ipr, IP_HDR_SIZE);
+		memcpy(buf + ETHER_HDR_SIZE + IP_HDR_SIZE, dgram + offset,
+		       part);
+	}
+	free(dgram);
+}
+
+/*
+ * sb_eth_tftp_reply()
+ *
+ * Queue a UDP packet from the fake TFTP server to U-Boot
+ *
+ * req - Ethernet frame holding the client's last request
+ * data - TFTP payload
+ * len - Length of the TFTP payload
+ */
+static void sb_eth_tftp_reply(struct eth_sandbox_priv *priv,
+			      struct ethernet_hdr *req, const void *data,
+			      int len)
+{
+	struct ip_udp_hdr *ip = (void *)req + ETHER_HDR_SIZE;
+
+	sb_eth_udp_reply(priv, req->et_src, net_read_ip(&ip->ip_src),
+			 SANDBOX_TFTP_SERVER_PORT, ntohs(ip->udp_src), data,
+			 len);
+}
+
+/*
+ * sb_eth_tftp_send_block()
+ *
+ * Send one data block of the served file, unless it is chosen to be lost
+ */
+static void sb_eth_tftp_send_block(struct eth_sandbox_priv *priv,
+				   struct ethernet_hdr *req, ulong block)
+{
+	struct sandbox_eth_tftp *tftp = &tftp_server;
+	uchar pkt[4 + SANDBOX_TFTP_MAX_BLKSIZE];
+	ulong offset = (block - 1) * tftp->blksize;
+	ulong len, i;
+
+	tftp->data_sent++;
+	if (tftp->drop_every && tftp->data_sent % tftp->drop_every == 0) {
+		tftp->data_dropped++;
+		return;
+	}
+
+	len = min(tftp->file_size - offset, (ulong)tftp->blksize);
+	put_unaligned_be16(3, pkt);
+	put_unaligned_be16(block & 0xffff, pkt + 2);
+	for (i = 0; i < len; i++)
+		pkt[4 + i] = sandbox_eth_tftp_byte(offset + i);
+	sb_eth_tftp_reply(priv, req, pkt, 4 + len);
+}
+
+/*
+ * sb_eth_tftp_send_window()
+ *
+ * Send the window of data blocks following the one the client last ACKed,
+ * sending every swap_every'th pair of blocks in reverse order.
+ */
+static void sb_eth_tftp_send_window(struct eth_sandbox_priv *priv,
+				    struct ethernet_hdr *req)
+{
+	struct sandbox_eth_tftp *tftp = &tftp_server;
+	ulong last = tftp->file_size / tftp->blksize + 1;
+	ulong end = min(tftp->acked + tftp->windowsize, last);
+	ulong block;
+
+	for (block = tftp->acked + 1; block <= end; block += 2) {
+		bool swap = tftp->swap_every && block < end &&
+			    tftp->pairs_sent++ % tftp->swap_every == 0;
+
+		if (swap)
+			sb_eth_tftp_send_block(priv, req, block + 1);
+		sb_eth_tftp_send_block(priv, req, block);
+		if (!swap && block < end)
+			sb_eth_tftp_send_block(priv, req, block + 1);
+	}
+}
+
+/*
+ * sb_eth_tftp_handle()
+ *
+ * Act as a TFTP server for the fake host. Read requests are answered
+ * with an OACK, then a window of data blocks is sent for each ACK.
+ */
+static void sb_eth_tftp_handle(struct eth_sandbox_priv *priv,
+			       struct ethernet_hdr *eth, int length)
+{
+	struct sandbox_eth_tftp *tftp = &tftp_server;
+	struct ip_udp_hdr *ip = (void *)eth + ETHER_HDR_SIZE;
+	uchar *pkt = (uchar *)ip + IP_UDP_HDR_SIZE;
+	int len = ntohs(ip->udp_len) - UDP_HDR_SIZE;
+	char oack[64], *p;
+	int op, i;
+
+	if (!tftp->file_size || len < 4)
+		return;
+	op = get_unaligned_be16(pkt);
+
+	if (op == 1 && ntohs(ip->udp_dst) == 69) {
+		/* RRQ: filename, mode, then option/value pairs */
+		tftp->active = true;
+		tftp->acked = 0;
+		tftp->blksize = 512;
+		tftp->windowsize = 1;
+		p = oack + 2;
+		put_unaligned_be16(6, oack);
+		for (i = 2; i < len; i += strlen((char *)pkt + i) + 1) {
+			char *opt = (char *)pkt + i;
+			char *val = opt + strlen(opt) + 1;
+
+			if (!strcmp(opt, "blksize")) {
+				tftp->blksize = min(simple_strtoul(val, NULL,
+						10), (ulong)SANDBOX_TFTP_MAX_BLKSIZE);
+				p += sprintf(p, "blksize%c%u%c", 0,
+					     tftp->blksize, 0);
+			} else if (!strcmp(opt, "windowsize") &&
+				   tftp->max_windowsize) {
+				tftp->windowsize = min(simple_strtoul(val, NULL,
+						10), (ulong)tftp->max_windowsize);
+				p += sprintf(p, "windowsize%c%u%c", 0,
+					     tftp->windowsize, 0);
+			}
+		}
+		sb_eth_tftp_reply(priv, eth, oack, p - oack);
+	} else if (op == 4 && tftp->active &&
+		   ntohs(ip->udp_dst) == SANDBOX_TFTP_SERVER_PORT) {
+		/* ACK: work out the full block number from the 16-bit one */
+		ushort block = get_unaligned_be16(pkt + 2);
+
+		tftp->acks++;
+		tftp->acked += (short)(block - (ushort)tftp->acked);
+		if (tftp->acked == tftp->file_size / tftp->blksize + 1)
+			tftp->active = false;
+		else
+			sb_eth_tftp_send_window(priv, eth);
+	}
+}
+
+/*
+ * sb_eth_rpc_reply()
+ *
+ * Queue an accepted RPC reply from the fake NFS server to U-Boot
+ *
+ * sport - UDP port the call was sent to
+ * xid - ID of the call, in network order
+ * stat - Accept status
+ * res - Results, as 32-bit words in network order
+ * words - Number of words of results
+ */
+static void sb_eth_rpc_reply(struct eth_sandbox_priv *priv, int sport,
+			     u32 xid, u32 stat, const u32 *res, int words)
+{
+	struct sandbox_eth_nfs *nfs = &nfs_server;
+	u32 *pkt;
+
+	pkt = malloc((6 + words) * sizeof(u32));
+	if (!pkt)
+		return;
+	pkt[0] = xid;
+	pkt[1] = htonl(1);	/* reply */
+	pkt[2] = 0;		/* accepted */
+	pkt[3] = 0;		/* AUTH_NONE verifier */
+	pkt[4] = 0;
+	pkt[5] = htonl(stat);
+	memcpy(pkt + 6, res, words * sizeof(u32));
+	sb_eth_udp_reply(priv, nfs->client_hwaddr, nfs->client_ip, sport,
+			 nfs->client_port, pkt, (6 + words) * sizeof(u32));
+	free(pkt);
+}
+
+/*
+ * sb_eth_nfs_read_reply()
+ *
+ * Send the reply to a READ call, with the NFSv2 or NFSv3 layout
+ */
+static void sb_eth_nfs_read_reply(struct eth_sandbox_priv *priv, int i)
+{
+	struct sandbox_eth_nfs *nfs = &nfs_server;
+	ulong offset = nfs->read[i].offset;
+	ulong count = 0;
+	int words, n;
+	u32 *res;
+	u8 *data;
+
+	if (offset < nfs->file_size)
+		count = min((ulong)nfs->read[i].count, nfs->file_size - offset);
+	if (nfs->max_read)
+		count = min(count, (ulong)nfs->max_read);
+	res = calloc(26 + DIV_ROUND_UP(count, 4), sizeof(u32));
+	if (!res)
+		return;
+
+	if (nfs->read[i].version == 2) {
+		/* status, fattr, data */
+		res[6] = htonl(nfs->file_size);
+		res[18] = htonl(count);
+		words = 19;
+	} else {
+		/* status, post_op_attr, count, eof, data */
+		res[1] = htonl(1);
+		res[8] = htonl(nfs->file_size);
+		res[23] = htonl(count);
+		res[24] = htonl(offset + count >= nfs->file_size);
+		res[25] = htonl(count);
+		words = 26;
+	}
+	data = (u8 *)(res + words);
+	for (n = 0; n < count; n++)
+		data[n] = sandbox_eth_tftp_byte(offset + n);
+	sb_eth_rpc_reply(priv, SANDBOX_NFS_SERVER_PORT, nfs->read[i].xid, 0,
+			 res, words + DIV_ROUND_UP(count, 4));
+	free(res);
+}
+
+/*
+ * sb_eth_nfs_flush()
+ *
+ * Answer the READ calls received since the last batch, which completes a
+ * round trip
+ */
+static void sb_eth_nfs_flush(struct eth_sandbox_priv *priv)
+{
+	struct sandbox_eth_nfs *nfs = &nfs_server;
+	int i;
+
+	nfs->round_trips++;
+	nfs->max_in_flight = max(nfs->max_in_flight, (uint)nfs->pending);
+	for (i = 0; i < nfs->pending; i++) {
+		if (nfs->drop_every && ++nfs->replies % nfs->drop_every == 0)
+			continue;
+		sb_eth_nfs_read_reply(priv, nfs->reverse ?
+				      nfs->pending - 1 - i : i);
+	}
+	nfs->pending = 0;
+}
+
+/*
+ * sb_eth_nfs_handle()
+ *
+ * Act as the portmapper, mount daemon and NFS server of the fake host, for
+ * the calls needed to read a file. READ calls are answered later, by
+ * sb_eth_nfs_flush().
+ */
+static void sb_eth_nfs_handle(struct eth_sandbox_priv *priv,
+			      struct ethernet_hdr *eth, int length)
+{
+	struct sandbox_eth_nfs *nfs = &nfs_server;
+	struct ip_udp_hdr *ip = (void *)eth + ETHER_HDR_SIZE;
+	u32 *call = (void *)ip + IP_UDP_HDR_SIZE;
+	int words = (ntohs(ip->udp_len) - UDP_HDR_SIZE) / sizeof(u32);
+	int dport = ntohs(ip->udp_dst);
+	uint prog, vers, proc;
+	u32 res[26], *args;
+	int pos;
+
+	/* The portmapper is on port 111, the rest share one port */
+	if (!nfs->file_size || words < 10 ||
+	    (dport != 111 && dport != SANDBOX_NFS_SERVER_PORT))
+		return;
+	prog = ntohl(call[3]);
+	vers = ntohl(call[4]);
+	proc = ntohl(call[5]);
+
+	/* Skip the credentials and verifier */
+	pos = 8 + DIV_ROUND_UP(ntohl(call[7]), sizeof(u32));
+	if (pos + 2 > words)
+		return;
+	pos += 2 + DIV_ROUND_UP(ntohl(call[pos + 1]), sizeof(u32));
+	args = call + pos;
+	words -= pos;
+
+	memcpy(nfs->client_hwaddr, eth->et_src, ARP_HLEN);
+	nfs->client_ip = net_read_ip(&ip->ip_src);
+	nfs->client_port = ntohs(ip->udp_src);
+	memset(res, '\0', sizeof(res));
+
+	switch (prog) {
+	case 100000:	/* portmapper: GETPORT */
+		nfs->active = true;
+		res[0] = htonl(SANDBOX_NFS_SERVER_PORT);
+		sb_eth_rpc_reply(priv, dport, call[0], 0, res, 1);
+		break;
+	case 100005:	/* mount: MNT gives a status and handle */
+		if (proc == 4)
+			nfs->active = false;
+		sb_eth_rpc_reply(priv, dport, call[0], 0, res,
+				 proc == 1 ? 1 + 8 : 0);
+		break;
+	case 100003:
+		if (vers < max(nfs->min_version, 2U)) {
+			/* PROG_MISMATCH, giving the versions supported */
+			res[0] = htonl(3);
+			res[1] = htonl(3);
+			sb_eth_rpc_reply(priv, dport, call[0], 2, res, 2);
+		} else if (proc == 6) {
+			/* READ: skip the file handle */
+			pos = vers == 2 ? 8 : 2 + DIV_ROUND_UP(ntohl(args[0]),
+							       sizeof(u32));
+			if (pos + 2 > words ||
+			    nfs->pending == SANDBOX_NFS_MAX_PENDING)
+				return;
+			nfs->reads++;
+			nfs->read[nfs->pending].xid = call[0];
+			nfs->read[nfs->pending].version = vers;
+			nfs->read[nfs->pending].offset = ntohl(args[pos]);
+			nfs->read[nfs->pending].count = ntohl(args[pos + 1]);
+			nfs->pending++;
+		} else if (vers == 2 && proc == 4) {
+			/* LOOKUP: status, handle, fattr */
+			sb_eth_rpc_reply(priv, dport, call[0], 0, res, 26);
+		} else if (vers == 3 && proc == 3) {
+			/* LOOKUP: status, handle, two post_op_attrs */
+			res[1] = htonl(32);
+			sb_eth_rpc_reply(priv, dport, call[0], 0, res, 12);
+		}
+		break;
+	}
+}
+
 static int sb_eth_start(struct udevice *dev)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -62,7 +488,8 @@ static int sb_eth_start(struct udevice *dev)
 
 	fdtdec_get_byte_array(gd->fdt_blob, dev->of_offset, "fake-host-hwaddr",
 			      priv->fake_host_hwaddr, ARP_HLEN);
-	priv->recv_packet_buffer = net_rx_packets[0];
+	priv->recv_head = 0;
+	priv->recv_count = 0;
 	return 0;
 }
 
@@ -79,22 +506,26 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 
 	if (ntohs(eth->et_protlen) == PROT_ARP) {
 		struct arp_hdr *arp = packet + ETHER_HDR_SIZE;
+		uchar *buf;
 
 		if (ntohs(arp->ar_op) == ARPOP_REQUEST) {
 			struct ethernet_hdr *eth_recv;
 			struct arp_hdr *arp_recv;
 
+			buf = sb_eth_queue_packet(priv, ETHER_HDR_SIZE +
+						  ARP_HDR_SIZE);
+			if (!buf)
+				return 0;
 			/* store this as the assumed IP of the fake host */
 			priv->fake_host_ipaddr = net_read_ip(&arp->ar_tpa);
 			/* Formulate a fake response */
-			eth_recv = (void *)priv->recv_packet_buffer;
+			eth_recv = (void *)buf;
 			memcpy(eth_recv->et_dest, eth->et_src, ARP_HLEN);
 			memcpy(eth_recv->et_src, priv->fake_host_hwaddr,
 			       ARP_HLEN);
 			eth_recv->et_protlen = htons(PROT_ARP);
 
-			arp_recv = (void *)priv->recv_packet_buffer +
-				ETHER_HDR_SIZE;
+			arp_recv = (void *)buf + ETHER_HDR_SIZE;
 			arp_recv->ar_hrd = htons(ARP_ETHER);
 			arp_recv->ar_pro = htons(PROT_IP);
 			arp_recv->ar_hln = ARP_HLEN;
@@ -105,9 +536,6 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 			net_write_ip(&arp_recv->ar_spa, priv->fake_host_ipaddr);
 			memcpy(&arp_recv->ar_tha, &arp->ar_sha, ARP_HLEN);
 			net_copy_ip(&arp_recv->ar_tpa, &arp->ar_spa);
-
-			priv->recv_packet_length = ETHER_HDR_SIZE +
-				ARP_HDR_SIZE;
 		}
 	} else if (ntohs(eth->et_protlen) == PROT_IP) {
 		struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
@@ -119,13 +547,15 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 				struct ethernet_hdr *eth_recv;
 				struct ip_udp_hdr *ipr;
 				struct icmp_hdr *icmpr;
+				uchar *buf;
 
+				buf = sb_eth_queue_packet(priv, length);
+				if (!buf)
+					return 0;
 				/* reply to the ping */
-				memcpy(priv->recv_packet_buffer, packet,
-				       length);
-				eth_recv = (void *)priv->recv_packet_buffer;
-				ipr = (void *)priv->recv_packet_buffer +
-					ETHER_HDR_SIZE;
+				memcpy(buf, packet, length);
+				eth_recv = (void *)buf;
+				ipr = (void *)buf + ETHER_HDR_SIZE;
 				icmpr = (struct icmp_hdr *)&ipr->udp_src;
 				memcpy(eth_recv->et_dest, eth->et_src,
 				       ARP_HLEN);
@@ -143,9 +573,10 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 				icmpr->checksum = 0;
 				icmpr->checksum = compute_ip_checksum(icmpr,
 					ICMP_HDR_SIZE);
-
-				priv->recv_packet_length = length;
 			}
+		} else if (ip->ip_p == IPPROTO_UDP) {
+			sb_eth_tftp_handle(priv, eth, length);
+			sb_eth_nfs_handle(priv, eth, length);
 		}
 	}
 
@@ -161,15 +592,50 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		skip_timeout = false;
 	}
 
-	if (priv->recv_packet_length) {
-		int lcl_recv_packet_length = priv->recv_packet_length;
+	/* The client is waiting, so the NFS READ replies arrive now */
+	if (!priv->recv_count && nfs_server.pending)
+		sb_eth_nfs_flush(priv);
+
+	if (priv->recv_count) {
+		int lcl_recv_packet_length =
+			priv->recv_packet_length[priv->recv_head];
+		uchar *buf;
+		int size;
 
 		debug("eth_sandbox: received packet %d\n",
-		      priv->recv_packet_length);
-		priv->recv_packet_length = 0;
-		*packetp = priv->recv_packet_buffer;
+		      lcl_recv_packet_length);
+		*packetp = priv->recv_packet_buffer[priv->recv_head];
+
+		/* Like DMA into a buffer the stack chose, when there is one */
+		buf = eth_rx_direct_buf(&size);
+		if (buf && lcl_recv_packet_length <= size) {
+			memcpy(buf, *packetp, lcl_recv_packet_length);
+			*packetp = buf;
+		}
 		return lcl_recv_packet_length;
 	}
+
+	/*
+	 * The TFTP and NFS servers only send in reply to us, so with nothing
+	 * queued the client is waiting for a lost packet: move on to its
+	 * timeout.
+	 */
+	if (tftp_server.active || nfs_server.active)
+		sandbox_timer_add_offset(1000UL);
+
+	return 0;
+}
+
+static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	/* The buffer can now be reused for another packet */
+	if (length > 0 && priv->recv_count) {
+		priv->recv_head = (priv->recv_head + 1) % SB_ETH_RECV_QUEUE;
+		priv->recv_count--;
+	}
+
 	return 0;
 }
 
@@ -191,6 +657,7 @@ static const struct eth_ops sb_eth_ops = {
 	.start			= sb_eth_start,
 	.send			= sb_eth_send,
 	.recv			= sb_eth_recv,
+	.free_pkt		= sb_eth_free_pkt,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
 };
@@ -25,6 +25,18 @@ u64 notrace timer_early_get_count(void)
 	return os_get_nsec() / 1000 + sandbox_timer_offset * 1000;
 }
 
+/* Microsecond times for bootstage, starting from the first call */
+ulong notrace timer_get_boot_us(void)
+{
+	static u64 base;
+	u64 now = timer_early_get_count();
+
+	if (!base)
+		base = now;
+
+	return now - base;
+}
+
 unsigned long notrace timer_early_get_rate(void)
 {
 	return SANDBOX_TIMER_RATE;
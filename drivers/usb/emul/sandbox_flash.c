@@ -10,6 +10,7 @@
 #include <os.h>
 #include <scsi.h>
 #include <usb.h>
+#include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -52,6 +53,12 @@ enum {
  * @status_buff:	Data buffer for outgoing status
  * @buff_used:	Number of bytes ready to transfer back to host
  * @buff:	Data buffer for outgoing data
+ * @stalled:	true if the bulk-in endpoint is halted
+ * @sense_key:	Sense key for the next REQUEST SENSE
+ * @asc:	Additional sense code for the next REQUEST SENSE
+ * @max_xfer:	Most blocks allowed in a READ(10) command, or 0 for no limit
+ * @bad_lba:	Block which cannot be read, or -1 for none
+ * @read_count:	Number of READ(10) commands received
  */
 struct sandbox_flash_priv {
 	bool error;
@@ -65,6 +72,12 @@ struct sandbox_flash_priv {
 	struct umass_bbb_csw status;
 	int buff_used;
 	u8 buff[512];
+	bool stalled;
+	u8 sense_key;
+	u8 asc;
+	uint max_xfer;
+	long bad_lba;
+	int read_count;
 };
 
 struct sandbox_flash_plat {
@@ -188,6 +201,15 @@ static int sandbox_flash_control(struct udevice *dev, struct usb_device *udev,
 			debug("request=%x\n", setup->request);
 			break;
 		}
+	} else if (pipe == usb_sndctrlpipe(udev, 0)) {
+		switch (setup->request) {
+		case USB_REQ_CLEAR_FEATURE:
+			priv->stalled = false;
+			return 0;
+		default:
+			debug("request=%x\n", setup->request);
+			break;
+		}
 	}
 	debug("pipe=%lx\n", pipe);
 
@@ -230,7 +252,19 @@ static void handle_read(struct sandbox_flash_priv *priv, ulong lba,
 			ulong transfer_len)
 {
 	debug("%s: lba=%lx, transfer_len=%lx\n", __func__, lba, transfer_len);
-	if (priv->fd != -1) {
+	if (priv->max_xfer && transfer_len > priv->max_xfer) {
+		/* Give up part way through and stall the data stage */
+		setup_fail_response(priv);
+		priv->sense_key = SENSE_ABORTED_COMMAND;
+		priv->asc = 0;
+		priv->stalled = true;
+	} else if (priv->bad_lba >= 0 && priv->bad_lba >= lba &&
+		   priv->bad_lba < lba + transfer_len) {
+		setup_fail_response(priv);
+		priv->sense_key = SENSE_MEDIUM_ERROR;
+		priv->asc = 0x11;	/* Unrecovered read error */
+		priv->stalled = true;
+	} else if (priv->fd != -1) {
 		os_lseek(priv->fd, lba * SANDBOX_FLASH_BLOCK_LEN, OS_SEEK_SET);
 		priv->read_len = transfer_len;
 		setup_response(priv, priv->buff,
@@ -267,6 +301,20 @@ static int handle_ufi_command(struct sandbox_flash_plat *plat,
 	case SCSI_TST_U_RDY:
 		setup_response(priv, NULL, 0);
 		break;
+	case SCSI_REQ_SENSE: {
+		u8 *resp = priv->buff;
+
+		priv->alloc_len = req->cmd[4];
+		memset(resp, '\0', 18);
+		resp[0] = 0x70;		/* Current errors, fixed format */
+		resp[2] = priv->sense_key;
+		resp[7] = 10;		/* Additional sense length */
+		resp[12] = priv->asc;
+		priv->sense_key = 0;
+		priv->asc = 0;
+		setup_response(priv, resp, 18);
+		break;
+	}
 	case SCSI_RD_CAPAC: {
 		struct scsi_read_capacity_resp *resp = (void *)priv->buff;
 		uint blocks;
@@ -283,6 +331,7 @@ static int handle_ufi_command(struct sandbox_flash_plat *plat,
 	case SCSI_READ10: {
 		struct scsi_read10_req *req = (void *)buff;
 
+		priv->read_count++;
 		handle_read(priv, be32_to_cpu(req->lba),
 			    be16_to_cpu(req->transfer_len));
 		break;
@@ -292,7 +341,10 @@ static int handle_ufi_command(struct sandbox_flash_plat *plat,
 		return -EPROTONOSUPPORT;
 	}
 
-	priv->phase = priv->transfer_len ? PHASE_DATA : PHASE_STATUS;
+	if (priv->transfer_len && !priv->stalled)
+		priv->phase = PHASE_DATA;
+	else
+		priv->phase = PHASE_STATUS;
 	return 0;
 }
 
@@ -306,6 +358,8 @@ static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 
 	debug("%s: dev=%s, pipe=%lx, ep=%x, len=%x, phase=%d\n", __func__,
 	      dev->name, pipe, ep, len, priv->phase);
+	if (ep == SANDBOX_FLASH_EP_IN && priv->stalled)
+		return -EPIPE;
 	switch (ep) {
 	case SANDBOX_FLASH_EP_OUT:
 		switch (priv->phase) {
@@ -368,6 +422,27 @@ err:
 	return 0;
 }
 
+void sandbox_flash_set_max_xfer(struct udevice *dev, uint blocks)
+{
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+
+	priv->max_xfer = blocks;
+}
+
+void sandbox_flash_set_bad_block(struct udevice *dev, long lba)
+{
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+
+	priv->bad_lba = lba;
+}
+
+int sandbox_flash_read_count(struct udevice *dev)
+{
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+
+	return priv->read_count;
+}
+
 static int sandbox_flash_ofdata_to_platdata(struct udevice *dev)
 {
 	struct sandbox_flash_plat *plat = dev_get_platdata(dev);
@@ -401,6 +476,7 @@ static int sandbox_flash_probe(struct udevice *dev)
 	struct sandbox_flash_plat *plat = dev_get_platdata(dev);
 	struct sandbox_flash_priv *priv = dev_get_priv(dev);
 
+	priv->bad_lba = -1;
 	priv->fd = os_open(plat->pathname, OS_O_RDONLY);
 	if (priv->fd != -1)
 		return os_get_filesize(plat->pathname, &priv->file_size);
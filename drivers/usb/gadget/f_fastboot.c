@@ -62,6 +62,22 @@ static struct f_fastboot *fastboot_func;
 static unsigned int download_size;
 static unsigned int download_bytes;
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+/*
+ * Largest download accepted once "oem stream" is used, since it no longer
+ * has to fit in the buffer
+ */
+#define FASTBOOT_STREAM_MAX_SIZE	0x7ffff000
+
+/* Partition which the next download is written to, set by "oem stream" */
+static char stream_part[32 + 1];
+static bool stream_armed;
+/* true while a download is being written to stream_part */
+static bool stream_active;
+/* Result of writing the last download to stream_part, if it was */
+static char stream_response[FASTBOOT_RESPONSE_LEN];
+#endif
+
 static struct usb_endpoint_descriptor fs_ep_in = {
 	.bLength            = USB_DT_ENDPOINT_SIZE,
 	.bDescriptorType    = USB_DT_ENDPOINT,
@@ -165,6 +181,45 @@ void fastboot_okay(const char *reason)
 	strncat(fb_response_str, reason, FASTBOOT_RESPONSE_LEN - 4 - 1);
 }
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+static int fb_stream_start(void)
+{
+	fb_response_str = stream_response;
+	fastboot_fail("no flash device defined");
+#if defined(CONFIG_FASTBOOT_FLASH_MMC_DEV)
+	return fb_mmc_flash_stream_start(stream_part);
+#elif defined(CONFIG_FASTBOOT_FLASH_NAND_DEV)
+	return fb_nand_flash_stream_start(stream_part);
+#else
+	return -ENODEV;
+#endif
+}
+
+static int fb_stream_write(const void *data, unsigned int len)
+{
+	fb_response_str = stream_response;
+#if defined(CONFIG_FASTBOOT_FLASH_MMC_DEV)
+	return fb_mmc_flash_stream_write(data, len);
+#elif defined(CONFIG_FASTBOOT_FLASH_NAND_DEV)
+	return fb_nand_flash_stream_write(data, len);
+#else
+	return -ENODEV;
+#endif
+}
+
+static int fb_stream_end(void)
+{
+	fb_response_str = stream_response;
+#if defined(CONFIG_FASTBOOT_FLASH_MMC_DEV)
+	return fb_mmc_flash_stream_end();
+#elif defined(CONFIG_FASTBOOT_FLASH_NAND_DEV)
+	return fb_nand_flash_stream_end();
+#else
+	return -ENODEV;
+#endif
+}
+#endif
+
 static void fastboot_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	int status = req->status;
@@ -422,8 +477,13 @@ static void cb_getvar(struct usb_ep *ep, struct usb_request *req)
 	} else if (!strcmp_l1("downloadsize", cmd) ||
 		!strcmp_l1("max-download-size", cmd)) {
 		char str_num[12];
+		unsigned int max_size = CONFIG_FASTBOOT_BUF_SIZE;
 
-		sprintf(str_num, "0x%08x", CONFIG_FASTBOOT_BUF_SIZE);
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+		if (stream_armed)
+			max_size = FASTBOOT_STREAM_MAX_SIZE;
+#endif
+		sprintf(str_num, "0x%08x", max_size);
 		strncat(response, str_num, chars_left);
 	} else if (!strcmp_l1("serialno", cmd)) {
 		s = getenv("serial#");
@@ -487,6 +547,12 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 	if (buffer_size < transfer_size)
 		transfer_size = buffer_size;
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	/* After an error the rest is still received, but not written */
+	if (stream_active)
+		fb_stream_write(buffer, transfer_size);
+	else
+#endif
 	memcpy((void *)CONFIG_FASTBOOT_BUF_ADDR + download_bytes,
 	       buffer, transfer_size);
 
@@ -511,6 +577,14 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 		req->length = EP_BUFFER_SIZE;
 
 		strcpy(response, "OKAY");
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+		if (stream_active) {
+			putc('\n');
+			fb_stream_end();
+			stream_active = false;
+			strcpy(response, stream_response);
+		}
+#endif
 		fastboot_tx_write_str(response);
 
 		printf("\ndownloading of %d bytes finished\n", download_bytes);
@@ -526,6 +600,7 @@ static void cb_download(struct usb_ep *ep, struct usb_request *req)
 {
 	char *cmd = req->buf;
 	char response[FASTBOOT_RESPONSE_LEN];
+	unsigned int max_size = CONFIG_FASTBOOT_BUF_SIZE;
 
 	strsep(&cmd, ":");
 	download_size = simple_strtoul(cmd, NULL, 16);
@@ -533,12 +608,27 @@ static void cb_download(struct usb_ep *ep, struct usb_request *req)
 
 	printf("Starting download of %d bytes\n", download_size);
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	stream_response[0] = '\0';
+	if (stream_armed)
+		max_size = FASTBOOT_STREAM_MAX_SIZE;
+#endif
 	if (0 == download_size) {
 		strcpy(response, "FAILdata invalid size");
-	} else if (download_size > CONFIG_FASTBOOT_BUF_SIZE) {
+	} else if (download_size > max_size) {
 		download_size = 0;
 		strcpy(response, "FAILdata too large");
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	} else if (stream_armed && fb_stream_start()) {
+		download_size = 0;
+		stream_armed = false;
+		strcpy(response, stream_response);
+#endif
 	} else {
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+		stream_active = stream_armed;
+		stream_armed = false;
+#endif
 		sprintf(response, "DATA%08x", download_size);
 		req->complete = rx_handler_dl_image;
 		req->length = rx_bytes_expected(ep);
@@ -590,6 +680,19 @@ static void cb_flash(struct usb_ep *ep, struct usb_request *req)
 		return;
 	}
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	/* The download has already been written, so report how that went */
+	if (stream_response[0]) {
+		if (strcmp(cmd, stream_part))
+			fastboot_tx_write_str(
+				"FAILdownload written to another partition");
+		else
+			fastboot_tx_write_str(stream_response);
+		stream_response[0] = '\0';
+		return;
+	}
+#endif
+
 	/* initialize the response buffer */
 	fb_response_str = response;
 
@@ -620,6 +723,21 @@ static void cb_oem(struct usb_ep *ep, struct usb_request *req)
                 else
 			fastboot_tx_write_str("OKAY");
 	} else
+#endif
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	if (strncmp("stream", cmd + 4, 6) == 0) {
+		/* "oem stream <partition>", or just "oem stream" to stop */
+		cmd += 10;
+		while (*cmd == ' ')
+			cmd++;
+		if (strlen(cmd) >= sizeof(stream_part)) {
+			fastboot_tx_write_str("FAILpartition name too long");
+		} else {
+			strcpy(stream_part, cmd);
+			stream_armed = stream_part[0] != '\0';
+			fastboot_tx_write_str("OKAY");
+		}
+	} else
 #endif
 	if (strncmp("unlock", cmd + 4, 8) == 0) {
 		fastboot_tx_write_str("FAILnot implemented");
@@ -296,14 +296,25 @@ static void ehci_update_endpt2_dev_n_port(struct usb_device *udev,
 				     QH_ENDPT2_HUBADDR(hubaddr));
 }
 
+/*
+ * Submit a transfer made up of @count segments, each of which starts a new
+ * series of qTDs. With more than one segment, a short packet moves the
+ * controller on to the next segment rather than stopping the transfer, and
+ * the data toggle is kept in the QH since it cannot be known in advance.
+ */
 static int
-ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
-		   int length, struct devrequest *req)
+ehci_submit_async_chain(struct usb_device *dev, unsigned long pipe,
+			struct usb_bulk_seg *seg, int count,
+			struct devrequest *req)
 {
 	ALLOC_ALIGN_BUFFER(struct QH, qh, 1, USB_DMA_MINALIGN);
 	struct qTD *qtd;
 	int qtd_count = 0;
 	int qtd_counter = 0;
+	int seg_first[USB_MAX_BULK_SEGS + 1];
+	void *buffer = seg[0].buffer;
+	int length = seg[0].length;
+	int i, j;
 	volatile struct qTD *vtd;
 	unsigned long ts;
 	uint32_t *tdp;
@@ -312,10 +323,13 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 	uint32_t cmd;
 	int timeout;
 	int ret = 0;
+	bool halted = false;
 	struct ehci_ctrl *ctrl = ehci_get_ctrl(dev);
 
-	debug("dev=%p, pipe=%lx, buffer=%p, length=%d, req=%p\n", dev, pipe,
-	      buffer, length, req);
+	debug("dev=%p, pipe=%lx, buffer=%p, length=%d, count=%d, req=%p\n",
+	      dev, pipe, buffer, length, count, req);
+	if (count < 1 || count > USB_MAX_BULK_SEGS || (req && count != 1))
+		return -1;
 	if (req != NULL)
 		debug("req=%u (%#x), type=%u (%#x), value=%u (%#x), index=%u\n",
 		      req->request, req->request,
@@ -342,7 +356,13 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 	if (req != NULL)
 		/* 1 qTD will be needed for SETUP, and 1 for ACK. */
 		qtd_count += 1 + 1;
-	if (length > 0 || req == NULL) {
+	for (i = 0; i < count; i++) {
+		int xfr_sz;
+
+		buffer = seg[i].buffer;
+		length = seg[i].length;
+		if (length <= 0 && req != NULL)
+			continue;
 		/*
 		 * Determine the qTD transfer size that will be used for the
 		 * data payload (not considering the first qTD transfer, which
@@ -357,7 +377,7 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 		 * By default, i.e. if the input buffer is aligned to PKT_ALIGN,
 		 * QT_BUFFER_CNT full pages will be used.
 		 */
-		int xfr_sz = QT_BUFFER_CNT;
+		xfr_sz = QT_BUFFER_CNT;
 		/*
 		 * However, if the input buffer is not aligned to PKT_ALIGN, the
 		 * qTD transfer size will be one page shorter, and the first qTD
@@ -408,7 +428,8 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 	maxpacket = usb_maxpacket(dev, pipe);
 	endpt = QH_ENDPT1_RL(8) | QH_ENDPT1_C(c) |
 		QH_ENDPT1_MAXPKTLEN(maxpacket) | QH_ENDPT1_H(0) |
-		QH_ENDPT1_DTC(QH_ENDPT1_DTC_DT_FROM_QTD) |
+		QH_ENDPT1_DTC(count > 1 ? QH_ENDPT1_DTC_IGNORE_QTD_TD :
+			      QH_ENDPT1_DTC_DT_FROM_QTD) |
 		QH_ENDPT1_EPS(ehci_encode_speed(dev->speed)) |
 		QH_ENDPT1_ENDPT(usb_pipeendpoint(pipe)) | QH_ENDPT1_I(0) |
 		QH_ENDPT1_DEVADDR(usb_pipedevice(pipe));
@@ -418,6 +439,8 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 	ehci_update_endpt2_dev_n_port(dev, qh);
 	qh->qh_overlay.qt_next = cpu_to_hc32(QT_NEXT_TERMINATE);
 	qh->qh_overlay.qt_altnext = cpu_to_hc32(QT_NEXT_TERMINATE);
+	if (count > 1)
+		qh->qh_overlay.qt_token = cpu_to_hc32(QT_TOKEN_DT(toggle));
 
 	tdp = &qh->qh_overlay.qt_next;
 	if (req != NULL) {
@@ -447,10 +470,13 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 		toggle = 1;
 	}
 
-	if (length > 0 || req == NULL) {
-		uint8_t *buf_ptr = buffer;
-		int left_length = length;
+	for (i = 0; i < count; i++) {
+		uint8_t *buf_ptr = seg[i].buffer;
+		int left_length = seg[i].length;
 
+		seg_first[i] = qtd_counter;
+		if (left_length <= 0 && req != NULL)
+			continue;
 		do {
 			/*
 			 * Determine the size of this qTD transfer. By default,
@@ -514,6 +540,15 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 			left_length -= xfr_bytes;
 		} while (left_length > 0);
 	}
+	seg_first[count] = qtd_counter;
+
+	/* A short packet in one segment moves on to the next */
+	for (i = 0; i < count - 1; i++) {
+		uint32_t next = virt_to_phys(&qtd[seg_first[i + 1]]);
+
+		for (j = seg_first[i]; j < seg_first[i + 1]; j++)
+			qtd[j].qt_altnext = cpu_to_hc32(next);
+	}
 
 	if (req != NULL) {
 		/*
@@ -579,6 +614,12 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 		token = hc32_to_cpu(vtd->qt_token);
 		if (!(QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE))
 			break;
+		/* The rest of a chain is not run once the QH halts */
+		if (count > 1 && (hc32_to_cpu(qh->qh_overlay.qt_token) &
+				  QT_TOKEN_STATUS(QT_TOKEN_STATUS_HALTED))) {
+			halted = true;
+			break;
+		}
 		WATCHDOG_RESET();
 	} while (get_timer(ts) < timeout);
 
@@ -591,11 +632,20 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 	 * dangerous operation, it's responsibility of the calling
 	 * code to make sure enough space is reserved.
 	 */
-	invalidate_dcache_range((unsigned long)buffer,
-		ALIGN((unsigned long)buffer + length, ARCH_DMA_MINALIGN));
+	for (i = 0; i < count; i++) {
+		unsigned long start = (unsigned long)seg[i].buffer;
+		unsigned long end;
+
+		length = seg[i].length;
+		end = ALIGN(start + length, ARCH_DMA_MINALIGN);
+		invalidate_dcache_range(start, end);
+	}
 
-	/* Check that the TD processing happened */
-	if (QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE)
+	/*
+	 * Check that the TD processing happened. A halted chain leaves its last
+	 * TD active, but its status comes from the QH overlay below.
+	 */
+	if (!halted && (QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE))
 		printf("EHCI timed out on TD - token=%#x\n", token);
 
 	/* Disable async schedule. */
@@ -638,7 +688,23 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 				dev->status |= USB_ST_STALLED;
 			break;
 		}
-		dev->act_len = length - QT_TOKEN_GET_TOTALBYTES(token);
+		if (count == 1) {
+			dev->act_len = length - QT_TOKEN_GET_TOTALBYTES(token);
+			seg[0].act_len = dev->act_len;
+		} else {
+			/* qTDs which were skipped still hold their length */
+			dev->act_len = 0;
+			for (i = 0; i < count; i++) {
+				seg[i].act_len = seg[i].length;
+				for (j = seg_first[i]; j < seg_first[i + 1];
+				     j++) {
+					token = hc32_to_cpu(qtd[j].qt_token);
+					seg[i].act_len -=
+						QT_TOKEN_GET_TOTALBYTES(token);
+				}
+				dev->act_len += seg[i].act_len;
+			}
+		}
 	} else {
 		dev->act_len = 0;
 #ifndef CONFIG_USB_EHCI_FARADAY
@@ -657,6 +723,17 @@ fail:
 	return -1;
 }
 
+static int ehci_submit_async(struct usb_device *dev, unsigned long pipe,
+			     void *buffer, int length, struct devrequest *req)
+{
+	struct usb_bulk_seg seg = {
+		.buffer = buffer,
+		.length = length,
+	};
+
+	return ehci_submit_async_chain(dev, pipe, &seg, 1, req);
+}
+
 static int ehci_submit_root(struct usb_device *dev, unsigned long pipe,
 			    void *buffer, int length, struct devrequest *req)
 {
@@ -1145,6 +1222,16 @@ static int _ehci_submit_bulk_msg(struct usb_device *dev, unsigned long pipe,
 	return ehci_submit_async(dev, pipe, buffer, length, NULL);
 }
 
+static int _ehci_submit_bulk_chain(struct usb_device *dev, unsigned long pipe,
+				   struct usb_bulk_seg *seg, int count)
+{
+	if (usb_pipetype(pipe) != PIPE_BULK) {
+		debug("non-bulk pipe (type=%lu)", usb_pipetype(pipe));
+		return -1;
+	}
+	return ehci_submit_async_chain(dev, pipe, seg, count, NULL);
+}
+
 static int _ehci_submit_control_msg(struct usb_device *dev, unsigned long pipe,
 				    void *buffer, int length,
 				    struct devrequest *setup)
@@ -1512,6 +1599,12 @@ int submit_bulk_msg(struct usb_device *dev, unsigned long pipe,
 	return _ehci_submit_bulk_msg(dev, pipe, buffer, length);
 }
 
+int submit_bulk_chain(struct usb_device *dev, unsigned long pipe,
+		      struct usb_bulk_seg *seg, int count)
+{
+	return _ehci_submit_bulk_chain(dev, pipe, seg, count);
+}
+
 int submit_control_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 		   int length, struct devrequest *setup)
 {
@@ -1561,6 +1654,22 @@ static int ehci_submit_bulk_msg(struct udevice *dev, struct usb_device *udev,
 	return _ehci_submit_bulk_msg(udev, pipe, buffer, length);
 }
 
+static int ehci_submit_bulk_chain(struct udevice *dev, struct usb_device *udev,
+				  unsigned long pipe, struct usb_bulk_seg *seg,
+				  int count)
+{
+	debug("%s: dev='%s', udev=%p\n", __func__, dev->name, udev);
+	return _ehci_submit_bulk_chain(udev, pipe, seg, count);
+}
+
+/* The driver splits a transfer into as many qTDs as it needs */
+static int ehci_get_max_xfer_size(struct udevice *dev, size_t *size)
+{
+	*size = SIZE_MAX;
+
+	return 0;
+}
+
 static int ehci_submit_int_msg(struct udevice *dev, struct usb_device *udev,
 			       unsigned long pipe, void *buffer, int length,
 			       int interval)
@@ -1650,10 +1759,12 @@ int ehci_deregister(struct udevice *dev)
 struct dm_usb_ops ehci_usb_ops = {
 	.control = ehci_submit_control_msg,
 	.bulk = ehci_submit_bulk_msg,
+	.bulk_chain = ehci_submit_bulk_chain,
 	.interrupt = ehci_submit_int_msg,
 	.create_int_queue = ehci_create_int_queue,
 	.poll_int_queue = ehci_poll_int_queue,
 	.destroy_int_queue = ehci_destroy_int_queue,
+	.get_max_xfer_size = ehci_get_max_xfer_size,
 };
 
 #endif
@@ -77,7 +77,8 @@ static int sandbox_submit_bulk(struct udevice *bus, struct usb_device *udev,
 	ret = usb_emul_bulk(emul, udev, pipe, buffer, length);
 	if (ret < 0) {
 		debug("ret=%d\n", ret);
-		udev->status = ret;
+		/* The emulator reports a stalled endpoint with -EPIPE */
+		udev->status = ret == -EPIPE ? USB_ST_STALLED : ret;
 		udev->act_len = 0;
 	} else {
 		udev->status = 0;
@@ -110,6 +111,13 @@ static int sandbox_alloc_device(struct udevice *dev, struct usb_device *udev)
 	return 0;
 }
 
+static int sandbox_get_max_xfer_size(struct udevice *dev, size_t *size)
+{
+	*size = SIZE_MAX;
+
+	return 0;
+}
+
 static int sandbox_usb_probe(struct udevice *dev)
 {
 	return 0;
@@ -120,6 +128,7 @@ static const struct dm_usb_ops sandbox_usb_ops = {
 	.bulk		= sandbox_submit_bulk,
 	.interrupt	= sandbox_submit_int,
 	.alloc_device	= sandbox_alloc_device,
+	.get_max_xfer_size = sandbox_get_max_xfer_size,
 };
 
 static const struct udevice_id sandbox_usb_ids[] = {
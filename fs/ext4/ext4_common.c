@@ -20,6 +20,7 @@
  */
 
 #include <common.h>
+#include <arena.h>
 #include <ext_common.h>
 #include <ext4fs.h>
 #include <inttypes.h>
@@ -33,6 +34,8 @@
 
 struct ext2_data *ext4fs_root;
 struct ext2fs_node *ext4fs_file;
+/* Path ext4fs_file was opened with */
+static char *ext4fs_file_name;
 uint32_t *ext4fs_indir1_block;
 int ext4fs_indir1_size;
 int ext4fs_indir1_blkno = -1;
@@ -46,6 +49,25 @@ int ext4fs_indir3_blkno = -1;
 struct ext2_inode *g_parent_inode;
 static int symlinknest;
 
+/* An extent decoded from the extent tree of an inode */
+struct ext4_cached_extent {
+	uint32_t block;		/* First file block */
+	uint32_t len;		/* Number of blocks */
+	uint64_t start;		/* First physical block, 0 if unwritten */
+};
+
+/*
+ * The extents of the last extent tree leaf used, so reading a file block by
+ * block does not walk the tree from the inode for every block
+ */
+static struct {
+	__le32 root[sizeof(((struct ext2_inode *)0)->b) / sizeof(__le32)];
+	uint32_t first;		/* First file block covered by the leaf */
+	uint64_t end;		/* File block after the last one covered */
+	int count;		/* Number of extents, -1 if nothing is cached */
+	struct ext4_cached_extent *extents;
+} ext4fs_extent_cache = { .count = -1 };
+
 #if defined(CONFIG_EXT4_WRITE)
 uint32_t ext4fs_div_roundup(uint32_t size, uint32_t n)
 {
@@ -1406,16 +1428,23 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 
 #endif
 
+/*
+ * Find the extent tree leaf covering 'fileblock', and the range of file
+ * blocks from *first up to *end which the leaf covers.
+ */
 static struct ext4_extent_header *ext4fs_get_extent_block
 	(struct ext2_data *data, char *buf,
 		struct ext4_extent_header *ext_block,
-		uint32_t fileblock, int log2_blksz)
+		uint32_t fileblock, int log2_blksz,
+		uint32_t *first, uint64_t *end)
 {
 	struct ext4_extent_idx *index;
 	unsigned long long block;
 	int blksz = EXT2_BLOCK_SIZE(data);
 	int i;
 
+	*first = 0;
+	*end = 1ULL << 32;
 	while (1) {
 		index = (struct ext4_extent_idx *)(ext_block + 1);
 
@@ -1431,8 +1460,11 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 				break;
 		} while (fileblock >= le32_to_cpu(index[i].ei_block));
 
+		if (i < le16_to_cpu(ext_block->eh_entries))
+			*end = le32_to_cpu(index[i].ei_block);
 		if (--i < 0)
 			return 0;
+		*first = le32_to_cpu(index[i].ei_block);
 
 		block = le16_to_cpu(index[i].ei_leaf_hi);
 		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
@@ -1498,6 +1530,125 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 	return 1;
 }
 
+/* Decode the extent tree leaf covering 'fileblock' into the extent cache */
+static int ext4fs_cache_extents(struct ext2_inode *inode, int fileblock)
+{
+	int blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	int log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+			 get_fs()->dev_desc->log2blksz;
+	struct ext4_cached_extent *cached;
+	struct ext4_extent_header *ext_block;
+	struct ext4_extent *extent;
+	uint32_t first;
+	uint64_t end;
+	char *buf;
+	int i, count;
+
+	ext4fs_extent_cache.count = -1;
+	if (!ext4fs_extent_cache.extents) {
+		ext4fs_extent_cache.extents =
+			malloc(blksz / sizeof(struct ext4_extent) *
+			       sizeof(struct ext4_cached_extent));
+		if (!ext4fs_extent_cache.extents)
+			return -ENOMEM;
+	}
+
+	buf = zalloc(blksz);
+	if (!buf)
+		return -ENOMEM;
+	ext_block = ext4fs_get_extent_block(ext4fs_root, buf,
+					    (struct ext4_extent_header *)
+					    inode->b.blocks.dir_blocks,
+					    fileblock, log2_blksz,
+					    &first, &end);
+	if (!ext_block) {
+		printf("invalid extent block\n");
+		free(buf);
+		return -EINVAL;
+	}
+
+	count = le16_to_cpu(ext_block->eh_entries);
+	if (count > blksz / sizeof(struct ext4_extent)) {
+		printf("invalid extent block\n");
+		free(buf);
+		return -EINVAL;
+	}
+	extent = (struct ext4_extent *)(ext_block + 1);
+	cached = ext4fs_extent_cache.extents;
+	for (i = 0; i < count; i++, extent++, cached++) {
+		cached->block = le32_to_cpu(extent->ee_block);
+		cached->len = le16_to_cpu(extent->ee_len);
+		cached->start = le16_to_cpu(extent->ee_start_hi);
+		cached->start = (cached->start << 32) +
+				le32_to_cpu(extent->ee_start_lo);
+		/* Unwritten extents read back as zeroes */
+		if (cached->len > EXT_INIT_MAX_LEN) {
+			cached->len -= EXT_INIT_MAX_LEN;
+			cached->start = 0;
+		}
+	}
+	free(buf);
+
+	memcpy(ext4fs_extent_cache.root, &inode->b,
+	       sizeof(ext4fs_extent_cache.root));
+	ext4fs_extent_cache.first = first;
+	ext4fs_extent_cache.end = end;
+	ext4fs_extent_cache.count = count;
+
+	return 0;
+}
+
+/*
+ * Map 'fileblock' of an extent-based inode to a physical block, and set *run
+ * to the number of file blocks from 'fileblock' on which are contiguous on
+ * disk, or which are all holes if 0 is returned.
+ */
+static long int read_extent_block(struct ext2_inode *inode, int fileblock,
+				  int *run)
+{
+	struct ext4_cached_extent *extents;
+	uint64_t next;
+	int lo, hi, mid, ret;
+
+	if (ext4fs_extent_cache.count < 0 ||
+	    fileblock < ext4fs_extent_cache.first ||
+	    fileblock >= ext4fs_extent_cache.end ||
+	    memcmp(ext4fs_extent_cache.root, &inode->b,
+		   sizeof(ext4fs_extent_cache.root))) {
+		ret = ext4fs_cache_extents(inode, fileblock);
+		if (ret)
+			return ret;
+	}
+
+	/* Find the last extent starting at or before the block */
+	extents = ext4fs_extent_cache.extents;
+	lo = -1;
+	hi = ext4fs_extent_cache.count - 1;
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (extents[mid].block <= fileblock)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	if (lo >= 0 && fileblock - extents[lo].block < extents[lo].len) {
+		*run = extents[lo].block + extents[lo].len - fileblock;
+		if (!extents[lo].start)
+			return 0;
+		return extents[lo].start + fileblock - extents[lo].block;
+	}
+
+	/* A hole, up to the next extent */
+	if (lo + 1 < ext4fs_extent_cache.count)
+		next = extents[lo + 1].block;
+	else
+		next = ext4fs_extent_cache.end;
+	*run = min_t(uint64_t, next - fileblock, INT_MAX);
+
+	return 0;
+}
+
 long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 {
 	long int blknr;
@@ -1507,54 +1658,16 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 	long int rblock;
 	long int perblock_parent;
 	long int perblock_child;
-	unsigned long long start;
+
 	/* get the blocksize of the filesystem */
 	blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
 		- get_fs()->dev_desc->log2blksz;
 
 	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
-		char *buf = zalloc(blksz);
-		if (!buf)
-			return -ENOMEM;
-		struct ext4_extent_header *ext_block;
-		struct ext4_extent *extent;
-		int i = -1;
-		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, buf,
-						(struct ext4_extent_header *)
-						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
-		if (!ext_block) {
-			printf("invalid extent block\n");
-			free(buf);
-			return -EINVAL;
-		}
-
-		extent = (struct ext4_extent *)(ext_block + 1);
-
-		do {
-			i++;
-			if (i >= le16_to_cpu(ext_block->eh_entries))
-				break;
-		} while (fileblock >= le32_to_cpu(extent[i].ee_block));
-		if (--i >= 0) {
-			fileblock -= le32_to_cpu(extent[i].ee_block);
-			if (fileblock >= le16_to_cpu(extent[i].ee_len)) {
-				free(buf);
-				return 0;
-			}
+		int run;
 
-			start = le16_to_cpu(extent[i].ee_start_hi);
-			start = (start << 32) +
-					le32_to_cpu(extent[i].ee_start_lo);
-			free(buf);
-			return fileblock + start;
-		}
-
-		printf("Extent Error\n");
-		free(buf);
-		return -1;
+		return read_extent_block(inode, fileblock, &run);
 	}
 
 	/* Direct blocks. */
@@ -1842,6 +1955,15 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 	return blknr;
 }
 
+long int read_allocated_run(struct ext2_inode *inode, int fileblock, int *run)
+{
+	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL)
+		return read_extent_block(inode, fileblock, run);
+
+	*run = 1;
+	return read_allocated_block(inode, fileblock);
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -1874,6 +1996,11 @@ void ext4fs_reinit_global(void)
 		ext4fs_indir3_size = 0;
 		ext4fs_indir3_blkno = -1;
 	}
+	if (ext4fs_extent_cache.extents != NULL) {
+		free(ext4fs_extent_cache.extents);
+		ext4fs_extent_cache.extents = NULL;
+		ext4fs_extent_cache.count = -1;
+	}
 }
 void ext4fs_close(void)
 {
@@ -1881,6 +2008,8 @@ void ext4fs_close(void)
 		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
 		ext4fs_file = NULL;
 	}
+	free(ext4fs_file_name);
+	ext4fs_file_name = NULL;
 	if (ext4fs_root != NULL) {
 		free(ext4fs_root);
 		ext4fs_root = NULL;
@@ -1923,7 +2052,8 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 
 		if (dirent.namelen != 0) {
 			char filename[dirent.namelen + 1];
-			struct ext2fs_node *fdiro;
+			struct ext2fs_node entry;
+			struct ext2fs_node *fdiro = &entry;
 			int type = FILETYPE_UNKNOWN;
 
 			status = ext4fs_read_file(diro,
@@ -1934,10 +2064,8 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			if (status < 0)
 				return 0;
 
-			fdiro = zalloc(sizeof(struct ext2fs_node));
-			if (!fdiro)
-				return 0;
-
+			/* Only the node which is found needs to be kept */
+			memset(fdiro, '\0', sizeof(*fdiro));
 			fdiro->data = diro->data;
 			fdiro->ino = __le32_to_cpu(dirent.inode);
 
@@ -1957,10 +2085,8 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 							   __le32_to_cpu
 							   (dirent.inode),
 							   &fdiro->inode);
-				if (status == 0) {
-					free(fdiro);
+				if (status == 0)
 					return 0;
-				}
 				fdiro->inode_read = 1;
 
 				if ((__le16_to_cpu(fdiro->inode.mode) &
@@ -1983,8 +2109,11 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			if ((name != NULL) && (fnode != NULL)
 			    && (ftype != NULL)) {
 				if (strcmp(filename, name) == 0) {
+					*fnode = arena_alloc(sizeof(*fdiro));
+					if (!*fnode)
+						return 0;
+					**fnode = *fdiro;
 					*ftype = type;
-					*fnode = fdiro;
 					return 1;
 				}
 			} else {
@@ -1993,10 +2122,8 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 								 __le32_to_cpu(
 								 dirent.inode),
 								 &fdiro->inode);
-					if (status == 0) {
-						free(fdiro);
+					if (status == 0)
 						return 0;
-					}
 					fdiro->inode_read = 1;
 				}
 				switch (type) {
@@ -2017,7 +2144,6 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 				       __le32_to_cpu(fdiro->inode.size),
 					filename);
 			}
-			free(fdiro);
 		}
 		fpos += __le16_to_cpu(dirent.direntlen);
 	}
@@ -2036,9 +2162,11 @@ static char *ext4fs_read_symlink(struct ext2fs_node *node)
 		if (status == 0)
 			return 0;
 	}
-	symlink = zalloc(__le32_to_cpu(diro->inode.size) + 1);
+	symlink = arena_memalign(ARCH_DMA_MINALIGN,
+				 __le32_to_cpu(diro->inode.size) + 1);
 	if (!symlink)
 		return 0;
+	memset(symlink, '\0', __le32_to_cpu(diro->inode.size) + 1);
 
 	if (__le32_to_cpu(diro->inode.size) < sizeof(diro->inode.b.symlink)) {
 		strncpy(symlink, diro->inode.b.symlink,
@@ -2048,7 +2176,7 @@ static char *ext4fs_read_symlink(struct ext2fs_node *node)
 					   __le32_to_cpu(diro->inode.size),
 					   symlink, &actread);
 		if ((status < 0) || (actread == 0)) {
-			free(symlink);
+			arena_free(symlink);
 			return 0;
 		}
 	}
@@ -2135,7 +2263,7 @@ static int ext4fs_find_file1(const char *currpath,
 			status = ext4fs_find_file1(symlink, oldnode,
 						    &currnode, &type);
 
-			free(symlink);
+			arena_free(symlink);
 
 			if (status == 0) {
 				ext4fs_free_node(oldnode, currroot);
@@ -2188,7 +2316,19 @@ int ext4fs_open(const char *filename, loff_t *len)
 	if (ext4fs_root == NULL)
 		return -1;
 
-	ext4fs_file = NULL;
+	/* Reading a file in pieces opens it again for each one */
+	if (ext4fs_file != NULL && ext4fs_file_name != NULL &&
+	    !strcmp(filename, ext4fs_file_name)) {
+		*len = __le32_to_cpu(ext4fs_file->inode.size);
+		return 0;
+	}
+
+	if (ext4fs_file != NULL) {
+		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
+		ext4fs_file = NULL;
+	}
+	free(ext4fs_file_name);
+	ext4fs_file_name = NULL;
 	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
 				  FILETYPE_REG);
 	if (status == 0)
@@ -2202,6 +2342,7 @@ int ext4fs_open(const char *filename, loff_t *len)
 	}
 	*len = __le32_to_cpu(fdiro->inode.size);
 	ext4fs_file = fdiro;
+	ext4fs_file_name = strdup(filename);
 
 	return 0;
 fail:
@@ -22,6 +22,7 @@
  */
 
 #include <common.h>
+#include <arena.h>
 #include <ext_common.h>
 #include <ext4fs.h>
 #include "ext4_common.h"
@@ -38,24 +39,29 @@ struct ext_filesystem *get_fs(void)
 void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 {
 	if ((node != &ext4fs_root->diropen) && (node != currroot))
-		free(node);
+		arena_free(node);
 }
 
 /*
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
  * reads into one potentially more efficient larger sequential read action
+ *
+ * Blocks are mapped a run at a time, so each extent of an extent-based file
+ * costs a single lookup, and runs which are adjacent on disk are read in one
+ * go.
  */
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
+	int i, run;
 	lbaint_t blockcnt;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
 	int blocksize = (1 << (log2_fs_blocksize + log2blksz));
 	unsigned int filesize = __le32_to_cpu(node->inode.size);
+	lbaint_t firstblock;
 	lbaint_t previous_block_number = -1;
 	lbaint_t delayed_start = 0;
 	lbaint_t delayed_extent = 0;
@@ -65,43 +71,49 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 	short status;
 
 	/* Adjust len so it we can't read past the end of the file. */
-	if (len > filesize)
-		len = filesize;
+	if (pos >= filesize) {
+		*actread = 0;
+		return 0;
+	}
+	if (len > filesize - pos)
+		len = filesize - pos;
 
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
+	firstblock = lldiv(pos, blocksize);
 
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
+	for (i = firstblock; i < blockcnt; i += run) {
 		lbaint_t blknr;
-		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
+		int blockend;
 		int skipfirst = 0;
-		blknr = read_allocated_block(&(node->inode), i);
+
+		blknr = read_allocated_run(&(node->inode), i, &run);
 		if (blknr < 0)
 			return -1;
+		if (run > blockcnt - i)
+			run = blockcnt - i;
+		/* Keep the byte count of the run within an int */
+		run = min(run, INT_MAX >> (log2_fs_blocksize + log2blksz));
 
 		blknr = blknr << log2_fs_blocksize;
+		blockend = run * blocksize;
 
 		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
-
-			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
-		}
+		if (i + run == blockcnt)
+			blockend = (len + pos) - ((loff_t)blocksize * i);
 
 		/* First block. */
-		if (i == lldiv(pos, blocksize)) {
-			skipfirst = blockoff;
+		if (i == firstblock) {
+			skipfirst = pos - ((loff_t)blocksize * i);
 			blockend -= skipfirst;
 		}
 		if (blknr) {
 			int status;
 
 			if (previous_block_number != -1) {
-				if (delayed_next == blknr) {
+				if (delayed_next == blknr &&
+				    delayed_extent + blockend <= INT_MAX) {
 					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
+					delayed_next += run << log2_fs_blocksize;
 				} else {	/* spill */
 					status = ext4fs_devread(delayed_start,
 							delayed_skipfirst,
@@ -115,7 +127,7 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 					delayed_skipfirst = skipfirst;
 					delayed_buf = buf;
 					delayed_next = blknr +
-						(blockend >> log2blksz);
+						(run << log2_fs_blocksize);
 				}
 			} else {
 				previous_block_number = blknr;
@@ -124,7 +136,7 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 				delayed_skipfirst = skipfirst;
 				delayed_buf = buf;
 				delayed_next = blknr +
-					(blockend >> log2blksz);
+					(run << log2_fs_blocksize);
 			}
 		} else {
 			if (previous_block_number != -1) {
@@ -137,9 +149,9 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 					return -1;
 				previous_block_number = -1;
 			}
-			memset(buf, 0, blocksize - skipfirst);
+			memset(buf, 0, blockend);
 		}
-		buf += blocksize - skipfirst;
+		buf += blockend;
 	}
 	if (previous_block_number != -1) {
 		/* spill */
@@ -190,12 +202,12 @@ int ext4fs_size(const char *filename, loff_t *size)
 	return ext4fs_open(filename, size);
 }
 
-int ext4fs_read(char *buf, loff_t len, loff_t *actread)
+int ext4fs_read(char *buf, loff_t offset, loff_t len, loff_t *actread)
 {
 	if (ext4fs_root == NULL || ext4fs_file == NULL)
 		return 0;
 
-	return ext4fs_read_file(ext4fs_file, 0, len, buf, actread);
+	return ext4fs_read_file(ext4fs_file, offset, len, buf, actread);
 }
 
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
@@ -217,11 +229,6 @@ int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	loff_t file_len;
 	int ret;
 
-	if (offset != 0) {
-		printf("** Cannot support non-zero offset **\n");
-		return -1;
-	}
-
 	ret = ext4fs_open(filename, &file_len);
 	if (ret < 0) {
 		printf("** File not found %s **\n", filename);
@@ -231,7 +238,7 @@ int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	if (len == 0)
 		len = file_len;
 
-	return ext4fs_read(buf, len, len_read);
+	return ext4fs_read(buf, offset, len, len_read);
 }
 
 int ext4fs_uuid(char *uuid_str)
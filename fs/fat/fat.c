@@ -10,8 +10,10 @@
  */
 
 #include <common.h>
+#include <arena.h>
 #include <blk.h>
 #include <config.h>
+#include <div64.h>
 #include <exports.h>
 #include <fat.h>
 #include <asm/byteorder.h>
@@ -41,6 +43,62 @@ static void downcase(char *str)
 static struct blk_desc *cur_dev;
 static disk_partition_t cur_part_info;
 
+/* A run of clusters which are contiguous on disk */
+struct fat_extent {
+	__u32 index;	/* Position of the first cluster within the file */
+	__u32 start;	/* First cluster on disk */
+	__u32 count;	/* Number of clusters */
+};
+
+/* A window of FATCACHE_BLOCKS sectors of the FAT */
+struct fat_window {
+	__u32 num;		/* Window number within the FAT */
+	unsigned long stamp;	/* Time of last use, 0 if unused */
+	__u8 *buf;
+};
+
+/*
+ * Read cache for the current device: the recently used parts of the FAT, and
+ * the cluster runs of the last file read, so reading a file at an offset does
+ * not walk its cluster chain from the start again. The extents cover file
+ * clusters from extents[0].index onwards; once the array is full, the map
+ * slides along the file. The directory entry of the last file read is kept
+ * too, so reading it again does not search its directories again.
+ */
+static struct {
+	struct fat_window win[FATCACHE_WINDOWS];
+	unsigned long tick;
+	__u32 file_start;	/* First cluster of the mapped file, 0 if none */
+	bool chain_end;		/* The last extent ends the cluster chain */
+	int num_extents;
+	struct fat_extent extents[FATCACHE_EXTENTS];
+	char name[FATCACHE_NAMELEN];	/* Path of dent, "" if none */
+	dir_entry dent;
+} fatcache;
+
+/* Drop everything cached, e.g. because the device changed or was written */
+static void fat_cache_invalidate(void)
+{
+	int i;
+
+	for (i = 0; i < FATCACHE_WINDOWS; i++)
+		fatcache.win[i].stamp = 0;
+	fatcache.file_start = 0;
+	fatcache.num_extents = 0;
+	fatcache.name[0] = '\0';
+}
+
+static void fat_cache_free(void)
+{
+	int i;
+
+	fat_cache_invalidate();
+	for (i = 0; i < FATCACHE_WINDOWS; i++) {
+		free(fatcache.win[i].buf);
+		fatcache.win[i].buf = NULL;
+	}
+}
+
 #define DOS_BOOT_MAGIC_OFFSET	0x1fe
 #define DOS_FS_TYPE_OFFSET	0x36
 #define DOS_FS32_TYPE_OFFSET	0x52
@@ -64,6 +122,7 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, disk_partition_t *info)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, buffer, dev_desc->blksz);
 
+	fat_cache_free();
 	cur_dev = dev_desc;
 	cur_part_info = *info;
 
@@ -162,6 +221,51 @@ static void get_name(dir_entry *dirent, char *s_name)
 	downcase(s_name);
 }
 
+/*
+ * Get the window of the FAT holding sectors from num * FATCACHE_BLOCKS,
+ * reading it into the least-recently used window if it is not cached.
+ * Return NULL on failure.
+ */
+static __u8 *get_fatwindow(fsdata *mydata, __u32 num)
+{
+	struct fat_window *win = fatcache.win;
+	struct fat_window *lru = win;
+	__u32 getsize = FATCACHE_BLOCKS;
+	__u32 startblock = num * FATCACHE_BLOCKS;
+	int i;
+
+	for (i = 0; i < FATCACHE_WINDOWS; i++, win++) {
+		if (win->stamp && win->num == num) {
+			win->stamp = ++fatcache.tick;
+			return win->buf;
+		}
+		if (win->stamp < lru->stamp)
+			lru = win;
+	}
+
+	if (!lru->buf) {
+		lru->buf = memalign(ARCH_DMA_MINALIGN, FATCACHE_SIZE);
+		if (!lru->buf) {
+			debug("Error: allocating memory\n");
+			return NULL;
+		}
+	}
+
+	if (startblock + getsize > mydata->fatlength)
+		getsize = mydata->fatlength - startblock;
+
+	/* Offset from start of disk */
+	lru->stamp = 0;
+	if (disk_read(mydata->fat_sect + startblock, getsize, lru->buf) < 0) {
+		debug("Error reading FAT blocks\n");
+		return NULL;
+	}
+	lru->num = num;
+	lru->stamp = ++fatcache.tick;
+
+	return lru->buf;
+}
+
 /*
  * Get the entry at index 'entry' in a FAT (12/16/32) table.
  * On failure 0x00 is returned.
@@ -170,21 +274,18 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 {
 	__u32 bufnum;
 	__u32 off16, offset;
+	__u32 entries;
 	__u32 ret = 0x00;
 	__u16 val1, val2;
+	__u8 *fatbuf;
 
 	switch (mydata->fatsize) {
 	case 32:
-		bufnum = entry / FAT32BUFSIZE;
-		offset = entry - bufnum * FAT32BUFSIZE;
-		break;
 	case 16:
-		bufnum = entry / FAT16BUFSIZE;
-		offset = entry - bufnum * FAT16BUFSIZE;
-		break;
 	case 12:
-		bufnum = entry / FAT12BUFSIZE;
-		offset = entry - bufnum * FAT12BUFSIZE;
+		entries = FATCACHE_SIZE * 8 / mydata->fatsize;
+		bufnum = entry / entries;
+		offset = entry - bufnum * entries;
 		break;
 
 	default:
@@ -195,57 +296,42 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	debug("FAT%d: entry: 0x%04x = %d, offset: 0x%04x = %d\n",
 	       mydata->fatsize, entry, entry, offset, offset);
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		startblock += mydata->fat_sect;	/* Offset from start of disk */
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return ret;
-		}
-		mydata->fatbufnum = bufnum;
-	}
+	fatbuf = get_fatwindow(mydata, bufnum);
+	if (!fatbuf)
+		return ret;
 
 	/* Get the actual entry from the table */
 	switch (mydata->fatsize) {
 	case 32:
-		ret = FAT2CPU32(((__u32 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU32(((__u32 *)fatbuf)[offset]);
 		break;
 	case 16:
-		ret = FAT2CPU16(((__u16 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU16(((__u16 *)fatbuf)[offset]);
 		break;
 	case 12:
 		off16 = (offset * 3) / 4;
 
 		switch (offset & 0x3) {
 		case 0:
-			ret = FAT2CPU16(((__u16 *) mydata->fatbuf)[off16]);
+			ret = FAT2CPU16(((__u16 *)fatbuf)[off16]);
 			ret &= 0xfff;
 			break;
 		case 1:
-			val1 = FAT2CPU16(((__u16 *)mydata->fatbuf)[off16]);
+			val1 = FAT2CPU16(((__u16 *)fatbuf)[off16]);
 			val1 &= 0xf000;
-			val2 = FAT2CPU16(((__u16 *)mydata->fatbuf)[off16 + 1]);
+			val2 = FAT2CPU16(((__u16 *)fatbuf)[off16 + 1]);
 			val2 &= 0x00ff;
 			ret = (val2 << 4) | (val1 >> 12);
 			break;
 		case 2:
-			val1 = FAT2CPU16(((__u16 *)mydata->fatbuf)[off16]);
+			val1 = FAT2CPU16(((__u16 *)fatbuf)[off16]);
 			val1 &= 0xff00;
-			val2 = FAT2CPU16(((__u16 *)mydata->fatbuf)[off16 + 1]);
+			val2 = FAT2CPU16(((__u16 *)fatbuf)[off16 + 1]);
 			val2 &= 0x000f;
 			ret = (val2 << 8) | (val1 >> 8);
 			break;
 		case 3:
-			ret = FAT2CPU16(((__u16 *)mydata->fatbuf)[off16]);
+			ret = FAT2CPU16(((__u16 *)fatbuf)[off16]);
 			ret = (ret & 0xfff0) >> 4;
 			break;
 		default:
@@ -259,6 +345,69 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	return ret;
 }
 
+/*
+ * Find the run of clusters holding cluster 'index' of the file starting at
+ * cluster 'start', extending the extent map of the file as needed.
+ * Return NULL if the cluster chain ends first or is broken.
+ */
+static struct fat_extent *get_extent(fsdata *mydata, __u32 start,
+				     __u32 index)
+{
+	struct fat_extent *ext;
+	__u32 next;
+	int lo, hi, mid;
+
+	/* Map from the start of the file if the cluster is before the map */
+	if (fatcache.file_start != start || !fatcache.num_extents ||
+	    index < fatcache.extents[0].index) {
+		fatcache.file_start = start;
+		fatcache.chain_end = false;
+		fatcache.extents[0].index = 0;
+		fatcache.extents[0].start = start;
+		fatcache.extents[0].count = 1;
+		fatcache.num_extents = 1;
+	}
+
+	ext = &fatcache.extents[fatcache.num_extents - 1];
+	while (index >= ext->index + ext->count) {
+		if (fatcache.chain_end)
+			return NULL;
+
+		next = get_fatent(mydata, ext->start + ext->count - 1);
+		if (CHECK_CLUST(next, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", next);
+			fatcache.chain_end = true;
+			return NULL;
+		}
+		if (next == ext->start + ext->count) {
+			ext->count++;
+			continue;
+		}
+
+		/* Keep only the last run when the map is full */
+		if (fatcache.num_extents == FATCACHE_EXTENTS) {
+			fatcache.extents[0] = *ext;
+			fatcache.num_extents = 1;
+		}
+		ext = &fatcache.extents[fatcache.num_extents++];
+		ext[0].index = ext[-1].index + ext[-1].count;
+		ext[0].start = next;
+		ext[0].count = 1;
+	}
+
+	lo = 0;
+	hi = fatcache.num_extents - 1;
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (fatcache.extents[mid].index <= index)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	return &fatcache.extents[lo];
+}
+
 /*
  * Read at most 'size' bytes from the specified cluster into 'buffer'.
  * Return 0 on success, -1 otherwise.
@@ -335,9 +484,11 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	__u32 startclust = START(dentptr);
+	struct fat_extent *ext;
+	__u32 offset;
 	loff_t actsize;
+	u64 index;
 
 	*gotsize = 0;
 	debug("Filesize: %llu bytes\n", filesize);
@@ -352,92 +503,52 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
-
-	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize += bytesperclust;
+	if (CHECK_CLUST(startclust, mydata->fatsize)) {
+		debug("curclust: 0x%x\n", startclust);
+		debug("Invalid FAT entry\n");
+		return 0;
 	}
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
-	filesize -= actsize;
-	pos -= actsize;
+	while (pos < filesize) {
+		index = pos;
+		offset = do_div(index, bytesperclust);
 
-	/* align to beginning of next cluster if any */
-	if (pos) {
-		actsize = min(filesize, (loff_t)bytesperclust);
-		if (get_cluster(mydata, curclust, get_contents_vfatname_block,
-				(int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, get_contents_vfatname_block + pos, actsize);
-		*gotsize += actsize;
-		if (!filesize)
-			return 0;
-		buffer += actsize;
-
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
+		ext = get_extent(mydata, startclust, index);
+		if (!ext) {
 			debug("Invalid FAT entry\n");
 			return 0;
 		}
-	}
-
-	actsize = bytesperclust;
-	endclust = curclust;
 
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				debug("Invalid FAT entry\n");
-				return 0;
+		if (offset) {
+			/* Read up to the start of the next cluster */
+			actsize = min(filesize - pos + offset,
+				      (loff_t)bytesperclust);
+			if (get_cluster(mydata, ext->start + index - ext->index,
+					get_contents_vfatname_block,
+					actsize) != 0) {
+				printf("Error reading cluster\n");
+				return -1;
+			}
+			actsize -= offset;
+			memcpy(buffer, get_contents_vfatname_block + offset,
+			       actsize);
+		} else {
+			/* Read the rest of the run in one go */
+			actsize = (loff_t)(ext->index + ext->count - index) *
+				  bytesperclust;
+			actsize = min(actsize, filesize - pos);
+			if (get_cluster(mydata, ext->start + index - ext->index,
+					buffer, actsize) != 0) {
+				printf("Error reading cluster\n");
+				return -1;
 			}
-			endclust = newclust;
-			actsize += bytesperclust;
-		}
-
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
-		filesize -= actsize;
 		buffer += actsize;
+		pos += actsize;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
@@ -755,7 +866,7 @@ read_bootsectandvi(boot_sector *bs, volume_info *volinfo, int *fatsize)
 		return -1;
 	}
 
-	block = memalign(ARCH_DMA_MINALIGN, cur_dev->blksz);
+	block = arena_memalign(ARCH_DMA_MINALIGN, cur_dev->blksz);
 	if (block == NULL) {
 		debug("Error: allocating block\n");
 		return -1;
@@ -807,7 +918,7 @@ read_bootsectandvi(boot_sector *bs, volume_info *volinfo, int *fatsize)
 fail:
 	ret = -1;
 exit:
-	free(block);
+	arena_free(block);
 	return ret;
 }
 
@@ -875,13 +986,6 @@ int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
 					(mydata->clust_size * 2);
 	}
 
-	mydata->fatbufnum = -1;
-	mydata->fatbuf = memalign(ARCH_DMA_MINALIGN, FATBUFSIZE);
-	if (mydata->fatbuf == NULL) {
-		debug("Error: allocating memory\n");
-		return -1;
-	}
-
 	if (vfat_enabled)
 		debug("VFAT Support enabled\n");
 
@@ -899,6 +1003,11 @@ int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
 	while (ISDIRDELIM(*filename))
 		filename++;
 
+	if (!dols && *filename && !strcmp(filename, fatcache.name)) {
+		dentptr = &fatcache.dent;
+		goto file_found;
+	}
+
 	/* Make a copy of the filename and convert it to lowercase */
 	strcpy(fnamecopy, filename);
 	downcase(fnamecopy);
@@ -1221,6 +1330,12 @@ rootdir_done:
 			subname = nextname;
 	}
 
+	if (!dols && strlen(filename) < sizeof(fatcache.name)) {
+		strcpy(fatcache.name, filename);
+		fatcache.dent = *dentptr;
+	}
+
+file_found:
 	if (dogetsize) {
 		*size = FAT2CPU32(dentptr->size);
 		ret = 0;
@@ -1230,7 +1345,6 @@ rootdir_done:
 	debug("Size: %u, got: %llu\n", FAT2CPU32(dentptr->size), *size);
 
 exit:
-	free(mydata->fatbuf);
 	return ret;
 }
 
@@ -1348,7 +1462,10 @@ int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 {
 	int ret;
 
-	ret = file_fat_read_at(filename, offset, buf, len, actread);
+	/* A streamed load reads the file in pieces; only say so once */
+	if (!offset)
+		printf("reading %s\n", filename);
+	ret = do_fat_read_at(filename, offset, buf, len, LS_NO, 0, actread);
 	if (ret)
 		printf("** Unable to read file %s **\n", filename);
 
@@ -1357,4 +1474,5 @@ int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 
 void fat_close(void)
 {
+	fat_cache_free();
 }
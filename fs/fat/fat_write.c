@@ -41,6 +41,9 @@ static int disk_write(__u32 block, __u32 nr_blocks, void *buf)
 		return -1;
 	}
 
+	/* The FAT and files may have changed under the read cache */
+	fat_cache_invalidate();
+
 	ret = blk_dwrite(cur_dev, cur_part_info.start + block, nr_blocks, buf);
 	if (nr_blocks && ret == 0)
 		return -1;
@@ -7,6 +7,9 @@
 #include <config.h>
 #include <errno.h>
 #include <common.h>
+#include <arena.h>
+#include <bootm.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <part.h>
 #include <ext4fs.h>
@@ -24,6 +27,13 @@ static struct blk_desc *fs_dev_desc;
 static disk_partition_t fs_partition;
 static int fs_type = FS_TYPE_ANY;
 
+/*
+ * Temporary allocations of the filesystem operation under way, freed by
+ * fs_close(). It is only active during the operation, so that nothing else
+ * allocates from it if a caller returns early after fs_set_blk_dev().
+ */
+static struct arena fs_arena;
+
 static inline int fs_probe_unsupported(struct blk_desc *fs_dev_desc,
 				      disk_partition_t *fs_partition)
 {
@@ -192,6 +202,16 @@ static struct fstype_info *fs_get_info(int fstype)
 	return info;
 }
 
+static void fs_close(void)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+
+	info->close();
+
+	fs_type = FS_TYPE_ANY;
+	arena_release(&fs_arena);
+}
+
 int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 {
 	struct fstype_info *info;
@@ -213,6 +233,9 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	}
 #endif
 
+	/* Close anything left open by an earlier caller */
+	fs_close();
+
 	part = blk_get_device_part_str(ifname, dev_part_str, &fs_dev_desc,
 					&fs_partition, 1);
 	if (part < 0)
@@ -235,20 +258,17 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	return -1;
 }
 
-static void fs_close(void)
+int fs_uuid(char *uuid_str)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
+	int ret;
 
-	info->close();
+	arena_begin(&fs_arena);
+	ret = info->uuid(uuid_str);
 
-	fs_type = FS_TYPE_ANY;
-}
-
-int fs_uuid(char *uuid_str)
-{
-	struct fstype_info *info = fs_get_info(fs_type);
+	fs_close();
 
-	return info->uuid(uuid_str);
+	return ret;
 }
 
 int fs_ls(const char *dirname)
@@ -257,9 +277,9 @@ int fs_ls(const char *dirname)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	arena_begin(&fs_arena);
 	ret = info->ls(dirname);
 
-	fs_type = FS_TYPE_ANY;
 	fs_close();
 
 	return ret;
@@ -271,6 +291,7 @@ int fs_exists(const char *filename)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	arena_begin(&fs_arena);
 	ret = info->exists(filename);
 
 	fs_close();
@@ -284,6 +305,7 @@ int fs_size(const char *filename, loff_t *size)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	arena_begin(&fs_arena);
 	ret = info->size(filename, size);
 
 	fs_close();
@@ -303,6 +325,7 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	 * means read the whole file.
 	 */
 	buf = map_sysmem(addr, len);
+	arena_begin(&fs_arena);
 	ret = info->read(filename, buf, offset, len, actread);
 	unmap_sysmem(buf);
 
@@ -314,6 +337,55 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	return ret;
 }
 
+#ifdef CONFIG_BOOTM_STREAM
+/*
+ * Read a file a chunk at a time and pass it to the bootm stream, which
+ * decompresses each chunk to the load address before the next is read.
+ */
+static int fs_read_stream(const char *filename, loff_t offset, loff_t len,
+			  loff_t *actread)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+	loff_t chunk, got;
+	void *buf;
+	int ret;
+
+	*actread = 0;
+	buf = malloc(CONFIG_BOOTM_STREAM_BUF);
+	if (!buf) {
+		puts("** Not enough memory to stream file **\n");
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	arena_begin(&fs_arena);
+	do {
+		chunk = CONFIG_BOOTM_STREAM_BUF;
+		if (len && len - *actread < chunk)
+			chunk = len - *actread;
+		ret = info->read(filename, buf, offset + *actread, chunk, &got);
+		if (ret < 0)
+			break;
+		ret = bootm_stream_write(buf, got);
+		if (ret)
+			break;
+		*actread += got;
+	} while (got == chunk && *actread != len);
+
+	free(buf);
+out:
+	fs_close();
+
+	return ret;
+}
+#else
+static inline int fs_read_stream(const char *filename, loff_t offset,
+				 loff_t len, loff_t *actread)
+{
+	return -ENOSYS;
+}
+#endif
+
 int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	     loff_t *actwrite)
 {
@@ -322,6 +394,7 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	int ret;
 
 	buf = map_sysmem(addr, len);
+	arena_begin(&fs_arena);
 	ret = info->write(filename, buf, offset, len, actwrite);
 	unmap_sysmem(buf);
 
@@ -362,6 +435,8 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	loff_t bytes;
 	loff_t pos;
 	loff_t len_read;
+	ulong size;
+	int stream;
 	int ret;
 	unsigned long time;
 	char *ep;
@@ -404,10 +479,17 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		pos = 0;
 
 	time = get_timer(0);
-	ret = fs_read(filename, addr, pos, bytes, &len_read);
+	stream = bootm_stream_start(addr);
+	if (stream)
+		ret = fs_read_stream(filename, pos, bytes, &len_read);
+	else
+		ret = fs_read(filename, addr, pos, bytes, &len_read);
 	time = get_timer(time);
-	if (ret < 0)
+	if (ret < 0) {
+		if (stream)
+			bootm_stream_abort();
 		return 1;
+	}
 
 	printf("%llu bytes read in %lu ms", len_read, time);
 	if (time > 0) {
@@ -417,8 +499,12 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	}
 	puts("\n");
 
+	size = len_read;
+	if (stream && bootm_stream_end(&size))
+		return 1;
+
 	setenv_hex("fileaddr", addr);
-	setenv_hex("filesize", len_read);
+	setenv_hex("filesize", size);
 
 	return 0;
 }
@@ -532,6 +618,7 @@ int do_fs_type(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		setenv(argv[3], info->name);
 	else
 		printf("%s\n", info->name);
+	fs_close();
 
 	return CMD_RET_SUCCESS;
 }
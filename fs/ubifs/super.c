@@ -78,6 +78,14 @@ void iget_failed(struct inode *inode)
 
 int ubifs_iput(struct inode *inode)
 {
+	int i;
+
+	/* Locked down inodes are handed out again by ubifs_iget() */
+	for (i = 0; i < INODE_LOCKED_MAX && inodes_locked_down[i]; i++) {
+		if (inodes_locked_down[i] == inode)
+			return 0;
+	}
+
 	list_del_init(&inode->i_sb_list);
 
 	free(inode);
@@ -2277,6 +2285,9 @@ static int ubifs_fill_super(struct super_block *sb, void *data, int silent)
 		goto out_bdi;
 
 	sb->s_bdi = &c->bdi;
+#else
+	/* Files are read whole, so always read runs of data nodes together */
+	c->bulk_read = 1;
 #endif
 	sb->s_fs_info = c;
 	sb->s_magic = UBIFS_SUPER_MAGIC;
@@ -13,6 +13,7 @@
  */
 
 #include <common.h>
+#include <arena.h>
 #include <memalign.h>
 #include "ubifs.h"
 #include <u-boot/zlib.h>
@@ -398,9 +399,9 @@ static int ubifs_finddir(struct super_block *sb, char *dirname,
 	struct inode *dir;
 	int ret = 0;
 
-	file = kzalloc(sizeof(struct file), 0);
-	dentry = kzalloc(sizeof(struct dentry), 0);
-	dir = kzalloc(sizeof(struct inode), 0);
+	file = arena_zalloc(sizeof(struct file));
+	dentry = arena_zalloc(sizeof(struct dentry));
+	dir = arena_zalloc(sizeof(struct inode));
 	if (!file || !dentry || !dir) {
 		printf("%s: Error, no memory for malloc!\n", __func__);
 		err = -ENOMEM;
@@ -462,14 +463,11 @@ out:
 		dbg_gen("cannot find next direntry, error %d", err);
 
 out_free:
-	if (file->private_data)
+	if (file && file->private_data)
 		kfree(file->private_data);
-	if (file)
-		free(file);
-	if (dentry)
-		free(dentry);
-	if (dir)
-		free(dir);
+	arena_free(dir);
+	arena_free(dentry);
+	arena_free(file);
 
 	return ret;
 }
@@ -516,7 +514,7 @@ static unsigned long ubifs_findfile(struct super_block *sb, char *filename)
 			return 0;
 		inode = ubifs_iget(sb, inum);
 
-		if (!inode)
+		if (IS_ERR(inode))
 			return 0;
 		ui = ubifs_inode(inode);
 
@@ -526,10 +524,12 @@ static unsigned long ubifs_findfile(struct super_block *sb, char *filename)
 			/* We have some sort of symlink recursion, bail out */
 			if (symlink_count++ > 8) {
 				printf("Symlink recursion, aborting\n");
+				ubifs_iput(inode);
 				return 0;
 			}
 			memcpy(link_name, ui->data, ui->data_len);
 			link_name[ui->data_len] = '\0';
+			ubifs_iput(inode);
 
 			if (link_name[0] == '/') {
 				/* Absolute path, redo everything without
@@ -545,6 +545,7 @@ static unsigned long ubifs_findfile(struct super_block *sb, char *filename)
 			next = name = symlinkpath;
 			continue;
 		}
+		ubifs_iput(inode);
 
 		/*
 		 * Check if directory with this name exists
@@ -597,9 +598,9 @@ int ubifs_ls(const char *filename)
 		goto out;
 	}
 
-	file = kzalloc(sizeof(struct file), 0);
-	dentry = kzalloc(sizeof(struct dentry), 0);
-	dir = kzalloc(sizeof(struct inode), 0);
+	file = arena_zalloc(sizeof(struct file));
+	dentry = arena_zalloc(sizeof(struct dentry));
+	dir = arena_zalloc(sizeof(struct inode));
 	if (!file || !dentry || !dir) {
 		printf("%s: Error, no memory for malloc!\n", __func__);
 		ret = -ENOMEM;
@@ -616,12 +617,9 @@ int ubifs_ls(const char *filename)
 	ubifs_printdir(file, dirent);
 
 out_mem:
-	if (file)
-		free(file);
-	if (dentry)
-		free(dentry);
-	if (dir)
-		free(dir);
+	arena_free(dir);
+	arena_free(dentry);
+	arena_free(file);
 
 out:
 	ubi_close_volume(c->ubi);
@@ -681,23 +679,12 @@ static inline void *kmap(struct page *page)
 	return page->addr;
 }
 
-static int read_block(struct inode *inode, void *addr, unsigned int block,
-		      struct ubifs_data_node *dn)
+static int decode_block(struct ubifs_info *c, struct inode *inode, void *addr,
+			unsigned int block, struct ubifs_data_node *dn)
 {
-	struct ubifs_info *c = inode->i_sb->s_fs_info;
 	int err, len, out_len;
-	union ubifs_key key;
 	unsigned int dlen;
 
-	data_key_init(c, &key, inode->i_ino, block);
-	err = ubifs_tnc_lookup(c, &key, dn);
-	if (err) {
-		if (err == -ENOENT)
-			/* Not found, so it must be a hole */
-			memset(addr, 0, UBIFS_BLOCK_SIZE);
-		return err;
-	}
-
 	ubifs_assert(le64_to_cpu(dn->ch.sqnum) > ubifs_inode(inode)->creat_sqnum);
 
 	len = le32_to_cpu(dn->size);
@@ -728,6 +715,93 @@ dump:
 	return -EINVAL;
 }
 
+static int read_block(struct inode *inode, void *addr, unsigned int block,
+		      struct ubifs_data_node *dn)
+{
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	union ubifs_key key;
+	int err;
+
+	data_key_init(c, &key, inode->i_ino, block);
+	err = ubifs_tnc_lookup(c, &key, dn);
+	if (err) {
+		if (err == -ENOENT)
+			/* Not found, so it must be a hole */
+			memset(addr, 0, UBIFS_BLOCK_SIZE);
+		return err;
+	}
+
+	return decode_block(c, inode, addr, block, dn);
+}
+
+/*
+ * Read whole blocks of a file. Runs of data nodes which sit next to each
+ * other in a LEB are found with one TNC walk and read with one flash read,
+ * then decompressed from the buffer straight to their destination.
+ */
+static int read_blocks(struct ubifs_info *c, struct inode *inode, void *addr,
+		       unsigned int block, unsigned int count)
+{
+	struct bu_info *bu = &c->bu;
+	struct ubifs_data_node *dn;
+	unsigned int done, i;
+	void *buf;
+	int err, n;
+
+	while (count) {
+		data_key_init(c, &bu->key, inode->i_ino, block);
+		bu->buf_len = c->max_bu_buf_len;
+		err = ubifs_tnc_get_bu_keys(c, bu);
+		if (err)
+			return err;
+
+		done = min_t(unsigned int, bu->blk_cnt, count);
+		if (!bu->cnt && bu->eof) {
+			/* No more data nodes, so the rest is a hole */
+			memset(addr, 0, count * UBIFS_BLOCK_SIZE);
+			return 0;
+		}
+		if (bu->cnt) {
+			err = ubifs_tnc_bulk_read(c, bu);
+			if (err == -EAGAIN)
+				bu->cnt = 0;
+			else if (err)
+				return err;
+		}
+		if (!bu->cnt || !done) {
+			/* Fall back to reading a single block */
+			dn = (void *)bu->buf;
+			err = read_block(inode, addr, block, dn);
+			if (err && err != -ENOENT)
+				return err;
+			done = 1;
+		} else {
+			buf = bu->buf;
+			for (i = 0, n = 0; i < done; i++) {
+				void *dest = addr + i * UBIFS_BLOCK_SIZE;
+
+				if (n >= bu->cnt ||
+				    key_block(c, &bu->zbranch[n].key) !=
+				    block + i) {
+					/* A hole */
+					memset(dest, 0, UBIFS_BLOCK_SIZE);
+					continue;
+				}
+				err = decode_block(c, inode, dest, block + i,
+						   buf);
+				if (err)
+					return err;
+				buf += ALIGN(bu->zbranch[n++].len, 8);
+			}
+		}
+		block += done;
+		addr += done * UBIFS_BLOCK_SIZE;
+		count -= done;
+	}
+
+	return 0;
+}
+
 static int do_readpage(struct ubifs_info *c, struct inode *inode,
 		       struct page *page, int last_block_size)
 {
@@ -750,7 +824,7 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 		goto out;
 	}
 
-	dn = kmalloc(UBIFS_MAX_DATA_NODE_SZ, GFP_NOFS);
+	dn = arena_alloc(UBIFS_MAX_DATA_NODE_SZ);
 	if (!dn)
 		return -ENOMEM;
 
@@ -777,7 +851,8 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 				 * destination area to a multiple of
 				 * UBIFS_BLOCK_SIZE.
 				 */
-				buff = malloc_cache_aligned(UBIFS_BLOCK_SIZE);
+				buff = arena_memalign(ARCH_DMA_MINALIGN,
+						      UBIFS_BLOCK_SIZE);
 				if (!buff) {
 					printf("%s: Error, malloc fails!\n",
 					       __func__);
@@ -790,7 +865,7 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 				if (ret) {
 					err = ret;
 					if (err != -ENOENT) {
-						free(buff);
+						arena_free(buff);
 						break;
 					}
 				}
@@ -803,7 +878,7 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 				/* Now copy required size back to dest */
 				memcpy(addr, buff, dlen);
 
-				free(buff);
+				arena_free(buff);
 			} else {
 				ret = read_block(inode, addr, block, dn);
 				if (ret) {
@@ -830,12 +905,12 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 	}
 
 out_free:
-	kfree(dn);
+	arena_free(dn);
 out:
 	return 0;
 
 error:
-	kfree(dn);
+	arena_free(dn);
 	return err;
 }
 
@@ -897,7 +972,25 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 	page.addr = buf;
 	page.index = offset / PAGE_SIZE;
 	page.inode = inode;
-	for (i = 0; i < count; i++) {
+	i = 0;
+	if (c->bu.buf && count > 1) {
+		/*
+		 * Read all but the last block in bulk. The last block may be
+		 * partial, so do_readpage() deals with it below.
+		 */
+		err = read_blocks(c, inode, buf,
+				  page.index << UBIFS_BLOCKS_PER_PAGE_SHIFT,
+				  count - 1);
+		if (err) {
+			ubifs_err(c, "cannot read inode %lu, error %d",
+				  inode->i_ino, err);
+		} else {
+			i = count - 1;
+			page.addr += i * PAGE_SIZE;
+			page.index += i;
+		}
+	}
+	for (; i < count && !err; i++) {
 		/*
 		 * Make sure to not read beyond the requested size
 		 */
@@ -760,7 +760,12 @@ static inline ino_t parent_ino(struct dentry *dentry)
 #define BOTTOM_UP_HEIGHT 64
 
 /* Maximum number of data nodes to bulk-read */
+#ifndef __UBOOT__
 #define UBIFS_MAX_BULK_READ 32
+#else
+/* U-Boot reads whole files, so read up to a whole LEB in one go */
+#define UBIFS_MAX_BULK_READ 256
+#endif
 
 /*
  * Lockdep classes for UBIFS inode @ui_mutex.
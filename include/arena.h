@@ -0,0 +1,138 @@
+/*
+ * Scoped arena allocator
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <malloc.h>
+
+/* Alignment of memory from arena_alloc(), as for malloc() */
+#define ARENA_ALIGN		16
+
+/* Number of recent allocations which arena_free() can give back */
+#define ARENA_MARKS		8
+
+struct arena_chunk;
+
+/**
+ * struct arena - Memory which is all freed together
+ *
+ * While an arena is active, arena_alloc() takes memory from it by moving a
+ * pointer along a chunk, getting a new chunk from malloc() when that one is
+ * full. arena_release() frees all the chunks at once, so nothing allocated
+ * in the arena may be used after that.
+ *
+ * @chunk:	Newest chunk, which allocations are taken from
+ * @prev:	Arena which was active before this one
+ * @active:	true between arena_begin() and arena_release()
+ * @marks:	Start of the latest allocations in @chunk, oldest first
+ * @nmarks:	Number of entries in @marks
+ * @allocs:	Number of allocations made
+ * @held:	Number of bytes held in chunks
+ */
+struct arena {
+	struct arena_chunk *chunk;
+	struct arena *prev;
+	bool active;
+	ulong marks[ARENA_MARKS];
+	int nmarks;
+	uint allocs;
+	ulong held;
+};
+
+#if CONFIG_IS_ENABLED(ARENA)
+/**
+ * arena_begin() - Make an arena the active one
+ *
+ * Arenas nest: the previously active arena is used again once this one is
+ * released.
+ *
+ * @arena:	Arena to use, which must not be active already
+ */
+void arena_begin(struct arena *arena);
+
+/**
+ * arena_memalign() - Allocate aligned memory from the active arena
+ *
+ * With no active arena this uses memalign(), so that code using an arena
+ * still works when called without one.
+ *
+ * @align:	Alignment needed, a power of two
+ * @size:	Number of bytes needed
+ * @return pointer to the memory, or NULL if out of memory
+ */
+void *arena_memalign(size_t align, size_t size);
+
+/**
+ * arena_alloc() - Allocate memory from the active arena
+ *
+ * @size:	Number of bytes needed
+ * @return pointer to the memory, or NULL if out of memory
+ */
+static inline void *arena_alloc(size_t size)
+{
+	return arena_memalign(ARENA_ALIGN, size);
+}
+
+/**
+ * arena_zalloc() - Allocate zeroed memory from the active arena
+ *
+ * @size:	Number of bytes needed
+ * @return pointer to the memory, or NULL if out of memory
+ */
+void *arena_zalloc(size_t size);
+
+/**
+ * arena_free() - Free memory from arena_alloc()
+ *
+ * Memory in an active arena is only given back if it was the last
+ * allocation still in use, so that buffers freed in the reverse order of
+ * allocation in a loop do not grow the arena. The rest is freed by
+ * arena_release(). Memory which came from malloc() is passed to free().
+ *
+ * @ptr:	Memory to free, or NULL
+ */
+void arena_free(void *ptr);
+
+/**
+ * arena_release() - Free everything allocated in an arena
+ *
+ * This does nothing if the arena is not active.
+ *
+ * @arena:	Arena to release, which must be the active one
+ */
+void arena_release(struct arena *arena);
+#else
+static inline void arena_begin(struct arena *arena)
+{
+}
+
+static inline void *arena_memalign(size_t align, size_t size)
+{
+	return memalign(align, size);
+}
+
+static inline void *arena_alloc(size_t size)
+{
+	return malloc(size);
+}
+
+static inline void *arena_zalloc(size_t size)
+{
+	return calloc(1, size);
+}
+
+static inline void arena_free(void *ptr)
+{
+	free(ptr);
+}
+
+static inline void arena_release(struct arena *arena)
+{
+}
+#endif
+
+#endif /* __ARENA_H */
@@ -89,6 +89,9 @@ typedef struct global_data {
 	unsigned long malloc_base;	/* base address of early malloc() */
 	unsigned long malloc_limit;	/* limit address */
 	unsigned long malloc_ptr;	/* current address */
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB_F)
+	struct slab_heap *malloc_slab;	/* small objects in early malloc() */
+#endif
 #endif
 #ifdef CONFIG_PCI
 	struct pci_controller *hose;	/* PCI hose for early use */
@@ -89,42 +89,54 @@ struct blk_desc {
 #define PAD_TO_BLOCKSIZE(size, blk_desc) \
 	(PAD_SIZE(size, blk_desc->blksz))
 
+/**
+ * blkcache_read_t - function which reads blocks from the device itself
+ *
+ * @block_dev: Block device to read from
+ * @start: First block to read
+ * @blkcnt: Number of blocks to read
+ * @buffer: Place to put the data
+ * @return number of blocks read
+ */
+typedef unsigned long (*blkcache_read_t)(struct blk_desc *block_dev,
+					 lbaint_t start, lbaint_t blkcnt,
+					 void *buffer);
+
 #ifdef CONFIG_BLOCK_CACHE
 /**
- * blkcache_read() - attempt to read a set of blocks from cache
+ * blkcache_read() - read a set of blocks, using the cache where possible
  *
- * @param iftype - IF_TYPE_x for type of device
- * @param dev - device index of particular type
+ * Blocks held in the cache are copied out. Runs of missing blocks are read
+ * with @read, one request per run, and added to the cache. Sequential reads
+ * also fetch the following blocks ahead of time.
+ *
+ * @param block_dev - block device to read from
  * @param start - starting block number
  * @param blkcnt - number of blocks to read
- * @param blksz - size in bytes of each block
- * @param buf - buffer to contain cached data
+ * @param buffer - buffer to contain the data
+ * @param read - function to read blocks from the device
  *
- * @return - '1' if block returned from cache, '0' otherwise.
+ * @return - number of blocks read
  */
-int blkcache_read(int iftype, int dev,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer);
+unsigned long blkcache_read(struct blk_desc *block_dev, lbaint_t start,
+			    lbaint_t blkcnt, void *buffer,
+			    blkcache_read_t read);
 
 /**
- * blkcache_fill() - make data read from a block device available
- * to the block cache
+ * blkcache_invalidate_range() - discard cached copies of a set of blocks
+ * because they are about to be written or erased
  *
  * @param iftype - IF_TYPE_x for type of device
  * @param dev - device index of particular type
  * @param start - starting block number
- * @param blkcnt - number of blocks available
- * @param blksz - size in bytes of each block
- * @param buf - buffer containing data to cache
- *
+ * @param blkcnt - number of blocks
  */
-void blkcache_fill(int iftype, int dev,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer);
+void blkcache_invalidate_range(int iftype, int dev, lbaint_t start,
+			       lbaint_t blkcnt);
 
 /**
- * blkcache_invalidate() - discard the cache for a set of blocks
- * because of a write or device (re)initialization.
+ * blkcache_invalidate() - discard the cache for a whole device
+ * because of a device (re)initialization.
  *
  * @param iftype - IF_TYPE_x for type of device
  * @param dev - device index of particular type
@@ -134,7 +146,7 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
+ * @param blocks - blocks per entry, rounded up to a power of two
  * @param entries - maximum entries in cache
  */
 void blkcache_configure(unsigned blocks, unsigned entries);
@@ -143,8 +155,10 @@ void blkcache_configure(unsigned blocks, unsigned entries);
  * statistics of the block cache
  */
 struct block_cache_stats {
-	unsigned hits;
-	unsigned misses;
+	unsigned hits;		/* reads served entirely from the cache */
+	unsigned partial_hits;	/* reads served partly from the cache */
+	unsigned misses;	/* reads which found nothing in the cache */
+	unsigned readahead;	/* blocks read ahead of time */
 	unsigned entries; /* current entry count */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
@@ -159,16 +173,15 @@ void blkcache_stats(struct block_cache_stats *stats);
 
 #else
 
-static inline int blkcache_read(int iftype, int dev,
-				lbaint_t start, lbaint_t blkcnt,
-				unsigned long blksz, void *buffer)
+static inline unsigned long blkcache_read(struct blk_desc *block_dev,
+					  lbaint_t start, lbaint_t blkcnt,
+					  void *buffer, blkcache_read_t read)
 {
-	return 0;
+	return read(block_dev, start, blkcnt, buffer);
 }
 
-static inline void blkcache_fill(int iftype, int dev,
-				 lbaint_t start, lbaint_t blkcnt,
-				 unsigned long blksz, void const *buffer) {}
+static inline void blkcache_invalidate_range(int iftype, int dev,
+					     lbaint_t start, lbaint_t blkcnt) {}
 
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
@@ -217,6 +230,34 @@ struct blk_ops {
 	unsigned long (*erase)(struct udevice *dev, lbaint_t start,
 			       lbaint_t blkcnt);
 
+	/**
+	 * write_submit() - start writing to a block device
+	 *
+	 * This is optional, and needs write_wait() too. It returns once the
+	 * device has the data, without waiting for the device to finish
+	 * with it, so that the caller can get on with something else.
+	 *
+	 * @dev:	Device to write to
+	 * @start:	Start block number to write (0=first)
+	 * @blkcnt:	Number of blocks to write
+	 * @buffer:	Source buffer for data to write, which must not change
+	 *		until write_wait() returns
+	 * @return 0 if the write was started, -ve on error
+	 */
+	int (*write_submit)(struct udevice *dev, lbaint_t start,
+			    lbaint_t blkcnt, const void *buffer);
+
+	/**
+	 * write_wait() - wait for a write started by write_submit()
+	 *
+	 * This must be called before anything else is done with the device.
+	 *
+	 * @dev:	Device being written
+	 * @return number of blocks written, or -ve error number (see the
+	 * IS_ERR_VALUE() macro
+	 */
+	unsigned long (*write_wait)(struct udevice *dev);
+
 	/**
 	 * select_hwpart() - select a particular hardware partition
 	 *
@@ -252,6 +293,33 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
 
+/**
+ * blk_dwrite_submit() - Start writing blocks without waiting for the device
+ *
+ * Where the device supports it, this returns once the write is under way,
+ * so that the caller can prepare more data while the device is busy.
+ * blk_dwrite_wait() must then be called before the device is used again,
+ * and the buffer must not change until it returns.
+ *
+ * @block_dev:	Device to write to
+ * @start:	Start block number to write (0=first)
+ * @blkcnt:	Number of blocks to write
+ * @buffer:	Data to write
+ * @return 0 if the write was started, -ENOSYS if the device cannot do this
+ * (nothing is written; use blk_dwrite() instead), other -ve on error
+ */
+int blk_dwrite_submit(struct blk_desc *block_dev, lbaint_t start,
+		      lbaint_t blkcnt, const void *buffer);
+
+/**
+ * blk_dwrite_wait() - Wait for a write started by blk_dwrite_submit()
+ *
+ * @block_dev:	Device being written
+ * @return number of blocks written, or -ve error number (see the
+ * IS_ERR_VALUE() macro
+ */
+unsigned long blk_dwrite_wait(struct blk_desc *block_dev);
+
 /**
  * blk_get_device() - Find and probe a block device ready for use
  *
@@ -375,38 +443,44 @@ int blk_select_hwpart(struct udevice *dev, int hwpart);
 static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			      lbaint_t blkcnt, void *buffer)
 {
-	ulong blks_read;
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
-		return blkcnt;
-
 	/*
 	 * We could check if block_read is NULL and return -ENOSYS. But this
 	 * bloats the code slightly (cause some board to fail to build), and
 	 * it would be an error to try an operation that does not exist.
 	 */
-	blks_read = block_dev->block_read(block_dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
-
-	return blks_read;
+	return blkcache_read(block_dev, start, blkcnt, buffer,
+			     block_dev->block_read);
 }
 
 static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blkcache_invalidate_range(block_dev->if_type, block_dev->devnum,
+				  start, blkcnt);
 	return block_dev->block_write(block_dev, start, blkcnt, buffer);
 }
 
 static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blkcache_invalidate_range(block_dev->if_type, block_dev->devnum,
+				  start, blkcnt);
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
+/* Legacy block devices always write synchronously */
+static inline int blk_dwrite_submit(struct blk_desc *block_dev,
+				    lbaint_t start, lbaint_t blkcnt,
+				    const void *buffer)
+{
+	return -ENOSYS;
+}
+
+static inline ulong blk_dwrite_wait(struct blk_desc *block_dev)
+{
+	return -ENOSYS;
+}
+
 /**
  * struct blk_driver - Driver for block interface types
  *
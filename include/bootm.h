@@ -73,4 +73,63 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		       void *load_buf, void *image_buf, ulong image_len,
 		       uint unc_len, ulong *load_end);
 
+#ifdef CONFIG_BOOTM_STREAM
+/**
+ * bootm_stream_start() - start decompressing an image as it is loaded
+ *
+ * Loaders call this before they read an image, and if it returns 1 pass
+ * the data to bootm_stream_write() in order instead of storing it. See
+ * common/bootm_stream.c for which images are decompressed.
+ *
+ * @addr:	Load address
+ * @return 1 if the image should be streamed (the "loaddecomp" environment
+ * variable is set), 0 if it should be loaded as usual
+ */
+int bootm_stream_start(ulong addr);
+
+/**
+ * bootm_stream_write() - pass the next piece of the image
+ *
+ * @buf:	Image data
+ * @len:	Number of bytes in @buf
+ * @return 0 if OK, -ve on error, after which the stream is abandoned
+ */
+int bootm_stream_write(const void *buf, ulong len);
+
+/**
+ * bootm_stream_end() - finish loading the image
+ *
+ * @lenp:	Returns the number of bytes now at the load address
+ * @return 0 if OK, -ve if the image was truncated, corrupt or too large
+ */
+int bootm_stream_end(ulong *lenp);
+
+/**
+ * bootm_stream_abort() - abandon the image being loaded
+ *
+ * Loaders call this if they fail part-way through an image, so that the
+ * decompressor's buffers are freed before the next load.
+ */
+void bootm_stream_abort(void);
+#else
+static inline int bootm_stream_start(ulong addr)
+{
+	return 0;
+}
+
+static inline int bootm_stream_write(const void *buf, ulong len)
+{
+	return -ENOSYS;
+}
+
+static inline int bootm_stream_end(ulong *lenp)
+{
+	return -ENOSYS;
+}
+
+static inline void bootm_stream_abort(void)
+{
+}
+#endif
+
 #endif
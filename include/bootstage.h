@@ -198,6 +198,8 @@ enum bootstage_id {
 	BOOTSTAGE_ID_ACCUM_SCSI,
 	BOOTSTAGE_ID_ACCUM_SPI,
 	BOOTSTAGE_ID_ACCUM_DECOMP,
+	BOOTSTAGE_ID_ACCUM_DM_R,
+	BOOTSTAGE_ID_ACCUM_UBI_ATTACH,
 	BOOTSTAGE_ID_FPGA_INIT,
 
 	/* a few spare for the user, from here */
@@ -392,6 +394,84 @@ static inline int bootstage_unstash(void *base, int size)
 }
 #endif /* CONFIG_BOOTSTAGE */
 
+/* Kinds of timing span, which are kept apart in reports and traces */
+enum bootstage_span_type {
+	BOOTSTAGE_SPAN_USER,		/* Added by bootstage_span_begin() */
+	BOOTSTAGE_SPAN_INITCALL,	/* Function in an initcall list */
+	BOOTSTAGE_SPAN_PROBE,		/* device_probe() */
+	BOOTSTAGE_SPAN_UCLASS,		/* Uclass init() method */
+	BOOTSTAGE_SPAN_CMD,		/* Command run from the command line */
+
+	BOOTSTAGE_SPAN_TYPE_COUNT,
+};
+
+#if defined(CONFIG_BOOTSTAGE_SPANS) && !defined(CONFIG_SPL_BUILD) && \
+	!defined(USE_HOSTCC)
+/**
+ * Mark the start of a timing span
+ *
+ * Spans nest: one which starts before the last one has ended is taken to be
+ * part of it. The name is copied, so it need not last beyond this call.
+ *
+ * @param type	Kind of span (enum bootstage_span_type)
+ * @param name	Name of the span
+ * @return span number to pass to bootstage_span_end(), or -ENOSPC if the
+ *		span table is full
+ */
+int bootstage_span_begin(enum bootstage_span_type type, const char *name);
+
+/**
+ * Mark the start of a timing span named by a code address
+ *
+ * This is used for initcalls, which have no name at run time. The address
+ * is recorded before relocation, so that it can be looked up in System.map.
+ *
+ * @param type	Kind of span (enum bootstage_span_type)
+ * @param addr	Address of the code, before relocation
+ * @return span number to pass to bootstage_span_end(), or -ENOSPC
+ */
+int bootstage_span_begin_addr(enum bootstage_span_type type, ulong addr);
+
+/**
+ * Mark the end of a timing span
+ *
+ * Any spans inside it which are still open end at the same time.
+ *
+ * @param span	Span number from bootstage_span_begin(), or -ve to do nothing
+ */
+void bootstage_span_end(int span);
+
+/**
+ * Write the timeline as Chrome trace-event JSON
+ *
+ * Each span becomes a complete ("X") event and each bootstage record an
+ * instant ("i") event, with times in microseconds. Spans which have not
+ * ended yet run up to the present.
+ *
+ * @param buf	Buffer to write into, which is nul-terminated if @size > 0
+ * @param size	Size of buffer
+ * @return number of characters needed for the whole trace, not counting
+ *		the terminator. If this is @size or more the trace was cut short
+ */
+int bootstage_trace(char *buf, int size);
+#else
+static inline int bootstage_span_begin(enum bootstage_span_type type,
+				       const char *name)
+{
+	return -1;
+}
+
+static inline int bootstage_span_begin_addr(enum bootstage_span_type type,
+					    ulong addr)
+{
+	return -1;
+}
+
+static inline void bootstage_span_end(int span)
+{
+}
+#endif /* CONFIG_BOOTSTAGE_SPANS */
+
 /* Helper macro for adding a bootstage to a line of code */
 #define BOOTSTAGE_MARKER()	\
 		bootstage_mark_code(__FILE__, __func__, __LINE__)
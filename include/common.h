@@ -786,6 +786,18 @@ int gunzip(void *, int, unsigned char *, unsigned long *);
 int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 						int stoponerr, int offset);
 
+/*
+ * Incremental gunzip: start a stream decompressing into @dst, feed it the
+ * compressed data in pieces of any size, then end it to get the length.
+ * gunzip_stream_write() returns 1 once the end of the gzip stream has been
+ * seen, 0 if more input is needed, -ENOSPC if @dst is full or another
+ * negative error. gunzip_stream_end() frees the stream and fails if it was
+ * not complete.
+ */
+void *gunzip_stream_start(void *dst, unsigned long dstlen);
+int gunzip_stream_write(void *stream, const void *src, unsigned long srclen);
+int gunzip_stream_end(void *stream, unsigned long *lenp);
+
 /**
  * gzwrite progress indicators: defined weak to allow board-specific
  * overrides:
@@ -827,6 +839,10 @@ int gzwrite(unsigned char *src, int len,
 
 /* lib/lz4_wrapper.c */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
+/* Incremental ulz4fn(), with the same conventions as gunzip_stream_*() */
+void *ulz4_stream_start(void *dst, size_t dstn);
+int ulz4_stream_write(void *stream, const void *src, size_t srcn);
+int ulz4_stream_end(void *stream, size_t *dstn);
 
 /* lib/qsort.c */
 void qsort(void *base, size_t nmemb, size_t size,
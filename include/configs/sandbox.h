@@ -194,6 +194,7 @@
 #define CONFIG_LZMA
 
 #define CONFIG_CMD_LZMADEC
+#define CONFIG_CMD_UNZIP
 #define CONFIG_CMD_DATE
 
 #ifndef CONFIG_SPL_BUILD
@@ -193,4 +193,27 @@ struct uclass *uclass_find(enum uclass_id key);
  */
 int uclass_destroy(struct uclass *uc);
 
+/**
+ * uclass_set_seq() - Set the sequence number of a device
+ *
+ * This keeps the uclass lookup index up to date, so must be used instead of
+ * writing dev->seq directly.
+ *
+ * @dev: Device to update
+ * @seq: New sequence number, or -1 if none
+ */
+void uclass_set_seq(struct udevice *dev, int seq);
+
+/**
+ * uclass_index_drop() - Drop the lookup index of a uclass
+ *
+ * Driver model drops the index itself when devices are bound or unbound.
+ * This must be called by anything else which changes the name or device-tree
+ * offset of a bound device, or reorders the devices in a uclass. The index
+ * is built again when needed.
+ *
+ * @uc: uclass to update
+ */
+void uclass_index_drop(struct uclass *uc);
+
 #endif
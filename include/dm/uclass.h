@@ -30,12 +30,19 @@
  * @dev_head: List of devices in this uclass (devices are attached to their
  * uclass when their bind method is called)
  * @sibling_node: Next uclass in the linked list of uclasses
+ * @index: Lookup tables for the devices in this uclass, or NULL if they have
+ * not been built (see CONFIG_DM_INDEX)
+ * @index_scans: Number of list walks since @index was last dropped
  */
 struct uclass {
 	void *priv;
 	struct uclass_driver *uc_drv;
 	struct list_head dev_head;
 	struct list_head sibling_node;
+#if CONFIG_IS_ENABLED(DM_INDEX)
+	struct uclass_index *index;
+	int index_scans;
+#endif
 };
 
 struct driver;
@@ -0,0 +1,72 @@
+/*
+ * Log-structured environment storage
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __ENV_LOG_H__
+#define __ENV_LOG_H__
+
+#include <search.h>
+
+/**
+ * struct env_log - An environment area which is updated by appending
+ *
+ * The area starts with a normal copy of the environment (env_t), written
+ * when the area is erased. Each save after that appends a record holding
+ * just the variables which changed, as "name=value" strings, or "name" for
+ * a deleted variable. When a record does not fit, the area is erased and a
+ * new env_t written, which compacts the log.
+ *
+ * Each record has its own CRC. A record cut short by a power failure is
+ * ignored when loading, so the environment is as it was before that save.
+ *
+ * @read:	Read @len bytes at @offset in the area into @buf
+ * @write:	Program @len bytes at @offset in the area, which is erased
+ * @erase:	Erase the whole area
+ * @priv:	Private data for the above
+ * @size:	Size of the area in bytes
+ * @htab:	Hash table holding the environment
+ * @pos:	Offset of the next record; @size if the log must be compacted
+ * @saved:	Export of the environment as held in the area, or NULL if
+ *		not known
+ * @changes:	Value of @htab->changes when @saved was made
+ */
+struct env_log {
+	int (*read)(struct env_log *log, uint offset, size_t len, void *buf);
+	int (*write)(struct env_log *log, uint offset, size_t len,
+		     const void *buf);
+	int (*erase)(struct env_log *log);
+	void *priv;
+	uint size;
+	struct hsearch_data *htab;
+	uint pos;
+	char *saved;
+	unsigned int changes;
+};
+
+/**
+ * env_log_load() - Load the environment from a log area
+ *
+ * The env_t at the start of the area is imported, then each record is
+ * applied in turn.
+ *
+ * @log:	Log area to load
+ * @return number of records applied, -EBADMSG if the env_t is not valid,
+ * other -ve on error
+ */
+int env_log_load(struct env_log *log);
+
+/**
+ * env_log_save() - Save the environment to a log area
+ *
+ * If nothing has changed since the last load or save, nothing is written.
+ * Otherwise a record with the changes is appended, or the log compacted if
+ * there is no room for it.
+ *
+ * @log:	Log area to update
+ * @return 0 if OK, -ve on error
+ */
+int env_log_save(struct env_log *log);
+
+#endif /* __ENV_LOG_H__ */
@@ -33,6 +33,23 @@
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
 #define FAT32BUFSIZE	(FATBUFSIZE/4)
 
+/*
+ * The read path keeps FATCACHE_WINDOWS windows of FATCACHE_BLOCKS sectors of
+ * the FAT until the device changes. FATCACHE_BLOCKS must be a multiple of 3
+ * so that FAT12 entries never straddle two windows.
+ */
+#ifdef CONFIG_SPL_BUILD
+#define FATCACHE_BLOCKS		FATBUFBLOCKS
+#define FATCACHE_WINDOWS	1
+#else
+#define FATCACHE_BLOCKS		(FATBUFBLOCKS * 8)
+#define FATCACHE_WINDOWS	4
+#endif
+#define FATCACHE_SIZE		(mydata->sect_size * FATCACHE_BLOCKS)
+/* Number of cluster runs remembered for the file being read */
+#define FATCACHE_EXTENTS	64
+/* Longest path whose directory entry is remembered */
+#define FATCACHE_NAMELEN	256
 
 /* Filesystem identifiers */
 #define FAT12_SIGN	"FAT12   "
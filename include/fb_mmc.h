@@ -7,3 +7,33 @@
 void fb_mmc_flash_write(const char *cmd, void *download_buffer,
 			unsigned int download_bytes);
 void fb_mmc_erase(const char *cmd);
+
+/**
+ * fb_mmc_flash_stream_start() - Start writing a partition as data arrives
+ *
+ * The image is then passed to fb_mmc_flash_stream_write() in pieces of any
+ * size, so it need not fit in the download buffer. Errors are reported with
+ * fastboot_fail().
+ *
+ * @cmd:	Name of the partition
+ * @return 0 if OK, -ve on error
+ */
+int fb_mmc_flash_stream_start(const char *cmd);
+
+/**
+ * fb_mmc_flash_stream_write() - Write the next part of the image
+ *
+ * @data:	Data to write
+ * @len:	Number of bytes at @data
+ * @return 0 if OK, -ve if this or an earlier part failed
+ */
+int fb_mmc_flash_stream_write(const void *data, unsigned int len);
+
+/**
+ * fb_mmc_flash_stream_end() - Finish writing the image
+ *
+ * On success this reports fastboot_okay().
+ *
+ * @return 0 if OK, -ve on error
+ */
+int fb_mmc_flash_stream_end(void);
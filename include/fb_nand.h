@@ -8,3 +8,32 @@
 void fb_nand_flash_write(const char *cmd, void *download_buffer,
 			 unsigned int download_bytes);
 void fb_nand_erase(const char *cmd);
+
+/**
+ * fb_nand_flash_stream_start() - Start writing a partition as data arrives
+ *
+ * This works like fb_mmc_flash_stream_start(). FILL chunks of 0xff in a
+ * sparse image are skipped, as the partition is expected to be erased.
+ *
+ * @cmd:	Name of the partition
+ * @return 0 if OK, -ve on error
+ */
+int fb_nand_flash_stream_start(const char *cmd);
+
+/**
+ * fb_nand_flash_stream_write() - Write the next part of the image
+ *
+ * @data:	Data to write
+ * @len:	Number of bytes at @data
+ * @return 0 if OK, -ve if this or an earlier part failed
+ */
+int fb_nand_flash_stream_write(const void *data, unsigned int len);
+
+/**
+ * fb_nand_flash_stream_end() - Finish writing the image
+ *
+ * On success this reports fastboot_okay().
+ *
+ * @return 0 if OK, -ve on error
+ */
+int fb_nand_flash_stream_end(void);
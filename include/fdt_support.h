@@ -248,6 +248,36 @@ int arch_fixup_memory_node(void *blob);
 int fdt_setup_simplefb_node(void *fdt, int node, u64 base_address, u32 width,
 			    u32 height, u32 stride, const char *format);
 
+#if CONFIG_IS_ENABLED(OF_LIBFDT_INDEX)
+/**
+ * fdt_index_setup() - Index a device tree to speed up lookups
+ *
+ * The index is allocated with malloc(), leaving room for some nodes to be
+ * added. The tree must only be changed with libfdt functions until
+ * fdt_index_release() is called.
+ *
+ * @blob: Device tree to index
+ * @return 0 if OK, -ve on error
+ */
+int fdt_index_setup(const void *blob);
+
+/**
+ * fdt_index_release() - Stop indexing a device tree and free the index
+ *
+ * @blob: Device tree passed to fdt_index_setup()
+ */
+void fdt_index_release(const void *blob);
+#else
+static inline int fdt_index_setup(const void *blob)
+{
+	return 0;
+}
+
+static inline void fdt_index_release(const void *blob)
+{
+}
+#endif
+
 #endif /* ifdef CONFIG_OF_LIBFDT */
 
 #ifdef USE_HOSTCC
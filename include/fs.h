@@ -20,6 +20,10 @@
  * within the partition. The identification process may be limited to a
  * specific filesystem type by passing FS_* in the fstype parameter.
  *
+ * With CONFIG_ARENA this also starts an arena for the filesystem's temporary
+ * allocations, which is released when the next fs_*() call closes the
+ * filesystem.
+ *
  * Returns 0 on success.
  * Returns non-zero if there is an error accessing the disk or partition, or
  * no known filesystem type could be recognized on it.
@@ -6,6 +6,8 @@
 #ifndef _HASH_H
 #define _HASH_H
 
+#include <smp_work.h>
+
 /*
  * Maximum digest size for all algorithms we support. Having this value
  * avoids a malloc() or C99 local declaration in common/cmd_hash.c.
@@ -21,6 +23,29 @@ enum {
 #define CONFIG_HASH_VERIFY
 #endif
 
+struct hash_algo;
+
+/**
+ * struct hash_job - A block to hash as part of hash_block_multi()
+ *
+ * @algo:	Hash algorithm to use
+ * @data:	Data to hash
+ * @len:	Length of data in bytes
+ * @output:	Place to put the hash value (algo->digest_size bytes)
+ * @ret:	Result of the job: 0 if ok, -ve on error
+ * @priv:	For use by the algorithm while the job is in flight
+ * @work:	Used to hash on another CPU when the algorithm has no hardware
+ */
+struct hash_job {
+	struct hash_algo *algo;
+	const void *data;
+	unsigned int len;
+	uint8_t *output;
+	int ret;
+	void *priv;
+	struct smp_work work;
+};
+
 struct hash_algo {
 	const char *name;			/* Name of algorithm */
 	int digest_size;			/* Length of digest */
@@ -74,6 +99,26 @@ struct hash_algo {
 	 */
 	int (*hash_finish)(struct hash_algo *algo, void *ctx, void *dest_buf,
 			   int size);
+	/*
+	 * hash_submit: Start hashing a block without waiting for the result
+	 *
+	 * This is optional, for hardware which can work on several blocks
+	 * while the CPU does something else.
+	 *
+	 * @algo: Pointer to the hash_algo struct
+	 * @job: Block to hash; job->output must stay valid until hash_wait()
+	 * @return 0 if ok, -EBUSY if no more jobs can be started until one
+	 *   has been waited for, other -ve value on error
+	 */
+	int (*hash_submit)(struct hash_algo *algo, struct hash_job *job);
+	/*
+	 * hash_wait: Wait for a job started by hash_submit() to finish
+	 *
+	 * @algo: Pointer to the hash_algo struct
+	 * @job: Job to wait for
+	 * @return 0 if ok, -ve on error
+	 */
+	int (*hash_wait)(struct hash_algo *algo, struct hash_job *job);
 };
 
 #ifndef USE_HOSTCC
@@ -114,8 +159,33 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 int hash_block(const char *algo_name, const void *data, unsigned int len,
 	       uint8_t *output, int *output_size);
 
+/**
+ * hash_bench() - Measure the speed of each hash algorithm
+ *
+ * Each algorithm hashes the buffer repeatedly for a short while and the
+ * resulting speed is printed.
+ *
+ * @buf:		Data to hash
+ * @len:		Length of data in bytes
+ * @return 0 if ok, -EINTR if interrupted with Ctrl-C
+ */
+int hash_bench(const void *buf, ulong len);
+
 #endif /* !USE_HOSTCC */
 
+/**
+ * hash_block_multi() - Hash a number of blocks, overlapping where possible
+ *
+ * Jobs whose algorithm has hash_submit() are queued to the hardware, as
+ * many at a time as it accepts. Other jobs are hashed by the CPU while the
+ * hardware is busy. Each job's @ret is set to its result.
+ *
+ * @jobs:	Jobs to run, with @algo, @data, @len and @output filled in
+ * @count:	Number of jobs
+ * @return 0 if all jobs succeeded, else the error of the first that failed
+ */
+int hash_block_multi(struct hash_job *jobs, int count);
+
 /**
  * hash_lookup_algo() - Look up the hash_algo struct for an algorithm
  *
@@ -73,4 +73,22 @@ int hw_sha_update(struct hash_algo *algo, void *ctx, const void *buf,
 int hw_sha_finish(struct hash_algo *algo, void *ctx, void *dest_buf,
 		     int size);
 
+/*
+ * Start sha hashing of a block using h/w acceleration, without waiting
+ *
+ * @algo: Pointer to the hash_algo struct
+ * @job: Block to hash
+ * @return 0 if ok, -EBUSY if the hardware queue is full, other -ve on error
+ */
+int hw_sha_submit(struct hash_algo *algo, struct hash_job *job);
+
+/*
+ * Wait for a block started with hw_sha_submit() to finish hashing
+ *
+ * @algo: Pointer to the hash_algo struct
+ * @job: Block being hashed
+ * @return 0 if ok, -ve on error
+ */
+int hw_sha_wait(struct hash_algo *algo, struct hash_job *job);
+
 #endif
@@ -23,6 +23,28 @@ struct sparse_storage {
 	lbaint_t	(*reserve)(struct sparse_storage *info,
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
+
+	/* Report the result, like fastboot_okay() and fastboot_fail() */
+	void		(*okay)(const char *reason);
+	void		(*fail)(const char *reason);
+
+	/*
+	 * Optional: tell the device that blocks no longer hold anything
+	 * useful, so that it can erase them ahead of time. This is used for
+	 * DONT_CARE chunks, in whole groups of discard_grp blocks.
+	 */
+	int		(*discard)(struct sparse_storage *info,
+				   lbaint_t blk,
+				   lbaint_t blkcnt);
+	uint		discard_grp;
+
+	/*
+	 * If set, FILL chunks of erased_val are skipped like DONT_CARE
+	 * chunks, since blocks which are not written already hold that
+	 * (0xffffffff on NAND, for example)
+	 */
+	bool		skip_erased;
+	uint32_t	erased_val;
 };
 
 static inline int is_sparse_image(void *buf)
@@ -38,3 +60,43 @@ static inline int is_sparse_image(void *buf)
 
 void write_sparse_image(struct sparse_storage *info, const char *part_name,
 			void *data, unsigned sz);
+
+struct sparse_stream;
+
+/**
+ * sparse_stream_start() - Start writing an image which arrives in pieces
+ *
+ * The image is written as it arrives, so it need not all be in memory at
+ * once. A sparse image is unpacked; anything else is written as it is.
+ * Errors are reported through info->fail().
+ *
+ * @info:	Where to write the image, which must stay valid until
+ *		sparse_stream_end()
+ * @part_name:	Name of the partition, for messages
+ * @return stream, or NULL if out of memory
+ */
+struct sparse_stream *sparse_stream_start(struct sparse_storage *info,
+					  const char *part_name);
+
+/**
+ * sparse_stream_write() - Write the next piece of an image
+ *
+ * @ss:		Stream to write to
+ * @data:	Next part of the image, of any size
+ * @len:	Number of bytes at @data
+ * @return 0 if OK, -ve if this or an earlier piece failed
+ */
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			size_t len);
+
+/**
+ * sparse_stream_end() - Finish writing an image
+ *
+ * This writes anything still held back, checks that the whole image
+ * arrived and matches its checksum, then frees the stream. On success it
+ * calls info->okay().
+ *
+ * @ss:		Stream to finish
+ * @return 0 if OK, -ve on error
+ */
+int sparse_stream_end(struct sparse_stream *ss);
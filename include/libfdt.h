@@ -2089,4 +2089,47 @@ int fdt_next_region(const void *fdt,
 int fdt_add_alias_regions(const void *fdt, struct fdt_region *region, int count,
 			  int max_regions, struct fdt_region_state *info);
 
+/**********************************************************************/
+/* Lookup index                                                       */
+/**********************************************************************/
+
+/**
+ * fdt_index_size() - find the space needed to index a device tree
+ *
+ * @fdt:	Device tree to index
+ * @return number of bytes needed for the index as the tree stands, or -ve
+ * FDT_ERR_... on error. Allow extra space if nodes will be added.
+ */
+int fdt_index_size(const void *fdt);
+
+/**
+ * fdt_index_add() - index a device tree to speed up lookups
+ *
+ * Once added, finding nodes by path, phandle or compatible string, and
+ * finding the parent, children or siblings of a node, use the index rather
+ * than scanning the tree. The index follows changes made with libfdt
+ * functions, being rebuilt in the same buffer when nodes are added or
+ * removed. If the buffer becomes too small, lookups scan the tree.
+ *
+ * The tree must not be moved or changed in any other way until the index is
+ * removed with fdt_index_remove().
+ *
+ * @fdt:	Device tree to index
+ * @buf:	Buffer to hold the index, of at least fdt_index_size() bytes,
+ *		which must stay valid until the index is removed
+ * @bufsize:	Size of buffer in bytes
+ * @return 0 if OK, -FDT_ERR_EXISTS if the tree is already indexed,
+ * -FDT_ERR_NOSPACE if the buffer is too small, other -ve FDT_ERR_... on
+ * error
+ */
+int fdt_index_add(const void *fdt, void *buf, int bufsize);
+
+/**
+ * fdt_index_remove() - stop using the index for a device tree
+ *
+ * @fdt:	Device tree which was indexed
+ * @return buffer passed to fdt_index_add(), or NULL if not indexed
+ */
+void *fdt_index_remove(const void *fdt);
+
 #endif /* _LIBFDT_H */
@@ -909,6 +909,20 @@ void *realloc_simple(void *ptr, size_t size);
 /* Set up pre-relocation malloc() ready for use */
 int initf_malloc(void);
 
+struct slab_heap;
+
+/**
+ * malloc_slab_get() - Get the slab allocator used for small requests
+ *
+ * @early:	true for the one used before relocation. After relocation
+ *		this is a copy taken when malloc() was set up.
+ * @return slab heap, or NULL if there is none
+ */
+struct slab_heap *malloc_slab_get(bool early);
+
+/* Get the largest number of bytes dlmalloc has taken from its area */
+ulong malloc_get_peak(void);
+
 /* Public routines */
 
 /* Simple versions which can be used when space is tight */
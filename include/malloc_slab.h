@@ -0,0 +1,114 @@
+/*
+ * Size-class allocator for small malloc() requests
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __MALLOC_SLAB_H
+#define __MALLOC_SLAB_H
+
+/* Number of size classes, and the largest request they serve */
+#define SLAB_CLASSES		12
+#define SLAB_MAX_SIZE		256
+
+/* Bytes at the start of each page which say which class it belongs to */
+#define SLAB_PAGE_HDR		16
+
+/**
+ * struct slab_class - Objects of one size
+ *
+ * @free:	First free object, each holding a pointer to the next
+ * @pages:	Number of pages given to this class
+ * @in_use:	Number of objects allocated now
+ * @peak:	Largest number of objects allocated at once
+ * @allocs:	Number of requests served
+ * @frees:	Number of objects freed
+ * @misses:	Number of requests passed on because no page was free
+ */
+struct slab_class {
+	void *free;
+	uint pages;
+	uint in_use;
+	uint peak;
+	uint allocs;
+	uint frees;
+	uint misses;
+};
+
+/**
+ * struct slab_heap - An area of memory shared out between the size classes
+ *
+ * Pages are taken from the top of the area downwards as classes need them,
+ * and are never given back. An object's page is found by rounding its
+ * address down, so the header of that page gives the object's class.
+ *
+ * @base:	Lowest page in use; equal to @end if there are none
+ * @end:	End of the area, aligned to @page_size
+ * @limit:	Lowest address a page may use. The owner may move this up
+ *		to share the area with something growing from the bottom.
+ * @page_size:	Size of each page, a power of two
+ * @cls:	Size classes
+ */
+struct slab_heap {
+	ulong base;
+	ulong end;
+	ulong limit;
+	uint page_size;
+	struct slab_class cls[SLAB_CLASSES];
+};
+
+/**
+ * slab_init() - Set up a heap
+ *
+ * @heap:	Heap to set up
+ * @end:	End of the area, which is rounded down to @page_size
+ * @limit:	Start of the area
+ * @page_size:	Size of each page, a power of two
+ */
+void slab_init(struct slab_heap *heap, ulong end, ulong limit,
+	       uint page_size);
+
+/**
+ * slab_class_size() - Get the size of the objects in a class
+ *
+ * @cls:	Class number (0 to SLAB_CLASSES - 1)
+ * @return size in bytes
+ */
+uint slab_class_size(int cls);
+
+/**
+ * slab_alloc() - Allocate an object
+ *
+ * @heap:	Heap to allocate from
+ * @size:	Number of bytes needed
+ * @return object, or NULL if @size is more than SLAB_MAX_SIZE or there is
+ * no space
+ */
+void *slab_alloc(struct slab_heap *heap, size_t size);
+
+/**
+ * slab_size() - Check whether memory came from a heap
+ *
+ * @heap:	Heap to check
+ * @ptr:	Memory to check
+ * @return size of the object at @ptr, or 0 if it is not in @heap
+ */
+size_t slab_size(const struct slab_heap *heap, const void *ptr);
+
+/**
+ * slab_free() - Free an object
+ *
+ * @heap:	Heap which the object came from
+ * @ptr:	Object to free, for which slab_size() is non-zero
+ */
+void slab_free(struct slab_heap *heap, void *ptr);
+
+/**
+ * slab_used() - Get the number of bytes held in objects
+ *
+ * @heap:	Heap to check
+ * @return total size of the objects allocated now
+ */
+ulong slab_used(const struct slab_heap *heap);
+
+#endif /* __MALLOC_SLAB_H */
@@ -57,8 +57,10 @@
 #define MMC_MODE_8BIT		(1 << 3)
 #define MMC_MODE_SPI		(1 << 4)
 #define MMC_MODE_DDR_52MHz	(1 << 5)
+#define MMC_MODE_CMD23		(1 << 6)
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_CMD23_SUPPORT	0x00000002
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -436,6 +438,7 @@ struct mmc {
 #ifndef CONFIG_BLK
 	struct blk_desc block_dev;
 #endif
+	lbaint_t write_pending;	/* blocks written by mmc_bwrite_submit() */
 	char op_cond_pending;	/* 1 if we are waiting on an op_cond command */
 	char init_in_progress;	/* 1 if we have done mmc_start_init() */
 	char preinit;		/* start init as early as possible */
@@ -493,6 +496,34 @@ int mmc_unbind(struct udevice *dev);
 int mmc_initialize(bd_t *bis);
 int mmc_init(struct mmc *mmc);
 int mmc_read(struct mmc *mmc, u64 src, uchar *dst, int size);
+
+/**
+ * struct mmc_read_req - One read in a queue passed to mmc_bread_queue()
+ *
+ * @dst:	Buffer to read into
+ * @start:	First block to read
+ * @blkcnt:	Number of blocks to read
+ */
+struct mmc_read_req {
+	void *dst;
+	lbaint_t start;
+	lbaint_t blkcnt;
+};
+
+/**
+ * mmc_bread_queue() - Read several ranges of blocks, one after the other
+ *
+ * This is quicker than reading each range separately: the hardware partition
+ * and block length are set up once for the whole queue, and neighbouring
+ * ranges which also sit next to each other in memory are read with a single
+ * command. Reads complete in the order given, and stop at the first failure.
+ *
+ * @mmc:	MMC device to read from, using its current hardware partition
+ * @req:	Reads to do
+ * @count:	Number of reads in @req
+ * @return number of reads completed, which is less than @count on error
+ */
+int mmc_bread_queue(struct mmc *mmc, struct mmc_read_req *req, int count);
 void mmc_set_clock(struct mmc *mmc, uint clock);
 struct mmc *find_mmc_device(int dev_num);
 int mmc_set_dev(int dev_num);
@@ -0,0 +1,150 @@
+/*
+ * ADMA2 descriptor tables for SD/MMC host controllers
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __MMC_ADMA_H
+#define __MMC_ADMA_H
+
+#include <linux/compiler.h>
+
+/* Descriptor attributes */
+#define ADMA_DESC_VALID		(1 << 0)
+#define ADMA_DESC_END		(1 << 1)
+#define ADMA_DESC_INT		(1 << 2)
+#define ADMA_DESC_ACT_MASK	(3 << 4)
+#define ADMA_DESC_ACT_NOP	(0 << 4)
+#define ADMA_DESC_ACT_TRAN	(2 << 4)
+#define ADMA_DESC_ACT_LINK	(3 << 4)
+
+/* Data addresses must be aligned to this */
+#define ADMA_ALIGN		4
+
+/*
+ * Most data one descriptor transfers. The length field allows 64KiB, but this
+ * is kept a multiple of ADMA_ALIGN so the next descriptor stays aligned.
+ */
+#define ADMA_MAX_LEN		(0x10000 - ADMA_ALIGN)
+
+/**
+ * struct mmc_adma_desc - ADMA2 descriptor
+ *
+ * With CONFIG_MMC_ADMA2_64BIT this is the 128-bit form with a 64-bit address,
+ * otherwise the 64-bit form with a 32-bit address. All fields are little
+ * endian.
+ *
+ * @attr:	Attributes (ADMA_DESC_...)
+ * @len:	Number of bytes to transfer, with 0 meaning 64KiB
+ * @addr:	Address of the data, or of the next descriptor for a link
+ * @addr_hi:	Upper 32 bits of the address
+ * @reserved:	Must be zero
+ */
+struct mmc_adma_desc {
+	__le16 attr;
+	__le16 len;
+	__le32 addr;
+#ifdef CONFIG_MMC_ADMA2_64BIT
+	__le32 addr_hi;
+	__le32 reserved;
+#endif
+} __packed;
+
+/**
+ * struct mmc_adma_head - Start of a buffer which uses the bounce buffer
+ *
+ * @ptr:	Start of the buffer, or NULL if it is aligned
+ * @len:	Number of bytes held in the bounce buffer
+ */
+struct mmc_adma_head {
+	u8 *ptr;
+	uint len;
+};
+
+/**
+ * struct mmc_adma_table - A table of descriptors for one data transfer
+ *
+ * Where a buffer does not start on an ADMA_ALIGN boundary, its first few
+ * bytes go through a small aligned bounce buffer instead.
+ *
+ * @desc:	Descriptors
+ * @count:	Number of descriptors allocated
+ * @used:	Number of descriptors in use
+ * @read:	true if the transfer is from the card into memory
+ * @bounce:	Bounce buffer, ADMA_ALIGN bytes for each buffer
+ * @head:	Information about the start of each buffer
+ * @max_bufs:	Largest number of buffers in a transfer
+ * @bufs:	Number of buffers added
+ */
+struct mmc_adma_table {
+	struct mmc_adma_desc *desc;
+	uint count;
+	uint used;
+	bool read;
+	u8 *bounce;
+	struct mmc_adma_head *head;
+	uint max_bufs;
+	uint bufs;
+};
+
+/**
+ * mmc_adma_init() - Allocate a descriptor table
+ *
+ * @table:	Table to set up
+ * @max_len:	Largest number of bytes in a transfer
+ * @max_bufs:	Largest number of separate buffers in a transfer
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int mmc_adma_init(struct mmc_adma_table *table, ulong max_len, uint max_bufs);
+
+/**
+ * mmc_adma_free() - Free a descriptor table
+ *
+ * @table:	Table to free
+ */
+void mmc_adma_free(struct mmc_adma_table *table);
+
+/**
+ * mmc_adma_start() - Start filling in a descriptor table for a transfer
+ *
+ * @table:	Table to use
+ * @read:	true if the data is read from the card
+ */
+void mmc_adma_start(struct mmc_adma_table *table, bool read);
+
+/**
+ * mmc_adma_add() - Add a buffer to a transfer
+ *
+ * Buffers are transferred in the order they are added. For a write the data
+ * must not change until the transfer is complete.
+ *
+ * @table:	Table being filled in
+ * @buf:	Buffer to transfer to or from
+ * @len:	Number of bytes in the buffer
+ * @return 0 if OK, -ENOSPC if the table is full, -EINVAL if the buffer is
+ * beyond the reach of 32-bit descriptors
+ */
+int mmc_adma_add(struct mmc_adma_table *table, void *buf, ulong len);
+
+/**
+ * mmc_adma_finish() - Finish filling in a descriptor table
+ *
+ * This marks the last descriptor and flushes the table from the cache, so
+ * that it is ready to give to the controller.
+ *
+ * @table:	Table to finish
+ * @return 0 if OK, -EINVAL if there are no descriptors
+ */
+int mmc_adma_finish(struct mmc_adma_table *table);
+
+/**
+ * mmc_adma_complete() - Tidy up after a transfer
+ *
+ * For a read this copies any data which went through the bounce buffer into
+ * place. Buffers must be invalidated in the cache before calling this.
+ *
+ * @table:	Table used for the transfer
+ */
+void mmc_adma_complete(struct mmc_adma_table *table);
+
+#endif /* __MMC_ADMA_H */
@@ -107,6 +107,8 @@ int nand_read_skip_bad(struct mtd_info *mtd, loff_t offset, size_t *length,
 
 int nand_write_skip_bad(struct mtd_info *mtd, loff_t offset, size_t *length,
 			size_t *actual, loff_t lim, u_char *buffer, int flags);
+int check_skip_len(struct mtd_info *mtd, loff_t offset, size_t length,
+		   size_t *used);
 int nand_erase_opts(struct mtd_info *mtd,
 		    const nand_erase_options_t *opts);
 int nand_torture(struct mtd_info *mtd, loff_t offset);
@@ -112,10 +112,14 @@ enum eth_recv_flags {
  *	 packet buffer in the packetp parameter. If not, return an error or 0 to
  *	 indicate that the hardware receive FIFO is empty. If 0 is returned, the
  *	 network stack will not process the empty packet, but free_pkt() will be
- *	 called if supplied
+ *	 called if supplied. The buffer may be the driver's own DMA buffer,
+ *	 which is then lent to the stack without copying, or one from
+ *	 eth_rx_direct_buf()
  * free_pkt: Give the driver an opportunity to manage its packet buffer memory
- *	     when the network stack is finished processing it. This will only be
- *	     called when no error was returned from recv - optional
+ *	     when the network stack is finished processing it. A buffer lent by
+ *	     recv() is given back here, and may be reused for another packet.
+ *	     This will only be called when no error was returned from recv -
+ *	     optional
  * stop: Stop the hardware from looking for packets - may be called even if
  *	 state == PASSIVE
  * mcast: Join or leave a multicast group (for TFTP) - optional
@@ -156,6 +160,42 @@ unsigned char *eth_get_ethaddr(void); /* get the current device MAC */
 int eth_is_active(struct udevice *dev); /* Test device for active state */
 int eth_init_state_only(void); /* Set active state */
 void eth_halt_state_only(void); /* Set passive state */
+
+/* Largest number of header bytes for eth_rx_direct_set() */
+#define ETH_RX_DIRECT_MAX_HDR	64
+
+/**
+ * eth_rx_direct_set() - Say where the payload of the next packet belongs
+ *
+ * A protocol which knows where it will store the payload of the packet it
+ * expects next can call this, so that a driver able to choose where each
+ * packet is received can put that payload straight there. The protocol then
+ * finds its payload already in place and need not copy it. Any other packet
+ * is received as usual, or lands in the same place and is copied from there,
+ * so the memory at @dst must not yet hold anything of value.
+ *
+ * @dst:	Final location of the payload, or NULL if there is none
+ * @hdr_len:	Number of bytes before the payload, from the start of the
+ *		Ethernet header, at most ETH_RX_DIRECT_MAX_HDR
+ * @max_len:	Most bytes of payload expected
+ */
+void eth_rx_direct_set(void *dst, int hdr_len, int max_len);
+
+/**
+ * eth_rx_direct_buf() - Get a buffer to receive the next packet in place
+ *
+ * A driver may call this from recv() before receiving a packet. If a protocol
+ * has asked for its next payload in place, this returns a buffer laid out so
+ * that the payload of that packet lands at the right address. The bytes in
+ * front of the payload are saved, and put back once the packet has been
+ * processed. The buffer is not aligned in any particular way, and a packet
+ * larger than the buffer must be received elsewhere. If the driver uses it,
+ * it must return the packet in this buffer from recv().
+ *
+ * @sizep:	Returns the size of the buffer in bytes
+ * @return buffer, or NULL if no payload is expected in place
+ */
+uchar *eth_rx_direct_buf(int *sizep);
 #endif
 
 #ifndef CONFIG_DM_ETH
@@ -226,6 +266,10 @@ int eth_write_hwaddr(struct eth_device *dev, const char *base_name,
 		     int eth_number);
 
 int usb_eth_initialize(bd_t *bi);
+
+static inline void eth_rx_direct_set(void *dst, int hdr_len, int max_len)
+{
+}
 #endif
 
 int eth_initialize(void);		/* Initialize network subsystem */
@@ -535,6 +579,10 @@ extern char	net_boot_file_name[1024];/* Boot File name */
 extern u32	net_boot_file_size;
 /* Boot file size in blocks as reported by the DHCP server */
 extern u32	net_boot_file_expected_size_in_blocks;
+/* Number of received payloads copied to where they belong */
+extern ulong	net_rx_copied;
+/* Number of received payloads which were already in place */
+extern ulong	net_rx_in_place;
 
 #if defined(CONFIG_CMD_DNS)
 extern char *net_dns_resolve;		/* The host to resolve  */
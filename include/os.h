@@ -75,6 +75,7 @@ int os_open(const char *pathname, int flags);
 #define OS_O_RDWR	2
 #define OS_O_MASK	3	/* Mask for read/write flags */
 #define OS_O_CREAT	0100
+#define OS_O_TRUNC	01000
 
 /**
  * Access to the OS close() system call
@@ -92,6 +93,15 @@ int os_close(int fd);
  */
 int os_unlink(const char *pathname);
 
+/**
+ * Create a new file with a unique name, open for reading and writing
+ *
+ * \param fname	Template ending in XXXXXX, such as "/tmp/u-boot.XXXXXX",
+ *			which is updated with the name of the file
+ * \return file descriptor, or -ve on error
+ */
+int os_mktemp(char *fname);
+
 /**
  * Access to the OS exit() system call
  *
@@ -170,6 +180,36 @@ void os_usleep(unsigned long usec);
  */
 uint64_t os_get_nsec(void);
 
+/**
+ * os_cpu_start() - Start host threads to act as secondary CPUs
+ *
+ * Each thread calls @func with its CPU number, starting at 1, and exits
+ * when it returns.
+ *
+ * @count:	Number of threads to start
+ * @func:	Function for each thread to run
+ * @return number of threads started, or -EBUSY if some are still running
+ */
+int os_cpu_start(int count, void (*func)(int cpu));
+
+/** os_cpu_stop() - Wait for the threads from os_cpu_start() to exit */
+void os_cpu_stop(void);
+
+/**
+ * os_cpu_send_event() - Wake up all threads in os_cpu_wait_event()
+ *
+ * Like the ARM 'sev' instruction, this also stops the next
+ * os_cpu_wait_event() on each thread from waiting.
+ */
+void os_cpu_send_event(void);
+
+/**
+ * os_cpu_wait_event() - Wait for os_cpu_send_event()
+ *
+ * @seen:	Per-thread count of events already seen, updated on return
+ */
+void os_cpu_wait_event(unsigned long *seen);
+
 /**
  * Parse arguments and update sandbox state.
  *
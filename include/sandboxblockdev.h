@@ -7,12 +7,24 @@
 #ifndef __SANDBOX_BLOCK_DEV__
 #define __SANDBOX_BLOCK_DEV__
 
+#include <smp_work.h>
+
 struct host_block_dev {
 #ifndef CONFIG_BLK
 	struct blk_desc blk_dev;
 #endif
 	char *filename;
 	int fd;
+	ulong reads;	/* Number of reads from the device, for tests */
+#ifdef CONFIG_BLK
+	/* Write started by write_submit() */
+	struct smp_work work;
+	lbaint_t wr_start;
+	lbaint_t wr_blkcnt;
+	ulong wr_blksz;
+	const void *wr_buf;
+	long written;
+#endif
 };
 
 int host_dev_bind(int dev, char *filename);
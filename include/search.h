@@ -62,6 +62,11 @@ struct hsearch_data {
  */
 	int (*change_ok)(const ENTRY *__item, const char *newval, enum env_op,
 		int flag);
+/* Incremented on every change, so callers can tell if anything changed */
+	unsigned int changes;
+/* Entries sorted by key for hexport_r(), or NULL if keys have changed */
+	ENTRY **sorted;
+	unsigned int nsorted;
 };
 
 /* Create a new hashing table which will at most contain NEL elements.  */
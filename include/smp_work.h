@@ -0,0 +1,160 @@
+/*
+ * Run independent jobs on the secondary CPUs
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __SMP_WORK_H
+#define __SMP_WORK_H
+
+#ifdef USE_HOSTCC
+#include <string.h>
+#else
+#include <linux/string.h>
+#endif
+
+/**
+ * struct smp_work - A job which may be run on any CPU
+ *
+ * Jobs run alongside U-Boot on the boot CPU, so they may only work on
+ * memory: they must not use the console, malloc(), global state or drivers.
+ *
+ * @func:	Function to run, returning 0 if OK or -ve on error
+ * @arg:	Argument to pass to @func
+ * @ret:	Value returned by @func, valid once smp_work_wait() returns
+ */
+struct smp_work {
+	int (*func)(void *arg);
+	void *arg;
+	int ret;
+};
+
+#if defined(CONFIG_SMP_WORK) && !defined(CONFIG_SPL_BUILD) && \
+	!defined(USE_HOSTCC)
+/**
+ * smp_work_cpus() - Get the number of CPUs which run jobs
+ *
+ * This starts the secondary CPUs on first use.
+ *
+ * @return number of CPUs, including the boot CPU
+ */
+int smp_work_cpus(void);
+
+/**
+ * smp_work_queue() - Queue a job to run on any CPU
+ *
+ * If there are no secondary CPUs the job is run immediately.
+ *
+ * @work:	Job to run, which must stay valid until smp_work_wait()
+ */
+void smp_work_queue(struct smp_work *work);
+
+/**
+ * smp_work_wait() - Wait for all queued jobs to finish
+ *
+ * The boot CPU runs any jobs which have not been started yet, resetting the
+ * watchdog between them and while it waits for the other CPUs.
+ */
+void smp_work_wait(void);
+
+/**
+ * smp_work_stop() - Wait for all jobs and park the secondary CPUs
+ *
+ * This must be called before booting an OS, so that the secondary CPUs are
+ * back where the OS expects them. It is called by bootm, go, bootefi, reset
+ * and the ARMv8 cleanup_before_linux(). The CPUs are started again if more
+ * jobs are queued.
+ */
+void smp_work_stop(void);
+
+/**
+ * smp_memcpy() - Copy memory using all CPUs
+ *
+ * Overlapping areas are copied by the boot CPU with memmove().
+ *
+ * @dst:	Destination
+ * @src:	Source
+ * @len:	Number of bytes to copy
+ */
+void smp_memcpy(void *dst, const void *src, size_t len);
+
+/**
+ * smp_memset() - Fill memory using all CPUs
+ *
+ * @s:		Memory to fill
+ * @c:		Byte value to fill with
+ * @len:	Number of bytes to fill
+ */
+void smp_memset(void *s, int c, size_t len);
+
+/**
+ * smp_work_run() - Run jobs on a secondary CPU until told to stop
+ *
+ * This is called on each secondary CPU started by smp_work_arch_start().
+ *
+ * @cpu:	CPU number chosen by the architecture, not 0
+ */
+void smp_work_run(int cpu);
+
+/*
+ * The architecture provides the following. Without them, jobs all run on
+ * the boot CPU.
+ */
+
+/**
+ * smp_work_arch_start() - Start the secondary CPUs running smp_work_run()
+ *
+ * @return number of secondary CPUs started, or -ve on error
+ */
+int smp_work_arch_start(void);
+
+/**
+ * smp_work_arch_stop() - Wait for the secondary CPUs to leave smp_work_run()
+ *
+ * On return they are parked as they were before smp_work_arch_start().
+ */
+void smp_work_arch_stop(void);
+
+/** smp_work_arch_kick() - Wake any secondary CPUs in smp_work_arch_idle() */
+void smp_work_arch_kick(void);
+
+/**
+ * smp_work_arch_idle() - Wait on a secondary CPU for smp_work_arch_kick()
+ *
+ * This may return early, but must not miss a kick which happens after the
+ * previous call returned.
+ *
+ * @cpu:	CPU number passed to smp_work_run()
+ */
+void smp_work_arch_idle(int cpu);
+#else
+static inline int smp_work_cpus(void)
+{
+	return 1;
+}
+
+static inline void smp_work_queue(struct smp_work *work)
+{
+	work->ret = work->func(work->arg);
+}
+
+static inline void smp_work_wait(void)
+{
+}
+
+static inline void smp_work_stop(void)
+{
+}
+
+static inline void smp_memcpy(void *dst, const void *src, size_t len)
+{
+	memmove(dst, src, len);
+}
+
+static inline void smp_memset(void *s, int c, size_t len)
+{
+	memset(s, c, len);
+}
+#endif
+
+#endif /* __SMP_WORK_H */
@@ -41,6 +41,7 @@ struct spi_slave;
  * @page_size:		Write (page) size
  * @sector_size:	Sector size
  * @erase_size:		Erase size
+ * @block_size:		Size erased by CMD_ERASE_64K, 0 if not supported
  * @bank_read_cmd:	Bank read cmd
  * @bank_write_cmd:	Bank write cmd
  * @bank_curr:		Current flash bank
@@ -74,6 +75,7 @@ struct spi_flash {
 	u32 page_size;
 	u32 sector_size;
 	u32 erase_size;
+	u32 block_size;
 #ifdef CONFIG_SPI_FLASH_BAR
 	u8 bank_read_cmd;
 	u8 bank_write_cmd;
@@ -228,6 +230,40 @@ static inline int spi_flash_erase(struct spi_flash *flash, u32 offset,
 }
 #endif
 
+/**
+ * struct spi_flash_update_stats - What spi_flash_smart_update() did
+ *
+ * @skipped:	Number of bytes which already held the new data
+ * @erased:	Number of bytes erased
+ * @written:	Number of bytes programmed
+ */
+struct spi_flash_update_stats {
+	size_t skipped;
+	size_t erased;
+	size_t written;
+};
+
+/**
+ * spi_flash_smart_update() - Write data, changing only what differs
+ *
+ * The flash is read back in large chunks and compared with the new data.
+ * Sectors which already hold the new data are left alone, blank sectors
+ * are programmed without erasing them, and other sectors are erased, using
+ * block erase where a whole block needs it. Pages which would be programmed
+ * with 0xff are skipped. Data outside the area being written is preserved,
+ * so @offset and @len need not be aligned.
+ *
+ * @flash:	Flash to update
+ * @offset:	Offset into flash in bytes to write to
+ * @len:	Number of bytes to write
+ * @buf:	Buffer containing bytes to write
+ * @stats:	Statistics, which are added to (not cleared) by this function
+ * @return 0 if OK, -ve on error
+ */
+int spi_flash_smart_update(struct spi_flash *flash, u32 offset, size_t len,
+			   const void *buf,
+			   struct spi_flash_update_stats *stats);
+
 static inline int spi_flash_protect(struct spi_flash *flash, u32 ofs, u32 len,
 					bool prot)
 {
@@ -8,9 +8,19 @@
 #ifndef __TEST_SUITES_H__
 #define __TEST_SUITES_H__
 
+int do_ut_arena(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
+int do_ut_bootstage(cmd_tbl_t *cmdtp, int flag, int argc,
+		    char * const argv[]);
 int do_ut_dm(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
 int do_ut_env(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
+int do_ut_ext4(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
+int do_ut_fdt_index(cmd_tbl_t *cmdtp, int flag, int argc,
+		    char * const argv[]);
 int do_ut_overlay(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
+int do_ut_slab(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
+int do_ut_smp_work(cmd_tbl_t *cmdtp, int flag, int argc,
+		   char * const argv[]);
+int do_ut_sparse(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
 int do_ut_time(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
 
 #endif /* __TEST_SUITES_H__ */
@@ -14,6 +14,28 @@ uint32_t crc32 (uint32_t, const unsigned char *, uint);
 uint32_t crc32_wd (uint32_t, const unsigned char *, uint, uint);
 uint32_t crc32_no_comp (uint32_t, const unsigned char *, uint);
 
+/**
+ * crc32_combine() - Get the CRC32 of two pieces of data joined together
+ *
+ * @crc1:	CRC32 of the first piece
+ * @crc2:	CRC32 of the second piece
+ * @len2:	Length of the second piece in bytes
+ * @return CRC32 of the first piece followed by the second
+ */
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+/**
+ * crc32_zeros() - Continue a CRC32 over a run of zero bytes
+ *
+ * This is the same as crc32() on a buffer of zeros, but takes time in
+ * proportion to the log of the length.
+ *
+ * @crc:	CRC32 so far
+ * @len:	Number of zero bytes
+ * @return CRC32 including the zero bytes
+ */
+uint32_t crc32_zeros(uint32_t crc, uint64_t len);
+
 /**
  * crc32_wd_buf - Perform CRC32 on a buffer and return result in buffer
  *
@@ -19,4 +19,8 @@ void sha256_finish(sha256_context * ctx, uint8_t digest[SHA256_SUM_LEN]);
 void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
+/* Hash whole blocks with the ARMv8 SHA2 instructions, see sha256_ce.S */
+void sha256_ce_transform(uint32_t state[8], const uint8_t *data,
+			 uint32_t blocks);
+
 #endif /* _SHA256_H */
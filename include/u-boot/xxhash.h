@@ -0,0 +1,24 @@
+/*
+ * xxHash - fast non-cryptographic hash
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _UBOOT_XXHASH_H
+#define _UBOOT_XXHASH_H
+
+#include <linux/types.h>
+
+/**
+ * xxh32() - Calculate the 32-bit xxHash of a buffer
+ *
+ * This is the checksum used by the LZ4 frame format.
+ *
+ * @input:	Data to hash
+ * @len:	Number of bytes of data
+ * @seed:	Starting value, normally 0
+ * @return hash value
+ */
+u32 xxh32(const void *input, size_t len, u32 seed);
+
+#endif /* _UBOOT_XXHASH_H */
@@ -187,6 +187,53 @@ int submit_control_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 int submit_int_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 			int transfer_len, int interval);
 
+/* Most segments which can be passed to submit_bulk_chain() */
+#define USB_MAX_BULK_SEGS	4
+
+/**
+ * struct usb_bulk_seg - One part of a chain of bulk transfers
+ *
+ * @buffer:	Buffer to send from or receive into
+ * @length:	Number of bytes in @buffer
+ * @act_len:	Number of bytes actually transferred, set on completion
+ */
+struct usb_bulk_seg {
+	void *buffer;
+	int length;
+	int act_len;
+};
+
+/**
+ * submit_bulk_chain() - Queue a chain of bulk transfers on one endpoint
+ *
+ * All the segments are handed to the controller at once, so that it can move
+ * from one to the next without waiting for software. A segment which ends
+ * with a short packet does not stop the chain: the controller carries on with
+ * the next one. This suits a mass-storage data stage followed by its status,
+ * for example.
+ *
+ * dev->status is set as for submit_bulk_msg() and dev->act_len to the total
+ * number of bytes transferred.
+ *
+ * @dev:	Device to transfer with
+ * @pipe:	Bulk pipe to use
+ * @seg:	Segments to transfer, in order
+ * @count:	Number of segments, at most USB_MAX_BULK_SEGS
+ * @return 0 if the chain was processed, -ENOSYS if the controller cannot
+ * chain transfers, other -ve on error
+ */
+int submit_bulk_chain(struct usb_device *dev, unsigned long pipe,
+		      struct usb_bulk_seg *seg, int count);
+
+/**
+ * usb_get_max_xfer_size() - Get the largest bulk transfer a device can make
+ *
+ * @dev:	Device to check
+ * @size:	Returns the maximum number of bytes in one bulk transfer
+ * @return 0 if OK, -ENOSYS if the controller does not say
+ */
+int usb_get_max_xfer_size(struct usb_device *dev, size_t *size);
+
 #if defined CONFIG_USB_EHCI || defined CONFIG_USB_MUSB_HOST || defined(CONFIG_DM_USB)
 struct int_queue *create_int_queue(struct usb_device *dev, unsigned long pipe,
 	int queuesize, int elementsize, void *buffer, int interval);
@@ -261,6 +308,8 @@ int usb_control_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, unsigned short size, int timeout);
 int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, int len, int *actual_length, int timeout);
+int usb_bulk_msg_chain(struct usb_device *dev, unsigned int pipe,
+		       struct usb_bulk_seg *seg, int count, int timeout);
 int usb_submit_int_msg(struct usb_device *dev, unsigned long pipe,
 			void *buffer, int transfer_len, int interval);
 int usb_disable_asynch(int disable);
@@ -716,6 +765,28 @@ struct dm_usb_ops {
 	int (*destroy_int_queue)(struct udevice *bus, struct usb_device *udev,
 				 struct int_queue *queue);
 
+	/**
+	 * bulk_chain() - Send a chain of bulk messages
+	 *
+	 * This is optional. See submit_bulk_chain() for details.
+	 *
+	 * @seg:	Segments to transfer
+	 * @count:	Number of segments
+	 */
+	int (*bulk_chain)(struct udevice *bus, struct usb_device *udev,
+			  unsigned long pipe, struct usb_bulk_seg *seg,
+			  int count);
+
+	/**
+	 * get_max_xfer_size() - Get the largest bulk transfer supported
+	 *
+	 * This is optional. If not provided, callers use a conservative size.
+	 *
+	 * @size:	Returns the maximum number of bytes in a bulk transfer
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*get_max_xfer_size)(struct udevice *bus, size_t *size);
+
 	/**
 	 * alloc_device() - Allocate a new device context (XHCI)
 	 *
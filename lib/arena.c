@@ -0,0 +1,150 @@
+/*
+ * Scoped arena allocator
+ *
+ * Code which makes many small allocations for one operation, such as a
+ * filesystem looking up a path, can take them from an arena. Each is a
+ * pointer bump, and everything goes back in one go at the end however the
+ * operation finished, so error paths cannot leak.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <arena.h>
+#include <malloc.h>
+
+/**
+ * struct arena_chunk - A block of memory in an arena
+ *
+ * @next:	Next older chunk
+ * @end:	End of the chunk
+ * @ptr:	Start of the free part of the chunk
+ * @first:	Start of the first allocation in the chunk
+ */
+struct arena_chunk {
+	struct arena_chunk *next;
+	ulong end;
+	ulong ptr;
+	ulong first;
+};
+
+static struct arena *arena_cur;
+
+void arena_begin(struct arena *arena)
+{
+	memset(arena, '\0', sizeof(*arena));
+	arena->prev = arena_cur;
+	arena->active = true;
+	arena_cur = arena;
+}
+
+static struct arena_chunk *arena_add_chunk(struct arena *arena, size_t align,
+					   size_t size)
+{
+	struct arena_chunk *chunk;
+	ulong len;
+
+	len = max((ulong)CONFIG_ARENA_CHUNK_SIZE,
+		  sizeof(*chunk) + align + size);
+	chunk = malloc(len);
+	if (!chunk)
+		return NULL;
+	chunk->next = arena->chunk;
+	chunk->end = (ulong)chunk + len;
+	chunk->ptr = (ulong)(chunk + 1);
+	chunk->first = ALIGN(chunk->ptr, align);
+	arena->chunk = chunk;
+	arena->held += len;
+
+	return chunk;
+}
+
+void *arena_memalign(size_t align, size_t size)
+{
+	struct arena *arena = arena_cur;
+	struct arena_chunk *chunk;
+	ulong ptr = 0;
+
+	if (!arena)
+		return memalign(align, size);
+
+	align = max(align, (size_t)ARENA_ALIGN);
+	chunk = arena->chunk;
+	if (chunk)
+		ptr = ALIGN(chunk->ptr, align);
+	if (!chunk || ptr > chunk->end || chunk->end - ptr < size) {
+		chunk = arena_add_chunk(arena, align, size);
+		if (!chunk)
+			return NULL;
+		ptr = ALIGN(chunk->ptr, align);
+	}
+	if (arena->nmarks == ARENA_MARKS) {
+		memmove(arena->marks, arena->marks + 1,
+			sizeof(arena->marks) - sizeof(arena->marks[0]));
+		arena->nmarks--;
+	}
+	arena->marks[arena->nmarks++] = ptr;
+	chunk->ptr = ptr + size;
+	arena->allocs++;
+
+	return (void *)ptr;
+}
+
+void *arena_zalloc(size_t size)
+{
+	void *ptr = arena_alloc(size);
+
+	if (ptr)
+		memset(ptr, '\0', size);
+
+	return ptr;
+}
+
+void arena_free(void *ptr)
+{
+	struct arena_chunk *chunk;
+	struct arena *arena;
+	ulong addr = (ulong)ptr;
+
+	if (!ptr)
+		return;
+	for (arena = arena_cur; arena; arena = arena->prev) {
+		for (chunk = arena->chunk; chunk; chunk = chunk->next) {
+			if (addr <= (ulong)chunk || addr >= chunk->end)
+				continue;
+			if (!arena->nmarks ||
+			    arena->marks[arena->nmarks - 1] != addr)
+				return;
+			arena->nmarks--;
+			chunk->ptr = addr;
+
+			/* Give back a chunk which was only needed briefly */
+			if (addr == chunk->first && chunk == arena->chunk &&
+			    chunk->next) {
+				arena->chunk = chunk->next;
+				arena->held -= chunk->end - (ulong)chunk;
+				free(chunk);
+			}
+			return;
+		}
+	}
+	free(ptr);
+}
+
+void arena_release(struct arena *arena)
+{
+	struct arena_chunk *chunk, *next;
+
+	if (!arena->active)
+		return;
+	debug("%s: %u allocations in %lu bytes\n", __func__, arena->allocs,
+	      arena->held);
+	for (chunk = arena->chunk; chunk; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+	arena->chunk = NULL;
+	arena->active = false;
+	if (arena_cur == arena)
+		arena_cur = arena->prev;
+}
@@ -6,6 +6,7 @@
  */
 
 #include <common.h>
+#include <blk.h>
 #include <watchdog.h>
 #include <command.h>
 #include <console.h>
@@ -13,6 +14,7 @@
 #include <malloc.h>
 #include <u-boot/zlib.h>
 #include <div64.h>
+#include <errno.h>
 
 #define HEADER0			'\x1f'
 #define HEADER1			'\x8b'
@@ -104,6 +106,44 @@ void gzwrite_progress_finish(int returnval,
 	}
 }
 
+/*
+ * Write @blkcnt blocks from @buf at @blk. If the device can, the write is
+ * left running and *@pending set to @blkcnt, to be waited for with
+ * gzwrite_wait().
+ */
+static int gzwrite_submit(struct blk_desc *dev, lbaint_t blk,
+			  lbaint_t blkcnt, const void *buf, lbaint_t *pending)
+{
+	ulong blocks_written;
+	int ret;
+
+	ret = blk_dwrite_submit(dev, blk, blkcnt, buf);
+	if (!ret) {
+		*pending = blkcnt;
+		return 0;
+	} else if (ret != -ENOSYS) {
+		return ret;
+	}
+
+	blocks_written = blk_dwrite(dev, blk, blkcnt, buf);
+
+	return blocks_written == blkcnt ? 0 : -EIO;
+}
+
+/* Wait for a write left running by gzwrite_submit(), if any */
+static int gzwrite_wait(struct blk_desc *dev, lbaint_t *pending)
+{
+	ulong blocks_written;
+	lbaint_t blkcnt = *pending;
+
+	if (!blkcnt)
+		return 0;
+	*pending = 0;
+	blocks_written = blk_dwrite_wait(dev);
+
+	return blocks_written == blkcnt ? 0 : -EIO;
+}
+
 int gzwrite(unsigned char *src, int len,
 	    struct blk_desc *dev,
 	    unsigned long szwritebuf,
@@ -113,10 +153,12 @@ int gzwrite(unsigned char *src, int len,
 	int i, flags;
 	z_stream s;
 	int r = 0;
-	unsigned char *writebuf;
+	unsigned char *writebuf[2];
+	int cur = 0;
 	unsigned crc = 0;
 	u64 totalfilled = 0;
 	lbaint_t blksperbuf, outblock;
+	lbaint_t pending = 0;
 	u32 expected_crc;
 	u32 payload_size;
 	int iteration = 0;
@@ -180,6 +222,19 @@ int gzwrite(unsigned char *src, int len,
 		return -1;
 	}
 
+	/*
+	 * One buffer is inflated while the other is written, if the device
+	 * can write without waiting
+	 */
+	writebuf[0] = malloc(szwritebuf);
+	writebuf[1] = malloc(szwritebuf);
+	if (!writebuf[0] || !writebuf[1]) {
+		puts("Error: out of memory\n");
+		free(writebuf[0]);
+		free(writebuf[1]);
+		return -1;
+	}
+
 	gzwrite_progress_init(szexpected);
 
 	s.zalloc = gzalloc;
@@ -188,12 +243,13 @@ int gzwrite(unsigned char *src, int len,
 	r = inflateInit2(&s, -MAX_WBITS);
 	if (r != Z_OK) {
 		printf("Error: inflateInit2() returned %d\n", r);
+		free(writebuf[0]);
+		free(writebuf[1]);
 		return -1;
 	}
 
 	s.next_in = src + i;
 	s.avail_in = payload_size+8;
-	writebuf = (unsigned char *)malloc(szwritebuf);
 
 	/* decompress until deflate stream ends or end of file */
 	do {
@@ -205,12 +261,11 @@ int gzwrite(unsigned char *src, int len,
 
 		/* run inflate() on input until output buffer not full */
 		do {
-			unsigned long blocks_written;
 			int numfilled;
 			lbaint_t writeblocks;
 
 			s.avail_out = szwritebuf;
-			s.next_out = writebuf;
+			s.next_out = writebuf[cur];
 			r = inflate(&s, Z_SYNC_FLUSH);
 			if ((r != Z_OK) &&
 			    (r != Z_STREAM_END)) {
@@ -218,25 +273,40 @@ int gzwrite(unsigned char *src, int len,
 				goto out;
 			}
 			numfilled = szwritebuf - s.avail_out;
-			crc = crc32(crc, writebuf, numfilled);
-			totalfilled += numfilled;
+			crc = crc32(crc, writebuf[cur], numfilled);
 			if (numfilled < szwritebuf) {
 				writeblocks = (numfilled+dev->blksz-1)
 						/ dev->blksz;
-				memset(writebuf+numfilled, 0,
+				memset(writebuf[cur]+numfilled, 0,
 				       dev->blksz-(numfilled%dev->blksz));
 			} else {
 				writeblocks = blksperbuf;
 			}
 
+			/* The previous buffer must be written before this */
+			if (gzwrite_wait(dev, &pending)) {
+				printf("%s: write failed\n", __func__);
+				r = -1;
+				goto out;
+			}
 			gzwrite_progress(iteration++,
 					 totalfilled,
 					 szexpected);
-			blocks_written = blk_dwrite(dev, outblock,
-						    writeblocks, writebuf);
-			outblock += blocks_written;
+
+			if (writeblocks &&
+			    gzwrite_submit(dev, outblock, writeblocks,
+					   writebuf[cur], &pending)) {
+				printf("%s: write failed at block " LBAFU "\n",
+				       __func__, outblock);
+				r = -1;
+				goto out;
+			}
+			outblock += writeblocks;
+			totalfilled += numfilled;
+			cur = !cur;
 			if (ctrlc()) {
 				puts("abort\n");
+				r = -1;
 				goto out;
 			}
 			WATCHDOG_RESET();
@@ -244,16 +314,23 @@ int gzwrite(unsigned char *src, int len,
 		/* done when inflate() says it's done */
 	} while (r != Z_STREAM_END);
 
-	if ((szexpected != totalfilled) ||
-	    (crc != expected_crc))
+	if (gzwrite_wait(dev, &pending)) {
+		printf("%s: write failed\n", __func__);
+		r = -1;
+	} else if ((szexpected != totalfilled) ||
+	    (crc != expected_crc)) {
 		r = -1;
-	else
+	} else {
 		r = 0;
+	}
 
 out:
+	/* The buffers must not be freed while a write is using them */
+	gzwrite_wait(dev, &pending);
 	gzwrite_progress_finish(r, totalfilled, szexpected,
 				expected_crc, crc);
-	free(writebuf);
+	free(writebuf[0]);
+	free(writebuf[1]);
 	inflateEnd(&s);
 
 	return r;
@@ -296,3 +373,70 @@ int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 
 	return err;
 }
+
+struct gunzip_stream {
+	z_stream s;
+	int done;
+};
+
+void *gunzip_stream_start(void *dst, unsigned long dstlen)
+{
+	struct gunzip_stream *gs;
+	int r;
+
+	gs = calloc(1, sizeof(*gs));
+	if (!gs)
+		return NULL;
+	gs->s.zalloc = gzalloc;
+	gs->s.zfree = gzfree;
+
+	/* Let zlib parse the gzip header and check the trailer itself */
+	r = inflateInit2(&gs->s, 16 + MAX_WBITS);
+	if (r != Z_OK) {
+		printf("Error: inflateInit2() returned %d\n", r);
+		free(gs);
+		return NULL;
+	}
+	gs->s.next_out = dst;
+	gs->s.avail_out = dstlen;
+
+	return gs;
+}
+
+int gunzip_stream_write(void *stream, const void *src, unsigned long srclen)
+{
+	struct gunzip_stream *gs = stream;
+	int r;
+
+	if (gs->done)
+		return 1;
+	gs->s.next_in = (unsigned char *)src;
+	gs->s.avail_in = srclen;
+	while (gs->s.avail_in) {
+		r = inflate(&gs->s, Z_NO_FLUSH);
+		if (r == Z_STREAM_END) {
+			gs->done = 1;
+			return 1;
+		}
+		if (r == Z_BUF_ERROR && !gs->s.avail_out)
+			return -ENOSPC;
+		if (r != Z_OK) {
+			printf("Error: inflate() returned %d\n", r);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int gunzip_stream_end(void *stream, unsigned long *lenp)
+{
+	struct gunzip_stream *gs = stream;
+	int done = gs->done;
+
+	*lenp = gs->s.total_out;
+	inflateEnd(&gs->s);
+	free(gs);
+
+	return done ? 0 : -EINVAL;
+}
@@ -66,6 +66,16 @@ typedef struct _ENTRY {
 static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 	int idx);
 
+/*
+ * Drop the list of entries sorted by key, which hexport_r() keeps so that it
+ * need not sort them again while the set of keys is unchanged
+ */
+static void hsort_invalidate(struct hsearch_data *htab)
+{
+	free(htab->sorted);
+	htab->sorted = NULL;
+}
+
 /*
  * hcreate()
  */
@@ -156,6 +166,8 @@ void hdestroy_r(struct hsearch_data *htab)
 		}
 	}
 	free(htab->table);
+	hsort_invalidate(htab);
+	htab->changes++;
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
@@ -259,6 +271,7 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 				*retval = NULL;
 				return 0;
 			}
+			htab->changes++;
 		}
 		/* return found entry */
 		*retval = &htab->table[idx].entry;
@@ -375,6 +388,8 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		}
 
 		++htab->filled;
+		hsort_invalidate(htab);
+		htab->changes++;
 
 		/* This is a new entry, so look up a possible callback */
 		env_callback_init(&htab->table[idx].entry);
@@ -437,6 +452,8 @@ static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 	htab->table[idx].used = -1;
 
 	--htab->filled;
+	hsort_invalidate(htab);
+	htab->changes++;
 }
 
 int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
@@ -528,6 +545,37 @@ static int cmpkey(const void *p1, const void *p2)
 	return (strcmp(e1->key, e2->key));
 }
 
+/*
+ * Fill list[] with all entries sorted by key, and return how many there are.
+ * The sorted list is kept until an entry is added or deleted, so that
+ * exporting an environment whose values alone have changed (for example by
+ * "saveenv" after a script has updated a few variables) needs no sort.
+ */
+static int hsort_entries(struct hsearch_data *htab, ENTRY **list)
+{
+	int i, n;
+
+	if (htab->sorted) {
+		memcpy(list, htab->sorted, htab->nsorted * sizeof(ENTRY *));
+		return htab->nsorted;
+	}
+
+	for (i = 1, n = 0; i <= htab->size; ++i) {
+		if (htab->table[i].used > 0)
+			list[n++] = &htab->table[i].entry;
+	}
+	qsort(list, n, sizeof(ENTRY *), cmpkey);
+
+	/* If there is no memory for a copy, sort again next time */
+	htab->sorted = malloc(n * sizeof(ENTRY *) + 1);
+	if (htab->sorted) {
+		memcpy(htab->sorted, list, n * sizeof(ENTRY *));
+		htab->nsorted = n;
+	}
+
+	return n;
+}
+
 static int match_string(int flag, const char *str, const char *pat, void *priv)
 {
 	switch (flag & H_MATCH_METHOD) {
@@ -594,7 +642,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 	ENTRY *list[htab->size];
 	char *res, *p;
 	size_t totlen;
-	int i, n;
+	int i, n, count;
 
 	/* Test for correct arguments.  */
 	if ((resp == NULL) || (htab == NULL)) {
@@ -606,54 +654,49 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 	      htab, htab->size, htab->filled, (ulong)size);
 	/*
 	 * Pass 1:
-	 * search used entries,
-	 * save addresses and compute total length
+	 * get used entries sorted by key, keep the matching ones
+	 * and compute total length
 	 */
-	for (i = 1, n = 0, totlen = 0; i <= htab->size; ++i) {
-
-		if (htab->table[i].used > 0) {
-			ENTRY *ep = &htab->table[i].entry;
-			int found = match_entry(ep, flag, argc, argv);
+	count = hsort_entries(htab, list);
+	for (i = 0, n = 0, totlen = 0; i < count; ++i) {
+		ENTRY *ep = list[i];
+		int found = match_entry(ep, flag, argc, argv);
 
-			if ((argc > 0) && (found == 0))
-				continue;
+		if ((argc > 0) && (found == 0))
+			continue;
 
-			if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
-				continue;
+		if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
+			continue;
 
-			list[n++] = ep;
+		list[n++] = ep;
 
-			totlen += strlen(ep->key) + 2;
+		totlen += strlen(ep->key) + 2;
 
-			if (sep == '\0') {
-				totlen += strlen(ep->data);
-			} else {	/* check if escapes are needed */
-				char *s = ep->data;
+		if (sep == '\0') {
+			totlen += strlen(ep->data);
+		} else {	/* check if escapes are needed */
+			char *s = ep->data;
 
-				while (*s) {
+			while (*s) {
+				++totlen;
+				/* add room for needed escape chars */
+				if ((*s == sep) || (*s == '\\'))
 					++totlen;
-					/* add room for needed escape chars */
-					if ((*s == sep) || (*s == '\\'))
-						++totlen;
-					++s;
-				}
+				++s;
 			}
-			totlen += 2;	/* for '=' and 'sep' char */
 		}
+		totlen += 2;	/* for '=' and 'sep' char */
 	}
 
 #ifdef DEBUG
-	/* Pass 1a: print unsorted list */
-	printf("Unsorted: n=%d\n", n);
+	/* Pass 1a: print sorted list */
+	printf("Sorted: n=%d\n", n);
 	for (i = 0; i < n; ++i) {
 		printf("\t%3d: %p ==> %-10s => %s\n",
 		       i, list[i], list[i]->key, list[i]->data);
 	}
 #endif
 
-	/* Sort list by keys */
-	qsort(list, n, sizeof(ENTRY *), cmpkey);
-
 	/* Check if the user supplied buffer size is sufficient */
 	if (size) {
 		if (size < totlen + 1) {	/* provided buffer too small */
@@ -16,7 +16,7 @@ int initcall_run_list(const init_fnc_t init_sequence[])
 
 	for (init_fnc_ptr = init_sequence; *init_fnc_ptr; ++init_fnc_ptr) {
 		unsigned long reloc_ofs = 0;
-		int ret;
+		int ret, span;
 
 		if (gd->flags & GD_FLG_RELOC)
 			reloc_ofs = gd->reloc_off;
@@ -28,7 +28,10 @@ int initcall_run_list(const init_fnc_t init_sequence[])
 			debug(" (relocated to %p)\n", (char *)*init_fnc_ptr);
 		else
 			debug("\n");
+		span = bootstage_span_begin_addr(BOOTSTAGE_SPAN_INITCALL,
+				(ulong)*init_fnc_ptr - reloc_ofs);
 		ret = (*init_fnc_ptr)();
+		bootstage_span_end(span);
 		if (ret) {
 			printf("initcall sequence %p failed at call %p (err=%d)\n",
 			       init_sequence,
@@ -161,6 +161,9 @@ int fdt_first_subnode(const void *fdt, int offset)
 {
 	int depth = 0;
 
+	if (_fdt_index_child(fdt, offset, 0, &offset))
+		return offset;
+
 	offset = fdt_next_node(fdt, offset, &depth);
 	if (offset < 0 || depth != 1)
 		return -FDT_ERR_NOTFOUND;
@@ -172,6 +175,9 @@ int fdt_next_subnode(const void *fdt, int offset)
 {
 	int depth = 1;
 
+	if (_fdt_index_child(fdt, offset, 1, &offset))
+		return offset;
+
 	/*
 	 * With respect to the parent, the depth of the next subnode will be
 	 * the same as the last.
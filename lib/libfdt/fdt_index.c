@@ -0,0 +1,592 @@
+/*
+ * libfdt - Flat Device Tree manipulation
+ * Lookup index for a flat device tree
+ *
+ * SPDX-License-Identifier:	GPL-2.0+ BSD-2-Clause
+ */
+
+#include <libfdt_env.h>
+#include <fdt.h>
+#include <libfdt.h>
+
+#include "libfdt_internal.h"
+
+/*
+ * Finding a node by phandle, path or compatible string normally scans the
+ * structure block from the start, as does finding the parent of a node.
+ * Code which fixes up a tree does this in a loop, so the time taken grows
+ * with the square of the tree size.
+ *
+ * An index holds every node in offset order, linked to its parent, first
+ * child and next sibling, plus tables of phandles and compatible strings
+ * sorted for binary search. The tables refer to nodes by position in the
+ * node array, so when a property or node name changes size only the node
+ * offsets need adjusting. Nodes which are added or removed are added to or
+ * removed from the arrays. Changing a phandle or compatible property marks
+ * the index stale and it is rebuilt when next used.
+ *
+ * Changes made through libfdt keep the index coherent. The owner must
+ * remove the index before changing the tree any other way, or reusing its
+ * memory.
+ */
+#define FDT_INDEX_MAX_DEPTH	32
+
+struct fdt_index_node {
+	int offset;
+	int parent;		/* node number, or -1 for the root */
+	int first_child;	/* node number, or -1 if none */
+	int next_sibling;	/* node number, or -1 if none */
+};
+
+struct fdt_index_phandle {
+	uint32_t phandle;
+	int node;
+};
+
+struct fdt_index_compat {
+	uint32_t hash;
+	int node;
+};
+
+struct fdt_index {
+	const void *fdt;
+	struct fdt_index *next;
+	int bufsize;
+	int stale;
+	int num_nodes;
+	int max_nodes;
+	int num_phandles;
+	int num_compats;
+	struct fdt_index_node *node;
+	struct fdt_index_phandle *phandle;
+	struct fdt_index_compat *compat;
+};
+
+/* This is used before relocation, when BSS is not available */
+static struct fdt_index *fdt_index_list __attribute__((section(".data")));
+
+static uint32_t _fdt_index_hash(const char *str, int len)
+{
+	uint32_t hash = 2166136261u;
+
+	while (len-- && *str)
+		hash = (hash ^ (uint8_t)*str++) * 16777619;
+
+	return hash;
+}
+
+/*
+ * Count the nodes and compatible strings in a tree, filling in the index
+ * if @idx is not NULL
+ */
+static int _fdt_index_scan(const void *fdt, struct fdt_index *idx,
+			   int *num_compats)
+{
+	int last[FDT_INDEX_MAX_DEPTH + 1];
+	int offset, depth = 0;
+	int count = 0, compats = 0;
+	const char *compat;
+	uint32_t phandle;
+	int len, n;
+
+	for (offset = 0; offset >= 0 && depth >= 0;
+	     offset = fdt_next_node(fdt, offset, &depth)) {
+		if (depth > FDT_INDEX_MAX_DEPTH)
+			return -FDT_ERR_BADSTRUCTURE;
+		compat = fdt_getprop(fdt, offset, "compatible", &len);
+		if (!idx) {
+			for (n = 0; compat && n < len;
+			     n += strnlen(compat + n, len - n) + 1)
+				compats++;
+			count++;
+			continue;
+		}
+
+		idx->node[count].offset = offset;
+		idx->node[count].parent = depth ? last[depth - 1] : -1;
+		idx->node[count].first_child = -1;
+		idx->node[count].next_sibling = -1;
+		if (depth && idx->node[last[depth - 1]].first_child == -1)
+			idx->node[last[depth - 1]].first_child = count;
+		else if (depth)
+			idx->node[last[depth]].next_sibling = count;
+		last[depth] = count;
+
+		phandle = fdt_get_phandle(fdt, offset);
+		if (phandle) {
+			idx->phandle[idx->num_phandles].phandle = phandle;
+			idx->phandle[idx->num_phandles++].node = count;
+		}
+		for (n = 0; compat && n < len;
+		     n += strnlen(compat + n, len - n) + 1) {
+			idx->compat[compats].hash =
+				_fdt_index_hash(compat + n, len - n);
+			idx->compat[compats++].node = count;
+		}
+		count++;
+	}
+	if (offset < 0 && offset != -FDT_ERR_NOTFOUND)
+		return offset;
+	if (num_compats)
+		*num_compats = compats;
+
+	return count;
+}
+
+/* Insertion sorts: the tables are normally nearly in order already */
+static void _fdt_index_sort_phandles(struct fdt_index_phandle *tab, int num)
+{
+	struct fdt_index_phandle tmp;
+	int i, j;
+
+	for (i = 1; i < num; i++) {
+		tmp = tab[i];
+		for (j = i; j > 0 && (tab[j - 1].phandle > tmp.phandle ||
+				      (tab[j - 1].phandle == tmp.phandle &&
+				       tab[j - 1].node > tmp.node)); j--)
+			tab[j] = tab[j - 1];
+		tab[j] = tmp;
+	}
+}
+
+static void _fdt_index_sort_compats(struct fdt_index_compat *tab, int num)
+{
+	struct fdt_index_compat tmp;
+	int i, j, step;
+
+	/* Shell sort, since strings hash in no particular order */
+	for (step = num / 2; step > 0; step /= 2) {
+		for (i = step; i < num; i++) {
+			tmp = tab[i];
+			for (j = i; j >= step &&
+			     (tab[j - step].hash > tmp.hash ||
+			      (tab[j - step].hash == tmp.hash &&
+			       tab[j - step].node > tmp.node)); j -= step)
+				tab[j] = tab[j - step];
+			tab[j] = tmp;
+		}
+	}
+}
+
+static int _fdt_index_build(struct fdt_index *idx)
+{
+	const void *fdt = idx->fdt;
+	int num_nodes, num_compats;
+	int ret;
+
+	num_nodes = _fdt_index_scan(fdt, NULL, &num_compats);
+	if (num_nodes < 0)
+		return num_nodes;
+
+	/* Use any spare space for nodes added later */
+	idx->compat = (struct fdt_index_compat *)(idx + 1);
+	idx->max_nodes = (idx->bufsize - (int)sizeof(*idx) -
+			  num_compats * (int)sizeof(struct fdt_index_compat)) /
+		(int)(sizeof(struct fdt_index_node) +
+		      sizeof(struct fdt_index_phandle));
+	if (num_nodes > idx->max_nodes)
+		return -FDT_ERR_NOSPACE;
+	idx->node = (struct fdt_index_node *)(idx->compat + num_compats);
+	idx->phandle = (struct fdt_index_phandle *)(idx->node +
+						    idx->max_nodes);
+	idx->num_phandles = 0;
+	ret = _fdt_index_scan(fdt, idx, NULL);
+	if (ret < 0)
+		return ret;
+	idx->num_nodes = num_nodes;
+	idx->num_compats = num_compats;
+	_fdt_index_sort_phandles(idx->phandle, idx->num_phandles);
+	_fdt_index_sort_compats(idx->compat, num_compats);
+	idx->stale = 0;
+
+	return 0;
+}
+
+static struct fdt_index *_fdt_index_find(const void *fdt)
+{
+	struct fdt_index *idx;
+
+	for (idx = fdt_index_list; idx; idx = idx->next) {
+		if (idx->fdt == fdt)
+			return idx;
+	}
+
+	return NULL;
+}
+
+static struct fdt_index *_fdt_index_get(const void *fdt)
+{
+	struct fdt_index *idx = _fdt_index_find(fdt);
+
+	if (!idx || (idx->stale && _fdt_index_build(idx)))
+		return NULL;
+
+	return idx;
+}
+
+/* Find the node number for a node offset, or -1 if not a node */
+static int _fdt_index_lookup(struct fdt_index *idx, int offset)
+{
+	int lo = 0, hi = idx->num_nodes;
+	int mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (idx->node[mid].offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == idx->num_nodes || idx->node[lo].offset != offset)
+		return -1;
+
+	return lo;
+}
+
+/* Find the first node whose offset is after @offset */
+static int _fdt_index_after(struct fdt_index *idx, int offset)
+{
+	int lo = 0, hi = idx->num_nodes;
+	int mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (idx->node[mid].offset <= offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+int fdt_index_size(const void *fdt)
+{
+	int num_nodes, num_compats;
+
+	FDT_CHECK_HEADER(fdt);
+
+	num_nodes = _fdt_index_scan(fdt, NULL, &num_compats);
+	if (num_nodes < 0)
+		return num_nodes;
+
+	return sizeof(struct fdt_index) +
+		num_nodes * (sizeof(struct fdt_index_node) +
+			     sizeof(struct fdt_index_phandle)) +
+		num_compats * sizeof(struct fdt_index_compat);
+}
+
+int fdt_index_add(const void *fdt, void *buf, int bufsize)
+{
+	struct fdt_index *idx = buf;
+	int ret;
+
+	FDT_CHECK_HEADER(fdt);
+
+	if (_fdt_index_find(fdt))
+		return -FDT_ERR_EXISTS;
+	if (bufsize < sizeof(*idx))
+		return -FDT_ERR_NOSPACE;
+	memset(idx, '\0', sizeof(*idx));
+	idx->fdt = fdt;
+	idx->bufsize = bufsize;
+	ret = _fdt_index_build(idx);
+	if (ret)
+		return ret;
+	idx->next = fdt_index_list;
+	fdt_index_list = idx;
+
+	return 0;
+}
+
+void *fdt_index_remove(const void *fdt)
+{
+	struct fdt_index **idxp, *idx;
+
+	for (idxp = &fdt_index_list; *idxp; idxp = &(*idxp)->next) {
+		idx = *idxp;
+		if (idx->fdt == fdt) {
+			*idxp = idx->next;
+			return idx;
+		}
+	}
+
+	return NULL;
+}
+
+static int _fdt_index_name_eq(const void *fdt, int offset, const char *s,
+			      int len)
+{
+	const char *name;
+	int namelen;
+
+	name = fdt_get_name(fdt, offset, &namelen);
+	if (!name || namelen < len || memcmp(name, s, len))
+		return 0;
+	if (name[len] == '\0')
+		return 1;
+
+	/* As _fdt_nodename_eq(), "foo" matches "foo@1" */
+	return !memchr(s, '@', len) && name[len] == '@';
+}
+
+int _fdt_index_subnode(const void *fdt, int offset, const char *name,
+		       int namelen, int *offsetp)
+{
+	struct fdt_index *idx = _fdt_index_get(fdt);
+	int n;
+
+	if (!idx)
+		return 0;
+	n = _fdt_index_lookup(idx, offset);
+	if (n < 0)
+		return 0;
+
+	*offsetp = -FDT_ERR_NOTFOUND;
+	for (n = idx->node[n].first_child; n != -1;
+	     n = idx->node[n].next_sibling) {
+		if (_fdt_index_name_eq(fdt, idx->node[n].offset, name,
+				       namelen)) {
+			*offsetp = idx->node[n].offset;
+			break;
+		}
+	}
+
+	return 1;
+}
+
+int _fdt_index_child(const void *fdt, int offset, int sibling, int *offsetp)
+{
+	struct fdt_index *idx = _fdt_index_get(fdt);
+	int n;
+
+	if (!idx)
+		return 0;
+	n = _fdt_index_lookup(idx, offset);
+	if (n < 0)
+		return 0;
+
+	n = sibling ? idx->node[n].next_sibling : idx->node[n].first_child;
+	*offsetp = n == -1 ? -FDT_ERR_NOTFOUND : idx->node[n].offset;
+
+	return 1;
+}
+
+int _fdt_index_supernode(const void *fdt, int offset, int supernodedepth,
+			 int *nodedepth, int *offsetp)
+{
+	struct fdt_index *idx = _fdt_index_get(fdt);
+	int depth, n, up;
+
+	if (!idx)
+		return 0;
+	n = _fdt_index_lookup(idx, offset);
+	if (n < 0)
+		return 0;
+
+	for (depth = 0, up = n; idx->node[up].parent != -1; depth++)
+		up = idx->node[up].parent;
+	if (nodedepth)
+		*nodedepth = depth;
+	if (supernodedepth > depth) {
+		*offsetp = -FDT_ERR_NOTFOUND;
+		return 1;
+	}
+	for (; depth > supernodedepth; depth--)
+		n = idx->node[n].parent;
+	*offsetp = idx->node[n].offset;
+
+	return 1;
+}
+
+int _fdt_index_phandle(const void *fdt, uint32_t phandle, int *offsetp)
+{
+	struct fdt_index *idx = _fdt_index_get(fdt);
+	int lo = 0, hi, mid;
+
+	if (!idx)
+		return 0;
+	hi = idx->num_phandles;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (idx->phandle[mid].phandle < phandle)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < idx->num_phandles && idx->phandle[lo].phandle == phandle)
+		*offsetp = idx->node[idx->phandle[lo].node].offset;
+	else
+		*offsetp = -FDT_ERR_NOTFOUND;
+
+	return 1;
+}
+
+int _fdt_index_compatible(const void *fdt, int startoffset,
+			  const char *compatible, int *offsetp)
+{
+	struct fdt_index *idx = _fdt_index_get(fdt);
+	uint32_t hash = _fdt_index_hash(compatible, strlen(compatible));
+	int lo = 0, hi, mid, first, offset;
+	struct fdt_index_compat *entry;
+
+	if (!idx)
+		return 0;
+
+	/* Entries for a hash are sorted by node, so find the first after */
+	first = _fdt_index_after(idx, startoffset);
+	hi = idx->num_compats;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		entry = &idx->compat[mid];
+		if (entry->hash < hash ||
+		    (entry->hash == hash && entry->node < first))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*offsetp = -FDT_ERR_NOTFOUND;
+	for (entry = &idx->compat[lo];
+	     entry != idx->compat + idx->num_compats && entry->hash == hash;
+	     entry++) {
+		offset = idx->node[entry->node].offset;
+
+		/* Check the string, in case another one has the same hash */
+		if (!fdt_node_check_compatible(fdt, offset, compatible)) {
+			*offsetp = offset;
+			break;
+		}
+	}
+
+	return 1;
+}
+
+/* Add @delta to every reference to node @from or later */
+static void _fdt_index_renumber(struct fdt_index *idx, int from, int delta)
+{
+	struct fdt_index_node *node;
+	int i;
+
+	for (i = 0; i < idx->num_nodes; i++) {
+		node = &idx->node[i];
+		if (node->parent >= from)
+			node->parent += delta;
+		if (node->first_child >= from)
+			node->first_child += delta;
+		if (node->next_sibling >= from)
+			node->next_sibling += delta;
+	}
+	for (i = 0; i < idx->num_phandles; i++) {
+		if (idx->phandle[i].node >= from)
+			idx->phandle[i].node += delta;
+	}
+	for (i = 0; i < idx->num_compats; i++) {
+		if (idx->compat[i].node >= from)
+			idx->compat[i].node += delta;
+	}
+}
+
+/* Remove nodes @first to @end - 1, which make up a subtree */
+static void _fdt_index_remove_nodes(struct fdt_index *idx, int first,
+				    int end)
+{
+	struct fdt_index_node *parent;
+	int i, j, n;
+
+	/* Unlink the subtree from its parent */
+	parent = &idx->node[idx->node[first].parent];
+	if (parent->first_child == first) {
+		parent->first_child = idx->node[first].next_sibling;
+	} else {
+		for (n = parent->first_child;
+		     idx->node[n].next_sibling != first;
+		     n = idx->node[n].next_sibling)
+			;
+		idx->node[n].next_sibling = idx->node[first].next_sibling;
+	}
+
+	for (i = 0, j = 0; i < idx->num_phandles; i++) {
+		n = idx->phandle[i].node;
+		if (n < first || n >= end)
+			idx->phandle[j++] = idx->phandle[i];
+	}
+	idx->num_phandles = j;
+	for (i = 0, j = 0; i < idx->num_compats; i++) {
+		n = idx->compat[i].node;
+		if (n < first || n >= end)
+			idx->compat[j++] = idx->compat[i];
+	}
+	idx->num_compats = j;
+
+	memmove(&idx->node[first], &idx->node[end],
+		(idx->num_nodes - end) * sizeof(struct fdt_index_node));
+	idx->num_nodes -= end - first;
+	_fdt_index_renumber(idx, end, first - end);
+}
+
+void _fdt_index_splice(const void *fdt, int offset, int oldlen, int newlen)
+{
+	struct fdt_index *idx = _fdt_index_find(fdt);
+	int n, end;
+
+	if (!idx || idx->stale)
+		return;
+	n = _fdt_index_after(idx, offset - 1);
+
+	/* Any nodes in the old region were deleted */
+	end = _fdt_index_after(idx, offset + oldlen - 1);
+	if (oldlen && end > n) {
+		if (n == 0) {
+			idx->stale = 1;
+			return;
+		}
+		_fdt_index_remove_nodes(idx, n, end);
+	}
+	for (; n < idx->num_nodes; n++)
+		idx->node[n].offset += newlen - oldlen;
+}
+
+void _fdt_index_add_node(const void *fdt, int parentoffset, int offset)
+{
+	struct fdt_index *idx = _fdt_index_find(fdt);
+	struct fdt_index_node *parent;
+	int n, p;
+
+	if (!idx || idx->stale)
+		return;
+	p = _fdt_index_lookup(idx, parentoffset);
+	if (p < 0 || idx->num_nodes == idx->max_nodes) {
+		idx->stale = 1;
+		return;
+	}
+
+	/* The new node has no properties and is its parent's first child */
+	n = _fdt_index_after(idx, offset - 1);
+	_fdt_index_renumber(idx, n, 1);
+	memmove(&idx->node[n + 1], &idx->node[n],
+		(idx->num_nodes - n) * sizeof(struct fdt_index_node));
+	idx->num_nodes++;
+	parent = &idx->node[p];
+	idx->node[n].offset = offset;
+	idx->node[n].parent = p;
+	idx->node[n].first_child = -1;
+	idx->node[n].next_sibling = parent->first_child;
+	parent->first_child = n;
+}
+
+void _fdt_index_invalidate(const void *fdt)
+{
+	struct fdt_index *idx = _fdt_index_find(fdt);
+
+	if (idx)
+		idx->stale = 1;
+}
+
+void _fdt_index_prop(const void *fdt, const char *name, int namelen)
+{
+	if ((namelen == 7 && !memcmp(name, "phandle", 7)) ||
+	    (namelen == 13 && !memcmp(name, "linux,phandle", 13)) ||
+	    (namelen == 10 && !memcmp(name, "compatible", 10)))
+		_fdt_index_invalidate(fdt);
+}
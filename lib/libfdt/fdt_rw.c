@@ -88,6 +88,8 @@ static int _fdt_splice_struct(void *fdt, void *p,
 	if ((err = _fdt_splice(fdt, p, oldlen, newlen)))
 		return err;
 
+	_fdt_index_splice(fdt, (char *)p - (char *)_fdt_offset_ptr(fdt, 0),
+			  oldlen, newlen);
 	fdt_set_size_dt_struct(fdt, fdt_size_dt_struct(fdt) + delta);
 	fdt_set_off_dt_strings(fdt, fdt_off_dt_strings(fdt) + delta);
 	return 0;
@@ -238,6 +240,7 @@ int fdt_setprop(void *fdt, int nodeoffset, const char *name,
 
 	FDT_RW_CHECK_HEADER(fdt);
 
+	_fdt_index_prop(fdt, name, strlen(name));
 	err = _fdt_resize_property(fdt, nodeoffset, name, len, &prop);
 	if (err == -FDT_ERR_NOTFOUND)
 		err = _fdt_add_property(fdt, nodeoffset, name, len, &prop);
@@ -256,6 +259,7 @@ int fdt_appendprop(void *fdt, int nodeoffset, const char *name,
 
 	FDT_RW_CHECK_HEADER(fdt);
 
+	_fdt_index_prop(fdt, name, strlen(name));
 	prop = fdt_get_property_w(fdt, nodeoffset, name, &oldlen);
 	if (prop) {
 		newlen = len + oldlen;
@@ -286,6 +290,7 @@ int fdt_delprop(void *fdt, int nodeoffset, const char *name)
 	if (!prop)
 		return len;
 
+	_fdt_index_prop(fdt, name, strlen(name));
 	proplen = sizeof(*prop) + FDT_TAGALIGN(len);
 	return _fdt_splice_struct(fdt, prop, proplen, 0);
 }
@@ -321,6 +326,7 @@ int fdt_add_subnode_namelen(void *fdt, int parentoffset,
 	err = _fdt_splice_struct(fdt, nh, 0, nodelen);
 	if (err)
 		return err;
+	_fdt_index_add_node(fdt, parentoffset, offset);
 
 	nh->tag = cpu_to_fdt32(FDT_BEGIN_NODE);
 	memset(nh->name, 0, FDT_TAGALIGN(namelen+1));
@@ -30,6 +30,7 @@ int fdt_setprop_inplace_namelen_partial(void *fdt, int nodeoffset,
 	if (proplen < (len + index))
 		return -FDT_ERR_NOSPACE;
 
+	_fdt_index_prop(fdt, name, namelen);
 	memcpy(propval + index, val, len);
 	return 0;
 }
@@ -69,6 +70,7 @@ int fdt_nop_property(void *fdt, int nodeoffset, const char *name)
 	if (!prop)
 		return len;
 
+	_fdt_index_prop(fdt, name, strlen(name));
 	_fdt_nop_region(prop, len + sizeof(*prop));
 
 	return 0;
@@ -92,6 +94,7 @@ int fdt_nop_node(void *fdt, int nodeoffset)
 	if (endoffset < 0)
 		return endoffset;
 
+	_fdt_index_invalidate(fdt);
 	_fdt_nop_region(fdt_offset_ptr_w(fdt, nodeoffset, 0),
 			endoffset - nodeoffset);
 	return 0;
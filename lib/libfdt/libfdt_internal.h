@@ -47,4 +47,75 @@ static inline struct fdt_reserve_entry *_fdt_mem_rsv_w(void *fdt, int n)
 
 #define FDT_SW_MAGIC		(~FDT_MAGIC)
 
+/*
+ * Hooks for the lookup index in fdt_index.c. The lookups return 1 and set
+ * *offsetp if the tree is indexed, or 0 to fall back to scanning it.
+ */
+#if defined(CONFIG_OF_LIBFDT_INDEX) && !defined(USE_HOSTCC) && \
+	!defined(CONFIG_SPL_BUILD)
+int _fdt_index_subnode(const void *fdt, int offset, const char *name,
+		       int namelen, int *offsetp);
+int _fdt_index_child(const void *fdt, int offset, int sibling, int *offsetp);
+int _fdt_index_supernode(const void *fdt, int offset, int supernodedepth,
+			 int *nodedepth, int *offsetp);
+int _fdt_index_phandle(const void *fdt, uint32_t phandle, int *offsetp);
+int _fdt_index_compatible(const void *fdt, int startoffset,
+			  const char *compatible, int *offsetp);
+void _fdt_index_splice(const void *fdt, int offset, int oldlen, int newlen);
+void _fdt_index_add_node(const void *fdt, int parentoffset, int offset);
+void _fdt_index_invalidate(const void *fdt);
+void _fdt_index_prop(const void *fdt, const char *name, int namelen);
+#else
+static inline int _fdt_index_subnode(const void *fdt, int offset,
+				     const char *name, int namelen,
+				     int *offsetp)
+{
+	return 0;
+}
+
+static inline int _fdt_index_child(const void *fdt, int offset, int sibling,
+				   int *offsetp)
+{
+	return 0;
+}
+
+static inline int _fdt_index_supernode(const void *fdt, int offset,
+				       int supernodedepth, int *nodedepth,
+				       int *offsetp)
+{
+	return 0;
+}
+
+static inline int _fdt_index_phandle(const void *fdt, uint32_t phandle,
+				     int *offsetp)
+{
+	return 0;
+}
+
+static inline int _fdt_index_compatible(const void *fdt, int startoffset,
+					const char *compatible, int *offsetp)
+{
+	return 0;
+}
+
+static inline void _fdt_index_splice(const void *fdt, int offset, int oldlen,
+				     int newlen)
+{
+}
+
+static inline void _fdt_index_add_node(const void *fdt, int parentoffset,
+				       int offset)
+{
+}
+
+static inline void _fdt_index_invalidate(const void *fdt)
+{
+}
+
+static inline void _fdt_index_prop(const void *fdt, const char *name,
+				   int namelen)
+{
+}
+#endif
+
 #endif /* _LIBFDT_INTERNAL_H */
@@ -6,6 +6,10 @@
 
 #include <common.h>
 #include <compiler.h>
+#include <malloc.h>
+#include <smp_work.h>
+#include <u-boot/xxhash.h>
+#include <asm/unaligned.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
 
@@ -63,77 +67,657 @@ struct lz4_block_header {
 	/* + u32 block_checksum iff has_block_checksum is set */
 } __packed;
 
+/* Frame descriptor: flags, block size, content size and header checksum */
+#define ULZ4_DESC_MAX	(sizeof(struct lz4_frame_header) + sizeof(u64) + \
+			 sizeof(u8))
+
+/* Most jobs used to decode one frame */
+#define ULZ4_JOBS	8
+
+/* Most of the heap which the block buffers for streaming jobs may take */
+#ifdef CONFIG_SYS_MALLOC_LEN
+#define ULZ4_JOBS_HEAP	(CONFIG_SYS_MALLOC_LEN / 2)
+#else
+#define ULZ4_JOBS_HEAP	0
+#endif
+
+/**
+ * struct ulz4_frame - What the frame descriptor says about a frame
+ *
+ * @block_size:		Largest size of a block once decoded
+ * @content_size:	Size of the decoded content, if @has_content_size
+ * @has_content_size:	true if the content size is given
+ * @independent:	true if each block can be decoded on its own
+ * @block_checksum:	true if each block is followed by its checksum
+ * @content_checksum:	true if the frame ends with a checksum of the content
+ */
+struct ulz4_frame {
+	size_t block_size;
+	u64 content_size;
+	bool has_content_size;
+	bool independent;
+	bool block_checksum;
+	bool content_checksum;
+};
+
+/**
+ * struct ulz4_job - A run of blocks decoded by one CPU
+ *
+ * Each job puts its blocks where they would be if all the blocks before
+ * them were full-sized, which is how the compressor makes them except
+ * perhaps for the last. ulz4_jobs_finish() closes up any gaps.
+ *
+ * @work:	Job to queue
+ * @f:		Frame the blocks are from
+ * @in:		Header of the first block
+ * @count:	Number of blocks
+ * @out:	Where to put the first block
+ * @end:	End of the output buffer
+ * @len:	Number of bytes decoded
+ * @buf:	Buffer holding the block, when streaming
+ */
+struct ulz4_job {
+	struct smp_work work;
+	const struct ulz4_frame *f;
+	const void *in;
+	int count;
+	void *out;
+	const void *end;
+	size_t len;
+	u8 *buf;
+};
+
+/* Check the fixed part of the header, returning the length of the rest */
+static int ulz4_frame_flags(struct ulz4_frame *f, const void *hdr)
+{
+	const struct lz4_frame_header *h = hdr;
+
+	/* We assume there's always only a single, standard frame. */
+	if (le32_to_cpu(h->magic) != LZ4F_MAGIC || h->version != 1)
+		return -EPROTONOSUPPORT;	/* unknown format */
+	if (h->reserved0 || h->reserved1 || h->reserved2)
+		return -EINVAL;	/* reserved must be zero */
+	if (h->max_block_size < 4)
+		return -EINVAL;
+	f->block_size = 1 << (8 + 2 * h->max_block_size);
+	f->has_content_size = h->has_content_size;
+	f->independent = h->independent_blocks;
+	f->block_checksum = h->has_block_checksum;
+	f->content_checksum = h->has_content_checksum;
+
+	return (f->has_content_size ? sizeof(u64) : 0) + sizeof(u8);
+}
+
+/* Check the header checksum, which covers all but the magic number */
+static int ulz4_frame_check(struct ulz4_frame *f, const u8 *hdr, int len)
+{
+	if (f->has_content_size)
+		f->content_size = get_unaligned_le64(hdr +
+					sizeof(struct lz4_frame_header));
+	if (hdr[len - 1] != (u8)(xxh32(hdr + sizeof(u32),
+				       len - sizeof(u32) - 1, 0) >> 8))
+		return -EBADMSG;
+
+	return 0;
+}
+
+/* Check the content once all @len bytes are decoded */
+static int ulz4_frame_end(const struct ulz4_frame *f, const void *in,
+			  const void *in_end, const void *dst, size_t len)
+{
+	if (f->has_content_size && f->content_size != len)
+		return -EBADMSG;
+	if (f->content_checksum) {
+		if (in_end - in < sizeof(u32))
+			return -EINVAL;	/* input overrun */
+		if (xxh32(dst, len, 0) != get_unaligned_le32(in))
+			return -EBADMSG;
+	}
+
+	return 0;
+}
+
+/* Check the checksum which follows the data of a block */
+static int ulz4_block_check(const struct lz4_block_header *b, const void *in)
+{
+	if (xxh32(in, b->size, 0) != get_unaligned_le32(in + b->size))
+		return -EBADMSG;
+
+	return 0;
+}
+
+/*
+ * Decode a block into @out, which has room for @avail bytes. Matches may
+ * reach back as far as @prefix, which is @out if blocks are independent.
+ * Returns the number of bytes decoded, or -ve on error.
+ */
+static int ulz4_block(const struct lz4_block_header *b, const void *in,
+		      void *out, size_t avail, const void *prefix)
+{
+	int ret;
+
+	if (b->not_compressed) {
+		if (b->size > avail)
+			return -ENOBUFS;	/* output overrun */
+		memmove(out, in, b->size);
+		return b->size;
+	}
+
+	/* constant folding essential, do not touch params! */
+	ret = LZ4_decompress_generic(in, out, b->size, avail, endOnInputSize,
+				     full, 0, noDict, prefix, NULL, 0);
+	if (ret < 0)
+		return -EPROTO;	/* decompression error or output overrun */
+
+	return ret;
+}
+
+static int ulz4_job_run(void *arg)
+{
+	struct ulz4_job *job = arg;
+	const struct ulz4_frame *f = job->f;
+	const void *in = job->in;
+	void *out = job->out;
+	struct lz4_block_header b;
+	int i, ret;
+
+	for (i = 0; i < job->count; i++) {
+		b.raw = le32_to_cpu(*(u32 *)in);
+		in += sizeof(b);
+		if (f->block_checksum) {
+			ret = ulz4_block_check(&b, in);
+			if (ret)
+				return ret;
+		}
+		ret = ulz4_block(&b, in, out, min((size_t)(job->end - out),
+						  f->block_size), out);
+		if (ret < 0)
+			return ret;
+		out += ret;
+		in += b.size + (f->block_checksum ? sizeof(u32) : 0);
+	}
+	job->len = out - job->out;
+
+	return 0;
+}
+
+static void ulz4_job_queue(struct ulz4_job *job)
+{
+	job->work.func = ulz4_job_run;
+	job->work.arg = job;
+	smp_work_queue(&job->work);
+}
+
+/* Wait for the jobs, then move up any blocks left after a gap */
+static int ulz4_jobs_finish(struct ulz4_job *job, int count, void **outp)
+{
+	void *pos = job[0].out;
+	int ret = 0;
+	int i;
+
+	smp_work_wait();
+	for (i = 0; i < count; i++) {
+		if (job[i].work.ret) {
+			ret = ret ? ret : job[i].work.ret;
+			continue;
+		}
+		if (pos != job[i].out)
+			memmove(pos, job[i].out, job[i].len);
+		pos += job[i].len;
+	}
+	*outp = pos;
+
+	return ret;
+}
+
+/*
+ * Decode a frame of independent blocks, sharing the blocks out between the
+ * CPUs. On success this updates @inp to the end of the blocks and @outp to
+ * the end of the output. Returns -EAGAIN if the frame should be decoded in
+ * order instead, which also takes care of reporting any error.
+ */
+static int ulz4_split(const struct ulz4_frame *f, const void **inp,
+		      const void *in_end, void *dst, const void *end,
+		      void **outp)
+{
+	size_t skip = f->block_checksum ? sizeof(u32) : 0;
+	struct ulz4_job job[ULZ4_JOBS];
+	struct lz4_block_header b;
+	const void *in;
+	void *out;
+	int blocks, count, first, i, j;
+
+	count = min(smp_work_cpus(), ULZ4_JOBS);
+	if (count < 2)
+		return -EAGAIN;
+
+	for (in = *inp, blocks = 0;; blocks++) {
+		if (in_end - in < sizeof(b))
+			return -EAGAIN;
+		b.raw = le32_to_cpu(*(u32 *)in);
+		in += sizeof(b);
+		if (!b.size)
+			break;
+		if (b.size > f->block_size || b.size + skip > in_end - in)
+			return -EAGAIN;
+		in += b.size + skip;
+	}
+	if (blocks < 2 || (blocks - 1) * f->block_size >= (size_t)(end - dst))
+		return -EAGAIN;
+	count = min(count, blocks);
+
+	/* Give each job a run of blocks and the space they would fill */
+	for (i = 0, first = 0, in = *inp; i < count; i++) {
+		job[i].f = f;
+		job[i].in = in;
+		job[i].count = blocks * (i + 1) / count - first;
+		job[i].out = dst + first * f->block_size;
+		job[i].end = end;
+		ulz4_job_queue(&job[i]);
+		for (j = 0; j < job[i].count; j++) {
+			b.raw = le32_to_cpu(*(u32 *)in);
+			in += sizeof(b) + b.size + skip;
+		}
+		first += job[i].count;
+	}
+	if (ulz4_jobs_finish(job, count, &out))
+		return -EAGAIN;
+	*inp = in + sizeof(b);
+	*outp = out;
+
+	return 0;
+}
+
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 {
 	const void *end = dst + *dstn;
 	const void *in = src;
+	const void *in_end = src + srcn;
 	void *out = dst;
-	int has_block_checksum;
+	struct ulz4_frame f;
+	size_t hdr_len, skip;
 	int ret;
 	*dstn = 0;
 
-	{ /* With in-place decompression the header may become invalid later. */
-		const struct lz4_frame_header *h = in;
-
-		if (srcn < sizeof(*h) + sizeof(u64) + sizeof(u8))
-			return -EINVAL;	/* input overrun */
-
-		/* We assume there's always only a single, standard frame. */
-		if (le32_to_cpu(h->magic) != LZ4F_MAGIC || h->version != 1)
-			return -EPROTONOSUPPORT;	/* unknown format */
-		if (h->reserved0 || h->reserved1 || h->reserved2)
-			return -EINVAL;	/* reserved must be zero */
-		if (!h->independent_blocks)
-			return -EPROTONOSUPPORT; /* we can't support this yet */
-		has_block_checksum = h->has_block_checksum;
+	/* With in-place decompression the header may become invalid later. */
+	if (srcn < sizeof(struct lz4_frame_header))
+		return -EINVAL;	/* input overrun */
+	ret = ulz4_frame_flags(&f, in);
+	if (ret < 0)
+		return ret;
+	hdr_len = sizeof(struct lz4_frame_header) + ret;
+	if (srcn < hdr_len)
+		return -EINVAL;	/* input overrun */
+	ret = ulz4_frame_check(&f, in, hdr_len);
+	if (ret)
+		return ret;
+	in += hdr_len;
+	skip = f.block_checksum ? sizeof(u32) : 0;
 
-		in += sizeof(*h);
-		if (h->has_content_size)
-			in += sizeof(u64);
-		in += sizeof(u8);
+	/* Blocks may be decoded out of order unless they overwrite the input */
+	if (f.independent && (src >= end || dst >= in_end) &&
+	    !ulz4_split(&f, &in, in_end, dst, end, &out)) {
+		ret = 0;
+		goto done;
 	}
 
 	while (1) {
 		struct lz4_block_header b;
 
+		if (in_end - in < sizeof(b)) {
+			ret = -EINVAL;		/* input overrun */
+			break;
+		}
 		b.raw = le32_to_cpu(*(u32 *)in);
 		in += sizeof(struct lz4_block_header);
 
-		if (in - src + b.size > srcn) {
+		if (!b.size) {
+			ret = 0;	/* decompression successful */
+			break;
+		}
+
+		if (b.size + skip > in_end - in) {
 			ret = -EINVAL;		/* input overrun */
 			break;
 		}
+		if (f.block_checksum) {
+			ret = ulz4_block_check(&b, in);
+			if (ret)
+				break;
+		}
 
-		if (!b.size) {
-			ret = 0;	/* decompression successful */
+		ret = ulz4_block(&b, in, out, min((size_t)(end - out),
+						  f.block_size),
+				 f.independent ? out : dst);
+		if (ret < 0)
 			break;
+		out += ret;
+		in += b.size + skip;
+	}
+
+done:
+	if (!ret)
+		ret = ulz4_frame_end(&f, in, in_end, dst, out - dst);
+	*dstn = out - dst;
+	return ret;
+}
+
+enum ulz4_state {
+	ULZ4_FRAME_HEADER,
+	ULZ4_FRAME_DESC,	/* content size and header checksum */
+	ULZ4_BLOCK_HEADER,
+	ULZ4_BLOCK,		/* data, then checksum if present */
+	ULZ4_CONTENT_CHECKSUM,
+	ULZ4_DONE,
+};
+
+/*
+ * When blocks are independent and there are several CPUs, each block is
+ * collected in a job's buffer and decoded on another CPU while the caller
+ * loads the rest of the frame.
+ */
+struct ulz4_stream {
+	void *dst;
+	void *out;		/* where the next block goes */
+	const void *end;
+	enum ulz4_state state;
+	size_t need;		/* bytes left in the current state */
+	size_t have;		/* bytes collected in hdr or blk */
+	struct ulz4_frame f;
+	struct lz4_block_header b;	/* header of the current block */
+	u8 hdr[ULZ4_DESC_MAX];
+	u8 *blk;		/* where the current block is collected */
+	u8 *buf;		/* compressed block which spans two writes */
+	size_t bufsize;
+	struct ulz4_job job[ULZ4_JOBS];
+	int jobs;		/* number of jobs queued */
+	int max_jobs;		/* 0 to decode each block here */
+};
+
+void *ulz4_stream_start(void *dst, size_t dstn)
+{
+	struct ulz4_stream *ls;
+
+	ls = calloc(1, sizeof(*ls));
+	if (!ls)
+		return NULL;
+	ls->dst = dst;
+	ls->out = dst;
+	ls->end = dst + dstn;
+	ls->state = ULZ4_FRAME_HEADER;
+	ls->need = sizeof(struct lz4_frame_header);
+
+	return ls;
+}
+
+static void ulz4_expect(struct ulz4_stream *ls, enum ulz4_state state,
+			size_t need)
+{
+	ls->state = state;
+	ls->need = need;
+	ls->have = 0;
+}
+
+/* Wait for the queued blocks, leaving @ls->out after the last */
+static int ulz4_stream_flush(struct ulz4_stream *ls)
+{
+	int ret;
+
+	if (!ls->jobs)
+		return 0;
+	ret = ulz4_jobs_finish(ls->job, ls->jobs, &ls->out);
+	ls->jobs = 0;
+
+	return ret;
+}
+
+/* Free the job buffers and decode the rest of the frame here */
+static int ulz4_stream_serial(struct ulz4_stream *ls)
+{
+	int ret;
+	int i;
+
+	ret = ulz4_stream_flush(ls);
+	for (i = 0; i < ULZ4_JOBS; i++) {
+		free(ls->job[i].buf);
+		ls->job[i].buf = NULL;
+	}
+	ls->max_jobs = 0;
+
+	return ret;
+}
+
+/* Decide where the block just started is collected */
+static int ulz4_stream_slot(struct ulz4_stream *ls)
+{
+	struct ulz4_job *job;
+	int ret;
+
+	ls->blk = NULL;
+	if (ls->jobs == ls->max_jobs) {
+		ret = ulz4_stream_flush(ls);
+		if (ret)
+			return ret;
+	}
+	if (!ls->max_jobs || ls->end - ls->out < ls->f.block_size)
+		return ulz4_stream_flush(ls);
+
+	job = &ls->job[ls->jobs];
+	if (!job->buf) {
+		job->buf = malloc(sizeof(ls->b) + ls->bufsize);
+		if (!job->buf)
+			return ulz4_stream_serial(ls);
+	}
+	memcpy(job->buf, ls->hdr, sizeof(ls->b));
+	ls->blk = job->buf + sizeof(ls->b);
+
+	return 0;
+}
+
+static int ulz4_frame_header(struct ulz4_stream *ls)
+{
+	int ret;
+
+	ret = ulz4_frame_flags(&ls->f, ls->hdr);
+	if (ret < 0)
+		return ret;
+
+	/* The content size and header checksum follow in hdr */
+	ls->state = ULZ4_FRAME_DESC;
+	ls->need = ret;
+
+	return 0;
+}
+
+static int ulz4_frame_desc(struct ulz4_stream *ls)
+{
+	int jobs;
+	int ret;
+
+	ret = ulz4_frame_check(&ls->f, ls->hdr, ls->have);
+	if (ret)
+		return ret;
+	ls->bufsize = ls->f.block_size + sizeof(u32);
+	if (ls->f.independent && smp_work_cpus() > 1) {
+		jobs = ULZ4_JOBS_HEAP / (sizeof(ls->b) + ls->bufsize) - 1;
+		ls->max_jobs = clamp(jobs, 0, min(smp_work_cpus(), ULZ4_JOBS));
+	}
+
+	/*
+	 * Take the buffer for blocks decoded here first, so that it is there
+	 * if the job buffers use up the heap
+	 */
+	if (ls->max_jobs) {
+		ls->buf = malloc(ls->bufsize);
+		if (!ls->buf)
+			ls->max_jobs = 0;
+	}
+	ulz4_expect(ls, ULZ4_BLOCK_HEADER, sizeof(struct lz4_block_header));
+
+	return 0;
+}
+
+static int ulz4_block_header(struct ulz4_stream *ls)
+{
+	int ret;
+
+	ls->b.raw = le32_to_cpu(*(u32 *)ls->hdr);
+	if (!ls->b.size) {
+		ret = ulz4_stream_flush(ls);
+		if (ret)
+			return ret;
+		if (ls->f.content_checksum) {
+			ulz4_expect(ls, ULZ4_CONTENT_CHECKSUM, sizeof(u32));
+			return 0;
 		}
+		ls->state = ULZ4_DONE;
+		ret = ulz4_frame_end(&ls->f, NULL, NULL, ls->dst,
+				     ls->out - ls->dst);
+		return ret ? ret : 1;
+	}
+	if (ls->b.size > ls->f.block_size)
+		return -EINVAL;
+	ulz4_expect(ls, ULZ4_BLOCK, ls->b.size +
+		    (ls->f.block_checksum ? sizeof(u32) : 0));
+
+	return ulz4_stream_slot(ls);
+}
+
+static int ulz4_content_checksum(struct ulz4_stream *ls)
+{
+	int ret;
+
+	ls->state = ULZ4_DONE;
+	ret = ulz4_frame_end(&ls->f, ls->hdr, ls->hdr + sizeof(u32), ls->dst,
+			     ls->out - ls->dst);
+
+	return ret ? ret : 1;
+}
+
+/* Decode the block here, once it and its checksum are all at @in */
+static int ulz4_stream_block(struct ulz4_stream *ls, const void *in)
+{
+	int ret;
+
+	if (ls->f.block_checksum) {
+		ret = ulz4_block_check(&ls->b, in);
+		if (ret)
+			return ret;
+	}
+	ret = ulz4_block(&ls->b, in, ls->out, min((size_t)(ls->end - ls->out),
+						 ls->f.block_size),
+			 ls->f.independent ? ls->out : ls->dst);
+	if (ret < 0)
+		return ret;
+	ls->out += ret;
+	ulz4_expect(ls, ULZ4_BLOCK_HEADER, sizeof(struct lz4_block_header));
+
+	return 0;
+}
 
-		if (b.not_compressed) {
-			size_t size = min((ptrdiff_t)b.size, end - out);
-			memcpy(out, in, size);
-			out += size;
-			if (size < b.size) {
-				ret = -ENOBUFS;	/* output overrun */
+/* Hand the block collected in a job's buffer to another CPU */
+static void ulz4_stream_queue(struct ulz4_stream *ls)
+{
+	struct ulz4_job *job = &ls->job[ls->jobs++];
+
+	job->f = &ls->f;
+	job->in = job->buf;
+	job->count = 1;
+	job->out = ls->out;
+	job->end = ls->end;
+	ulz4_job_queue(job);
+	ls->out += ls->f.block_size;
+	ulz4_expect(ls, ULZ4_BLOCK_HEADER, sizeof(struct lz4_block_header));
+}
+
+int ulz4_stream_write(void *stream, const void *src, size_t srcn)
+{
+	struct ulz4_stream *ls = stream;
+	const void *in = src;
+	const void *in_end = src + srcn;
+	size_t size;
+	int ret;
+
+	while (in < in_end) {
+		size = min((size_t)(in_end - in), ls->need);
+
+		switch (ls->state) {
+		case ULZ4_FRAME_HEADER:
+		case ULZ4_FRAME_DESC:
+		case ULZ4_BLOCK_HEADER:
+		case ULZ4_CONTENT_CHECKSUM:
+			memcpy(ls->hdr + ls->have, in, size);
+			in += size;
+			ls->have += size;
+			ls->need -= size;
+			if (ls->need)
 				break;
+			if (ls->state == ULZ4_FRAME_HEADER)
+				ret = ulz4_frame_header(ls);
+			else if (ls->state == ULZ4_FRAME_DESC)
+				ret = ulz4_frame_desc(ls);
+			else if (ls->state == ULZ4_BLOCK_HEADER)
+				ret = ulz4_block_header(ls);
+			else
+				ret = ulz4_content_checksum(ls);
+			if (ret)
+				return ret;
+			break;
+		case ULZ4_BLOCK:
+			/* Decompress from the input if the block is all there */
+			if (!ls->blk && size == ls->need) {
+				ret = ulz4_stream_block(ls, in);
+				if (ret)
+					return ret;
+				in += size;
+				break;
+			}
+			if (!ls->blk) {
+				if (!ls->buf) {
+					ls->buf = malloc(ls->bufsize);
+					if (!ls->buf)
+						return -ENOMEM;
+				}
+				ls->blk = ls->buf;
 			}
-		} else {
-			/* constant folding essential, do not touch params! */
-			ret = LZ4_decompress_generic(in, out, b.size,
-					end - out, endOnInputSize,
-					full, 0, noDict, out, NULL, 0);
-			if (ret < 0) {
-				ret = -EPROTO;	/* decompression error */
+			memcpy(ls->blk + ls->have, in, size);
+			in += size;
+			ls->have += size;
+			ls->need -= size;
+			if (ls->need)
+				break;
+			if (ls->blk != ls->buf) {
+				ulz4_stream_queue(ls);
 				break;
 			}
-			out += ret;
+			ret = ulz4_stream_block(ls, ls->buf);
+			if (ret)
+				return ret;
+			break;
+		case ULZ4_DONE:
+			return 1;
 		}
-
-		in += b.size;
-		if (has_block_checksum)
-			in += sizeof(u32);
 	}
 
-	*dstn = out - dst;
-	return ret;
+	return ls->state == ULZ4_DONE;
+}
+
+int ulz4_stream_end(void *stream, size_t *dstn)
+{
+	struct ulz4_stream *ls = stream;
+	int done = ls->state == ULZ4_DONE;
+	int ret;
+	int i;
+
+	/* Wait for any blocks still being decoded before freeing them */
+	ret = ulz4_stream_flush(ls);
+	*dstn = ls->out - ls->dst;
+	for (i = 0; i < ULZ4_JOBS; i++)
+		free(ls->job[i].buf);
+	free(ls->buf);
+	free(ls);
+	if (ret)
+		return ret;
+
+	return done ? 0 : -EINVAL;
 }
@@ -121,4 +121,122 @@ int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
     return res;
 }
 
+
+/*
+ * Incremental version of lzmaBuffToBuffDecompress(), decoding straight into
+ * the output buffer as the LZMA_Alone stream is fed in.
+ */
+struct lzma_stream {
+    CLzmaDec dec;
+    ISzAlloc alloc;
+    unsigned char header[LZMA_DATA_OFFSET];
+    SizeT have;             /* header bytes seen so far */
+    SizeT limit;            /* output size, from the header if known */
+    int size_known;
+    int done;
+};
+
+void *lzma_stream_start(void *dst, SizeT dstlen)
+{
+    struct lzma_stream *ls;
+
+    ls = calloc(1, sizeof(*ls));
+    if (!ls)
+        return NULL;
+    LzmaDec_Construct(&ls->dec);
+    ls->alloc.Alloc = SzAlloc;
+    ls->alloc.Free = SzFree;
+    ls->dec.dic = dst;
+    ls->dec.dicBufSize = dstlen;
+
+    return ls;
+}
+
+static int lzma_stream_header(struct lzma_stream *ls)
+{
+    SizeT dstlen = ls->dec.dicBufSize;
+    uint64_t size = 0;
+    int i;
+
+    for (i = 0; i < sizeof(uint64_t); i++)
+        size |= (uint64_t)ls->header[LZMA_SIZE_OFFSET + i] << (i * 8);
+
+    ls->limit = dstlen;
+    if (size != (uint64_t)-1) {
+        if (size > dstlen)
+            return -ENOSPC;
+        ls->limit = size;
+        ls->size_known = 1;
+    }
+
+    if (LzmaDec_AllocateProbs(&ls->dec, ls->header, LZMA_PROPS_SIZE,
+                              &ls->alloc) != SZ_OK)
+        return -ENOMEM;
+    /* Start decoding at the beginning of the output buffer */
+    LzmaDec_Init(&ls->dec);
+
+    return 0;
+}
+
+int lzma_stream_write(void *stream, const void *src, SizeT srclen)
+{
+    struct lzma_stream *ls = stream;
+    const unsigned char *in = src;
+    ELzmaStatus status;
+    SizeT size;
+    SRes res;
+    int ret;
+
+    if (ls->done)
+        return 1;
+
+    if (ls->have < LZMA_DATA_OFFSET) {
+        size = min(srclen, LZMA_DATA_OFFSET - ls->have);
+        memcpy(ls->header + ls->have, in, size);
+        ls->have += size;
+        in += size;
+        srclen -= size;
+        if (ls->have < LZMA_DATA_OFFSET)
+            return 0;
+        ret = lzma_stream_header(ls);
+        if (ret)
+            return ret;
+    }
+
+    while (srclen) {
+        size = srclen;
+        WATCHDOG_RESET();
+        /* At the limit, anything but the end mark means it is full */
+        res = LzmaDec_DecodeToDic(&ls->dec, ls->limit, in, &size,
+                                  LZMA_FINISH_END, &status);
+        if (res != SZ_OK) {
+            debug("LZMA: decode error %d\n", res);
+            return ls->dec.dicPos == ls->limit ? -ENOSPC : -EINVAL;
+        }
+        in += size;
+        srclen -= size;
+        if (status == LZMA_STATUS_FINISHED_WITH_MARK ||
+            (ls->size_known && ls->dec.dicPos == ls->limit)) {
+            ls->done = 1;
+            return 1;
+        }
+        if (!size)
+            break;
+    }
+
+    return 0;
+}
+
+int lzma_stream_end(void *stream, SizeT *lenp)
+{
+    struct lzma_stream *ls = stream;
+    int done = ls->done;
+
+    *lenp = ls->have < LZMA_DATA_OFFSET ? 0 : ls->dec.dicPos;
+    LzmaDec_FreeProbs(&ls->dec, &ls->alloc);
+    free(ls);
+
+    return done ? 0 : -EINVAL;
+}
+
 #endif
@@ -16,4 +16,12 @@
 
 extern int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
 			      unsigned char *inStream,  SizeT  length);
+
+/*
+ * Incremental decompression, with the same conventions as
+ * gunzip_stream_start(), gunzip_stream_write() and gunzip_stream_end()
+ */
+extern void *lzma_stream_start(void *dst, SizeT dstlen);
+extern int lzma_stream_write(void *stream, const void *src, SizeT srclen);
+extern int lzma_stream_end(void *stream, SizeT *lenp);
 #endif
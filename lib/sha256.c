@@ -14,6 +14,9 @@
 #endif /* USE_HOSTCC */
 #include <watchdog.h>
 #include <u-boot/sha256.h>
+#if defined(CONFIG_ARMV8_SHA256) && !defined(USE_HOSTCC)
+#include <asm/system.h>
+#endif
 
 /*
  * 32-bit integer manipulation macros (big endian)
@@ -50,10 +53,10 @@ void sha256_starts(sha256_context * ctx)
 	ctx->state[7] = 0x5BE0CD19;
 }
 
-static void sha256_process(sha256_context *ctx, const uint8_t data[64])
+static void sha256_process_one(sha256_context *ctx, const uint8_t data[64])
 {
 	uint32_t temp1, temp2;
-	uint32_t W[64];
+	uint32_t W[16];
 	uint32_t A, B, C, D, E, F, G, H;
 
 	GET_UINT32_BE(W[0], data, 0);
@@ -85,10 +88,12 @@ static void sha256_process(sha256_context *ctx, const uint8_t data[64])
 #define F0(x,y,z) ((x & y) | (z & (x | y)))
 #define F1(x,y,z) (z ^ (x & (y ^ z)))
 
-#define R(t)					\
-(						\
-	W[t] = S1(W[t - 2]) + W[t - 7] +	\
-		S0(W[t - 15]) + W[t - 16]	\
+/* Only the last 16 words of the message schedule are needed at any time */
+#define R(t)						\
+(							\
+	W[(t) & 15] = S1(W[((t) - 2) & 15]) +		\
+		W[((t) - 7) & 15] +			\
+		S0(W[((t) - 15) & 15]) + W[(t) & 15]	\
 )
 
 #define P(a,b,c,d,e,f,g,h,x,K) {		\
@@ -181,6 +186,19 @@ static void sha256_process(sha256_context *ctx, const uint8_t data[64])
 	ctx->state[7] += H;
 }
 
+static void sha256_process(sha256_context *ctx, const uint8_t *data,
+			   uint32_t blocks)
+{
+#if defined(CONFIG_ARMV8_SHA256) && !defined(USE_HOSTCC)
+	if (read_id_aa64isar0() & ID_AA64ISAR0_SHA2_MASK) {
+		sha256_ce_transform(ctx->state, data, blocks);
+		return;
+	}
+#endif
+	for (; blocks; blocks--, data += 64)
+		sha256_process_one(ctx, data);
+}
+
 void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 {
 	uint32_t left, fill;
@@ -199,16 +217,16 @@ void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 
 	if (left && length >= fill) {
 		memcpy((void *) (ctx->buffer + left), (void *) input, fill);
-		sha256_process(ctx, ctx->buffer);
+		sha256_process(ctx, ctx->buffer, 1);
 		length -= fill;
 		input += fill;
 		left = 0;
 	}
 
-	while (length >= 64) {
-		sha256_process(ctx, input);
-		length -= 64;
-		input += 64;
+	if (length >= 64) {
+		sha256_process(ctx, input, length / 64);
+		input += length & ~0x3F;
+		length &= 0x3F;
 	}
 
 	if (length)
@@ -0,0 +1,77 @@
+/*
+ * xxHash - fast non-cryptographic hash
+ *
+ * Written from the xxHash specification at github.com/Cyan4973/xxHash,
+ * which is Copyright (C) 2012-2016, Yann Collet.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <u-boot/xxhash.h>
+#include <asm/unaligned.h>
+
+#define PRIME32_1	2654435761U
+#define PRIME32_2	2246822519U
+#define PRIME32_3	3266489917U
+#define PRIME32_4	668265263U
+#define PRIME32_5	374761393U
+
+static inline u32 xxh_rotl32(u32 x, int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+static inline u32 xxh32_round(u32 acc, const u8 *p)
+{
+	acc += get_unaligned_le32(p) * PRIME32_2;
+
+	return xxh_rotl32(acc, 13) * PRIME32_1;
+}
+
+u32 xxh32(const void *input, size_t len, u32 seed)
+{
+	const u8 *p = input;
+	const u8 *end = p + len;
+	u32 h32;
+
+	if (len >= 16) {
+		const u8 *limit = end - 16;
+		u32 v1 = seed + PRIME32_1 + PRIME32_2;
+		u32 v2 = seed + PRIME32_2;
+		u32 v3 = seed;
+		u32 v4 = seed - PRIME32_1;
+
+		/* Four independent lanes, 16 bytes at a time */
+		do {
+			v1 = xxh32_round(v1, p);
+			v2 = xxh32_round(v2, p + 4);
+			v3 = xxh32_round(v3, p + 8);
+			v4 = xxh32_round(v4, p + 12);
+			p += 16;
+		} while (p <= limit);
+
+		h32 = xxh_rotl32(v1, 1) + xxh_rotl32(v2, 7) +
+			xxh_rotl32(v3, 12) + xxh_rotl32(v4, 18);
+	} else {
+		h32 = seed + PRIME32_5;
+	}
+	h32 += (u32)len;
+
+	for (; p + 4 <= end; p += 4) {
+		h32 += get_unaligned_le32(p) * PRIME32_3;
+		h32 = xxh_rotl32(h32, 17) * PRIME32_4;
+	}
+	for (; p < end; p++) {
+		h32 += *p * PRIME32_5;
+		h32 = xxh_rotl32(h32, 11) * PRIME32_1;
+	}
+
+	h32 ^= h32 >> 15;
+	h32 *= PRIME32_2;
+	h32 ^= h32 >> 13;
+	h32 *= PRIME32_3;
+	h32 ^= h32 >> 16;
+
+	return h32;
+}
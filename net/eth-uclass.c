@@ -37,6 +37,27 @@ struct eth_uclass_priv {
 /* eth_errno - This stores the most recent failure code from DM functions */
 static int eth_errno;
 
+/**
+ * struct eth_rx_direct - A request to receive the next payload in place
+ *
+ * @dst: Where the payload belongs, or NULL if there is no request
+ * @hdr_len: Number of bytes in front of the payload
+ * @max_len: Most bytes of payload expected
+ * @lent: Buffer given to the driver, or NULL if none
+ * @saved_len: Number of bytes saved from the start of @lent
+ * @saved: The bytes which were at the start of @lent
+ */
+struct eth_rx_direct {
+	uchar *dst;
+	int hdr_len;
+	int max_len;
+	uchar *lent;
+	int saved_len;
+	uchar saved[ETH_RX_DIRECT_MAX_HDR];
+};
+
+static struct eth_rx_direct eth_rx_direct;
+
 static struct eth_uclass_priv *eth_get_uclass_priv(void)
 {
 	struct uclass *uc;
@@ -345,6 +366,42 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+void eth_rx_direct_set(void *dst, int hdr_len, int max_len)
+{
+	struct eth_rx_direct *rxd = &eth_rx_direct;
+
+	if (hdr_len > ETH_RX_DIRECT_MAX_HDR || max_len <= 0)
+		dst = NULL;
+	rxd->dst = dst;
+	rxd->hdr_len = hdr_len;
+	rxd->max_len = max_len;
+}
+
+uchar *eth_rx_direct_buf(int *sizep)
+{
+	struct eth_rx_direct *rxd = &eth_rx_direct;
+
+	if (!rxd->dst || rxd->lent)
+		return NULL;
+	rxd->lent = rxd->dst - rxd->hdr_len;
+	rxd->saved_len = rxd->hdr_len;
+	memcpy(rxd->saved, rxd->lent, rxd->saved_len);
+	*sizep = rxd->hdr_len + rxd->max_len;
+
+	return rxd->lent;
+}
+
+/* Put back the bytes which the headers of a packet received in place hid */
+static void eth_rx_direct_done(void)
+{
+	struct eth_rx_direct *rxd = &eth_rx_direct;
+
+	if (rxd->lent) {
+		memcpy(rxd->lent, rxd->saved, rxd->saved_len);
+		rxd->lent = NULL;
+	}
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
@@ -369,6 +426,7 @@ int eth_rx(void)
 			net_process_received_packet(packet, ret);
 		if (ret >= 0 && eth_get_ops(current)->free_pkt)
 			eth_get_ops(current)->free_pkt(current, packet, ret);
+		eth_rx_direct_done();
 		if (ret <= 0)
 			break;
 	}
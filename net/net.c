@@ -170,6 +170,9 @@ char net_boot_file_name[1024];
 u32 net_boot_file_size;
 /* Boot file size in blocks as reported by the DHCP server */
 u32 net_boot_file_expected_size_in_blocks;
+/* Received payloads copied to where they belong, or already there */
+ulong net_rx_copied;
+ulong net_rx_in_place;
 
 #if defined(CONFIG_CMD_SNTP)
 /* NTP server IP address */
@@ -418,6 +421,7 @@ restart:
 	net_busy_flag = 0;
 #endif
 	net_set_state(NETLOOP_CONTINUE);
+	eth_rx_direct_set(NULL, 0, 0);
 
 	/*
 	 *	Start the ball rolling with the given start function.  From
@@ -644,6 +648,7 @@ done:
 #ifdef CONFIG_USB_KEYBOARD
 	net_busy_flag = 0;
 #endif
+	eth_rx_direct_set(NULL, 0, 0);
 #ifdef CONFIG_CMD_TFTPPUT
 	/* Clear out the handlers */
 	net_set_udp_handler(NULL);
@@ -836,6 +841,14 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 #endif
 #define IP_PKTSIZE (CONFIG_NET_MAXDEFRAG)
 
+/*
+ * Number of packets which can be assembled at once, for when the fragments
+ * of several replies (e.g. to pipelined NFS reads) arrive interleaved
+ */
+#ifndef CONFIG_NET_DEFRAG_SLOTS
+#define CONFIG_NET_DEFRAG_SLOTS 4
+#endif
+
 #define IP_MAXUDP (IP_PKTSIZE - IP_HDR_SIZE)
 
 /*
@@ -850,33 +863,74 @@ struct hole {
 	u16 unused;
 };
 
+/* A packet being assembled */
+struct defrag_slot {
+	uchar pkt_buff[IP_PKTSIZE] __aligned(PKTALIGN);
+	u16 first_hole;
+	u16 total_len;		/* 0 if the slot is free */
+	ulong last_used;	/* 0 if the slot is free */
+};
+
+static struct defrag_slot defrag_slots[CONFIG_NET_DEFRAG_SLOTS];
+
+/*
+ * Find the slot assembling the packet which this fragment belongs to. For a
+ * new packet use a free slot, or else drop the one left alone the longest.
+ */
+static struct defrag_slot *net_defrag_slot(struct ip_udp_hdr *ip)
+{
+	static ulong use_count;
+	struct defrag_slot *slot, *oldest = NULL;
+	struct ip_udp_hdr *localip;
+	int i;
+
+	for (i = 0; i < CONFIG_NET_DEFRAG_SLOTS; i++) {
+		slot = &defrag_slots[i];
+		localip = (struct ip_udp_hdr *)slot->pkt_buff;
+		if (slot->total_len && localip->ip_id == ip->ip_id &&
+		    localip->ip_src.s_addr == ip->ip_src.s_addr)
+			goto found;
+		if (!oldest || slot->last_used < oldest->last_used)
+			oldest = slot;
+	}
+	slot = oldest;
+	slot->total_len = 0;
+found:
+	slot->last_used = ++use_count;
+
+	return slot;
+}
+
 static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 {
-	static uchar pkt_buff[IP_PKTSIZE] __aligned(PKTALIGN);
-	static u16 first_hole, total_len;
+	struct defrag_slot *slot;
 	struct hole *payload, *thisfrag, *h, *newh;
-	struct ip_udp_hdr *localip = (struct ip_udp_hdr *)pkt_buff;
+	struct ip_udp_hdr *localip;
 	uchar *indata = (uchar *)ip;
 	int offset8, start, len, done = 0;
 	u16 ip_off = ntohs(ip->ip_off);
 
-	/* payload starts after IP header, this fragment is in there */
-	payload = (struct hole *)(pkt_buff + IP_HDR_SIZE);
 	offset8 =  (ip_off & IP_OFFS);
-	thisfrag = payload + offset8;
 	start = offset8 * 8;
 	len = ntohs(ip->ip_len) - IP_HDR_SIZE;
 
 	if (start + len > IP_MAXUDP) /* fragment extends too far */
 		return NULL;
 
-	if (!total_len || localip->ip_id != ip->ip_id) {
-		/* new (or different) packet, reset structs */
-		total_len = 0xffff;
+	slot = net_defrag_slot(ip);
+	localip = (struct ip_udp_hdr *)slot->pkt_buff;
+
+	/* payload starts after IP header, this fragment is in there */
+	payload = (struct hole *)(slot->pkt_buff + IP_HDR_SIZE);
+	thisfrag = payload + offset8;
+
+	if (!slot->total_len) {
+		/* new packet, reset structs */
+		slot->total_len = 0xffff;
 		payload[0].last_byte = ~0;
 		payload[0].next_hole = 0;
 		payload[0].prev_hole = 0;
-		first_hole = 0;
+		slot->first_hole = 0;
 		/* any IP header will work, copy the first we received */
 		memcpy(localip, ip, IP_HDR_SIZE);
 	}
@@ -888,7 +942,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 	 * so it is represented as byte count, not as 8-byte blocks.
 	 */
 
-	h = payload + first_hole;
+	h = payload + slot->first_hole;
 	while (h->last_byte < start) {
 		if (!h->next_hole) {
 			/* no hole that far away */
@@ -905,7 +959,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 
 	if (!(ip_off & IP_FLAGS_MFRAG)) {
 		/* no more fragmentss: truncate this (last) hole */
-		total_len = start + len;
+		slot->total_len = start + len;
 		h->last_byte = start + len;
 	}
 
@@ -922,7 +976,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 			done = 1;
 		} else if (!h->prev_hole) {
 			/* first hole */
-			first_hole = h->next_hole;
+			slot->first_hole = h->next_hole;
 			payload[h->next_hole].prev_hole = 0;
 		} else if (!h->next_hole) {
 			/* last hole */
@@ -947,7 +1001,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 		if (h->prev_hole)
 			payload[h->prev_hole].next_hole = (h - payload);
 		else
-			first_hole = (h - payload);
+			slot->first_hole = (h - payload);
 
 	} else {
 		/* fragment sits in the middle: split the hole */
@@ -965,8 +1019,11 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 	if (!done)
 		return NULL;
 
-	localip->ip_len = htons(total_len);
-	*lenp = total_len + IP_HDR_SIZE;
+	localip->ip_len = htons(slot->total_len);
+	*lenp = slot->total_len + IP_HDR_SIZE;
+	/* the packet stays in place until the next fragment arrives */
+	slot->total_len = 0;
+	slot->last_used = 0;
 	return localip;
 }
 
@@ -26,6 +26,11 @@
  * NFSv2 is still used by default. But if server does not support NFSv2, then
  * NFSv3 is used, if available on NFS server. */
 
+/* NOTE 5: The file is read with a window of several READ calls in flight, so
+ * that the link is not idle for a round trip after each block. Replies may
+ * come back in any order; each is matched to its call by the RPC id and
+ * stored at its own offset. */
+
 #include <common.h>
 #include <command.h>
 #include <net.h>
@@ -45,12 +50,31 @@
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
+#ifndef CONFIG_NFS_READ_WINDOW
+#define CONFIG_NFS_READ_WINDOW	1
+#endif
+#define NFS_MAX_READ_WINDOW	16
+
+/* Enough of a READ reply to reach the data, for NFSv2 or NFSv3 */
+#define NFS_READ_REPLY_HDR	(sizeof(uint32_t) * (6 + 26))
+
 static int fs_mounted;
 static unsigned long rpc_id;
 static int nfs_offset = -1;
 static int nfs_len;
 static ulong nfs_timeout = NFS_TIMEOUT;
 
+/* A READ call waiting for its reply */
+struct nfs_read_slot {
+	unsigned long id;	/* RPC id of the call, 0 if the slot is free */
+	int offset;
+	int len;
+};
+
+static struct nfs_read_slot nfs_read_slots[NFS_MAX_READ_WINDOW];
+static int nfs_read_window;	/* Number of slots in use for this file */
+static int nfs_read_end;	/* End of the file once known, else -1 */
+
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
 static char filefh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle */
 static int filefh3_length;	/* (variable) length of filefh when NFSv3 */
@@ -104,6 +128,7 @@ static inline int store_block(uchar *src, unsigned offset, unsigned len)
 		void *ptr = map_sysmem(load_addr + offset, len);
 
 		memcpy(ptr, src, len);
+		net_rx_copied++;
 		unmap_sysmem(ptr);
 	}
 
@@ -386,6 +411,68 @@ static void nfs_read_req(int offset, int readlen)
 	rpc_req(PROG_NFS, NFS_READ, data, len);
 }
 
+/* Send the READ call for a slot, which gets a new RPC id */
+static void nfs_read_slot_send(struct nfs_read_slot *slot)
+{
+	nfs_read_req(slot->offset, slot->len);
+	slot->id = rpc_id;
+}
+
+/* Use the free slots to ask for the next parts of the file */
+static void nfs_read_fill(void)
+{
+	struct nfs_read_slot *slot;
+	int i;
+
+	for (i = 0; i < nfs_read_window; i++) {
+		slot = &nfs_read_slots[i];
+		if (slot->id)
+			continue;
+		if (nfs_read_end >= 0 && nfs_offset >= nfs_read_end)
+			break;
+		slot->offset = nfs_offset;
+		slot->len = nfs_len;
+		nfs_offset += nfs_len;
+		nfs_read_slot_send(slot);
+	}
+}
+
+/* Send again each READ call which has had no reply */
+static void nfs_read_resend(void)
+{
+	int i;
+
+	for (i = 0; i < nfs_read_window; i++) {
+		if (nfs_read_slots[i].id)
+			nfs_read_slot_send(&nfs_read_slots[i]);
+	}
+}
+
+static bool nfs_read_busy(void)
+{
+	int i;
+
+	for (i = 0; i < nfs_read_window; i++) {
+		if (nfs_read_slots[i].id)
+			return true;
+	}
+
+	return false;
+}
+
+static void nfs_read_start(void)
+{
+	ulong window;
+
+	window = getenv_ulong("nfswindowsize", 10, CONFIG_NFS_READ_WINDOW);
+	nfs_read_window = clamp(window, 1UL, (ulong)NFS_MAX_READ_WINDOW);
+	memset(nfs_read_slots, '\0', sizeof(nfs_read_slots));
+	nfs_read_end = -1;
+	nfs_offset = 0;
+	nfs_len = NFS_READ_SIZE;
+	nfs_read_fill();
+}
+
 /**************************************************************************
 RPC request dispatcher
 **************************************************************************/
@@ -416,7 +503,7 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_resend();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
@@ -655,16 +742,27 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 static int nfs_read_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
-	int rlen;
+	struct nfs_read_slot *slot = NULL;
+	unsigned long id;
+	int rlen, offset, i;
 	uchar *data_ptr;
+	bool eof;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	/* Only the header is needed here; the data is stored from pkt */
+	memset(&rpc_pkt, '\0', NFS_READ_REPLY_HDR);
+	memcpy(&rpc_pkt.u.data[0], pkt, min_t(unsigned, len,
+					      NFS_READ_REPLY_HDR));
 
-	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
+	id = ntohl(rpc_pkt.u.reply.id);
+	if (id > rpc_id)
 		return -NFS_RPC_ERR;
-	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
+	for (i = 0; i < nfs_read_window; i++) {
+		if (id && nfs_read_slots[i].id == id)
+			slot = &nfs_read_slots[i];
+	}
+	if (!slot)	/* e.g. a late reply to a call which was sent again */
 		return -NFS_RPC_DROP;
 
 	if (rpc_pkt.u.reply.rstatus  ||
@@ -678,31 +776,52 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
+	offset = slot->offset;
+	if ((offset != 0) && !((offset) %
 			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
 		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
+	if (!(offset % ((NFS_READ_SIZE / 2) * 10)))
 		putc('#');
 
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
 		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
+		/* There is no EOF flag, so compare with the file size */
+		eof = offset + rlen >= ntohl(rpc_pkt.u.reply.data[6]);
 	} else {  /* NFSV3_FLAG */
 		int nfsv3_data_offset =
 			nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
 
 		/* count value */
 		rlen = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
+		eof = rpc_pkt.u.reply.data[2 + nfsv3_data_offset] != 0;
 		/* Skip unused values :
-			EOF:		32 bits value,
 			data_size:	32 bits value,
 		*/
 		data_ptr = (uchar *)
 			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
 	}
 
-	if (store_block(data_ptr, nfs_offset, rlen))
-			return -9999;
+	data_ptr = pkt + (data_ptr - (uchar *)&rpc_pkt);
+	if (rlen < 0 || rlen > slot->len || data_ptr + rlen > pkt + len)
+		return -9999;
+
+	/* Reads past the end of the file must not change its size */
+	if (rlen && store_block(data_ptr, offset, rlen))
+		return -9999;
+
+	if (eof || !rlen) {
+		if (nfs_read_end < 0 || offset + rlen < nfs_read_end)
+			nfs_read_end = offset + rlen;
+		slot->id = 0;
+	} else if (rlen < slot->len) {
+		/* Short read: ask for the rest */
+		slot->offset += rlen;
+		slot->len -= rlen;
+		nfs_read_slot_send(slot);
+	} else {
+		slot->id = 0;
+	}
 
 	return rlen;
 }
@@ -796,9 +915,7 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_send();
 		} else {
 			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
-			nfs_send();
+			nfs_read_start();
 		}
 		break;
 
@@ -822,19 +939,23 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 	case STATE_READ_REQ:
 		rlen = nfs_read_reply(pkt, len);
+		if (rlen == -NFS_RPC_DROP)
+			break;
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
+		if (rlen >= 0) {
+			nfs_read_fill();
+			if (nfs_read_busy())
+				break;
+			nfs_download_state = NETLOOP_SUCCESS;
+			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
+			memset(nfs_read_slots, '\0', sizeof(nfs_read_slots));
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
-				debug("NFS READ error (%d)\n", rlen);
+			debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		}
@@ -38,11 +38,15 @@
 
 /* Block size used for NFS read accesses.  A RPC reply packet (including  all
  * headers) must fit within a single Ethernet frame to avoid fragmentation.
- * However, if CONFIG_IP_DEFRAG is set, the config file may want to use a
- * bigger value. In any case, most NFS servers are optimized for a power of 2.
+ * However, if CONFIG_IP_DEFRAG is set, a bigger value is used by default, as
+ * fragmented replies are put back together. In any case, most NFS servers are
+ * optimized for a power of 2.
  */
 #ifdef CONFIG_NFS_READ_SIZE
 #define NFS_READ_SIZE CONFIG_NFS_READ_SIZE
+#elif defined(CONFIG_IP_DEFRAG) && \
+	(!defined(CONFIG_NET_MAXDEFRAG) || CONFIG_NET_MAXDEFRAG >= 4096 + 256)
+#define NFS_READ_SIZE 4096 /* leaves room for the headers when reassembled */
 #else
 #define NFS_READ_SIZE 1024 /* biggest power of two that fits Ether frame */
 #endif
@@ -7,6 +7,7 @@
  */
 
 #include <common.h>
+#include <bootm.h>
 #include <command.h>
 #include <efi_loader.h>
 #include <mapmem.h>
@@ -134,6 +135,30 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440 windowsize: number of blocks the server may send before it waits
+ * for an ACK. The receive window is tracked in a small ring indexed by the
+ * low bits of the block number, so it must be a power of two.
+ */
+#define TFTP_MAX_WINDOWSIZE	64
+#ifdef CONFIG_TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE	CONFIG_TFTP_WINDOWSIZE
+#else
+#define TFTP_WINDOWSIZE	1
+#endif
+
+static unsigned short tftp_windowsize = 1;
+/* set when the file goes to bootm_stream_write(), which needs it in order */
+static int tftp_stream;
+static unsigned short tftp_windowsize_option = TFTP_WINDOWSIZE;
+/* block number after which we owe the server an ACK */
+static ushort	tftp_next_ack;
+/* blocks received ahead of tftp_prev_block, indexed by block number */
+static uchar	tftp_window_map[TFTP_MAX_WINDOWSIZE];
+/* number of the final (short) block, once it has been received */
+static ushort	tftp_final_block;
+static int	tftp_final_block_seen;
+
 #ifdef CONFIG_MCAST_TFTP
 #include <malloc.h>
 #define MTFTP_BITMAPSIZE	0x1000
@@ -170,7 +195,22 @@ static inline void store_block(int block, uchar *src, unsigned len)
 	ulong newsize = offset + len;
 #ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 	int i, rc = 0;
+#endif
 
+	if (tftp_stream) {
+		/* A block we already have is sent again if our ACK was lost */
+		if (offset < net_boot_file_size)
+			return;
+		if (offset > net_boot_file_size ||
+		    bootm_stream_write(src, len)) {
+			puts("\nTFTP error: cannot stream file\n");
+			net_set_state(NETLOOP_FAIL);
+			return;
+		}
+		net_boot_file_size = newsize;
+		return;
+	}
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 	for (i = 0; i < CONFIG_SYS_MAX_FLASH_BANKS; i++) {
 		/* start address in flash? */
 		if (flash_info[i].flash_id == FLASH_UNKNOWN)
@@ -193,7 +233,13 @@ static inline void store_block(int block, uchar *src, unsigned len)
 	{
 		void *ptr = map_sysmem(load_addr + offset, len);
 
-		memcpy(ptr, src, len);
+		/* The block may have been received in place */
+		if (ptr != src) {
+			memcpy(ptr, src, len);
+			net_rx_copied++;
+		} else {
+			net_rx_in_place++;
+		}
 		unmap_sysmem(ptr);
 	}
 #ifdef CONFIG_MCAST_TFTP
@@ -205,12 +251,47 @@ static inline void store_block(int block, uchar *src, unsigned len)
 		net_boot_file_size = newsize;
 }
 
+/*
+ * Ask for the next block in sequence to be received straight into place. This
+ * is not done for the first block, as its headers would go in front of the
+ * load address, nor once the transfer is over.
+ */
+static void tftp_rx_direct(void)
+{
+#ifndef CONFIG_SYS_DIRECT_FLASH_TFTP
+	int hdr_len = net_eth_hdr_size() + IP_UDP_HDR_SIZE + 4;
+	ushort block = tftp_prev_block + 1;
+	int len = tftp_block_size;
+	ulong offset;
+
+	offset = (ulong)(block - 1) * tftp_block_size + tftp_block_wrap_offset;
+#ifdef CONFIG_TFTP_TSIZE
+	if (tftp_tsize)
+		len = min_t(long, len, tftp_tsize - (long)offset);
+#endif
+#ifdef CONFIG_MCAST_TFTP
+	if (tftp_mcast_active)
+		len = 0;
+#endif
+	if (!tftp_stream && net_state == NETLOOP_CONTINUE && block &&
+	    offset >= hdr_len && len > 0) {
+		eth_rx_direct_set(map_sysmem(load_addr + offset, len), hdr_len,
+				  len);
+		return;
+	}
+#endif
+	eth_rx_direct_set(NULL, 0, 0);
+}
+
 /* Clear our state ready for a new transfer */
 static void new_transfer(void)
 {
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	tftp_next_ack = tftp_windowsize;
+	tftp_final_block_seen = 0;
+	memset(tftp_window_map, '\0', sizeof(tftp_window_map));
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
@@ -322,6 +403,16 @@ static void tftp_complete(void)
 			time_start * 1000, "/s");
 	}
 	puts("\ndone\n");
+	if (tftp_stream) {
+		ulong size;
+
+		tftp_stream = 0;
+		if (bootm_stream_end(&size)) {
+			net_set_state(NETLOOP_FAIL);
+			return;
+		}
+		net_boot_file_size = size;
+	}
 	net_set_state(NETLOOP_SUCCESS);
 }
 
@@ -372,9 +463,14 @@ static void tftp_send(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
+		/* ask for several blocks per ACK (RFC 7440) */
+		if (tftp_state == STATE_SEND_RRQ && tftp_windowsize_option > 1 &&
+		    !tftp_stream)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, tftp_windowsize_option, 0);
 #ifdef CONFIG_MCAST_TFTP
 		/* Check all preconditions before even trying the option */
-		if (!tftp_mcast_disabled) {
+		if (!tftp_mcast_disabled && !tftp_stream) {
 			tftp_mcast_bitmap = malloc(tftp_mcast_bitmap_size);
 			if (tftp_mcast_bitmap && eth_get_dev()->mcast) {
 				free(tftp_mcast_bitmap);
@@ -404,6 +500,8 @@ static void tftp_send(void)
 		s[0] = htons(TFTP_ACK);
 		s[1] = htons(tftp_cur_block);
 		pkt = (uchar *)(s + 2);
+		/* The server now sends the next window after this block */
+		tftp_next_ack = tftp_cur_block + tftp_windowsize;
 #ifdef CONFIG_CMD_TFTPPUT
 		if (tftp_put_active) {
 			int toload = tftp_block_size;
@@ -445,6 +543,68 @@ static void tftp_send(void)
 			    tftp_remote_port, tftp_our_port, len);
 }
 
+/**
+ * Handle a data block while more than one block may be in flight
+ *
+ * Blocks inside the current window are written straight to their final
+ * location, even when they arrive out of order, and are remembered in
+ * tftp_window_map until the gap in front of them is filled. We ACK the last
+ * in-order block when the final block of the window turns up, so anything
+ * that was lost on the way is sent again in the next window.
+ *
+ * @param pkt	Block payload
+ * @param len	Number of bytes in the payload
+ */
+static void tftp_window_recv(uchar *pkt, unsigned len)
+{
+	ushort block = tftp_cur_block;
+	ushort ahead = block - tftp_prev_block - 1;
+	int slot = block & (TFTP_MAX_WINDOWSIZE - 1);
+
+	/* Blocks from before the window are duplicates; ignore them */
+	if (ahead >= tftp_windowsize) {
+		tftp_cur_block = tftp_prev_block;
+		return;
+	}
+
+	if (!tftp_window_map[slot]) {
+		store_block(tftp_prev_block + ahead, pkt, len);
+		tftp_window_map[slot] = 1;
+		if (len < tftp_block_size) {
+			tftp_final_block = block;
+			tftp_final_block_seen = 1;
+		}
+		timeout_count_max = tftp_timeout_count_max;
+		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+	}
+
+	/* Advance over everything we now hold in sequence */
+	for (;;) {
+		slot = (tftp_prev_block + 1) & (TFTP_MAX_WINDOWSIZE - 1);
+		if (!tftp_window_map[slot])
+			break;
+		tftp_window_map[slot] = 0;
+		tftp_cur_block = (ushort)(tftp_prev_block + 1);
+		update_block_number();
+		tftp_prev_block = tftp_cur_block;
+	}
+	tftp_cur_block = tftp_prev_block;
+
+	if (tftp_final_block_seen && tftp_prev_block == tftp_final_block) {
+		tftp_send();
+		tftp_complete();
+		return;
+	}
+
+	/*
+	 * ACK at the end of each window. If blocks are missing this names
+	 * the last one we have, and the server restarts from there.
+	 */
+	if (block == tftp_next_ack ||
+	    (ushort)(tftp_prev_block - tftp_next_ack) < tftp_windowsize)
+		tftp_send();
+}
+
 #ifdef CONFIG_CMD_TFTPPUT
 static void icmp_handler(unsigned type, unsigned code, unsigned dest,
 			 struct in_addr sip, unsigned src, uchar *pkt,
@@ -540,6 +700,17 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("Blocksize ack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
 			}
+			if (strcmp((char *)pkt + i, "windowsize") == 0) {
+				tftp_windowsize = (unsigned short)
+					simple_strtoul((char *)pkt + i + 11,
+						       NULL, 10);
+				if (tftp_windowsize > tftp_windowsize_option)
+					tftp_windowsize = tftp_windowsize_option;
+				if (!tftp_windowsize)
+					tftp_windowsize = 1;
+				debug("Windowsize ack: %s, %d\n",
+				      (char *)pkt + i + 11, tftp_windowsize);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				tftp_tsize = simple_strtoul((char *)pkt + i + 6,
@@ -551,6 +722,9 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		}
 #ifdef CONFIG_MCAST_TFTP
 		parse_multicast_oack((char *)pkt, len - 1);
+		/* multicast tracks missing blocks itself, one at a time */
+		if (tftp_mcast_active)
+			tftp_windowsize = 1;
 		if ((tftp_mcast_active) && (!tftp_mcast_master_client))
 			tftp_state = STATE_DATA;	/* passive.. */
 		else
@@ -570,7 +744,8 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		len -= 2;
 		tftp_cur_block = ntohs(*(__be16 *)pkt);
 
-		update_block_number();
+		if (tftp_windowsize == 1)
+			update_block_number();
 
 		if (tftp_state == STATE_SEND_RRQ)
 			debug("Server did not acknowledge timeout option!\n");
@@ -587,7 +762,8 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				tftp_prev_block = tftp_cur_block - 1;
 			} else
 #endif
-			if (tftp_cur_block != 1) {	/* Assertion */
+			if ((ushort)(tftp_cur_block - 1) >=
+			    tftp_windowsize) {	/* Assertion */
 				puts("\nTFTP error: ");
 				printf("First block is not block 1 (%ld)\n",
 				       tftp_cur_block);
@@ -597,6 +773,12 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			}
 		}
 
+		if (tftp_windowsize > 1) {
+			tftp_window_recv(pkt + 2, len);
+			tftp_rx_direct();
+			break;
+		}
+
 		if (tftp_cur_block == tftp_prev_block) {
 			/* Same block again; ignore it. */
 			break;
@@ -652,6 +834,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 #endif
 		if (len < tftp_block_size)
 			tftp_complete();
+		tftp_rx_direct();
 		break;
 
 	case TFTP_ERROR:
@@ -710,6 +893,16 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_block_size_option = simple_strtol(ep, NULL, 10);
 
+	ep = getenv("tftpwindowsize");
+	if (ep != NULL)
+		tftp_windowsize_option = simple_strtol(ep, NULL, 10);
+
+	if (tftp_windowsize_option > TFTP_MAX_WINDOWSIZE) {
+		printf("TFTP windowsize (%d) too large, set max = %d\n",
+		       tftp_windowsize_option, TFTP_MAX_WINDOWSIZE);
+		tftp_windowsize_option = TFTP_MAX_WINDOWSIZE;
+	}
+
 	ep = getenv("tftptimeout");
 	if (ep != NULL)
 		timeout_ms = simple_strtol(ep, NULL, 10);
@@ -731,8 +924,8 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-	      tftp_block_size_option, timeout_ms);
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+	      tftp_block_size_option, tftp_windowsize_option, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
 	if (net_boot_file_name[0] == '\0') {
@@ -805,6 +998,8 @@ void tftp_start(enum proto_t protocol)
 		printf("Load address: 0x%lx\n", load_addr);
 		puts("Loading: *\b");
 		tftp_state = STATE_SEND_RRQ;
+		/* Blocks then have to arrive in order, one per ACK */
+		tftp_stream = bootm_stream_start(load_addr);
 		efi_set_bootdev("Net", "", tftp_filename);
 	}
 
@@ -833,8 +1028,9 @@ void tftp_start(enum proto_t protocol)
 
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_windowsize to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
 #ifdef CONFIG_MCAST_TFTP
 	mcast_cleanup();
 #endif
@@ -850,6 +1046,7 @@ void tftp_start(enum proto_t protocol)
 void tftp_start_server(void)
 {
 	tftp_filename[0] = 0;
+	tftp_stream = 0;
 
 	printf("Using %s device\n", eth_get_name());
 	printf("Listening for TFTP transfer on %pI4\n", &net_ip);
@@ -862,8 +1059,9 @@ void tftp_start_server(void)
 	timeout_ms = TIMEOUT;
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_windowsize to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
 	tftp_cur_block = 0;
 	tftp_our_port = WELL_KNOWN_PORT;
 
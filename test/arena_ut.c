@@ -0,0 +1,212 @@
+/*
+ * Tests for the scoped arena allocator
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <arena.h>
+#include <command.h>
+#include <errno.h>
+#include <malloc.h>
+
+/*
+ * dlmalloc only has mallinfo() with DEBUG, which sandbox sets, so leaks are
+ * only checked there
+ */
+static int arena_heap_used(void)
+{
+#ifdef CONFIG_SANDBOX
+	return mallinfo().uordblks;
+#else
+	return 0;
+#endif
+}
+
+/* With no arena, memory comes from malloc() and goes back with free() */
+static int test_no_arena(void)
+{
+	int start = arena_heap_used();
+	int ret = 0;
+	u8 *ptr;
+
+	ptr = arena_memalign(ARCH_DMA_MINALIGN, 100);
+	if (!ptr || (ulong)ptr & (ARCH_DMA_MINALIGN - 1) ||
+	    malloc_usable_size(ptr) < 100) {
+		printf("%s: memory not from malloc()\n", __func__);
+		ret = -EINVAL;
+	}
+	arena_free(ptr);
+	arena_free(NULL);
+	if (arena_heap_used() != start) {
+		printf("%s: leak of %d bytes\n", __func__,
+		       arena_heap_used() - start);
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+/* Allocations are separate and aligned, and all go at once */
+static int test_alloc(void)
+{
+	int start = arena_heap_used();
+	struct arena arena;
+	u8 *ptr[20], *big;
+	int i, j, ret = 0;
+
+	arena_begin(&arena);
+	for (i = 0; i < ARRAY_SIZE(ptr); i++) {
+		ptr[i] = i & 1 ? arena_zalloc(i * 50) :
+			 arena_memalign(ARCH_DMA_MINALIGN, i * 50);
+		if (!ptr[i] || (ulong)ptr[i] & (ARENA_ALIGN - 1) ||
+		    (!(i & 1) && (ulong)ptr[i] & (ARCH_DMA_MINALIGN - 1))) {
+			printf("%s: bad allocation %d: %p\n", __func__, i,
+			       ptr[i]);
+			ret = -EINVAL;
+			goto out;
+		}
+		for (j = 0; j < i * 50; j++) {
+			if ((i & 1) && ptr[i][j]) {
+				printf("%s: not zeroed\n", __func__);
+				ret = -EINVAL;
+			}
+		}
+		memset(ptr[i], i, i * 50);
+	}
+
+	/* Larger than a chunk */
+	big = arena_alloc(CONFIG_ARENA_CHUNK_SIZE * 2);
+	if (!big) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	memset(big, 0xff, CONFIG_ARENA_CHUNK_SIZE * 2);
+
+	for (i = 0; i < ARRAY_SIZE(ptr); i++) {
+		for (j = 0; j < i * 50; j++) {
+			if (ptr[i][j] != i) {
+				printf("%s: allocation %d overwritten\n",
+				       __func__, i);
+				ret = -EINVAL;
+				goto out;
+			}
+		}
+	}
+	if (arena.allocs != ARRAY_SIZE(ptr) + 1 ||
+	    arena.held < CONFIG_ARENA_CHUNK_SIZE * 3) {
+		printf("%s: %u allocations in %lu bytes\n", __func__,
+		       arena.allocs, arena.held);
+		ret = -EINVAL;
+	}
+
+out:
+	arena_release(&arena);
+	arena_release(&arena);
+	if (arena_heap_used() != start) {
+		printf("%s: leak of %d bytes\n", __func__,
+		       arena_heap_used() - start);
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+/* Memory freed in reverse order is used again; other frees wait */
+static int test_free(void)
+{
+	struct arena arena;
+	u8 *a, *b, *c, *big;
+	ulong held;
+	int i, ret = 0;
+
+	arena_begin(&arena);
+	a = arena_alloc(64);
+	b = arena_alloc(64);
+	c = arena_alloc(64);
+	arena_free(c);
+	arena_free(b);
+	if (arena_alloc(64) != b || arena_alloc(64) != c) {
+		printf("%s: memory not used again\n", __func__);
+		ret = -EINVAL;
+	}
+
+	/* a is not the last allocation, so it stays */
+	arena_free(a);
+	if (arena_alloc(16) == a) {
+		printf("%s: memory in use given out again\n", __func__);
+		ret = -EINVAL;
+	}
+
+	/* A loop which frees what it allocates does not grow the arena */
+	held = arena.held;
+	for (i = 0; i < 100; i++) {
+		a = arena_alloc(CONFIG_ARENA_CHUNK_SIZE / 2);
+		b = arena_memalign(ARCH_DMA_MINALIGN,
+				   CONFIG_ARENA_CHUNK_SIZE / 2);
+		if (!a || !b) {
+			ret = -ENOMEM;
+			break;
+		}
+		arena_free(b);
+		arena_free(a);
+	}
+	big = arena_alloc(CONFIG_ARENA_CHUNK_SIZE * 4);
+	arena_free(big);
+	if (arena.held > held + CONFIG_ARENA_CHUNK_SIZE) {
+		printf("%s: arena grew from %lu to %lu bytes\n", __func__,
+		       held, arena.held);
+		ret = -EINVAL;
+	}
+	arena_release(&arena);
+
+	return ret;
+}
+
+/* Arenas nest, and malloc() memory can be freed while one is active */
+static int test_nest(void)
+{
+	int start = arena_heap_used();
+	struct arena outer, inner;
+	u8 *heap, *a, *b;
+	int ret = 0;
+
+	heap = malloc(100);
+	arena_begin(&outer);
+	a = arena_alloc(32);
+	arena_begin(&inner);
+	b = arena_alloc(32);
+	arena_free(heap);
+	arena_free(a);
+	if (!inner.allocs || inner.allocs != outer.allocs) {
+		printf("%s: wrong arena used\n", __func__);
+		ret = -EINVAL;
+	}
+	arena_release(&inner);
+	if (!b || arena_alloc(32) == b || outer.allocs != 2) {
+		printf("%s: outer arena not used again\n", __func__);
+		ret = -EINVAL;
+	}
+	arena_release(&outer);
+
+	if (arena_heap_used() != start) {
+		printf("%s: leak of %d bytes\n", __func__,
+		       arena_heap_used() - start);
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+int do_ut_arena(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	int ret = 0;
+
+	ret |= test_no_arena();
+	ret |= test_alloc();
+	ret |= test_free();
+	ret |= test_nest();
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
@@ -0,0 +1,177 @@
+/*
+ * Tests for bootstage timing spans
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <malloc.h>
+
+/**
+ * Get the trace in a buffer from malloc()
+ *
+ * Open spans grow while the trace is written, so leave some room.
+ */
+static char *get_trace(void)
+{
+	int size = bootstage_trace(NULL, 0) + 64;
+	char *buf;
+
+	buf = malloc(size);
+	if (buf && bootstage_trace(buf, size) >= size) {
+		free(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+
+/**
+ * Find the last event in a trace with the given name
+ *
+ * @param trace	Trace to search
+ * @param name	JSON for the name, including the quotes
+ * @param tsp	Returns the start time
+ * @param durp	Returns the duration
+ * @return 0 if found, -ENOENT if not
+ */
+static int find_event(const char *trace, const char *name, ulong *tsp,
+		      ulong *durp)
+{
+	const char *p, *found = NULL;
+	char key[40];
+
+	snprintf(key, sizeof(key), "{\"name\":%s,", name);
+	for (p = trace; (p = strstr(p, key)); p++)
+		found = p;
+	if (!found)
+		return -ENOENT;
+	p = strstr(found, "\"ts\":");
+	*tsp = p ? simple_strtoul(p + 5, NULL, 10) : 0;
+	p = strstr(found, "\"dur\":");
+	*durp = p ? simple_strtoul(p + 6, NULL, 10) : 0;
+
+	return 0;
+}
+
+/* Spans inside others are timed inside them */
+static int test_nest(void)
+{
+	ulong outer_ts, outer_dur, inner_ts, inner_dur, code_ts, code_dur;
+	int outer, inner, code;
+	char *trace;
+	int ret = 0;
+
+	outer = bootstage_span_begin(BOOTSTAGE_SPAN_USER, "ut_outer");
+	inner = bootstage_span_begin(BOOTSTAGE_SPAN_USER, "ut_inner");
+	udelay(1000);
+	bootstage_span_end(inner);
+	code = bootstage_span_begin_addr(BOOTSTAGE_SPAN_USER, 0x1234);
+	udelay(1000);
+
+	/* Ending the outer span ends the one left open inside it too */
+	bootstage_span_end(outer);
+	if (outer == -ENOSPC || inner == -ENOSPC || code == -ENOSPC) {
+		printf("%s: span table full, skipped\n", __func__);
+		return 0;
+	}
+
+	trace = get_trace();
+	if (!trace)
+		return -ENOMEM;
+	if (find_event(trace, "\"ut_outer\"", &outer_ts, &outer_dur) ||
+	    find_event(trace, "\"ut_inner\"", &inner_ts, &inner_dur) ||
+	    find_event(trace, "\"00001234\"", &code_ts, &code_dur)) {
+		printf("%s: spans missing from trace\n", __func__);
+		ret = -ENOENT;
+	} else if (inner_dur < 1000 || outer_dur < 2000 ||
+		   inner_ts < outer_ts || code_ts < inner_ts + inner_dur ||
+		   inner_ts + inner_dur > outer_ts + outer_dur ||
+		   code_ts + code_dur > outer_ts + outer_dur) {
+		printf("%s: outer %lu+%lu, inner %lu+%lu, code %lu+%lu\n",
+		       __func__, outer_ts, outer_dur, inner_ts, inner_dur,
+		       code_ts, code_dur);
+		ret = -EINVAL;
+	}
+	free(trace);
+
+	return ret;
+}
+
+/* The boot recorded initcalls, probes, marks and this command */
+static int test_boot(void)
+{
+	static const char *const expect[] = {
+		"\"cat\":\"initcall\"",
+		"\"cat\":\"probe\"",
+		"\"cat\":\"mark\"",
+		"{\"name\":\"ut\",\"cat\":\"cmd\"",
+	};
+	char *trace;
+	int i, ret = 0;
+
+	trace = get_trace();
+	if (!trace)
+		return -ENOMEM;
+	if (strncmp(trace, "{\"traceEvents\":[", 16) ||
+	    strcmp(trace + strlen(trace) - 4, "\n]}\n")) {
+		printf("%s: trace not framed correctly\n", __func__);
+		ret = -EINVAL;
+	}
+	for (i = 0; i < ARRAY_SIZE(expect); i++) {
+		if (!strstr(trace, expect[i])) {
+			printf("%s: no %s in trace\n", __func__, expect[i]);
+			ret = -ENOENT;
+		}
+	}
+	free(trace);
+
+	return ret;
+}
+
+/* Names are escaped, and a short buffer is filled and terminated */
+static int test_trace(void)
+{
+	char buf[20];
+	char *trace;
+	ulong ts, dur;
+	int span, len, ret = 0;
+
+	span = bootstage_span_begin(BOOTSTAGE_SPAN_USER, "a\"b\\c\td");
+	bootstage_span_end(span);
+	if (span != -ENOSPC) {
+		trace = get_trace();
+		if (!trace)
+			return -ENOMEM;
+		if (find_event(trace, "\"a\\\"b\\\\c\\u0009d\"", &ts, &dur)) {
+			printf("%s: name not escaped\n", __func__);
+			ret = -EINVAL;
+		}
+		free(trace);
+	}
+
+	memset(buf, 0xff, sizeof(buf));
+	len = bootstage_trace(buf, 10);
+	if (len < 20 || strcmp(buf, "{\"traceEv") || buf[10] != (char)0xff) {
+		printf("%s: short buffer gave %d '%.10s'\n", __func__, len,
+		       buf);
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+int do_ut_bootstage(cmd_tbl_t *cmdtp, int flag, int argc,
+		    char * const argv[])
+{
+	int ret = 0;
+
+	ret |= test_nest();
+	ret |= test_boot();
+	ret |= test_trace();
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
@@ -13,15 +13,38 @@ static int do_ut_all(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
 
 static cmd_tbl_t cmd_ut_sub[] = {
 	U_BOOT_CMD_MKENT(all, CONFIG_SYS_MAXARGS, 1, do_ut_all, "", ""),
+#ifdef CONFIG_UT_ARENA
+	U_BOOT_CMD_MKENT(arena, CONFIG_SYS_MAXARGS, 1, do_ut_arena, "", ""),
+#endif
+#ifdef CONFIG_UT_BOOTSTAGE
+	U_BOOT_CMD_MKENT(bootstage, CONFIG_SYS_MAXARGS, 1, do_ut_bootstage, "",
+			 ""),
+#endif
 #if defined(CONFIG_UT_DM)
 	U_BOOT_CMD_MKENT(dm, CONFIG_SYS_MAXARGS, 1, do_ut_dm, "", ""),
 #endif
 #if defined(CONFIG_UT_ENV)
 	U_BOOT_CMD_MKENT(env, CONFIG_SYS_MAXARGS, 1, do_ut_env, "", ""),
 #endif
+#ifdef CONFIG_UT_EXT4
+	U_BOOT_CMD_MKENT(ext4, CONFIG_SYS_MAXARGS, 1, do_ut_ext4, "", ""),
+#endif
+#ifdef CONFIG_UT_FDT_INDEX
+	U_BOOT_CMD_MKENT(fdt_index, CONFIG_SYS_MAXARGS, 1, do_ut_fdt_index, "",
+			 ""),
+#endif
 #ifdef CONFIG_UT_OVERLAY
 	U_BOOT_CMD_MKENT(overlay, CONFIG_SYS_MAXARGS, 1, do_ut_overlay, "", ""),
 #endif
+#ifdef CONFIG_UT_SLAB
+	U_BOOT_CMD_MKENT(slab, CONFIG_SYS_MAXARGS, 1, do_ut_slab, "", ""),
+#endif
+#ifdef CONFIG_UT_SMP_WORK
+	U_BOOT_CMD_MKENT(smp, CONFIG_SYS_MAXARGS, 1, do_ut_smp_work, "", ""),
+#endif
+#ifdef CONFIG_UT_SPARSE
+	U_BOOT_CMD_MKENT(sparse, CONFIG_SYS_MAXARGS, 1, do_ut_sparse, "", ""),
+#endif
 #ifdef CONFIG_UT_TIME
 	U_BOOT_CMD_MKENT(time, CONFIG_SYS_MAXARGS, 1, do_ut_time, "", ""),
 #endif
@@ -65,15 +88,36 @@ static int do_ut(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 #ifdef CONFIG_SYS_LONGHELP
 static char ut_help_text[] =
 	"all - execute all enabled tests\n"
+#ifdef CONFIG_UT_ARENA
+	"ut arena - Test of the scoped arena allocator\n"
+#endif
+#ifdef CONFIG_UT_BOOTSTAGE
+	"ut bootstage - Test of bootstage timing spans and trace export\n"
+#endif
 #ifdef CONFIG_UT_DM
 	"ut dm [test-name]\n"
 #endif
 #ifdef CONFIG_UT_ENV
 	"ut env [test-name]\n"
 #endif
+#ifdef CONFIG_UT_EXT4
+	"ut ext4 - Test of reading fragmented and sparse ext4 files\n"
+#endif
+#ifdef CONFIG_UT_FDT_INDEX
+	"ut fdt_index - Test and benchmark of the device-tree lookup index\n"
+#endif
 #ifdef CONFIG_UT_OVERLAY
 	"ut overlay [test-name]\n"
 #endif
+#ifdef CONFIG_UT_SLAB
+	"ut slab - Test of the size-class allocator for small requests\n"
+#endif
+#ifdef CONFIG_UT_SMP_WORK
+	"ut smp - Test of running jobs on the secondary CPUs\n"
+#endif
+#ifdef CONFIG_UT_SPARSE
+	"ut sparse - Test of writing sparse images as they arrive\n"
+#endif
 #ifdef CONFIG_UT_TIME
 	"ut time - Very basic test of time functions\n"
 #endif
@@ -7,11 +7,17 @@
 #define DEBUG
 
 #include <common.h>
+#include <blk.h>
 #include <bootm.h>
 #include <command.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <os.h>
+#include <sandboxblockdev.h>
+#include <smp_work.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
+#include <u-boot/xxhash.h>
 
 #include <u-boot/zlib.h>
 #include <bzlib.h>
@@ -22,6 +28,8 @@
 
 #include <linux/lzo.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static const char plain[] =
 	"I am a highly compressable bit of text.\n"
 	"I am a highly compressable bit of text.\n"
@@ -282,6 +290,80 @@ static int uncompress_using_lz4(void *in, unsigned long in_size,
 	return (ret != 0);
 }
 
+/* Pass the data to the stream decoders a few bytes at a time */
+#define STREAM_STEP	7
+
+static int uncompress_stream_using_gzip(void *in, unsigned long in_size,
+					void *out, unsigned long out_max,
+					unsigned long *out_size)
+{
+	unsigned long pos, len;
+	void *stream;
+	int ret = 0;
+
+	stream = gunzip_stream_start(out, out_max);
+	if (!stream)
+		return -ENOMEM;
+	for (pos = 0; pos < in_size && !ret; pos += len) {
+		len = min(in_size - pos, (unsigned long)STREAM_STEP);
+		ret = gunzip_stream_write(stream, in + pos, len);
+	}
+	if (gunzip_stream_end(stream, &len) || ret < 0)
+		return -EINVAL;
+	if (out_size)
+		*out_size = len;
+
+	return 0;
+}
+
+static int uncompress_stream_using_lzma(void *in, unsigned long in_size,
+					void *out, unsigned long out_max,
+					unsigned long *out_size)
+{
+	unsigned long pos, len;
+	SizeT size;
+	void *stream;
+	int ret = 0;
+
+	stream = lzma_stream_start(out, out_max);
+	if (!stream)
+		return -ENOMEM;
+	for (pos = 0; pos < in_size && !ret; pos += len) {
+		len = min(in_size - pos, (unsigned long)STREAM_STEP);
+		ret = lzma_stream_write(stream, in + pos, len);
+	}
+	if (lzma_stream_end(stream, &size) || ret < 0)
+		return -EINVAL;
+	if (out_size)
+		*out_size = size;
+
+	return 0;
+}
+
+static int uncompress_stream_using_lz4(void *in, unsigned long in_size,
+				       void *out, unsigned long out_max,
+				       unsigned long *out_size)
+{
+	unsigned long pos, len;
+	size_t size;
+	void *stream;
+	int ret = 0;
+
+	stream = ulz4_stream_start(out, out_max);
+	if (!stream)
+		return -ENOMEM;
+	for (pos = 0; pos < in_size && !ret; pos += len) {
+		len = min(in_size - pos, (unsigned long)STREAM_STEP);
+		ret = ulz4_stream_write(stream, in + pos, len);
+	}
+	if (ulz4_stream_end(stream, &size) || ret < 0)
+		return -EINVAL;
+	if (out_size)
+		*out_size = size;
+
+	return 0;
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -371,6 +453,526 @@ out:
 	return ret;
 }
 
+/* Room for the large LZ4 frames, placed in sandbox RAM */
+#define LZ4_ORIG_ADDR		0x0100000
+#define LZ4_FRAME_ADDR		0x1200000
+#define LZ4_OUT_ADDR		0x2300000
+#define LZ4_AREA_SIZE		0x1100000
+
+#define LZ4_TEST_SIZE		(1 << 20)
+#define LZ4_BENCH_SIZE		(16 << 20)
+
+/* Space after the output when decompressing in place */
+#define LZ4_INPLACE_MARGIN	(1 << 20)
+
+#define LZ4_HASH_BITS		12
+
+/* Heap left for the decoder: two and a half 64KiB blocks */
+#define LZ4_HOG_ROOM		(5 << 15)
+
+/* Make text-like data which compresses about as well as a kernel does */
+static void lz4_fill(u8 *buf, size_t len)
+{
+	static const char *const words[] = {
+		"boot", "image", "kernel", "load", " ", "0x", "\n", "ramdisk",
+		"device", "tree", "config", "=", "mmc", "usb", "net", "fit",
+	};
+	u32 seed = 1;
+	size_t pos, n;
+
+	for (pos = 0; pos < len; pos += n) {
+		seed = seed * 1103515245 + 12345;
+		if (!((seed >> 16) & 7)) {
+			buf[pos] = seed >> 24;
+			n = 1;
+			continue;
+		}
+		n = min(strlen(words[(seed >> 16) % ARRAY_SIZE(words)]),
+			len - pos);
+		memcpy(buf + pos, words[(seed >> 16) % ARRAY_SIZE(words)], n);
+	}
+}
+
+static u8 *lz4_put_len(u8 *op, size_t len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+
+	return op;
+}
+
+/*
+ * Compress @len bytes at @in as an LZ4 block, returning its size. Matches
+ * may reach back to @base. @table holds positions relative to @base.
+ */
+static size_t lz4_encode_block(const u8 *base, const u8 *in, size_t len,
+			       u8 *out, u32 *table)
+{
+	const u8 *iend = in + len;
+	const u8 *ip = in, *anchor = in, *ref, *mend;
+	u8 *op = out;
+	size_t lit, mlen;
+	u32 seq, h;
+
+	/* The last match starts 12 bytes before the end; 5 literals follow */
+	while (len > 12 && ip < iend - 12) {
+		seq = get_unaligned_le32(ip);
+		h = (seq * 2654435761U) >> (32 - LZ4_HASH_BITS);
+		ref = base + table[h];
+		table[h] = ip - base;
+		if (ref >= ip || ip - ref > 0xffff ||
+		    get_unaligned_le32(ref) != seq) {
+			ip++;
+			continue;
+		}
+		for (mend = ip + 4; mend < iend - 5 && *mend == ref[mend - ip];)
+			mend++;
+		lit = ip - anchor;
+		mlen = mend - ip - 4;
+		*op++ = (min(lit, (size_t)15) << 4) | min(mlen, (size_t)15);
+		if (lit >= 15)
+			op = lz4_put_len(op, lit - 15);
+		memcpy(op, anchor, lit);
+		op += lit;
+		put_unaligned_le16(ip - ref, op);
+		op += 2;
+		if (mlen >= 15)
+			op = lz4_put_len(op, mlen - 15);
+		ip = mend;
+		anchor = mend;
+	}
+
+	lit = iend - anchor;
+	*op++ = min(lit, (size_t)15) << 4;
+	if (lit >= 15)
+		op = lz4_put_len(op, lit - 15);
+	memcpy(op, anchor, lit);
+	op += lit;
+
+	return op - out;
+}
+
+/**
+ * lz4_make_frame() - Compress data into an LZ4 frame
+ *
+ * There is no lz4 compression in u-boot, so this is a simple one which is
+ * enough to make large frames. The frame has a content size and all the
+ * checksums.
+ *
+ * @in:		Data to compress
+ * @len:	Number of bytes of data
+ * @out:	Buffer for the frame
+ * @out_max:	Size of @out
+ * @bd:		Block size code, from 4 (64KiB) to 7 (4MiB)
+ * @linked:	true to let matches reach back into earlier blocks
+ * @first:	Size of the first block if it is to be short, else 0
+ * @return size of the frame, or 0 if @out is too small
+ */
+static size_t lz4_make_frame(const u8 *in, size_t len, u8 *out,
+			     size_t out_max, int bd, bool linked, size_t first)
+{
+	size_t block_size = 1 << (8 + 2 * bd);
+	const u8 *out_end = out + out_max;
+	size_t pos, chunk, clen;
+	u8 *op = out;
+	u32 *table;
+
+	table = calloc(1 << LZ4_HASH_BITS, sizeof(*table));
+	if (!table || out_max < 15)
+		goto err;
+	put_unaligned_le32(0x184d2204, op);
+	op[4] = 0x5c | (linked ? 0 : 0x20);
+	op[5] = bd << 4;
+	put_unaligned_le64(len, op + 6);
+	op[14] = xxh32(op + 4, 10, 0) >> 8;
+	op += 15;
+
+	for (pos = 0; pos < len; pos += chunk) {
+		chunk = min(len - pos, pos || !first ? block_size : first);
+		if (op + chunk + chunk / 255 + 32 > out_end)
+			goto err;
+		if (!linked)
+			memset(table, '\0', sizeof(*table) << LZ4_HASH_BITS);
+		clen = lz4_encode_block(linked ? in : in + pos, in + pos, chunk,
+					op + 4, table);
+		if (clen >= chunk) {
+			memcpy(op + 4, in + pos, chunk);
+			clen = chunk;
+			put_unaligned_le32(chunk | 0x80000000, op);
+		} else {
+			put_unaligned_le32(clen, op);
+		}
+		put_unaligned_le32(xxh32(op + 4, clen, 0), op + 4 + clen);
+		op += clen + 8;
+	}
+	if (op + 8 > out_end)
+		goto err;
+	put_unaligned_le32(0, op);
+	put_unaligned_le32(xxh32(in, len, 0), op + 4);
+	op += 8;
+	free(table);
+
+	return op - out;
+err:
+	free(table);
+	return 0;
+}
+
+/* Pass a frame to the stream decoder @step bytes at a time */
+static int lz4_stream(const u8 *frame, size_t frame_size, u8 *out,
+		      size_t out_max, size_t step, size_t *out_size)
+{
+	void *stream;
+	size_t pos, len;
+	int ret = 0;
+
+	stream = ulz4_stream_start(out, out_max);
+	if (!stream)
+		return -ENOMEM;
+	for (pos = 0; pos < frame_size && ret >= 0; pos += len) {
+		len = min(frame_size - pos, step);
+		ret = ulz4_stream_write(stream, frame + pos, len);
+	}
+	len = ulz4_stream_end(stream, out_size);
+
+	return ret < 0 ? ret : len;
+}
+
+/* Decode a frame both ways and check the result */
+static int lz4_check_frame(const u8 *orig, size_t len, const u8 *frame,
+			   size_t frame_size, u8 *out)
+{
+	size_t size;
+	int ret;
+
+	memset(out, '\0', len);
+	size = LZ4_AREA_SIZE;
+	ret = ulz4fn(frame, frame_size, out, &size);
+	if (ret || size != len || memcmp(orig, out, len))
+		return ret ? ret : -EINVAL;
+
+	memset(out, '\0', len);
+	ret = lz4_stream(frame, frame_size, out, LZ4_AREA_SIZE, 1500, &size);
+	if (ret || size != len || memcmp(orig, out, len))
+		return ret ? ret : -EINVAL;
+
+	return 0;
+}
+
+/*
+ * Take all the heap except about @room bytes, as a list of blocks linked
+ * through their first word, to be given back with lz4_heap_free()
+ */
+static void *lz4_heap_hog(size_t room)
+{
+	void *reserve, *list = NULL, *ptr;
+	size_t size;
+
+	reserve = malloc(room);
+	if (!reserve)
+		return NULL;
+	for (size = 1 << 20; size >= 1024; size /= 2) {
+		while ((ptr = malloc(size))) {
+			*(void **)ptr = list;
+			list = ptr;
+		}
+	}
+	free(reserve);
+
+	return list;
+}
+
+static void lz4_heap_free(void *list)
+{
+	void *next;
+
+	for (; list; list = next) {
+		next = *(void **)list;
+		free(list);
+	}
+}
+
+static int run_lz4_frame_test(void)
+{
+	size_t len = LZ4_TEST_SIZE;
+	size_t frame_size, size;
+	u8 *orig, *frame, *out, *src;
+	void *hog;
+	u32 seed;
+	int ret;
+
+	printf(" testing lz4 frames ...\n");
+	orig = map_sysmem(LZ4_ORIG_ADDR, LZ4_AREA_SIZE);
+	frame = map_sysmem(LZ4_FRAME_ADDR, LZ4_AREA_SIZE);
+	out = map_sysmem(LZ4_OUT_ADDR, LZ4_AREA_SIZE);
+	lz4_fill(orig, len);
+
+	/* Independent blocks, which are shared out between the CPUs */
+	frame_size = lz4_make_frame(orig, len, frame, LZ4_AREA_SIZE, 4, false,
+				    0);
+	errcheck(frame_size > 0 && frame_size < len);
+	errcheck(lz4_check_frame(orig, len, frame, frame_size, out) == 0);
+
+	/* With room for only a couple of blocks, the jobs give way */
+	hog = lz4_heap_hog(LZ4_HOG_ROOM);
+	errcheck(hog != NULL);
+	memset(out, '\0', len);
+	ret = lz4_stream(frame, frame_size, out, LZ4_AREA_SIZE, 1500, &size);
+	lz4_heap_free(hog);
+	errcheck(ret == 0 && size == len && !memcmp(orig, out, len));
+
+	/* In place, which must be done in order */
+	src = out + len + LZ4_INPLACE_MARGIN - frame_size;
+	memmove(src, frame, frame_size);
+	size = len + LZ4_INPLACE_MARGIN;
+	errcheck(ulz4fn(src, frame_size, out, &size) == 0);
+	errcheck(size == len && !memcmp(orig, out, len));
+
+	/* Too little space */
+	size = len - 1;
+	errcheck(ulz4fn(frame, frame_size, out, &size) != 0);
+	errcheck(lz4_stream(frame, frame_size, out, len - 1, 1500,
+			    &size) != 0);
+
+	/* Damage to a block, the content checksum and the header checksum */
+	frame[frame_size / 2] ^= 0x10;
+	size = LZ4_AREA_SIZE;
+	errcheck(ulz4fn(frame, frame_size, out, &size) == -EBADMSG);
+	frame[frame_size / 2] ^= 0x10;
+	frame[frame_size - 1] ^= 0x10;
+	size = LZ4_AREA_SIZE;
+	errcheck(ulz4fn(frame, frame_size, out, &size) == -EBADMSG);
+	errcheck(lz4_stream(frame, frame_size, out, LZ4_AREA_SIZE, 1500,
+			    &size) == -EBADMSG);
+	frame[frame_size - 1] ^= 0x10;
+	frame[14] ^= 0x10;
+	size = LZ4_AREA_SIZE;
+	errcheck(ulz4fn(frame, frame_size, out, &size) == -EBADMSG);
+
+	/* A short first block moves the rest of the output */
+	frame_size = lz4_make_frame(orig, len, frame, LZ4_AREA_SIZE, 4, false,
+				    1000);
+	errcheck(frame_size > 0);
+	errcheck(lz4_check_frame(orig, len, frame, frame_size, out) == 0);
+
+	/* Linked blocks, which are decoded in order */
+	frame_size = lz4_make_frame(orig, len, frame, LZ4_AREA_SIZE, 4, true,
+				    0);
+	errcheck(frame_size > 0);
+	errcheck(lz4_check_frame(orig, len, frame, frame_size, out) == 0);
+
+	/* Stored blocks, from data which does not compress */
+	for (size = 0, seed = 1; size < len; size++) {
+		seed = seed * 1103515245 + 12345;
+		orig[size] = seed >> 24;
+	}
+	frame_size = lz4_make_frame(orig, len, frame, LZ4_AREA_SIZE, 4, false,
+				    0);
+	errcheck(frame_size > len);
+	errcheck(lz4_check_frame(orig, len, frame, frame_size, out) == 0);
+	ret = 0;
+
+out:
+	printf(" lz4 frames: %s\n", ret == 0 ? "ok" : "FAILED");
+
+	return ret;
+}
+
+static void lz4_bench_show(const char *name, size_t len, ulong ms)
+{
+	printf("\t%-10s %5lu ms, %5lu MiB/s\n", name, ms,
+	       (ulong)(len / 1024 * 1000 / 1024 / max(ms, 1UL)));
+}
+
+/* Measure how fast large frames are decoded, with 64KiB and 4MiB blocks */
+static int run_lz4_bench(void)
+{
+	static const int bds[] = { 4, 7 };
+	size_t len = LZ4_BENCH_SIZE;
+	size_t frame_size, size;
+	u8 *orig, *frame, *out, *src;
+	ulong start;
+	int i, ret;
+
+	printf(" lz4 bench: %d CPUs\n", smp_work_cpus());
+	orig = map_sysmem(LZ4_ORIG_ADDR, LZ4_AREA_SIZE);
+	frame = map_sysmem(LZ4_FRAME_ADDR, LZ4_AREA_SIZE);
+	out = map_sysmem(LZ4_OUT_ADDR, LZ4_AREA_SIZE);
+	lz4_fill(orig, len);
+
+	for (i = 0; i < ARRAY_SIZE(bds); i++) {
+		frame_size = lz4_make_frame(orig, len, frame, LZ4_AREA_SIZE,
+					    bds[i], false, 0);
+		errcheck(frame_size > 0);
+		printf("\t%lu KiB blocks, %lu KiB -> %lu KiB\n",
+		       1UL << (8 + 2 * bds[i] - 10), (ulong)frame_size >> 10,
+		       (ulong)len >> 10);
+
+		size = LZ4_AREA_SIZE;
+		start = get_timer(0);
+		errcheck(ulz4fn(frame, frame_size, out, &size) == 0);
+		lz4_bench_show("split", len, get_timer(start));
+		errcheck(size == len && !memcmp(orig, out, len));
+
+		start = get_timer(0);
+		errcheck(lz4_stream(frame, frame_size, out, LZ4_AREA_SIZE,
+				    4096, &size) == 0);
+		lz4_bench_show("stream", len, get_timer(start));
+		errcheck(size == len && !memcmp(orig, out, len));
+
+		src = out + len + LZ4_INPLACE_MARGIN - frame_size;
+		memmove(src, frame, frame_size);
+		size = len + LZ4_INPLACE_MARGIN;
+		start = get_timer(0);
+		errcheck(ulz4fn(src, frame_size, out, &size) == 0);
+		lz4_bench_show("in place", len, get_timer(start));
+		errcheck(size == len && !memcmp(orig, out, len));
+	}
+	ret = 0;
+
+out:
+	printf(" lz4 bench: %s\n", ret == 0 ? "ok" : "FAILED");
+
+	return ret;
+}
+
+#ifdef CONFIG_CMD_UNZIP
+#define GZW_IMAGE_ADDR		0x0100000
+#define GZW_AREA_SIZE		0x3f00000
+#define GZW_CHUNK_SIZE		(1 << 20)
+#define GZW_DATA_SIZE		(32 << 10)
+#define GZW_TEST_MB		16
+#define GZW_BENCH_MB		4096
+
+/* Fixed gzip header, with no name or timestamp */
+static const u8 gzw_header[10] = { 0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0,
+				   3 };
+
+/* An empty final block with fixed codes, which ends the deflate stream */
+static const u8 gzw_end[2] = { 0x03, 0x00 };
+
+/*
+ * Deflate @len bytes from @in so that the output can be repeated to give a
+ * stream holding as many copies of the data. A full flush leaves no
+ * references to earlier data and does not end the stream.
+ */
+static long gzw_deflate_chunk(u8 *in, size_t len, u8 *out, size_t out_max)
+{
+	z_stream s;
+	long size;
+
+	memset(&s, '\0', sizeof(s));
+	if (deflateInit2_(&s, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS,
+			  MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY, ZLIB_VERSION,
+			  sizeof(s)) != Z_OK)
+		return -EINVAL;
+	s.next_in = in;
+	s.avail_in = len;
+	s.next_out = out;
+	s.avail_out = out_max;
+	if (deflate(&s, Z_FULL_FLUSH) != Z_OK || s.avail_in || !s.avail_out)
+		size = -ENOSPC;
+	else
+		size = out_max - s.avail_out;
+	deflateEnd(&s);
+
+	return size;
+}
+
+/*
+ * Flash a gzip image of a @mib MiB filesystem into a host-backed block
+ * device with gzwrite(), then read it back. The filesystem is mostly free
+ * space, with each MiB holding some text-like data and then zeros, so that
+ * a multi-GiB image fits in memory once compressed.
+ */
+static int run_gzwrite_bench(ulong mib)
+{
+	char fname[] = "/tmp/u-boot.gzwrite.XXXXXX";
+	u64 total = (u64)mib * GZW_CHUNK_SIZE;
+	lbaint_t blks, blk;
+	struct blk_desc *desc;
+	u8 *chunk, *buf, *image, *ptr;
+	long chunk_size;
+	ulong size, ms, i;
+	u32 crc, chunk_crc;
+	int devnum, fd, ret;
+
+	printf(" gzwrite bench: %lu MiB\n", mib);
+	chunk = malloc(GZW_CHUNK_SIZE);
+	buf = malloc(GZW_CHUNK_SIZE);
+	image = map_sysmem(GZW_IMAGE_ADDR, GZW_AREA_SIZE);
+	devnum = -1;
+	fd = -1;
+	errcheck(chunk && buf && mib);
+	lz4_fill(chunk, GZW_DATA_SIZE);
+	memset(chunk + GZW_DATA_SIZE, '\0', GZW_CHUNK_SIZE - GZW_DATA_SIZE);
+
+	/* Build the image from copies of one compressed MiB */
+	ptr = image;
+	memcpy(ptr, gzw_header, sizeof(gzw_header));
+	ptr += sizeof(gzw_header);
+	chunk_size = gzw_deflate_chunk(chunk, GZW_CHUNK_SIZE, ptr,
+				       GZW_CHUNK_SIZE);
+	errcheck(chunk_size > 0);
+	size = sizeof(gzw_header) + mib * chunk_size + sizeof(gzw_end) + 8;
+	errcheck(size <= GZW_AREA_SIZE);
+	chunk_crc = crc32(0, chunk, GZW_CHUNK_SIZE);
+	for (i = 1, crc = chunk_crc; i < mib; i++) {
+		memcpy(ptr + i * chunk_size, ptr, chunk_size);
+		crc = crc32_combine(crc, chunk_crc, GZW_CHUNK_SIZE);
+	}
+	ptr += mib * chunk_size;
+	memcpy(ptr, gzw_end, sizeof(gzw_end));
+	ptr += sizeof(gzw_end);
+	put_unaligned_le32(crc, ptr);
+	put_unaligned_le32(total, ptr + 4);
+
+	/* A sparse file, so that only what is written takes up space */
+	fd = os_mktemp(fname);
+	errcheck(fd >= 0);
+	memset(buf, '\0', 512);
+	ret = os_lseek(fd, total - 512, OS_SEEK_SET) == total - 512 &&
+		os_write(fd, buf, 512) == 512;
+	os_close(fd);
+	errcheck(ret);
+
+	/* Use a host device which nothing else has bound */
+	for (i = 0; !host_get_dev_err(i, &desc); i++)
+		;
+	errcheck(host_dev_bind(i, fname) == 0);
+	devnum = i;
+	errcheck(host_get_dev_err(devnum, &desc) == 0);
+
+	/* gzwrite() reports its progress, which would garble the results */
+	gd->flags |= GD_FLG_SILENT;
+	ms = get_timer(0);
+	ret = gzwrite(image, size, desc, GZW_CHUNK_SIZE, 0, total);
+	ms = get_timer(ms);
+	gd->flags &= ~GD_FLG_SILENT;
+	errcheck(ret == 0);
+	lz4_bench_show("gzwrite", total, ms);
+
+	blks = GZW_CHUNK_SIZE / desc->blksz;
+	for (i = 0, blk = 0; i < mib; i++, blk += blks) {
+		errcheck(blk_dread(desc, blk, blks, buf) == blks);
+		errcheck(!memcmp(buf, chunk, GZW_CHUNK_SIZE));
+	}
+	ret = 0;
+
+out:
+	if (devnum >= 0)
+		host_dev_bind(devnum, NULL);
+	if (fd >= 0)
+		os_unlink(fname);
+	free(buf);
+	free(chunk);
+	printf(" gzwrite bench: %s\n", ret == 0 ? "ok" : "FAILED");
+
+	return ret;
+}
+#endif
+
 static int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc,
 			     char *const argv[])
 {
@@ -381,6 +983,17 @@ static int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc,
 	err += run_test("lzma", compress_using_lzma, uncompress_using_lzma);
 	err += run_test("lzo", compress_using_lzo, uncompress_using_lzo);
 	err += run_test("lz4", compress_using_lz4, uncompress_using_lz4);
+	err += run_test("gzip stream", compress_using_gzip,
+			uncompress_stream_using_gzip);
+	err += run_test("lzma stream", compress_using_lzma,
+			uncompress_stream_using_lzma);
+	err += run_test("lz4 stream", compress_using_lz4,
+			uncompress_stream_using_lz4);
+	err += run_lz4_frame_test();
+	err += run_lz4_bench();
+#ifdef CONFIG_CMD_UNZIP
+	err += run_gzwrite_bench(GZW_TEST_MB);
+#endif
 
 	printf("ut_compression %s\n", err == 0 ? "ok" : "FAILED");
 
@@ -448,6 +1061,71 @@ static int run_bootm_test(int comp_type, mutate_func compress)
 	return 0;
 }
 
+#ifdef CONFIG_BOOTM_STREAM
+/**
+ * run_bootm_stream_test() - Test decompressing an image while it is loaded
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * @legacy:	true to wrap the data in a uImage, false to pass it bare
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_bootm_stream_test(int comp_type, mutate_func compress,
+				 bool legacy)
+{
+	const ulong image_start = 0;
+	const ulong load_addr = 0x1000;
+	ulong hdr_len = legacy ? image_get_header_size() : 0;
+	ulong compress_size = 1024;
+	ulong unc_len = strlen(plain);
+	image_header_t *hdr;
+	void *image, *data;
+	ulong pos, len;
+	int ret = 0;
+
+	printf("Testing: %s stream%s\n", genimg_get_comp_name(comp_type),
+	       legacy ? " (uImage)" : "");
+	image = map_sysmem(image_start, 0);
+	hdr = image;
+	compress((void *)plain, unc_len, image + hdr_len, compress_size,
+		 &compress_size);
+	if (legacy) {
+		memset(hdr, '\0', hdr_len);
+		image_set_magic(hdr, IH_MAGIC);
+		image_set_size(hdr, compress_size);
+		image_set_type(hdr, IH_TYPE_KERNEL);
+		image_set_os(hdr, IH_OS_LINUX);
+		image_set_comp(hdr, comp_type);
+		image_set_dcrc(hdr, crc32(0, image + hdr_len, compress_size));
+		image_set_hcrc(hdr, crc32(0, (uint8_t *)hdr, hdr_len));
+	}
+
+	setenv("loaddecomp", "yes");
+	if (bootm_stream_start(load_addr) != 1)
+		return -EINVAL;
+	for (pos = 0; pos < hdr_len + compress_size && !ret; pos += len) {
+		len = min(hdr_len + compress_size - pos,
+			  (ulong)STREAM_STEP);
+		ret = bootm_stream_write(image + pos, len);
+	}
+	setenv("loaddecomp", NULL);
+	if (ret || bootm_stream_end(&len))
+		return -EINVAL;
+	if (len != hdr_len + unc_len)
+		return -EINVAL;
+
+	hdr = map_sysmem(load_addr, 0);
+	data = (void *)hdr + hdr_len;
+	if (legacy && (!image_check_hcrc(hdr) || !image_check_dcrc(hdr) ||
+		       image_get_comp(hdr) != IH_COMP_NONE))
+		return -EINVAL;
+	if (memcmp(data, plain, unc_len))
+		return -EINVAL;
+
+	return 0;
+}
+#endif
+
 static int do_ut_image_decomp(cmd_tbl_t *cmdtp, int flag, int argc,
 			      char *const argv[])
 {
@@ -459,6 +1137,13 @@ static int do_ut_image_decomp(cmd_tbl_t *cmdtp, int flag, int argc,
 	err |= run_bootm_test(IH_COMP_LZO, compress_using_lzo);
 	err |= run_bootm_test(IH_COMP_LZ4, compress_using_lz4);
 	err |= run_bootm_test(IH_COMP_NONE, compress_using_none);
+#ifdef CONFIG_BOOTM_STREAM
+	err |= run_bootm_stream_test(IH_COMP_GZIP, compress_using_gzip, true);
+	err |= run_bootm_stream_test(IH_COMP_LZMA, compress_using_lzma, true);
+	err |= run_bootm_stream_test(IH_COMP_LZ4, compress_using_lz4, true);
+	err |= run_bootm_stream_test(IH_COMP_GZIP, compress_using_gzip, false);
+	err |= run_bootm_stream_test(IH_COMP_LZ4, compress_using_lz4, false);
+#endif
 
 	printf("ut_image_decomp %s\n", err == 0 ? "ok" : "FAILED");
 
@@ -470,7 +1155,28 @@ U_BOOT_CMD(
 	"Basic test of compressors: gzip bzip2 lzma lzo", ""
 );
 
+#ifdef CONFIG_CMD_UNZIP
+static int do_ut_gzwrite(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char *const argv[])
+{
+	ulong mib = GZW_BENCH_MB;
+
+	if (argc > 1)
+		mib = simple_strtoul(argv[1], NULL, 0);
+
+	return run_gzwrite_bench(mib) ? CMD_RET_FAILURE : 0;
+}
+#endif
+
 U_BOOT_CMD(
 	ut_image_decomp,	5,	1, do_ut_image_decomp,
 	"Basic test of bootm decompression", ""
 );
+
+#ifdef CONFIG_CMD_UNZIP
+U_BOOT_CMD(
+	ut_gzwrite,	2,	1,	do_ut_gzwrite,
+	"Benchmark gzwrite to a host-backed block device",
+	"[size_mib]"
+);
+#endif
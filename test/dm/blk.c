@@ -5,7 +5,10 @@
  */
 
 #include <common.h>
+#include <blk.h>
 #include <dm.h>
+#include <os.h>
+#include <sandboxblockdev.h>
 #include <usb.h>
 #include <asm/state.h>
 #include <dm/test.h>
@@ -94,3 +97,120 @@ static int dm_test_blk_usb(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_usb, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check that buf holds @count blocks starting at block @start */
+static int check_blocks(struct unit_test_state *uts, u32 *buf, int start,
+			int count)
+{
+	int i;
+
+	for (i = 0; i < count * 128; i++)
+		ut_asserteq(start + i / 128, buf[i]);
+
+	return 0;
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_blk_cache(struct unit_test_state *uts,
+			      struct blk_desc *desc)
+{
+	struct block_cache_stats stats;
+	u32 buf[32 * 128];
+	uint entries;
+	int i;
+
+	/* Reset the statistics; the partition table is already cached */
+	blkcache_stats(&stats);
+	entries = stats.entries;
+
+	/* A single block brings in its whole line */
+	ut_asserteq(1, blk_dread(desc, 515, 1, buf));
+	ut_assertok(check_blocks(uts, buf, 515, 1));
+	ut_asserteq(8, blk_dread(desc, 512, 8, buf));
+	ut_assertok(check_blocks(uts, buf, 512, 8));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(entries + 1, stats.entries);
+
+	/* Part of this read is already cached */
+	ut_asserteq(12, blk_dread(desc, 518, 12, buf));
+	ut_assertok(check_blocks(uts, buf, 518, 12));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.partial_hits);
+	ut_asserteq(entries + 3, stats.entries);
+
+	/* Reading one block at a time should trigger read-ahead */
+	for (i = 700; i < 764; i++) {
+		ut_asserteq(1, blk_dread(desc, i, 1, buf));
+		ut_assertok(check_blocks(uts, buf, i, 1));
+	}
+	blkcache_stats(&stats);
+	ut_assert(stats.readahead >= 32);
+	ut_assert(stats.misses <= 4);
+
+	/* A write only drops the lines it touches */
+	for (i = 0; i < 128; i++)
+		buf[i] = 0x1234;
+	ut_asserteq(1, blk_dwrite(desc, 515, 1, buf));
+	ut_asserteq(1, blk_dread(desc, 515, 1, buf));
+	ut_asserteq(0x1234, buf[0]);
+	ut_asserteq(1, blk_dread(desc, 522, 1, buf));
+	ut_assertok(check_blocks(uts, buf, 522, 1));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(1, stats.hits);
+
+	/* Big reads go straight to the device */
+	ut_asserteq(32, blk_dread(desc, 100, 32, buf));
+	ut_assertok(check_blocks(uts, buf, 100, 32));
+
+	/*
+	 * With a single set, the four missing lines before a hit evict it
+	 * while they are filled, so it must be copied out first
+	 */
+	blkcache_configure(8, 4);
+	ut_asserteq(1, blk_dread(desc, 352, 1, buf));
+	ut_asserteq(32, blk_dread(desc, 324, 32, buf));
+	ut_assertok(check_blocks(uts, buf, 324, 32));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.partial_hits);
+
+	return 0;
+}
+
+/* Test that the block cache returns the right data and counts hits */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	char fname[] = "/tmp/u-boot.blkcache.XXXXXX";
+	struct blk_desc *desc;
+	u32 buf[128];
+	int fd, i, j;
+	int retval;
+
+	/* Each block of the backing file is filled with its block number */
+	fd = os_mktemp(fname);
+	ut_assert(fd >= 0);
+	for (i = 0, retval = 0; i < 1024 && !retval; i++) {
+		for (j = 0; j < 128; j++)
+			buf[j] = i;
+		if (os_write(fd, buf, sizeof(buf)) != sizeof(buf))
+			retval = -EIO;
+	}
+	os_close(fd);
+
+	blkcache_configure(8, 32);
+	if (!retval)
+		retval = host_dev_bind(0, fname);
+	if (!retval) {
+		retval = host_get_dev_err(0, &desc);
+		if (!retval)
+			retval = _dm_test_blk_cache(uts, desc);
+		host_dev_bind(0, NULL);
+	}
+	os_unlink(fname);
+	blkcache_configure(8, 32);
+
+	return retval;
+}
+DM_TEST(dm_test_blk_cache, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
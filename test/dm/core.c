@@ -786,6 +786,79 @@ static int dm_test_uclass_devices_get_by_name(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_uclass_devices_get_by_name, DM_TESTF_SCAN_FDT);
 
+/* Check that lookups give the same results once a uclass is indexed */
+static int dm_test_uclass_index(struct unit_test_state *uts)
+{
+	struct dm_test_state *dms = uts->priv;
+	struct udevice *dev[20], *found;
+	struct uclass *uc;
+	char name[10];
+	int pass, i;
+
+	/* Name the devices in reverse, so that sorting them changes order */
+	dms->skip_post_probe = 1;
+	for (i = 0; i < ARRAY_SIZE(dev); i++) {
+		ut_assertok(device_bind_by_name(dms->root, false,
+						&driver_info_manual, &dev[i]));
+		snprintf(name, sizeof(name), "idx%d", 19 - i);
+		ut_assertok(device_set_name(dev[i], name));
+		dev[i]->of_offset = 1000 + i / 2;
+	}
+	ut_assertok(uclass_get(UCLASS_TEST, &uc));
+	uclass_index_drop(uc);
+
+	/* Probe in a different order to binding */
+	for (i = 0; i < ARRAY_SIZE(dev); i++)
+		ut_assertok(device_probe(dev[(i * 7) % ARRAY_SIZE(dev)]));
+
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < ARRAY_SIZE(dev); i++) {
+			ut_assertok(uclass_find_device_by_seq(UCLASS_TEST,
+							      dev[i]->seq,
+							      false, &found));
+			ut_asserteq_ptr(dev[i], found);
+			ut_assertok(uclass_find_device_by_of_offset(UCLASS_TEST,
+							1000 + i / 2, &found));
+			ut_asserteq_ptr(dev[i & ~1], found);
+		}
+		/* The first device whose name has this prefix is "idx19" */
+		ut_assertok(uclass_find_device_by_name(UCLASS_TEST, "idx1",
+						       &found));
+		ut_asserteq_ptr(dev[0], found);
+		ut_assertok(uclass_find_device_by_name(UCLASS_TEST, "idx3",
+						       &found));
+		ut_asserteq_ptr(dev[16], found);
+		ut_asserteq(-ENODEV, uclass_find_device_by_name(UCLASS_TEST,
+							"idx20", &found));
+		ut_asserteq(-ENODEV, uclass_find_device_by_of_offset(
+					UCLASS_TEST, 999, &found));
+	}
+#if CONFIG_IS_ENABLED(DM_INDEX)
+	ut_assert(uc->index);
+#endif
+
+	/* Removing a device frees its sequence number */
+	i = dev[5]->seq;
+	ut_assertok(device_remove(dev[5]));
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST, i, false,
+						       &found));
+	ut_assertok(device_probe(dev[5]));
+	ut_assertok(uclass_find_device_by_seq(UCLASS_TEST, i, false, &found));
+	ut_asserteq_ptr(dev[5], found);
+
+	/* Unbinding a device drops it from the index */
+	ut_assertok(device_remove(dev[0]));
+	ut_assertok(device_unbind(dev[0]));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST, "idx1", &found));
+	ut_asserteq_ptr(dev[1], found);
+	ut_assertok(uclass_find_device_by_of_offset(UCLASS_TEST, 1000,
+						    &found));
+	ut_asserteq_ptr(dev[1], found);
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_index, 0);
+
 static int dm_test_device_get_uclass_id(struct unit_test_state *uts)
 {
 	struct udevice *dev;
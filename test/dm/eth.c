@@ -11,6 +11,7 @@
 #include <dm.h>
 #include <fdtdec.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
@@ -259,3 +260,211 @@ static int dm_test_net_retry(struct unit_test_state *uts)
 	return retval;
 }
 DM_TEST(dm_test_net_retry, DM_TESTF_SCAN_FDT);
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_tftp(struct unit_test_state *uts, const char *window,
+			     uint max_windowsize, uint drop_every,
+			     uint swap_every)
+{
+	struct sandbox_eth_tftp *tftp = sandbox_eth_get_tftp();
+	ulong size = 300 * 1024 + 123;
+	ulong start, i;
+	u8 *buf;
+
+	memset(tftp, '\0', sizeof(*tftp));
+	tftp->file_size = size;
+	tftp->max_windowsize = max_windowsize;
+	tftp->drop_every = drop_every;
+	tftp->swap_every = swap_every;
+	setenv("tftpwindowsize", window);
+
+	buf = map_sysmem(load_addr, size);
+	memset(buf, '\0', size);
+	start = get_timer(0);
+	ut_asserteq(size, net_loop(TFTPGET));
+	printf("window %s/%u, lose %u, swap %u: %lu data (%lu lost), %lu acks, %lu ms\n",
+	       window, max_windowsize, drop_every, swap_every,
+	       tftp->data_sent, tftp->data_dropped, tftp->acks,
+	       get_timer(start));
+	for (i = 0; i < size; i++)
+		ut_asserteq(sandbox_eth_tftp_byte(i), buf[i]);
+	unmap_sysmem(buf);
+
+	return 0;
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_tftp_window(struct unit_test_state *uts)
+{
+	struct sandbox_eth_tftp *tftp = sandbox_eth_get_tftp();
+
+	/* One block per ACK, as before */
+	ut_assertok(_dm_test_eth_tftp(uts, "1", 16, 0, 0));
+	ut_asserteq(tftp->data_sent + 1, tftp->acks);
+
+	/* A full window needs one ACK per 16 blocks */
+	ut_assertok(_dm_test_eth_tftp(uts, "16", 16, 0, 0));
+	ut_assert(tftp->acks * 8 < tftp->data_sent);
+
+	/* Server does not know the option: fall back to one block per ACK */
+	ut_assertok(_dm_test_eth_tftp(uts, "16", 0, 0, 0));
+	ut_asserteq(tftp->data_sent + 1, tftp->acks);
+
+	/* Smaller window agreed by the server, with reordering */
+	ut_assertok(_dm_test_eth_tftp(uts, "16", 8, 0, 3));
+
+	/* Lost blocks, with and without reordering */
+	ut_assertok(_dm_test_eth_tftp(uts, "16", 16, 37, 0));
+	ut_assertok(_dm_test_eth_tftp(uts, "16", 16, 23, 2));
+
+	return 0;
+}
+
+static int dm_test_eth_tftp_window(struct unit_test_state *uts)
+{
+	ulong old_load_addr = load_addr;
+	int retval;
+
+	load_addr = 0x100000;
+	net_server_ip = string_to_ip("1.1.2.2");
+	setenv("ethact", "eth@10002000");
+	copy_filename(net_boot_file_name, "image.bin",
+		      sizeof(net_boot_file_name));
+
+	retval = _dm_test_eth_tftp_window(uts);
+
+	/* Restore the env */
+	memset(sandbox_eth_get_tftp(), '\0', sizeof(struct sandbox_eth_tftp));
+	setenv("tftpwindowsize", NULL);
+	setenv("ethact", NULL);
+	load_addr = old_load_addr;
+
+	return retval;
+}
+DM_TEST(dm_test_eth_tftp_window, DM_TESTF_SCAN_FDT);
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_rx_direct(struct unit_test_state *uts)
+{
+	struct sandbox_eth_tftp *tftp = sandbox_eth_get_tftp();
+
+	/* Every block after the first arrives where it belongs */
+	net_rx_copied = 0;
+	net_rx_in_place = 0;
+	ut_assertok(_dm_test_eth_tftp(uts, "1", 0, 0, 0));
+	ut_asserteq(1, net_rx_copied);
+	ut_asserteq(tftp->data_sent - 1, net_rx_in_place);
+
+	/* Blocks out of order are copied from where the next one goes */
+	net_rx_copied = 0;
+	net_rx_in_place = 0;
+	ut_assertok(_dm_test_eth_tftp(uts, "16", 16, 0, 2));
+	ut_assert(net_rx_copied > 1);
+	ut_assert(net_rx_in_place > net_rx_copied);
+	ut_asserteq(tftp->data_sent, net_rx_copied + net_rx_in_place);
+
+	return 0;
+}
+
+static int dm_test_eth_rx_direct(struct unit_test_state *uts)
+{
+	ulong old_load_addr = load_addr;
+	int retval;
+
+	load_addr = 0x100000;
+	net_server_ip = string_to_ip("1.1.2.2");
+	setenv("ethact", "eth@10002000");
+	copy_filename(net_boot_file_name, "image.bin",
+		      sizeof(net_boot_file_name));
+
+	retval = _dm_test_eth_rx_direct(uts);
+
+	/* Restore the env */
+	memset(sandbox_eth_get_tftp(), '\0', sizeof(struct sandbox_eth_tftp));
+	setenv("tftpwindowsize", NULL);
+	setenv("ethact", NULL);
+	load_addr = old_load_addr;
+
+	return retval;
+}
+DM_TEST(dm_test_eth_rx_direct, DM_TESTF_SCAN_FDT);
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_nfs(struct unit_test_state *uts, const char *window,
+			    uint version, uint max_read, uint drop_every,
+			    bool reverse)
+{
+	struct sandbox_eth_nfs *nfs = sandbox_eth_get_nfs();
+	ulong size = 300 * 1024 + 123;
+	ulong start, i;
+	u8 *buf;
+
+	memset(nfs, '\0', sizeof(*nfs));
+	nfs->file_size = size;
+	nfs->min_version = version;
+	nfs->max_read = max_read;
+	nfs->drop_every = drop_every;
+	nfs->reverse = reverse;
+	setenv("nfswindowsize", window);
+
+	buf = map_sysmem(load_addr, size);
+	memset(buf, '\0', size);
+	start = get_timer(0);
+	ut_asserteq(size, net_loop(NFS));
+	printf("NFS window %s, v%u, max %u, lose %u, reverse %d: %lu reads, %lu round trips, %lu ms\n",
+	       window, version, max_read, drop_every, reverse, nfs->reads,
+	       nfs->round_trips, get_timer(start));
+	for (i = 0; i < size; i++)
+		ut_asserteq(sandbox_eth_tftp_byte(i), buf[i]);
+	unmap_sysmem(buf);
+	ut_asserteq(simple_strtoul(window, NULL, 10), nfs->max_in_flight);
+
+	return 0;
+}
+
+static int _dm_test_eth_nfs_window(struct unit_test_state *uts)
+{
+	struct sandbox_eth_nfs *nfs = sandbox_eth_get_nfs();
+
+	/* One READ per round trip, as before */
+	ut_assertok(_dm_test_eth_nfs(uts, "1", 0, 0, 0, false));
+	ut_asserteq(nfs->reads, nfs->round_trips);
+
+	/* Several READs in flight need far fewer round trips */
+	ut_assertok(_dm_test_eth_nfs(uts, "4", 0, 0, 0, false));
+	ut_assert(nfs->round_trips * 3 < nfs->reads);
+
+	/* Replies in reverse order, and lost replies */
+	ut_assertok(_dm_test_eth_nfs(uts, "4", 0, 0, 0, true));
+	ut_assertok(_dm_test_eth_nfs(uts, "8", 0, 0, 13, true));
+
+	/* Short reads, with NFSv2 and with NFSv3 */
+	ut_assertok(_dm_test_eth_nfs(uts, "4", 0, 1000, 0, false));
+	ut_assertok(_dm_test_eth_nfs(uts, "4", 3, 1000, 0, true));
+	ut_assertok(_dm_test_eth_nfs(uts, "4", 3, 0, 0, false));
+
+	return 0;
+}
+
+static int dm_test_eth_nfs_window(struct unit_test_state *uts)
+{
+	ulong old_load_addr = load_addr;
+	int retval;
+
+	load_addr = 0x100000;
+	net_server_ip = string_to_ip("1.1.2.2");
+	setenv("ethact", "eth@10002000");
+	copy_filename(net_boot_file_name, "/nfsroot/image.bin",
+		      sizeof(net_boot_file_name));
+
+	retval = _dm_test_eth_nfs_window(uts);
+
+	/* Restore the env */
+	memset(sandbox_eth_get_nfs(), '\0', sizeof(struct sandbox_eth_nfs));
+	setenv("nfswindowsize", NULL);
+	setenv("ethact", NULL);
+	load_addr = old_load_addr;
+
+	return retval;
+}
+DM_TEST(dm_test_eth_nfs_window, DM_TESTF_SCAN_FDT);
@@ -6,9 +6,12 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
 #include <mmc.h>
+#include <mmc_adma.h>
 #include <dm/test.h>
 #include <test/ut.h>
+#include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -44,3 +47,230 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Large transfers to and from buffers which are not aligned */
+static int dm_test_mmc_rw_large(struct unit_test_state *uts)
+{
+	const int count = (2 << 20) / 512 + 3;
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	u8 *wbuf, *rbuf;
+	int i;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+
+	wbuf = malloc(count * 512 + 1);
+	rbuf = malloc(count * 512 + 3);
+	ut_assertnonnull(wbuf);
+	ut_assertnonnull(rbuf);
+	for (i = 0; i < count * 512; i++)
+		wbuf[i + 1] = i * 7 + i / 512;
+
+	ut_asserteq(count, blk_dwrite(dev_desc, 10, count, wbuf + 1));
+	memset(rbuf, '\0', count * 512 + 3);
+	ut_asserteq(count, blk_dread(dev_desc, 10, count, rbuf + 3));
+	ut_assertok(memcmp(wbuf + 1, rbuf + 3, count * 512));
+
+	/* Reading the blocks either side shows nothing else was written */
+	ut_asserteq(1, blk_dread(dev_desc, 9, 1, rbuf));
+	ut_asserteq(0, rbuf[511]);
+	ut_asserteq(1, blk_dread(dev_desc, 10 + count, 1, rbuf));
+	ut_asserteq(0, rbuf[0]);
+
+	free(rbuf);
+	free(wbuf);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_rw_large, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_MMC_ADMA2
+/* Descriptor tables are built and followed as the specification requires */
+static int dm_test_mmc_adma(struct unit_test_state *uts)
+{
+	const ulong size = 200 << 10;
+	struct mmc_adma_table table;
+	struct mmc_adma_desc *desc, *link;
+	u8 *card, *buf;
+	int i;
+
+	card = malloc(size + 103);
+	buf = memalign(ADMA_ALIGN, size + 103 + ADMA_ALIGN);
+	ut_assertnonnull(card);
+	ut_assertnonnull(buf);
+	for (i = 0; i < size + 103; i++)
+		card[i] = i * 13 + i / 256;
+
+	/* Three scattered buffers, two not aligned, with one over 64KiB */
+	ut_assertok(mmc_adma_init(&table, size + 103, 3));
+	memset(buf, '\0', size + 103 + ADMA_ALIGN);
+	mmc_adma_start(&table, true);
+	ut_assertok(mmc_adma_add(&table, buf + 1, 100));
+	ut_assertok(mmc_adma_add(&table, buf + 101 + ADMA_ALIGN, size));
+	ut_assertok(mmc_adma_add(&table, buf + 101, 3));
+	ut_asserteq(-ENOSPC, mmc_adma_add(&table, buf, 4));
+	ut_assertok(mmc_adma_finish(&table));
+	ut_assert(table.used > size / ADMA_MAX_LEN + 3);
+	ut_assertok(sandbox_mmc_adma_run(table.desc, card, size + 103, true));
+	mmc_adma_complete(&table);
+	ut_assertok(memcmp(card, buf + 1, 100));
+	ut_assertok(memcmp(card + 100, buf + 101 + ADMA_ALIGN, size));
+	ut_assertok(memcmp(card + 100 + size, buf + 101, 3));
+
+	/* Writing takes the data the same way */
+	memset(card, '\0', size + 103);
+	mmc_adma_start(&table, false);
+	ut_assertok(mmc_adma_add(&table, buf + 1, 100));
+	ut_assertok(mmc_adma_add(&table, buf + 101 + ADMA_ALIGN, size));
+	ut_assertok(mmc_adma_add(&table, buf + 101, 3));
+	ut_assertok(mmc_adma_finish(&table));
+	ut_assertok(sandbox_mmc_adma_run(table.desc, card, size + 103, false));
+	ut_assertok(memcmp(card, buf + 1, 100));
+	ut_assertok(memcmp(card + 100, buf + 101 + ADMA_ALIGN, size));
+	ut_assertok(memcmp(card + 100 + size, buf + 101, 3));
+
+	/* A transfer which is longer or shorter than the table is refused */
+	ut_asserteq(-EIO, sandbox_mmc_adma_run(table.desc, card, size + 104,
+					       true));
+	ut_asserteq(-EIO, sandbox_mmc_adma_run(table.desc, card, size + 102,
+					       true));
+
+	/* The table can continue elsewhere through a link */
+	desc = table.desc;
+	link = memalign(ARCH_DMA_MINALIGN, table.used * sizeof(*desc));
+	ut_assertnonnull(link);
+	memcpy(link, desc + 1, (table.used - 1) * sizeof(*desc));
+	memset(&link[table.used - 1], '\0', sizeof(*desc));
+	desc[1].attr = cpu_to_le16(ADMA_DESC_VALID | ADMA_DESC_ACT_LINK);
+	desc[1].addr = cpu_to_le32(lower_32_bits((ulong)link));
+#ifdef CONFIG_MMC_ADMA2_64BIT
+	desc[1].addr_hi = cpu_to_le32(upper_32_bits((ulong)link));
+#endif
+	ut_assertok(sandbox_mmc_adma_run(desc, card, size + 103, false));
+
+	/* Descriptors which break the rules are refused */
+	link[0].attr &= ~cpu_to_le16(ADMA_DESC_VALID);
+	ut_asserteq(-EIO, sandbox_mmc_adma_run(desc, card, size + 103, false));
+	link[0].attr |= cpu_to_le16(ADMA_DESC_VALID);
+	link[0].addr |= cpu_to_le32(1);
+	ut_asserteq(-EIO, sandbox_mmc_adma_run(desc, card, size + 103, false));
+	link[0].addr &= ~cpu_to_le32(1);
+	link[table.used - 2].attr &= ~cpu_to_le16(ADMA_DESC_END);
+	ut_asserteq(-EIO, sandbox_mmc_adma_run(desc, card, size + 103, false));
+
+	free(link);
+	mmc_adma_free(&table);
+	free(buf);
+	free(card);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_adma, 0);
+#endif
+
+/* Multi-block transfers set the block count instead of sending a stop */
+static int dm_test_mmc_cmd23(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	int set, stop;
+	char buf[8 * 512];
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assert(mmc->card_caps & MMC_MODE_CMD23);
+
+	/* Make sure that reads go to the card */
+	blkcache_invalidate(dev_desc->if_type, dev_desc->devnum);
+	ut_asserteq(8, blk_dread(dev_desc, 0, 8, buf));
+	ut_assertok(strcmp(buf, "this is a test"));
+
+	set = sandbox_mmc_cmd_count(dev, MMC_CMD_SET_BLOCK_COUNT);
+	stop = sandbox_mmc_cmd_count(dev, MMC_CMD_STOP_TRANSMISSION);
+	ut_asserteq(8, blk_dwrite(dev_desc, 40, 8, buf));
+	memset(buf, '\0', sizeof(buf));
+	ut_asserteq(8, blk_dread(dev_desc, 40, 8, buf));
+	ut_assertok(strcmp(buf, "this is a test"));
+	ut_asserteq(set + 2, sandbox_mmc_cmd_count(dev,
+						   MMC_CMD_SET_BLOCK_COUNT));
+	ut_asserteq(stop, sandbox_mmc_cmd_count(dev,
+						MMC_CMD_STOP_TRANSMISSION));
+
+	/* Without it, each transfer is stopped */
+	mmc->card_caps &= ~MMC_MODE_CMD23;
+	ut_asserteq(8, blk_dwrite(dev_desc, 48, 8, buf));
+	memset(buf, '\0', sizeof(buf));
+	ut_asserteq(8, blk_dread(dev_desc, 48, 8, buf));
+	mmc->card_caps |= MMC_MODE_CMD23;
+	ut_assertok(strcmp(buf, "this is a test"));
+	ut_asserteq(set + 2, sandbox_mmc_cmd_count(dev,
+						   MMC_CMD_SET_BLOCK_COUNT));
+	ut_asserteq(stop + 2, sandbox_mmc_cmd_count(dev,
+						    MMC_CMD_STOP_TRANSMISSION));
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_cmd23, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* A queue of reads is done in order, joining those which carry straight on */
+static int dm_test_mmc_read_queue(struct unit_test_state *uts)
+{
+	struct mmc_read_req req[4];
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	int reads, setlen;
+	u8 *wbuf, *rbuf;
+	int i;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	mmc = mmc_get_mmc_dev(dev);
+
+	wbuf = malloc(64 * 512);
+	rbuf = calloc(1, 64 * 512);
+	ut_assertnonnull(wbuf);
+	ut_assertnonnull(rbuf);
+	for (i = 0; i < 64 * 512; i++)
+		wbuf[i] = i * 3 + i / 512;
+	ut_asserteq(64, blk_dwrite(dev_desc, 100, 64, wbuf));
+
+	/* The first two follow on from each other, on the card and in memory */
+	req[0].dst = rbuf;
+	req[0].start = 100;
+	req[0].blkcnt = 10;
+	req[1].dst = rbuf + 10 * 512;
+	req[1].start = 110;
+	req[1].blkcnt = 6;
+	req[2].dst = rbuf + 16 * 512;
+	req[2].start = 150;
+	req[2].blkcnt = 1;
+	req[3].dst = rbuf + 20 * 512;
+	req[3].start = 140;
+	req[3].blkcnt = 4;
+	reads = sandbox_mmc_cmd_count(dev, MMC_CMD_READ_MULTIPLE_BLOCK) +
+		sandbox_mmc_cmd_count(dev, MMC_CMD_READ_SINGLE_BLOCK);
+	setlen = sandbox_mmc_cmd_count(dev, MMC_CMD_SET_BLOCKLEN);
+	ut_asserteq(4, mmc_bread_queue(mmc, req, 4));
+	ut_asserteq(reads + 3,
+		    sandbox_mmc_cmd_count(dev, MMC_CMD_READ_MULTIPLE_BLOCK) +
+		    sandbox_mmc_cmd_count(dev, MMC_CMD_READ_SINGLE_BLOCK));
+	ut_asserteq(setlen + 1, sandbox_mmc_cmd_count(dev,
+						      MMC_CMD_SET_BLOCKLEN));
+	ut_assertok(memcmp(rbuf, wbuf, 16 * 512));
+	ut_assertok(memcmp(rbuf + 16 * 512, wbuf + 50 * 512, 512));
+	ut_assertok(memcmp(rbuf + 20 * 512, wbuf + 40 * 512, 4 * 512));
+
+	/* Reads stop at one which is beyond the end of the card */
+	req[2].start = dev_desc->lba;
+	ut_asserteq(2, mmc_bread_queue(mmc, req, 4));
+
+	free(wbuf);
+	free(rbuf);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_read_queue, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
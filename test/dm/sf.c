@@ -7,6 +7,7 @@
 #include <common.h>
 #include <dm.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <spi.h>
 #include <spi_flash.h>
 #include <asm/state.h>
@@ -41,3 +42,87 @@ static int dm_test_spi_flash(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_spi_flash, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that a smart update only erases and programs what has changed */
+static int dm_test_spi_flash_update(struct unit_test_state *uts)
+{
+	struct sandbox_state *state = state_get_current();
+	struct spi_flash_update_stats stats;
+	struct udevice *bus, *dev;
+	struct spi_flash *flash;
+	const int busnum = 0, cs = 1, size = 0x40000;
+	u8 *buf, *cmp;
+	int i;
+
+	/* Use a chip with 4KiB sectors, so that block erase can be checked */
+	ut_assertok(run_command("sb save hostfs - 0 spi4k.bin 200000", 0));
+	state->spi[busnum][cs].spec = "w25x16:spi4k.bin";
+	ut_assertok(uclass_get_device_by_seq(UCLASS_SPI, busnum, &bus));
+	ut_assertok(sandbox_sf_bind_emul(state, busnum, cs, bus, -1,
+					 "w25x16"));
+	ut_assertok(spi_flash_probe_bus_cs(busnum, cs, 1000000, 0, &dev));
+	flash = dev_get_uclass_priv(dev);
+	ut_asserteq(0x1000, flash->erase_size);
+	ut_asserteq(0x10000, flash->block_size);
+	ut_assertok(spi_flash_erase(flash, 0, flash->size));
+
+	buf = malloc(size);
+	cmp = malloc(size);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(cmp);
+	for (i = 0; i < size; i++)
+		buf[i] = i * 7 + (i >> 9);
+	/* The second page of sector 0 should not be programmed */
+	memset(buf + 0x100, 0xff, 0x100);
+
+	/* Blank flash is programmed without erasing */
+	memset(&stats, '\0', sizeof(stats));
+	ut_assertok(spi_flash_smart_update(flash, 0, size, buf, &stats));
+	ut_asserteq(0, stats.skipped);
+	ut_asserteq(0, stats.erased);
+	ut_asserteq(size - 0x100, stats.written);
+	ut_assertok(spi_flash_read(flash, 0, size, cmp));
+	ut_assertok(memcmp(buf, cmp, size));
+
+	/* Nothing changed, so nothing is done */
+	memset(&stats, '\0', sizeof(stats));
+	ut_assertok(spi_flash_smart_update(flash, 0, size, buf, &stats));
+	ut_asserteq(size, stats.skipped);
+	ut_asserteq(0, stats.erased);
+	ut_asserteq(0, stats.written);
+
+	/* Change one byte in sector 3, and all of the block at 0x20000 */
+	buf[0x3010] ^= 0x55;
+	for (i = 0x20000; i < 0x30000; i++)
+		buf[i] = ~buf[i];
+	memset(&stats, '\0', sizeof(stats));
+	ut_assertok(spi_flash_smart_update(flash, 0, size, buf, &stats));
+	ut_asserteq(size - 0x1000 - 0x10000, stats.skipped);
+	ut_asserteq(0x1000 + 0x10000, stats.erased);
+	ut_asserteq(0x1000 + 0x10000, stats.written);
+	ut_assertok(spi_flash_read(flash, 0, size, cmp));
+	ut_assertok(memcmp(buf, cmp, size));
+
+	/* An unaligned update keeps the data around it */
+	for (i = 0x10ff0; i < 0x11010; i++)
+		buf[i] ^= 0x0f;
+	memset(&stats, '\0', sizeof(stats));
+	ut_assertok(spi_flash_smart_update(flash, 0x10ff0, 0x20, buf + 0x10ff0,
+					   &stats));
+	ut_asserteq(0x2000, stats.erased);
+	ut_assertok(spi_flash_read(flash, 0, size, cmp));
+	ut_assertok(memcmp(buf, cmp, size));
+
+	free(cmp);
+	free(buf);
+
+	/*
+	 * Since we are about to destroy all devices, we must tell sandbox
+	 * to forget the emulation device
+	 */
+	sandbox_sf_unbind_emul(state, busnum, cs);
+	state->spi[busnum][cs].spec = NULL;
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_update, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
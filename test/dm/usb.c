@@ -7,6 +7,8 @@
 #include <common.h>
 #include <console.h>
 #include <dm.h>
+#include <malloc.h>
+#include <os.h>
 #include <usb.h>
 #include <asm/io.h>
 #include <asm/state.h>
@@ -58,6 +60,88 @@ static int dm_test_usb_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_flash, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/*
+ * Test reading a large amount of data from the flash stick. This should take
+ * a single command, unless the device cannot manage that many blocks, in which
+ * case the transfer size should drop until it can.
+ */
+static int dm_test_usb_flash_large(struct unit_test_state *uts)
+{
+	const int blocks = 0x800;
+	const int size = blocks * 512;
+	struct udevice *dev, *emul;
+	struct blk_desc *dev_desc;
+	char *buf, *cmp;
+	ulong start;
+	int count;
+	int fd;
+
+	buf = malloc(size);
+	cmp = malloc(size);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(cmp);
+	fd = os_open("testflash.bin", OS_O_RDONLY);
+	ut_assert(fd >= 0);
+	ut_asserteq(size, os_read(fd, cmp, size));
+	os_close(fd);
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+	ut_assertok(uclass_get_device_by_name(UCLASS_USB_EMUL, "flash-stick@0",
+					      &emul));
+
+	count = sandbox_flash_read_count(emul);
+	memset(buf, '\xaa', size);
+	start = timer_get_us();
+	ut_asserteq(blocks, blk_dread(dev_desc, 0, blocks, buf));
+	printf("%s: %d KiB in %lu us\n", __func__, size / 1024,
+	       timer_get_us() - start);
+	ut_asserteq(count + 1, sandbox_flash_read_count(emul));
+	ut_assertok(memcmp(buf, cmp, size));
+
+	/* Reads of more than 0x100 blocks now fail, so should be split up */
+	sandbox_flash_set_max_xfer(emul, 0x100);
+	memset(buf, '\xaa', size);
+	ut_asserteq(blocks, blk_dread(dev_desc, 0, blocks, buf));
+	ut_assertok(memcmp(buf, cmp, size));
+
+	/* Having found the limit, there should be no more failures */
+	count = sandbox_flash_read_count(emul);
+	ut_asserteq(blocks, blk_dread(dev_desc, 0, blocks, buf));
+	ut_asserteq(count + blocks / 0x100, sandbox_flash_read_count(emul));
+	ut_assertok(memcmp(buf, cmp, size));
+
+	/* A bad block fails the read but leaves the transfer size alone */
+	sandbox_flash_set_bad_block(emul, 0x180);
+	ut_assert(blk_dread(dev_desc, 0, blocks, buf) < blocks);
+	sandbox_flash_set_bad_block(emul, -1);
+	count = sandbox_flash_read_count(emul);
+	ut_asserteq(blocks, blk_dread(dev_desc, 0, blocks, buf));
+	ut_asserteq(count + blocks / 0x100, sandbox_flash_read_count(emul));
+	ut_assertok(memcmp(buf, cmp, size));
+
+	/* A new session starts with the full transfer size */
+	sandbox_flash_set_max_xfer(emul, 0);
+	ut_assertok(usb_stop());
+	ut_assertok(usb_init());
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+	ut_assertok(uclass_get_device_by_name(UCLASS_USB_EMUL, "flash-stick@0",
+					      &emul));
+	count = sandbox_flash_read_count(emul);
+	ut_asserteq(blocks, blk_dread(dev_desc, 0, blocks, buf));
+	ut_asserteq(count + 1, sandbox_flash_read_count(emul));
+	ut_assertok(memcmp(buf, cmp, size));
+
+	ut_assertok(usb_stop());
+	free(buf);
+	free(cmp);
+
+	return 0;
+}
+DM_TEST(dm_test_usb_flash_large, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* test that we can handle multiple storage devices */
 static int dm_test_usb_multi(struct unit_test_state *uts)
 {
@@ -256,6 +340,7 @@ static int dm_test_usb_tree_reorder(struct unit_test_state *uts)
 
 	list_del(&dev->uclass_node);
 	list_add_tail(&dev->uclass_node, &dev->uclass->dev_head);
+	uclass_index_drop(dev->uclass);
 
 	state_set_skip_delays(true);
 	ut_assertok(usb_init());
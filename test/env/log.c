@@ -0,0 +1,272 @@
+/*
+ * Tests for the log-structured environment storage
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <environment.h>
+#include <env_log.h>
+#include <errno.h>
+#include <malloc.h>
+#include <search.h>
+#include <test/env.h>
+#include <test/ut.h>
+
+/* Room for the env_t and a few records */
+#define TEST_AREA_SIZE	(CONFIG_ENV_SIZE + 0x200)
+
+/**
+ * struct test_flash - NOR flash held in memory
+ *
+ * @mem:	Contents
+ * @erases:	Number of times the area was erased
+ * @writes:	Number of writes
+ * @cut:	Number of bytes to program before losing power, or -1
+ */
+struct test_flash {
+	u8 mem[TEST_AREA_SIZE];
+	int erases;
+	int writes;
+	int cut;
+};
+
+static int test_flash_read(struct env_log *log, uint offset, size_t len,
+			   void *buf)
+{
+	struct test_flash *flash = log->priv;
+
+	memcpy(buf, flash->mem + offset, len);
+
+	return 0;
+}
+
+/* Programming can only clear bits, as on NOR flash */
+static int test_flash_write(struct env_log *log, uint offset, size_t len,
+			    const void *buf)
+{
+	struct test_flash *flash = log->priv;
+	const u8 *data = buf;
+	size_t i;
+
+	flash->writes++;
+	for (i = 0; i < len; i++) {
+		if (!flash->cut)
+			return -EIO;
+		if (flash->cut > 0)
+			flash->cut--;
+		flash->mem[offset + i] &= data[i];
+	}
+
+	return 0;
+}
+
+static int test_flash_erase(struct env_log *log)
+{
+	struct test_flash *flash = log->priv;
+
+	flash->erases++;
+	memset(flash->mem, 0xff, log->size);
+
+	return 0;
+}
+
+static void test_log_init(struct env_log *log, struct test_flash *flash,
+			  struct hsearch_data *htab)
+{
+	memset(log, '\0', sizeof(*log));
+	memset(htab, '\0', sizeof(*htab));
+	log->read = test_flash_read;
+	log->write = test_flash_write;
+	log->erase = test_flash_erase;
+	log->priv = flash;
+	log->size = TEST_AREA_SIZE;
+	log->htab = htab;
+}
+
+static void test_log_free(struct env_log *log)
+{
+	hdestroy_r(log->htab);
+	free(log->saved);
+	log->saved = NULL;
+}
+
+static const char *test_get(struct hsearch_data *htab, const char *name)
+{
+	ENTRY e, *ep;
+
+	e.key = name;
+	e.data = NULL;
+	hsearch_r(e, FIND, &ep, htab, 0);
+
+	return ep ? ep->data : NULL;
+}
+
+static int test_set(struct hsearch_data *htab, const char *name,
+		    const char *value)
+{
+	ENTRY e, *ep;
+
+	if (!value)
+		return hdelete_r(name, htab, 0) ? 0 : -ENOENT;
+	e.key = name;
+	e.data = (char *)value;
+	hsearch_r(e, ENTER, &ep, htab, 0);
+
+	return ep ? 0 : -EINVAL;
+}
+
+/* Create a flash area holding an environment with three variables */
+static int test_log_setup(struct unit_test_state *uts, struct env_log *log,
+			  struct test_flash *flash, struct hsearch_data *htab)
+{
+	static const char env[] = "test_a=1\0test_b=2\0test_c=3\0";
+
+	memset(flash, 0xff, sizeof(*flash));
+	flash->erases = 0;
+	flash->writes = 0;
+	flash->cut = -1;
+	test_log_init(log, flash, htab);
+	ut_assert(himport_r(htab, env, sizeof(env), '\0', 0, 0, 0, NULL));
+
+	/* Nothing has been loaded, so this must compact */
+	ut_assertok(env_log_save(log));
+	ut_asserteq(1, flash->erases);
+
+	return 0;
+}
+
+/* Load the environment as after a reset and check it has @count records */
+static int test_log_reload(struct unit_test_state *uts, struct env_log *log,
+			   struct hsearch_data *htab, int count)
+{
+	struct test_flash *flash = log->priv;
+
+	test_log_free(log);
+	test_log_init(log, flash, htab);
+	ut_asserteq(count, env_log_load(log));
+
+	return 0;
+}
+
+/* Changes are appended, with no erase, and nothing is written if unchanged */
+static int env_test_log_append(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	struct test_flash flash;
+	struct env_log log;
+	int writes;
+
+	ut_assertok(test_log_setup(uts, &log, &flash, &htab));
+	ut_assertok(test_log_reload(uts, &log, &htab, 0));
+	ut_asserteq_str("2", test_get(&htab, "test_b"));
+
+	ut_assertok(test_set(&htab, "test_b", "22"));
+	ut_assertok(test_set(&htab, "test_d", "4"));
+	ut_assertok(test_set(&htab, "test_a", NULL));
+	writes = flash.writes;
+	ut_assertok(env_log_save(&log));
+	ut_asserteq(writes + 1, flash.writes);
+	ut_asserteq(1, flash.erases);
+
+	writes = flash.writes;
+	ut_assertok(env_log_save(&log));
+	ut_asserteq(writes, flash.writes);
+
+	/* Setting a variable to its current value writes nothing either */
+	ut_assertok(test_set(&htab, "test_c", "3"));
+	ut_assertok(env_log_save(&log));
+	ut_asserteq(writes, flash.writes);
+
+	ut_assertok(test_log_reload(uts, &log, &htab, 1));
+	ut_assert(!test_get(&htab, "test_a"));
+	ut_asserteq_str("22", test_get(&htab, "test_b"));
+	ut_asserteq_str("3", test_get(&htab, "test_c"));
+	ut_asserteq_str("4", test_get(&htab, "test_d"));
+	test_log_free(&log);
+
+	return 0;
+}
+ENV_TEST(env_test_log_append, 0);
+
+/* The log is compacted when full, keeping all the changes */
+static int env_test_log_compact(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	struct test_flash flash;
+	struct env_log log;
+	char value[12];
+	int i;
+
+	ut_assertok(test_log_setup(uts, &log, &flash, &htab));
+	for (i = 0; flash.erases == 1; i++) {
+		snprintf(value, sizeof(value), "%d", i);
+		ut_assertok(test_set(&htab, "test_count", value));
+		ut_assertok(env_log_save(&log));
+	}
+	ut_asserteq(2, flash.erases);
+	ut_assert(i > 10);
+
+	ut_assertok(test_log_reload(uts, &log, &htab, 0));
+	ut_asserteq_str(value, test_get(&htab, "test_count"));
+	ut_asserteq_str("1", test_get(&htab, "test_a"));
+	test_log_free(&log);
+
+	return 0;
+}
+ENV_TEST(env_test_log_compact, 0);
+
+/* A save cut short by power failure leaves the previous environment */
+static int env_test_log_power_fail(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	struct test_flash flash;
+	struct env_log log;
+
+	ut_assertok(test_log_setup(uts, &log, &flash, &htab));
+	ut_assertok(test_set(&htab, "test_a", "10"));
+	ut_assertok(env_log_save(&log));
+
+	/* Lose power part-way through the data of the next record */
+	ut_assertok(test_set(&htab, "test_a", "100"));
+	ut_assertok(test_set(&htab, "test_b", "200"));
+	flash.cut = 12;
+	ut_asserteq(-EIO, env_log_save(&log));
+	flash.cut = -1;
+
+	ut_assertok(test_log_reload(uts, &log, &htab, 1));
+	ut_asserteq_str("10", test_get(&htab, "test_a"));
+	ut_asserteq_str("2", test_get(&htab, "test_b"));
+
+	/* Later records go after the torn one, without an erase */
+	ut_assertok(test_set(&htab, "test_c", "30"));
+	ut_assertok(env_log_save(&log));
+	ut_asserteq(1, flash.erases);
+	ut_assertok(test_log_reload(uts, &log, &htab, 2));
+	ut_asserteq_str("10", test_get(&htab, "test_a"));
+	ut_asserteq_str("30", test_get(&htab, "test_c"));
+
+	/* A torn header cannot be skipped, so the next save compacts */
+	ut_assertok(test_set(&htab, "test_c", "300"));
+	flash.cut = 1;
+	ut_asserteq(-EIO, env_log_save(&log));
+	flash.cut = -1;
+	ut_assertok(test_log_reload(uts, &log, &htab, 2));
+	ut_asserteq_str("30", test_get(&htab, "test_c"));
+	ut_asserteq(log.size, log.pos);
+	ut_assertok(test_set(&htab, "test_c", "3000"));
+	ut_assertok(env_log_save(&log));
+	ut_asserteq(2, flash.erases);
+	ut_assertok(test_log_reload(uts, &log, &htab, 0));
+	ut_asserteq_str("3000", test_get(&htab, "test_c"));
+
+	/* A bad env_t is reported, so the default environment can be used */
+	flash.mem[8] ^= 1;
+	test_log_free(&log);
+	test_log_init(&log, &flash, &htab);
+	ut_asserteq(-EBADMSG, env_log_load(&log));
+	test_log_free(&log);
+
+	return 0;
+}
+ENV_TEST(env_test_log_power_fail, 0);
@@ -0,0 +1,399 @@
+/*
+ * Tests for reading fragmented and sparse ext4 files
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <command.h>
+#include <dm.h>
+#include <errno.h>
+#include <ext4fs.h>
+#include <malloc.h>
+#include <os.h>
+#include <part.h>
+#include <sandboxblockdev.h>
+
+/*
+ * The image has 1 KiB blocks in one group: the superblock in block 1, the
+ * group descriptors in block 2, 32 inodes of 128 bytes in blocks 5-8 and
+ * the root directory in block 9. Extent leaves and file data come after.
+ */
+#define TEST_BLKSZ		1024
+#define TEST_BLOCKS		128
+#define TEST_INODE_SIZE		128
+#define TEST_INODES		32
+#define TEST_ITABLE		5
+#define TEST_ROOT_BLOCK		9
+#define TEST_DATA_START		20
+
+/* An extent of a file, which reads back as zeroes if unwritten */
+struct test_extent {
+	uint block;		/* First file block */
+	uint len;		/* Number of blocks */
+	uint start;		/* First block on disk */
+	bool unwritten;
+};
+
+/* A leaf of the extent tree, covering file blocks from @first on */
+struct test_leaf {
+	uint first;
+	uint blknr;		/* Block holding the leaf */
+	const struct test_extent *ext;
+	int count;
+};
+
+struct test_file {
+	const char *name;
+	int ino;
+	uint size;
+	const struct test_leaf *leaf;
+	int num_leaves;
+};
+
+/*
+ * Blocks 0-4 are in two extents which are adjacent on disk, so they are
+ * read in one go. Then come a lone block, a hole, an unwritten extent and
+ * a second leaf. The file ends with a hole which is not a whole block.
+ */
+static const struct test_extent test_frag_ext0[] = {
+	{ 0, 3, 20 },
+	{ 3, 2, 23 },
+	{ 5, 1, 40 },
+	/* 6-9 are a hole */
+	{ 10, 2, 30 },
+	{ 12, 2, 50, true },
+	{ 14, 4, 60 },
+};
+
+static const struct test_extent test_frag_ext1[] = {
+	{ 18, 1, 45 },
+	/* 19-20 are a hole */
+};
+
+static const struct test_leaf test_frag_leaves[] = {
+	{ 0, 10, test_frag_ext0, ARRAY_SIZE(test_frag_ext0) },
+	{ 18, 12, test_frag_ext1, ARRAY_SIZE(test_frag_ext1) },
+};
+
+static const struct test_extent test_other_ext[] = {
+	{ 0, 2, 70 },
+	/* 2-3 are a hole */
+	{ 4, 2, 80 },
+};
+
+static const struct test_leaf test_other_leaves[] = {
+	{ 0, 11, test_other_ext, ARRAY_SIZE(test_other_ext) },
+};
+
+static const struct test_file test_frag = {
+	"frag", 12, 21 * TEST_BLKSZ - 100,
+	test_frag_leaves, ARRAY_SIZE(test_frag_leaves),
+};
+
+static const struct test_file test_other = {
+	"other", 13, 6 * TEST_BLKSZ,
+	test_other_leaves, ARRAY_SIZE(test_other_leaves),
+};
+
+/* Each word of a data block holds the block number and its position */
+static void test_fill_block(u32 *buf, uint blknr)
+{
+	int i;
+
+	for (i = 0; i < TEST_BLKSZ / sizeof(u32); i++)
+		buf[i] = blknr << 16 | i;
+}
+
+static struct ext2_inode *test_inode(u8 *img, int ino)
+{
+	return (struct ext2_inode *)(img + TEST_ITABLE * TEST_BLKSZ +
+				     (ino - 1) * TEST_INODE_SIZE);
+}
+
+static void test_add_dirent(u8 **ptr, int ino, const char *name, int type,
+			    int len)
+{
+	struct ext2_dirent *dirent = (struct ext2_dirent *)*ptr;
+
+	dirent->inode = cpu_to_le32(ino);
+	dirent->direntlen = cpu_to_le16(len);
+	dirent->namelen = strlen(name);
+	dirent->filetype = type;
+	memcpy(dirent + 1, name, dirent->namelen);
+	*ptr += len;
+}
+
+static void test_add_file(u8 *img, const struct test_file *file)
+{
+	struct ext2_inode *inode = test_inode(img, file->ino);
+	struct ext4_extent_header *hdr;
+	struct ext4_extent_idx *idx;
+	struct ext4_extent *ext;
+	const struct test_leaf *leaf;
+	uint len;
+	int i, j;
+
+	inode->mode = cpu_to_le16(FILETYPE_INO_REG | 0644);
+	inode->size = cpu_to_le32(file->size);
+	inode->nlinks = cpu_to_le16(1);
+	inode->flags = cpu_to_le32(EXT4_EXTENTS_FL);
+
+	/* A one-level tree, with the index in the inode */
+	hdr = (struct ext4_extent_header *)inode->b.blocks.dir_blocks;
+	hdr->eh_magic = cpu_to_le16(EXT4_EXT_MAGIC);
+	hdr->eh_entries = cpu_to_le16(file->num_leaves);
+	hdr->eh_max = cpu_to_le16(4);
+	hdr->eh_depth = cpu_to_le16(1);
+	idx = (struct ext4_extent_idx *)(hdr + 1);
+	for (i = 0, leaf = file->leaf; i < file->num_leaves; i++, leaf++) {
+		idx[i].ei_block = cpu_to_le32(leaf->first);
+		idx[i].ei_leaf_lo = cpu_to_le32(leaf->blknr);
+
+		hdr = (struct ext4_extent_header *)(img +
+						     leaf->blknr * TEST_BLKSZ);
+		hdr->eh_magic = cpu_to_le16(EXT4_EXT_MAGIC);
+		hdr->eh_entries = cpu_to_le16(leaf->count);
+		hdr->eh_max = cpu_to_le16((TEST_BLKSZ - sizeof(*hdr)) /
+					  sizeof(*ext));
+		ext = (struct ext4_extent *)(hdr + 1);
+		for (j = 0; j < leaf->count; j++) {
+			len = leaf->ext[j].len;
+			if (leaf->ext[j].unwritten)
+				len += EXT_INIT_MAX_LEN;
+			ext[j].ee_block = cpu_to_le32(leaf->ext[j].block);
+			ext[j].ee_len = cpu_to_le16(len);
+			ext[j].ee_start_lo = cpu_to_le32(leaf->ext[j].start);
+		}
+	}
+}
+
+/* Build the image, with every block from TEST_DATA_START on filled */
+static u8 *test_build(void)
+{
+	struct ext2_sblock *sb;
+	struct ext2_block_group *bg;
+	struct ext2_inode *root;
+	struct ext4_extent_header *hdr;
+	struct ext4_extent *ext;
+	u8 *img, *ptr;
+	int i;
+
+	img = calloc(TEST_BLOCKS, TEST_BLKSZ);
+	if (!img)
+		return NULL;
+
+	sb = (struct ext2_sblock *)(img + TEST_BLKSZ);
+	sb->total_inodes = cpu_to_le32(TEST_INODES);
+	sb->total_blocks = cpu_to_le32(TEST_BLOCKS);
+	sb->first_data_block = cpu_to_le32(1);
+	sb->blocks_per_group = cpu_to_le32(8192);
+	sb->fragments_per_group = cpu_to_le32(8192);
+	sb->inodes_per_group = cpu_to_le32(TEST_INODES);
+	sb->magic = cpu_to_le16(EXT2_MAGIC);
+	sb->revision_level = cpu_to_le32(1);
+	sb->first_inode = cpu_to_le32(11);
+	sb->inode_size = cpu_to_le16(TEST_INODE_SIZE);
+	sb->feature_incompat = cpu_to_le32(EXT4_FEATURE_INCOMPAT_EXTENTS);
+
+	bg = (struct ext2_block_group *)(img + 2 * TEST_BLKSZ);
+	bg->block_id = cpu_to_le32(3);
+	bg->inode_id = cpu_to_le32(4);
+	bg->inode_table_id = cpu_to_le32(TEST_ITABLE);
+
+	root = test_inode(img, 2);
+	root->mode = cpu_to_le16(FILETYPE_INO_DIRECTORY | 0755);
+	root->size = cpu_to_le32(TEST_BLKSZ);
+	root->nlinks = cpu_to_le16(2);
+	root->flags = cpu_to_le32(EXT4_EXTENTS_FL);
+	hdr = (struct ext4_extent_header *)root->b.blocks.dir_blocks;
+	hdr->eh_magic = cpu_to_le16(EXT4_EXT_MAGIC);
+	hdr->eh_entries = cpu_to_le16(1);
+	hdr->eh_max = cpu_to_le16(4);
+	ext = (struct ext4_extent *)(hdr + 1);
+	ext->ee_len = cpu_to_le16(1);
+	ext->ee_start_lo = cpu_to_le32(TEST_ROOT_BLOCK);
+
+	ptr = img + TEST_ROOT_BLOCK * TEST_BLKSZ;
+	test_add_dirent(&ptr, 2, ".", FILETYPE_DIRECTORY, 12);
+	test_add_dirent(&ptr, 2, "..", FILETYPE_DIRECTORY, 12);
+	test_add_dirent(&ptr, test_frag.ino, test_frag.name, FILETYPE_REG,
+			12);
+	test_add_dirent(&ptr, test_other.ino, test_other.name, FILETYPE_REG,
+			img + (TEST_ROOT_BLOCK + 1) * TEST_BLKSZ - ptr);
+
+	test_add_file(img, &test_frag);
+	test_add_file(img, &test_other);
+	for (i = TEST_DATA_START; i < TEST_BLOCKS; i++)
+		test_fill_block((u32 *)(img + i * TEST_BLKSZ), i);
+
+	return img;
+}
+
+/* Work out what reading @len bytes of @file from @pos should give */
+static int test_expect(const struct test_file *file, loff_t pos, loff_t len,
+		       u8 *out)
+{
+	u8 *whole, *blk;
+	const struct test_leaf *leaf;
+	const struct test_extent *ext;
+	int i, j, k;
+
+	whole = calloc(DIV_ROUND_UP(file->size, TEST_BLKSZ), TEST_BLKSZ);
+	if (!whole)
+		return -ENOMEM;
+	for (i = 0, leaf = file->leaf; i < file->num_leaves; i++, leaf++) {
+		for (j = 0, ext = leaf->ext; j < leaf->count; j++, ext++) {
+			if (ext->unwritten)
+				continue;
+			for (k = 0; k < ext->len; k++) {
+				blk = whole + (ext->block + k) * TEST_BLKSZ;
+				test_fill_block((u32 *)blk, ext->start + k);
+			}
+		}
+	}
+	memcpy(out, whole + pos, len);
+	free(whole);
+
+	return 0;
+}
+
+/*
+ * Read part of a file, check the data and that the device was read
+ * @reads times
+ */
+static int test_read(struct host_block_dev *host_dev,
+		     const struct test_file *file, loff_t pos, loff_t len,
+		     ulong reads)
+{
+	loff_t size, actread;
+	u8 *buf, *want;
+	int ret = 0;
+
+	if (ext4fs_open(file->name, &size) || size != file->size) {
+		printf("%s: cannot open %s\n", __func__, file->name);
+		return -ENOENT;
+	}
+	if (!len)
+		len = size - pos;
+
+	buf = malloc(len);
+	want = malloc(len);
+	if (!buf || !want || test_expect(file, pos, len, want)) {
+		free(want);
+		free(buf);
+		return -ENOMEM;
+	}
+	memset(buf, 0xa5, len);
+
+	host_dev->reads = 0;
+	if (ext4fs_read((char *)buf, pos, len, &actread) || actread != len) {
+		printf("%s: %s at %lld: read failed\n", __func__, file->name,
+		       pos);
+		ret = -EIO;
+	} else if (memcmp(buf, want, len)) {
+		printf("%s: %s at %lld: wrong data\n", __func__, file->name,
+		       pos);
+		ret = -EINVAL;
+	} else if (host_dev->reads != reads) {
+		printf("%s: %s at %lld: %lu reads, expected %lu\n", __func__,
+		       file->name, pos, host_dev->reads, reads);
+		ret = -EINVAL;
+	}
+	free(want);
+	free(buf);
+
+	return ret;
+}
+
+static int test_reads(int devnum, struct host_block_dev *host_dev)
+{
+	char dev_part[12];
+	struct blk_desc *desc;
+	disk_partition_t info;
+	int ret = 0;
+
+	snprintf(dev_part, sizeof(dev_part), "%d:0", devnum);
+	if (blk_get_device_part_str("host", dev_part, &desc, &info, 1) < 0)
+		return -ENODEV;
+	ext4fs_set_blk_dev(desc, &info);
+	if (!ext4fs_mount(info.size))
+		return -EINVAL;
+
+	/*
+	 * Each leaf is read once, then each run of blocks which is
+	 * contiguous on disk: blocks 0-4, 5, 10-11, 14-17 and 18
+	 */
+	ret |= test_read(host_dev, &test_frag, 0, 0, 2 + 5);
+
+	/*
+	 * Blocks 5-12 are in the first leaf, which has to be read again.
+	 * The read starts half-way through block 5, so that is read by
+	 * itself, then 10-11; block 12 is unwritten
+	 */
+	ret |= test_read(host_dev, &test_frag, 5 * TEST_BLKSZ + 512,
+			 7 * TEST_BLKSZ + 512, 1 + 2);
+
+	/* The cached leaf covers this, so only the data is read */
+	ret |= test_read(host_dev, &test_frag, 10 * TEST_BLKSZ,
+			 2 * TEST_BLKSZ, 1);
+
+	/* Another file does not use the leaf cached for the first */
+	ret |= test_read(host_dev, &test_other, 0, 0, 1 + 2);
+	ret |= test_read(host_dev, &test_frag, 0, 0, 2 + 5);
+
+	/* Holes and unwritten extents alone need no reads beyond the leaf */
+	ret |= test_read(host_dev, &test_frag, 6 * TEST_BLKSZ,
+			 4 * TEST_BLKSZ, 1);
+	ret |= test_read(host_dev, &test_frag, 12 * TEST_BLKSZ,
+			 2 * TEST_BLKSZ, 0);
+	ret |= test_read(host_dev, &test_frag, 19 * TEST_BLKSZ, 0, 1);
+	ext4fs_close();
+
+	return ret;
+}
+
+int do_ut_ext4(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	char fname[] = "/tmp/u-boot.ext4.XXXXXX";
+	struct host_block_dev *host_dev;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	int devnum, fd, ret;
+	u8 *img;
+
+	img = test_build();
+	if (!img)
+		return CMD_RET_FAILURE;
+	fd = os_mktemp(fname);
+	if (fd < 0) {
+		free(img);
+		return CMD_RET_FAILURE;
+	}
+	ret = os_write(fd, img, TEST_BLOCKS * TEST_BLKSZ) !=
+		TEST_BLOCKS * TEST_BLKSZ;
+	os_close(fd);
+	free(img);
+
+	/* Use a host device which nothing else has bound */
+	for (devnum = 0; !host_get_dev_err(devnum, &desc); devnum++)
+		;
+	if (!ret)
+		ret = host_dev_bind(devnum, fname);
+	if (!ret) {
+		ret = blk_get_device(IF_TYPE_HOST, devnum, &dev);
+		if (!ret) {
+			host_dev = dev_get_priv(dev);
+			/* Count every read, not just cache misses */
+			blkcache_configure(8, 0);
+			ret = test_reads(devnum, host_dev);
+			blkcache_configure(8, 32);
+		}
+		host_dev_bind(devnum, NULL);
+	}
+	os_unlink(fname);
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
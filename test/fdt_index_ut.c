@@ -0,0 +1,197 @@
+/*
+ * Tests and benchmark for the device-tree lookup index
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <libfdt.h>
+#include <malloc.h>
+
+#define TEST_NODES	2000
+#define TEST_COMPATS	16
+#define TEST_FDT_SIZE	(1 << 20)
+
+#define CHECK(op)	do {						\
+		int __ret = (op);					\
+		if (__ret < 0) {					\
+			printf("%s:%d: %s: %s\n", __func__, __LINE__,	\
+			       #op, fdt_strerror(__ret));		\
+			return -EINVAL;					\
+		}							\
+	} while (0)
+
+/* Make a tree shaped like a large SoC: many devices under one bus */
+static int make_tree(void *fdt)
+{
+	char name[20];
+	int i;
+
+	CHECK(fdt_create(fdt, TEST_FDT_SIZE));
+	CHECK(fdt_finish_reservemap(fdt));
+	CHECK(fdt_begin_node(fdt, ""));
+	CHECK(fdt_property_u32(fdt, "#address-cells", 1));
+	CHECK(fdt_begin_node(fdt, "soc"));
+	for (i = 0; i < TEST_NODES; i++) {
+		snprintf(name, sizeof(name), "dev@%x", i);
+		CHECK(fdt_begin_node(fdt, name));
+		snprintf(name, sizeof(name), "test,dev%d", i % TEST_COMPATS);
+		CHECK(fdt_property_string(fdt, "compatible", name));
+		CHECK(fdt_property_u32(fdt, "reg", i));
+		CHECK(fdt_property_u32(fdt, "phandle", i + 1));
+		if (!(i % 4)) {
+			CHECK(fdt_begin_node(fdt, "port"));
+			CHECK(fdt_property_u32(fdt, "remote-endpoint",
+					       (i + 7) % TEST_NODES + 1));
+			CHECK(fdt_end_node(fdt));
+		}
+		CHECK(fdt_end_node(fdt));
+	}
+	CHECK(fdt_end_node(fdt));
+	CHECK(fdt_end_node(fdt));
+	CHECK(fdt_finish(fdt));
+
+	return fdt_open_into(fdt, fdt, TEST_FDT_SIZE);
+}
+
+/* The sort of thing ft_board_setup() does, changing the tree as it goes */
+static int fixup_tree(void *fdt)
+{
+	char str[40];
+	int off, parent, depth;
+	int i, count;
+
+	for (i = 0; i < TEST_COMPATS; i++) {
+		snprintf(str, sizeof(str), "test,dev%d", i);
+		for (off = fdt_node_offset_by_compatible(fdt, -1, str);
+		     off >= 0;
+		     off = fdt_node_offset_by_compatible(fdt, off, str)) {
+			CHECK(fdt_setprop_string(fdt, off, "status",
+						 i & 1 ? "okay" : "disabled"));
+		}
+		if (off != -FDT_ERR_NOTFOUND)
+			CHECK(off);
+	}
+
+	for (i = 0; i < TEST_NODES; i += 3) {
+		CHECK(off = fdt_node_offset_by_phandle(fdt, i + 1));
+		CHECK(parent = fdt_parent_offset(fdt, off));
+		CHECK(depth = fdt_node_depth(fdt, off));
+		CHECK(fdt_setprop_u32(fdt, off, "depth", depth));
+		CHECK(fdt_setprop_u32(fdt, parent, "last-fixed", i));
+	}
+
+	for (i = 0; i < TEST_NODES; i += 50) {
+		snprintf(str, sizeof(str), "/soc/dev@%x", i);
+		CHECK(off = fdt_path_offset(fdt, str));
+		CHECK(fdt_add_subnode(fdt, off, "added"));
+		if (!(i % 100)) {
+			strcat(str, "/port");
+			CHECK(off = fdt_path_offset(fdt, str));
+			CHECK(fdt_del_node(fdt, off));
+		}
+	}
+
+	/* New phandles must be found too */
+	CHECK(off = fdt_path_offset(fdt, "/soc/dev@32/added"));
+	CHECK(fdt_setprop_u32(fdt, off, "phandle", TEST_NODES + 1));
+	CHECK(off = fdt_node_offset_by_phandle(fdt, TEST_NODES + 1));
+	CHECK(fdt_setprop_string(fdt, off, "status", "okay"));
+
+	CHECK(parent = fdt_path_offset(fdt, "/soc"));
+	count = 0;
+	fdt_for_each_subnode(fdt, off, parent)
+		count++;
+	CHECK(fdt_setprop_u32(fdt, 0, "soc-devices", count));
+
+	return 0;
+}
+
+static int test_fixup(void *base, void *fdt, void *indexed)
+{
+	ulong start, scan_ms, index_ms;
+	void *buf;
+	int size, ret;
+
+	memcpy(fdt, base, TEST_FDT_SIZE);
+	start = get_timer(0);
+	ret = fixup_tree(fdt);
+	scan_ms = get_timer(start);
+	if (ret)
+		return ret;
+
+	memcpy(indexed, base, TEST_FDT_SIZE);
+	start = get_timer(0);
+	size = fdt_index_size(indexed);
+	CHECK(size);
+	size *= 2;
+	buf = malloc(size);
+	if (!buf)
+		return -ENOMEM;
+	ret = fdt_index_add(indexed, buf, size);
+	if (!ret)
+		ret = fixup_tree(indexed);
+	index_ms = get_timer(start);
+	if (fdt_index_remove(indexed) != buf) {
+		printf("%s: index not found\n", __func__);
+		ret = -EINVAL;
+	}
+	free(buf);
+	CHECK(ret);
+
+	if (fdt_totalsize(fdt) != fdt_totalsize(indexed) ||
+	    memcmp(fdt, indexed, fdt_totalsize(fdt))) {
+		printf("%s: trees differ\n", __func__);
+		return -EINVAL;
+	}
+	printf("%s: %d nodes: %lu ms scanning, %lu ms indexed\n", __func__,
+	       TEST_NODES, scan_ms, index_ms);
+
+	return 0;
+}
+
+/* An index which does not fit is refused */
+static int test_nospace(void *base, void *fdt)
+{
+	char buf[1024];
+	int ret;
+
+	memcpy(fdt, base, TEST_FDT_SIZE);
+	ret = fdt_index_add(fdt, buf, sizeof(buf));
+	if (ret != -FDT_ERR_NOSPACE) {
+		printf("%s: small buffer gave %d\n", __func__, ret);
+		return -EINVAL;
+	}
+	if (fdt_index_remove(fdt)) {
+		printf("%s: index should not be present\n", __func__);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int do_ut_fdt_index(cmd_tbl_t *cmdtp, int flag, int argc,
+		    char * const argv[])
+{
+	void *base, *fdt, *indexed;
+	int ret;
+
+	base = malloc(TEST_FDT_SIZE * 3);
+	if (!base)
+		return CMD_RET_FAILURE;
+	fdt = base + TEST_FDT_SIZE;
+	indexed = fdt + TEST_FDT_SIZE;
+
+	ret = make_tree(base);
+	if (!ret)
+		ret = test_fixup(base, fdt, indexed);
+	if (!ret)
+		ret = test_nospace(base, fdt);
+
+	free(base);
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
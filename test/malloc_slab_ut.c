@@ -0,0 +1,203 @@
+/*
+ * Tests for the size-class allocator for small malloc() requests
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <malloc.h>
+#include <malloc_slab.h>
+
+#define TEST_PAGE_SIZE	512
+#define TEST_PAGES	4
+
+/* Objects are the right size, aligned, separate and used again when freed */
+static int test_classes(void)
+{
+	static const uint sizes[] = { 0, 1, 16, 17, 100, 129, 200, 256 };
+	/* Three sizes share a page, leaving no room for the last two */
+	static const uint expect[] = { 16, 16, 16, 32, 112, 160, 0, 0 };
+	struct slab_heap heap;
+	u8 *area, *ptr[ARRAY_SIZE(sizes)];
+	int i, j, ret = 0;
+
+	area = memalign(TEST_PAGE_SIZE, TEST_PAGE_SIZE * (TEST_PAGES + 1));
+	if (!area)
+		return -ENOMEM;
+	slab_init(&heap, (ulong)area + TEST_PAGE_SIZE * TEST_PAGES + 100,
+		  (ulong)area, TEST_PAGE_SIZE);
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		ptr[i] = slab_alloc(&heap, sizes[i]);
+		if (expect[i] ? !ptr[i] || slab_size(&heap, ptr[i]) !=
+		    expect[i] || (ulong)ptr[i] & 15 : !!ptr[i]) {
+			printf("%s: size %u gave %p\n", __func__, sizes[i],
+			       ptr[i]);
+			ret = -EINVAL;
+		}
+		if (ptr[i])
+			memset(ptr[i], i, sizes[i]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		for (j = 0; ptr[i] && j < sizes[i]; j++) {
+			if (ptr[i][j] != i) {
+				printf("%s: size %u overwritten\n", __func__,
+				       sizes[i]);
+				ret = -EINVAL;
+				break;
+			}
+		}
+	}
+	if (heap.base != (ulong)area || heap.cls[10].misses != 1 ||
+	    heap.cls[11].misses != 1 ||
+	    slab_alloc(&heap, SLAB_MAX_SIZE + 1) ||
+	    slab_size(&heap, area + TEST_PAGE_SIZE * TEST_PAGES) ||
+	    slab_size(&heap, area - 16)) {
+		printf("%s: wrong use of the area\n", __func__);
+		ret = -EINVAL;
+	}
+
+	if (slab_used(&heap) != 16 * 3 + 32 + 112 + 160) {
+		printf("%s: %lu bytes used\n", __func__, slab_used(&heap));
+		ret = -EINVAL;
+	}
+	slab_free(&heap, ptr[1]);
+	if (slab_alloc(&heap, 10) != ptr[1] || heap.cls[0].in_use != 3 ||
+	    heap.cls[0].peak != 3 || heap.cls[0].frees != 1) {
+		printf("%s: freed object not used again\n", __func__);
+		ret = -EINVAL;
+	}
+	free(area);
+
+	return ret;
+}
+
+/* Pages are not taken below the limit, which may move */
+static int test_limit(void)
+{
+	struct slab_heap heap;
+	uint per_page = (TEST_PAGE_SIZE - SLAB_PAGE_HDR) / 64;
+	u8 *area;
+	int i, count, ret = 0;
+
+	area = memalign(TEST_PAGE_SIZE, TEST_PAGE_SIZE * TEST_PAGES);
+	if (!area)
+		return -ENOMEM;
+	slab_init(&heap, (ulong)area + TEST_PAGE_SIZE * TEST_PAGES,
+		  (ulong)area + TEST_PAGE_SIZE, TEST_PAGE_SIZE);
+
+	for (count = 0; slab_alloc(&heap, 64); count++)
+		;
+	if (count != per_page * (TEST_PAGES - 1) || heap.cls[3].misses != 1) {
+		printf("%s: %d objects, expected %d\n", __func__, count,
+		       per_page * (TEST_PAGES - 1));
+		ret = -EINVAL;
+	}
+
+	/* Something else has grown up to the lowest page */
+	heap.limit = heap.base - 1;
+	for (i = 0; i < 4; i++) {
+		if (slab_alloc(&heap, 16)) {
+			printf("%s: page taken below the limit\n", __func__);
+			ret = -EINVAL;
+		}
+	}
+	free(area);
+
+	return ret;
+}
+
+/*
+ * malloc() and friends use the allocator, and leaks still show. dlmalloc
+ * only has mallinfo() with DEBUG, which sandbox sets.
+ */
+static int test_malloc(void)
+{
+	struct slab_heap *heap = malloc_slab_get(false);
+	u8 *ptr, *big;
+	int i, ret = 0;
+#ifdef CONFIG_SANDBOX
+	struct mallinfo start = mallinfo();
+#endif
+
+	if (!heap) {
+		printf("%s: no heap\n", __func__);
+		return -ENOENT;
+	}
+	ptr = malloc(40);
+	if (!ptr)
+		return -ENOMEM;
+	if (slab_size(heap, ptr) != 48 || malloc_usable_size(ptr) != 48) {
+		printf("%s: malloc() did not use the allocator\n", __func__);
+		ret = -EINVAL;
+	}
+#ifdef CONFIG_SANDBOX
+	if (mallinfo().uordblks != start.uordblks + 48) {
+		printf("%s: mallinfo() does not count objects\n", __func__);
+		ret = -EINVAL;
+	}
+#endif
+	for (i = 0; i < 40; i++)
+		ptr[i] = i;
+	if (realloc(ptr, 48) != ptr) {
+		printf("%s: realloc() moved a fitting object\n", __func__);
+		ret = -EINVAL;
+	}
+
+	big = realloc(ptr, 1000);
+	if (!big || slab_size(heap, big)) {
+		printf("%s: realloc() did not move to dlmalloc\n", __func__);
+		ret = -EINVAL;
+	}
+	for (i = 0; big && i < 40; i++) {
+		if (big[i] != i) {
+			printf("%s: realloc() lost data\n", __func__);
+			ret = -EINVAL;
+			break;
+		}
+	}
+	free(big);
+
+	ptr = malloc(200);
+	if (ptr)
+		memset(ptr, 0xff, 200);
+	free(ptr);
+	ptr = calloc(25, 8);
+	for (i = 0; ptr && i < 200; i++) {
+		if (ptr[i]) {
+			printf("%s: calloc() did not clear\n", __func__);
+			ret = -EINVAL;
+			break;
+		}
+	}
+	if (!ptr || slab_size(heap, ptr) != 224) {
+		printf("%s: calloc() did not use the allocator\n", __func__);
+		ret = -EINVAL;
+	}
+	free(ptr);
+
+#ifdef CONFIG_SANDBOX
+	if (mallinfo().uordblks != start.uordblks) {
+		printf("%s: leak of %d bytes\n", __func__,
+		       mallinfo().uordblks - start.uordblks);
+		ret = -EINVAL;
+	}
+#endif
+
+	return ret;
+}
+
+int do_ut_slab(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	int ret = 0;
+
+	ret |= test_classes();
+	ret |= test_limit();
+	ret |= test_malloc();
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
@@ -0,0 +1,178 @@
+/*
+ * Tests for running jobs on the secondary CPUs
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <hash.h>
+#include <malloc.h>
+#include <smp_work.h>
+#include <u-boot/crc.h>
+
+#define TEST_JOBS	200
+#define TEST_BLOCK	4096
+#define TEST_COPY_SIZE	(4 << 20)
+
+struct test_job {
+	struct smp_work work;
+	const uint8_t *data;
+	uint crc;
+};
+
+static int test_job_run(void *arg)
+{
+	struct test_job *job = arg;
+
+	job->crc = crc32(0, job->data, TEST_BLOCK);
+
+	return 0;
+}
+
+static int test_fail_run(void *arg)
+{
+	return -EIO;
+}
+
+static void test_fill(uint8_t *buf, int len, uint seed)
+{
+	int i;
+
+	for (i = 0; i < len; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = seed >> 16;
+	}
+}
+
+static int test_queue(uint8_t *buf)
+{
+	struct test_job *jobs;
+	int i, ret = 0;
+
+	jobs = calloc(TEST_JOBS, sizeof(*jobs));
+	if (!jobs)
+		return -ENOMEM;
+
+	/* More jobs than there are queue slots */
+	for (i = 0; i < TEST_JOBS; i++) {
+		jobs[i].work.func = i % 7 ? test_job_run : test_fail_run;
+		jobs[i].work.arg = &jobs[i];
+		jobs[i].data = buf + (i % 64) * TEST_BLOCK;
+		smp_work_queue(&jobs[i].work);
+	}
+	smp_work_wait();
+
+	for (i = 0; i < TEST_JOBS; i++) {
+		if (i % 7 == 0) {
+			if (jobs[i].work.ret != -EIO) {
+				printf("%s: job %d returned %d, expected %d\n",
+				       __func__, i, jobs[i].work.ret, -EIO);
+				ret = -EINVAL;
+			}
+		} else if (jobs[i].work.ret ||
+			   jobs[i].crc != crc32(0, jobs[i].data, TEST_BLOCK)) {
+			printf("%s: job %d returned %d, crc %08x\n", __func__,
+			       i, jobs[i].work.ret, jobs[i].crc);
+			ret = -EINVAL;
+		}
+	}
+	free(jobs);
+
+	return ret;
+}
+
+static int test_copy(uint8_t *buf)
+{
+	uint8_t *dst = buf + TEST_COPY_SIZE;
+	int i;
+
+	smp_memcpy(dst, buf, TEST_COPY_SIZE - 3);
+	if (memcmp(dst, buf, TEST_COPY_SIZE - 3)) {
+		printf("%s: copy differs\n", __func__);
+		return -EINVAL;
+	}
+
+	/* Overlapping copies must still work */
+	smp_memcpy(buf + 1, buf, TEST_COPY_SIZE - 1);
+	if (memcmp(buf + 1, dst, TEST_COPY_SIZE - 4)) {
+		printf("%s: overlapping copy differs\n", __func__);
+		return -EINVAL;
+	}
+
+	smp_memset(dst + 5, 0xa5, TEST_COPY_SIZE - 10);
+	for (i = 5; i < TEST_COPY_SIZE - 5; i++) {
+		if (dst[i] != 0xa5) {
+			printf("%s: fill differs at %d\n", __func__, i);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int test_hash(uint8_t *buf)
+{
+	struct hash_job jobs[10];
+	uint8_t output[10][HASH_MAX_DIGEST_SIZE];
+	uint8_t expect[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+	int i, ret;
+
+	ret = hash_lookup_algo("crc32", &algo);
+	if (ret)
+		return ret;
+
+	memset(jobs, '\0', sizeof(jobs));
+	for (i = 0; i < ARRAY_SIZE(jobs); i++) {
+		jobs[i].algo = algo;
+		jobs[i].data = buf + i * 12345;
+		jobs[i].len = TEST_COPY_SIZE / 2;
+		jobs[i].output = output[i];
+	}
+	ret = hash_block_multi(jobs, ARRAY_SIZE(jobs));
+	if (ret)
+		return ret;
+
+	for (i = 0; i < ARRAY_SIZE(jobs); i++) {
+		algo->hash_func_ws(jobs[i].data, jobs[i].len, expect,
+				   algo->chunk_size);
+		if (memcmp(expect, output[i], algo->digest_size)) {
+			printf("%s: hash %d differs\n", __func__, i);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int do_ut_smp_work(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	uint8_t *buf;
+	int cpus, ret = 0;
+
+	buf = malloc(TEST_COPY_SIZE * 2);
+	if (!buf)
+		return CMD_RET_FAILURE;
+	test_fill(buf, TEST_COPY_SIZE, 1);
+
+	cpus = smp_work_cpus();
+	printf("%s: %d CPUs\n", __func__, cpus);
+	if (cpus < 2)
+		ret |= -EINVAL;
+
+	ret |= test_queue(buf);
+	ret |= test_copy(buf);
+
+	/* The CPUs must start again after being parked */
+	smp_work_stop();
+	ret |= test_hash(buf);
+	ret |= test_queue(buf);
+	smp_work_stop();
+
+	free(buf);
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
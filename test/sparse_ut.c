@@ -0,0 +1,494 @@
+/*
+ * Tests for writing sparse images as they arrive
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <fastboot.h>
+#include <image-sparse.h>
+#include <malloc.h>
+#include <u-boot/crc.h>
+
+#define TEST_BLK_SZ	4096	/* block size of the sparse image */
+#define TEST_DEV_BLKSZ	512	/* block size of the devices */
+#define TEST_DEV_START	8	/* where the image goes on the devices */
+#define TEST_ERASED	0xa5	/* RAM device contents before writing */
+
+/* The NAND device has eraseblocks of 16 pages, some of them bad */
+#define TEST_NAND_PAGES	16
+#define TEST_NAND_SPARE	8	/* eraseblocks beyond the image */
+
+struct test_chunk {
+	uint type;
+	uint blks;
+	uint32_t val;		/* FILL value */
+};
+
+/*
+ * Every chunk type, with a RAW chunk larger than the write buffer and a
+ * CRC32 chunk part way through
+ */
+static const struct test_chunk test_chunks[] = {
+	{ CHUNK_TYPE_RAW, 3 },
+	{ CHUNK_TYPE_FILL, 5, 0x12345678 },
+	{ CHUNK_TYPE_DONT_CARE, 4 },
+	{ CHUNK_TYPE_RAW, 300 },
+	{ CHUNK_TYPE_CRC32, 0 },
+	{ CHUNK_TYPE_FILL, 2, 0xffffffff },
+	{ CHUNK_TYPE_DONT_CARE, 1 },
+	{ CHUNK_TYPE_RAW, 1 },
+	{ CHUNK_TYPE_CRC32, 0 },
+};
+
+/*
+ * Bad eraseblocks on the NAND device. With the chunks above they fall in
+ * the first FILL chunk, the first DONT_CARE chunk, the large RAW chunk and
+ * the FILL chunk of 0xff which is skipped.
+ */
+static const uint test_nand_bad[] = { 3, 6, 9, 160 };
+
+struct test_image {
+	u8 *data;		/* sparse image */
+	size_t len;
+	size_t crc_ofs;		/* offset of the first CRC32 chunk's value */
+	size_t out_len;		/* size of the expanded image */
+};
+
+/*
+ * A device to write the image to
+ *
+ * @info:	Storage, with @mem as its private data
+ * @mem:	Device contents
+ * @want:	Device contents expected after writing the image
+ * @size:	Size of @mem and @want in bytes
+ * @erased:	Value of each byte before writing
+ */
+struct test_dev {
+	struct sparse_storage info;
+	u8 *mem;
+	u8 *want;
+	size_t size;
+	u8 erased;
+};
+
+static char test_response[FASTBOOT_RESPONSE_LEN];
+
+static void test_okay(const char *reason)
+{
+	strncpy(test_response, "OKAY\0", 5);
+	strncat(test_response, reason, FASTBOOT_RESPONSE_LEN - 4 - 1);
+}
+
+static void test_fail(const char *reason)
+{
+	strncpy(test_response, "FAIL\0", 5);
+	strncat(test_response, reason, FASTBOOT_RESPONSE_LEN - 4 - 1);
+}
+
+static uint test_rand(uint *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+
+	return *seed >> 8;
+}
+
+static void test_fill(u8 *buf, int len, uint seed)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = test_rand(&seed);
+}
+
+/* Expand the image, with DONT_CARE blocks set to @erased */
+static void test_expand(u8 *out, u8 erased)
+{
+	const struct test_chunk *tc;
+	size_t dlen;
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(test_chunks); i++) {
+		tc = &test_chunks[i];
+		dlen = tc->blks * TEST_BLK_SZ;
+		if (tc->type == CHUNK_TYPE_RAW) {
+			test_fill(out, dlen, i);
+		} else if (tc->type == CHUNK_TYPE_FILL) {
+			for (j = 0; j < dlen; j += sizeof(uint32_t))
+				*(__le32 *)(out + j) = cpu_to_le32(tc->val);
+		} else if (tc->type == CHUNK_TYPE_DONT_CARE) {
+			memset(out, erased, dlen);
+		}
+		out += dlen;
+	}
+}
+
+/* Build the sparse image. DONT_CARE blocks count as zeros in checksums. */
+static int test_build(struct test_image *img)
+{
+	sparse_header_t *hdr;
+	chunk_header_t *chdr;
+	const struct test_chunk *tc;
+	size_t len, dlen, pos;
+	u8 *out, *p;
+	uint blks = 0;
+	int i;
+
+	len = sizeof(*hdr);
+	for (i = 0; i < ARRAY_SIZE(test_chunks); i++) {
+		tc = &test_chunks[i];
+		len += sizeof(*chdr);
+		if (tc->type == CHUNK_TYPE_RAW)
+			len += tc->blks * TEST_BLK_SZ;
+		else if (tc->type != CHUNK_TYPE_DONT_CARE)
+			len += sizeof(uint32_t);
+		blks += tc->blks;
+	}
+
+	memset(img, '\0', sizeof(*img));
+	img->len = len;
+	img->out_len = blks * TEST_BLK_SZ;
+	img->data = malloc(len);
+	out = malloc(img->out_len);
+	if (!img->data || !out) {
+		free(img->data);
+		free(out);
+		return -ENOMEM;
+	}
+	test_expand(out, 0);
+
+	hdr = (sparse_header_t *)img->data;
+	hdr->magic = cpu_to_le32(SPARSE_HEADER_MAGIC);
+	hdr->major_version = cpu_to_le16(1);
+	hdr->minor_version = cpu_to_le16(0);
+	hdr->file_hdr_sz = cpu_to_le16(sizeof(*hdr));
+	hdr->chunk_hdr_sz = cpu_to_le16(sizeof(*chdr));
+	hdr->blk_sz = cpu_to_le32(TEST_BLK_SZ);
+	hdr->total_blks = cpu_to_le32(blks);
+	hdr->total_chunks = cpu_to_le32(ARRAY_SIZE(test_chunks));
+	hdr->image_checksum = cpu_to_le32(crc32(0, out, img->out_len));
+
+	p = img->data + sizeof(*hdr);
+	for (i = 0, pos = 0; i < ARRAY_SIZE(test_chunks); i++) {
+		tc = &test_chunks[i];
+		chdr = (chunk_header_t *)p;
+		p += sizeof(*chdr);
+		dlen = tc->blks * TEST_BLK_SZ;
+		chdr->chunk_type = cpu_to_le16(tc->type);
+		chdr->reserved1 = 0;
+		chdr->chunk_sz = cpu_to_le32(tc->blks);
+		chdr->total_sz = cpu_to_le32(sizeof(*chdr));
+
+		switch (tc->type) {
+		case CHUNK_TYPE_RAW:
+			memcpy(p, out + pos, dlen);
+			p += dlen;
+			chdr->total_sz = cpu_to_le32(sizeof(*chdr) + dlen);
+			break;
+		case CHUNK_TYPE_FILL:
+			*(__le32 *)p = cpu_to_le32(tc->val);
+			p += sizeof(uint32_t);
+			chdr->total_sz = cpu_to_le32(sizeof(*chdr) + 4);
+			break;
+		case CHUNK_TYPE_CRC32:
+			if (!img->crc_ofs)
+				img->crc_ofs = p - img->data;
+			*(__le32 *)p = cpu_to_le32(crc32(0, out, pos));
+			p += sizeof(uint32_t);
+			chdr->total_sz = cpu_to_le32(sizeof(*chdr) + 4);
+			break;
+		}
+		pos += dlen;
+	}
+	free(out);
+
+	return 0;
+}
+
+static lbaint_t test_ram_write(struct sparse_storage *info, lbaint_t blk,
+			       lbaint_t blkcnt, const void *buffer)
+{
+	if (blk < info->start || blk + blkcnt > info->start + info->size)
+		return 0;
+	memcpy(info->priv + blk * info->blksz, buffer, blkcnt * info->blksz);
+
+	return blkcnt;
+}
+
+static lbaint_t test_ram_reserve(struct sparse_storage *info, lbaint_t blk,
+				 lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+/* Move past any bad eraseblocks at @page */
+static lbaint_t test_nand_skip(lbaint_t page)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(test_nand_bad); i++) {
+		if (page / TEST_NAND_PAGES == test_nand_bad[i]) {
+			page = (test_nand_bad[i] + 1) * TEST_NAND_PAGES;
+			i = -1;
+		}
+	}
+
+	return page;
+}
+
+/*
+ * Like nand_write_skip_bad(), returning the number of pages used,
+ * including those in bad eraseblocks
+ */
+static lbaint_t test_nand_write(struct sparse_storage *info, lbaint_t blk,
+				lbaint_t blkcnt, const void *buffer)
+{
+	lbaint_t page = blk;
+	lbaint_t i;
+
+	for (i = 0; i < blkcnt; i++, page++) {
+		page = test_nand_skip(page);
+		if (page >= info->start + info->size)
+			return 0;
+		memcpy(info->priv + page * info->blksz,
+		       buffer + i * info->blksz, info->blksz);
+	}
+
+	return page - blk;
+}
+
+static lbaint_t test_nand_reserve(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt)
+{
+	lbaint_t page = blk;
+	lbaint_t i;
+
+	for (i = 0; i < blkcnt; i++, page++)
+		page = test_nand_skip(page);
+
+	return page - blk;
+}
+
+static int test_dev_alloc(struct test_dev *dev, size_t size, u8 erased)
+{
+	memset(dev, '\0', sizeof(*dev));
+	dev->size = size;
+	dev->erased = erased;
+	dev->mem = malloc(size);
+	dev->want = malloc(size);
+	if (!dev->mem || !dev->want) {
+		free(dev->mem);
+		free(dev->want);
+		return -ENOMEM;
+	}
+	memset(dev->want, erased, size);
+
+	dev->info.blksz = TEST_DEV_BLKSZ;
+	dev->info.start = TEST_DEV_START;
+	dev->info.size = size / TEST_DEV_BLKSZ - TEST_DEV_START;
+	dev->info.priv = dev->mem;
+	dev->info.okay = test_okay;
+	dev->info.fail = test_fail;
+
+	return 0;
+}
+
+static void test_dev_free(struct test_dev *dev)
+{
+	free(dev->mem);
+	free(dev->want);
+}
+
+/* A device in RAM, where DONT_CARE blocks keep what was there before */
+static int test_ram_init(struct test_dev *dev, struct test_image *img)
+{
+	int ret;
+
+	ret = test_dev_alloc(dev, TEST_DEV_START * TEST_DEV_BLKSZ +
+			     img->out_len, TEST_ERASED);
+	if (ret)
+		return ret;
+	dev->info.write = test_ram_write;
+	dev->info.reserve = test_ram_reserve;
+	test_expand(dev->want + TEST_DEV_START * TEST_DEV_BLKSZ, TEST_ERASED);
+
+	return 0;
+}
+
+/*
+ * A NAND device, where the image skips the bad eraseblocks and FILL
+ * chunks of 0xff are left erased
+ */
+static int test_nand_init(struct test_dev *dev, struct test_image *img)
+{
+	lbaint_t pages = img->out_len / TEST_DEV_BLKSZ;
+	lbaint_t i, page;
+	u8 *out;
+	int ret;
+
+	ret = test_dev_alloc(dev, (TEST_DEV_START + pages) * TEST_DEV_BLKSZ +
+			     ARRAY_SIZE(test_nand_bad) * TEST_NAND_PAGES *
+			     TEST_DEV_BLKSZ, 0xff);
+	if (ret)
+		return ret;
+	dev->info.write = test_nand_write;
+	dev->info.reserve = test_nand_reserve;
+	dev->info.skip_erased = true;
+	dev->info.erased_val = 0xffffffff;
+
+	out = malloc(img->out_len);
+	if (!out) {
+		test_dev_free(dev);
+		return -ENOMEM;
+	}
+	test_expand(out, 0xff);
+	for (i = 0, page = TEST_DEV_START; i < pages; i++, page++) {
+		page = test_nand_skip(page);
+		memcpy(dev->want + page * TEST_DEV_BLKSZ,
+		       out + i * TEST_DEV_BLKSZ, TEST_DEV_BLKSZ);
+	}
+	free(out);
+
+	return 0;
+}
+
+/**
+ * Write an image to a fresh device in pieces of random size
+ *
+ * @param img		Image to write
+ * @param dev		Device to write to
+ * @param len		Number of bytes of the image to write
+ * @param max_piece	Largest piece to write, or 0 for all at once
+ * @param seed		Seed for the piece sizes
+ * @return result of sparse_stream_end()
+ */
+static int test_stream(struct test_image *img, struct test_dev *dev,
+		       size_t len, size_t max_piece, uint seed)
+{
+	struct sparse_stream *ss;
+	size_t ofs, part;
+
+	memset(dev->mem, dev->erased, dev->size);
+	test_response[0] = '\0';
+
+	ss = sparse_stream_start(&dev->info, "test");
+	if (!ss)
+		return -ENOMEM;
+	for (ofs = 0; ofs < len; ofs += part) {
+		part = max_piece ? 1 + test_rand(&seed) % max_piece : len;
+		part = min(part, len - ofs);
+		if (sparse_stream_write(ss, img->data + ofs, part))
+			break;
+	}
+
+	return sparse_stream_end(ss);
+}
+
+/* Pieces of any size give the same device contents */
+static int test_pieces(struct test_image *img, struct test_dev *dev,
+		       const char *name)
+{
+	static const size_t max_pieces[] = {
+		0, 1, 3, 17, 4096, 5000, 70000, 300000,
+	};
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(max_pieces); i++) {
+		ret = test_stream(img, dev, img->len, max_pieces[i], i);
+		if (ret || strcmp(test_response, "OKAY")) {
+			printf("%s: %s, pieces up to %zu: err %d '%s'\n",
+			       __func__, name, max_pieces[i], ret,
+			       test_response);
+			return -EINVAL;
+		}
+		if (memcmp(dev->mem, dev->want, dev->size)) {
+			printf("%s: %s, pieces up to %zu: wrong contents\n",
+			       __func__, name, max_pieces[i]);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/* A CRC32 chunk or image checksum which does not match is an error */
+static int test_bad_crc(struct test_image *img, struct test_dev *dev)
+{
+	sparse_header_t *hdr = (sparse_header_t *)img->data;
+	__le32 *crc = (__le32 *)(img->data + img->crc_ofs);
+	int ret = 0;
+
+	*crc ^= cpu_to_le32(1);
+	if (test_stream(img, dev, img->len, 100, 1) != -EBADMSG ||
+	    strcmp(test_response, "FAILsparse image CRC32 mismatch")) {
+		printf("%s: bad CRC32 chunk gave '%s'\n", __func__,
+		       test_response);
+		ret = -EINVAL;
+	}
+	*crc ^= cpu_to_le32(1);
+
+	hdr->image_checksum ^= cpu_to_le32(1);
+	if (test_stream(img, dev, img->len, 100, 2) != -EBADMSG ||
+	    strcmp(test_response, "FAILsparse image checksum mismatch")) {
+		printf("%s: bad image checksum gave '%s'\n", __func__,
+		       test_response);
+		ret = -EINVAL;
+	}
+	hdr->image_checksum ^= cpu_to_le32(1);
+
+	return ret;
+}
+
+/* An image which stops short is an error, wherever it stops */
+static int test_truncated(struct test_image *img, struct test_dev *dev)
+{
+	static const size_t cut[] = {
+		1, 4, 16, 4096 + 4 + 12, 4096 * 300,
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cut); i++) {
+		if (test_stream(img, dev, img->len - cut[i], 1000, i) !=
+		    -EINVAL ||
+		    strcmp(test_response, "FAILsparse image write failure")) {
+			printf("%s: %zu bytes short gave '%s'\n", __func__,
+			       cut[i], test_response);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int do_ut_sparse(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct test_image img;
+	struct test_dev ram, nand;
+	int ret = 0;
+
+	if (test_build(&img))
+		return CMD_RET_FAILURE;
+	if (test_ram_init(&ram, &img)) {
+		free(img.data);
+		return CMD_RET_FAILURE;
+	}
+	if (test_nand_init(&nand, &img)) {
+		test_dev_free(&ram);
+		free(img.data);
+		return CMD_RET_FAILURE;
+	}
+
+	ret |= test_pieces(&img, &ram, "RAM");
+	ret |= test_pieces(&img, &nand, "NAND");
+	ret |= test_bad_crc(&img, &ram);
+	ret |= test_truncated(&img, &ram);
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	test_dev_free(&nand);
+	test_dev_free(&ram);
+	free(img.data);
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}